@@ -418,6 +418,10 @@ struct callback_data {
   sqlite3 *db;           /* The database */
   int echoOn;            /* True to echo input commands */
   int statsOn;           /* True to display memory stats before each finalize */
+  int opseqOn;           /* True to record VDBE instruction sequences */
+  int nOpSeq;            /* Number of sequences recorded in aOpSeq[] */
+  int nOpSeqSlot;        /* Number of slots in aOpSeq[].  A power of 2 */
+  struct OpSeq *aOpSeq;  /* Hash table of sequences recorded by .opseq */
   int cnt;               /* Number of records displayed so far */
   FILE *out;             /* Write results here */
   FILE *traceOut;        /* Output for sqlite3_trace() */
@@ -1116,6 +1120,137 @@ static int display_stats(
   return 0;
 }
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+/*
+** A sequence of adjacent VM instructions recorded by .opseq, and the
+** number of times it has run.
+*/
+struct OpSeq {
+  char *zSeq;            /* Opcode names separated by spaces */
+  sqlite3_int64 n;       /* Number of times the sequence has run */
+};
+
+/*
+** Add n to the count for instruction sequence zSeq in the .opseq totals.
+*/
+static void opseq_add(struct callback_data *p, const char *zSeq, sqlite3_int64 n){
+  unsigned int h = 0;
+  const char *z;
+  int i;
+  if( p->nOpSeq*2>=p->nOpSeqSlot ){
+    /* Keep the table no more than half full */
+    int nNew = p->nOpSeqSlot ? p->nOpSeqSlot*2 : 256;
+    struct OpSeq *aNew = calloc(nNew, sizeof(struct OpSeq));
+    if( aNew==0 ) return;
+    for(i=0; i<p->nOpSeqSlot; i++){
+      struct OpSeq *pOld = &p->aOpSeq[i];
+      int j;
+      if( pOld->zSeq==0 ) continue;
+      for(h=0, z=pOld->zSeq; *z; z++) h = (h<<3) ^ h ^ (unsigned char)*z;
+      for(j=h&(nNew-1); aNew[j].zSeq; j=(j+1)&(nNew-1)){}
+      aNew[j] = *pOld;
+    }
+    free(p->aOpSeq);
+    p->aOpSeq = aNew;
+    p->nOpSeqSlot = nNew;
+  }
+  for(h=0, z=zSeq; *z; z++) h = (h<<3) ^ h ^ (unsigned char)*z;
+  for(i=h&(p->nOpSeqSlot-1); p->aOpSeq[i].zSeq; i=(i+1)&(p->nOpSeqSlot-1)){
+    if( strcmp(p->aOpSeq[i].zSeq, zSeq)==0 ) break;
+  }
+  if( p->aOpSeq[i].zSeq==0 ){
+    p->aOpSeq[i].zSeq = sqlite3_mprintf("%s", zSeq);
+    if( p->aOpSeq[i].zSeq==0 ) return;
+    p->nOpSeq++;
+  }
+  p->aOpSeq[i].n += n;
+}
+
+/*
+** Discard all sequences recorded by .opseq.
+*/
+static void opseq_clear(struct callback_data *p){
+  int i;
+  for(i=0; i<p->nOpSeqSlot; i++){
+    sqlite3_free(p->aOpSeq[i].zSeq);
+  }
+  free(p->aOpSeq);
+  p->aOpSeq = 0;
+  p->nOpSeq = 0;
+  p->nOpSeqSlot = 0;
+}
+
+/*
+** Add the sequences of two and three adjacent VM instructions run by
+** prepared statement pStmt to the .opseq totals.  pStmt must have been
+** profiled using sqlite3_stmt_profile().
+**
+** Only per-instruction execution counts are available, so the count for
+** a sequence is taken to be the smallest count of any instruction in it.
+** This overstates sequences whose second instruction is also reached by
+** a jump, but is good enough to show which sequences dominate a workload.
+*/
+static void opseq_record(struct callback_data *p, sqlite3_stmt *pStmt){
+  const char *azOp[3];         /* Opcodes of the last three instructions */
+  sqlite3_int64 anExec[3];     /* Execution counts of the same */
+  char zSeq[100];
+  int i;
+  for(i=0; sqlite3_stmt_profile_op(pStmt, i, &azOp[i%3], &anExec[i%3], 0)
+                 ==SQLITE_OK; i++){
+    const char *z0 = azOp[i%3];
+    const char *z1 = azOp[(i+2)%3];
+    const char *z2 = azOp[(i+1)%3];
+    sqlite3_int64 n;
+    if( z0==0 ) return;
+    if( i<1 ) continue;
+    n = anExec[(i+2)%3]<anExec[i%3] ? anExec[(i+2)%3] : anExec[i%3];
+    if( n<=0 ) continue;
+    sqlite3_snprintf(sizeof(zSeq), zSeq, "%s %s", z1, z0);
+    opseq_add(p, zSeq, n);
+    if( i<2 ) continue;
+    if( anExec[(i+1)%3]<n ) n = anExec[(i+1)%3];
+    if( n<=0 ) continue;
+    sqlite3_snprintf(sizeof(zSeq), zSeq, "%s %s %s", z2, z1, z0);
+    opseq_add(p, zSeq, n);
+  }
+}
+
+/*
+** Comparison function used to sort .opseq output by decreasing count.
+*/
+static int opseq_compare(const void *pA, const void *pB){
+  sqlite3_int64 nA = (*(struct OpSeq**)pA)->n;
+  sqlite3_int64 nB = (*(struct OpSeq**)pB)->n;
+  return nA<nB ? 1 : (nA>nB ? -1 : 0);
+}
+
+/*
+** Print the nShow most frequently run instruction sequences recorded
+** by opseq_record().
+*/
+static void opseq_report(struct callback_data *p, int nShow){
+  struct OpSeq **apSeq;
+  int i, j;
+  if( p->nOpSeq==0 ){
+    fprintf(stderr, "Error: no instruction sequences have been recorded\n");
+    return;
+  }
+  apSeq = malloc(p->nOpSeq*sizeof(apSeq[0]));
+  if( apSeq==0 ){
+    fprintf(stderr, "Error: out of memory\n");
+    return;
+  }
+  for(i=j=0; i<p->nOpSeqSlot; i++){
+    if( p->aOpSeq[i].zSeq ) apSeq[j++] = &p->aOpSeq[i];
+  }
+  qsort(apSeq, j, sizeof(apSeq[0]), opseq_compare);
+  for(i=0; i<j && i<nShow; i++){
+    fprintf(p->out, "%12lld  %s\n", apSeq[i]->n, apSeq[i]->zSeq);
+  }
+  free(apSeq);
+}
+#endif /* SQLITE_OMIT_OPCODE_PROFILE */
+
 /*
 ** Execute a statement or set of statements.  Print 
 ** any result rows/columns depending on the current mode 
@@ -1162,6 +1297,13 @@ static int shell_exec(
         pArg->cnt = 0;
       }
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+      /* profile each instruction if .opseq is on */
+      if( pArg && pArg->opseqOn ){
+        sqlite3_stmt_profile(pStmt, 1);
+      }
+#endif
+
       /* echo the sql statement if echo on */
       if( pArg && pArg->echoOn ){
         const char *zStmtSql = sqlite3_sql(pStmt);
@@ -1239,6 +1381,13 @@ static int shell_exec(
         display_stats(db, pArg, 0);
       }
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+      /* add this statement's instruction sequences to the .opseq totals */
+      if( pArg && pArg->opseqOn ){
+        opseq_record(pArg, pStmt);
+      }
+#endif
+
       /* Finalize the statement just executed. If this fails, save a 
       ** copy of the error message. Otherwise, set zSql to point to the
       ** next statement to execute. */
@@ -1437,6 +1586,11 @@ static char zHelp[] =
   "                         tabs     Tab-separated values\n"
   "                         tcl      TCL list elements\n"
   ".nullvalue STRING      Use STRING in place of NULL values\n"
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+  ".opseq ON|OFF          Record VM instruction sequences run by each statement\n"
+  ".opseq report ?N?      Show the N most frequent sequences (default 20)\n"
+  ".opseq reset           Discard all recorded sequences\n"
+#endif
   ".output FILENAME       Send output to FILENAME\n"
   ".output stdout         Send output to the screen\n"
   ".print STRING...       Print literal STRING\n"
@@ -2272,6 +2426,19 @@ static int do_meta_command(char *zLine, struct callback_data *p){
                      "%.*s", (int)ArraySize(p->nullvalue)-1, azArg[1]);
   }else
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+  if( c=='o' && n>1 && strncmp(azArg[0], "opseq", n)==0 && nArg>1 && nArg<4 ){
+    open_db(p);
+    if( strcmp(azArg[1], "report")==0 ){
+      opseq_report(p, nArg==3 ? atoi(azArg[2]) : 20);
+    }else if( strcmp(azArg[1], "reset")==0 && nArg==2 ){
+      opseq_clear(p);
+    }else{
+      p->opseqOn = booleanValue(azArg[1]);
+    }
+  }else
+#endif
+
   if( c=='o' && strncmp(azArg[0], "output", n)==0 && nArg==2 ){
     if( p->outfile[0]=='|' ){
       pclose(p->out);
@@ -912,6 +912,18 @@ struct sqlite3_io_methods {
 ** can be queried by passing in a pointer to a negative number.  This
 ** file-control is used internally to implement [PRAGMA mmap_size].
 **
+** <li>[[SQLITE_FCNTL_PREFETCH]]
+** The [SQLITE_FCNTL_PREFETCH] file control is a hint sent by SQLite to
+** the VFS when it expects to read a range of the database file in the
+** near future.  The argument is a pointer to an array of two values of
+** type sqlite3_int64: the byte offset of the range and its size.  A VFS
+** may begin reading the range asynchronously, or may ignore the hint.
+** The file control never fails and the range is never read
+** synchronously on behalf of the hint.  Its opcode is taken from the
+** range starting at 1000, which upstream SQLite leaves unused, so that a
+** VFS built against the headers of a later release never mistakes it
+** for one of the standard file controls.
+**
 ** </ul>
 */
 #define SQLITE_FCNTL_LOCKSTATE               1
@@ -931,6 +943,7 @@ struct sqlite3_io_methods {
 #define SQLITE_FCNTL_BUSYHANDLER            15
 #define SQLITE_FCNTL_TEMPFILENAME           16
 #define SQLITE_FCNTL_MMAP_SIZE              18
+#define SQLITE_FCNTL_PREFETCH             1000
 
 /*
 ** CAPI3REF: Mutex Handle
@@ -3132,6 +3145,161 @@ SQLITE_API int sqlite3_prepare16_v2(
   const void **pzTail     /* OUT: Pointer to unused portion of zSql */
 );
 
+/*
+** CAPI3REF: Prepared Statement Cache
+**
+** ^The sqlite3_stmt_cache(D,N) interface enables a cache of up to N
+** compiled statements on [database connection] D, or disables it if N
+** is zero.  ^While the cache is enabled, [sqlite3_finalize()] on a
+** statement created by [sqlite3_prepare_v2()] or [sqlite3_prepare16_v2()]
+** resets the statement, clears its bindings and keeps it in the cache
+** instead of deleting it.  ^A later call to one of those interfaces with
+** the same SQL text returns the cached statement without compiling it
+** again.  ^When more than N statements are cached, the one that has been
+** cached longest is deleted.  ^Statements that have been invalidated by a
+** schema change or by any other event that causes a re-prepare are
+** never returned from the cache.
+**
+** ^The SQL text must match byte for byte.  ^A statement prepared from the
+** start of a string containing several statements is only found again
+** by a call that passes the same string.  ^Statements whose query plan
+** depends on the values bound to their parameters, as when SQLite is
+** compiled with SQLITE_ENABLE_STAT3, are never cached.
+**
+** ^Cached statements do not count as unfinalized statements of the
+** connection.  ^They are not returned by [sqlite3_next_stmt()], and they
+** are deleted when the connection is closed, so they never cause
+** [sqlite3_close()] to return SQLITE_BUSY.
+**
+** ^Reducing N deletes cached statements as needed.  ^Hit and miss counts
+** are available through [SQLITE_DBSTATUS_STMTCACHE_HIT] and
+** [SQLITE_DBSTATUS_STMTCACHE_MISS].
+**
+** This interface is omitted if SQLite is compiled with
+** SQLITE_OMIT_STMT_CACHE.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_stmt_cache(sqlite3*, int N);
+
+/*
+** CAPI3REF: Parallel Table Scans
+**
+** ^The sqlite3_parallel_scan(D,N) interface allows [database connection]
+** D to use up to N threads for some aggregate queries without a GROUP BY
+** clause, such as "SELECT count(*), sum(x) FROM t WHERE y>?".  ^Only a
+** query that reads a single table, evaluates only the built-in count(),
+** sum(), total(), avg(), min() and max() aggregate functions on its
+** columns, and whose WHERE clause, if any, is an AND of at most eight
+** comparisons between an unindexed column and a constant qualifies.  ^The
+** table is divided into ranges of rowids, each scanned on its own thread
+** by a separate read-only connection to the same database file, and the
+** partial results are combined at the end.  ^An N of 0 or 1 disables
+** parallel scans, which is the default.
+**
+** ^A scan is only divided if the table is large, the database is an
+** ordinary file in rollback journal mode, not in shared cache mode, and
+** connection D has no write transaction open on it.  ^If another thread
+** cannot obtain a read lock, connection D scans that range itself.
+** ^The worker connections are kept open between scans, up to N-1 of
+** them, and are closed when N is reduced or connection D is closed.
+**
+** ^All other queries are never divided.  ^This includes every query with
+** a GROUP BY clause, every aggregate query with any other kind of WHERE
+** clause, and every query that returns table rows.  ^The rows of those
+** queries are processed by the bytecode program of the statement, which
+** runs only on the thread that calls [sqlite3_step()].
+**
+** ^Under the same conditions, [PRAGMA integrity_check] on connection D
+** checks the b-trees of the database on up to N threads at a time, using
+** the same worker connections.  ^The report is the same as that of a
+** check on a single thread: a b-tree whose result could differ, for
+** example because it shares a page with another, is checked again by
+** connection D in the usual order.
+**
+** ^Because the rows are not summed in order, the result of sum(), total()
+** or avg() over floating point values may differ in the last digits from
+** that of a serial scan.  ^Likewise sum() reports an integer overflow
+** whenever the total of one range overflows, which may differ from the
+** serial behavior if intermediate sums overflow but the final one does
+** not.
+**
+** Threads are only used if SQLite is compiled threadsafe and not
+** configured with [SQLITE_CONFIG_SINGLETHREAD].  This interface is
+** omitted if SQLite is compiled with SQLITE_OMIT_PARALLEL_SCAN or
+** SQLITE_OMIT_BATCH_AGGREGATE.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_parallel_scan(sqlite3*, int N);
+
+/*
+** CAPI3REF: Correlated Subquery Result Cache
+**
+** ^The sqlite3_subquery_cache(D,N) interface allows each correlated
+** scalar or EXISTS subquery in statements subsequently prepared on
+** [database connection] D to remember up to N of its results, as in
+** "SELECT a, (SELECT max(y) FROM t2 WHERE t2.x=t1.b) FROM t1".  ^When the
+** outer query reaches a row whose values for the outer columns the
+** subquery refers to are identical to those of a remembered result, that
+** result is reused instead of running the subquery again.  ^The least
+** recently used result is discarded when the cache is full.  ^An N of 0
+** disables the cache, which is the default.  ^N is limited to 100000.
+** ^Statements already prepared keep the setting they were prepared with.
+**
+** ^Cached results are discarded when the statement is reset or finalized.
+** ^The cache is bypassed while running statements that write to the
+** database, since the subquery may see their changes.  ^Subqueries that
+** read virtual tables or call a built-in function whose result may differ
+** between calls with the same arguments or that has side effects, such
+** as random(), changes(), load_extension() or any of the date and time
+** functions, which may read the current time, are never cached.
+**
+** ^SQLite cannot tell whether an
+** [application-defined SQL functions | application-defined SQL function]
+** depends on anything but its arguments, so every such function is
+** treated as if it did not.  By enabling the cache, the application
+** vouches that each application-defined function called from a
+** correlated subquery returns the same result for the same arguments
+** and has no side effects that the query relies on.  Applications that
+** cannot make that promise must leave the cache disabled.
+**
+** This interface is omitted if SQLite is compiled with
+** SQLITE_OMIT_SUBQUERY_CACHE or SQLITE_OMIT_SUBQUERY.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_subquery_cache(sqlite3*, int N);
+
+/*
+** CAPI3REF: Lazy Schema Loading
+**
+** ^The sqlite3_lazy_schema(D,B) interface enables lazy loading of the
+** schema of the main database and any attached databases of
+** [database connection] D if B is non-zero, and disables it if B is zero.
+** ^Databases attached afterwards inherit the setting of the main
+** database.  ^The setting takes effect the next time a schema is read
+** from the database file, so it is normally made right after the
+** connection is opened.
+**
+** ^When a schema is loaded lazily, the CREATE TABLE statement of each
+** ordinary table and the CREATE INDEX statements of its indexes are not
+** parsed when the schema is read.  ^They are parsed the first time a
+** statement that refers to the table or to one of its indexes is
+** prepared.  ^Views, triggers, virtual tables, tables with FOREIGN KEY
+** constraints and the internal sqlite_ tables are parsed when the schema
+** is read, as are the tables that a view or trigger refers to when that
+** view or trigger is parsed.  ^Statements that need every table, such
+** as [ANALYZE] of a whole database, [REINDEX] and
+** [PRAGMA integrity_check], parse any tables that are still pending.
+**
+** When several connections share a cache ([sqlite3_enable_shared_cache()]),
+** they also share a schema, and a table parsed by one connection is
+** seen by all of them.  The setting of the last connection to change it
+** applies to the shared schema.
+**
+** ^The memory used to hold the text of tables that have not been parsed
+** is included in [SQLITE_DBSTATUS_SCHEMA_USED].
+**
+** This interface is omitted if SQLite is compiled with
+** SQLITE_OMIT_LAZY_SCHEMA.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_lazy_schema(sqlite3*, int B);
+
 /*
 ** CAPI3REF: Retrieving Statement SQL
 **
@@ -3421,6 +3589,73 @@ SQLITE_API int sqlite3_bind_parameter_index(sqlite3_stmt*, const char *zName);
 */
 SQLITE_API int sqlite3_clear_bindings(sqlite3_stmt*);
 
+/*
+** CAPI3REF: Binding Arrays Of Values And Batched Execution
+**
+** ^The sqlite3_bind_array(S,I,T,A,N,R) interface binds an array of R
+** values to the I-th parameter of [prepared statement] S, so that the
+** statement can be run once for each element of the array by a single
+** call to sqlite3_step_batch().  ^The type code T determines the format
+** of array A:
+**
+** <ul>
+** <li> [SQLITE_INTEGER]: A is an array of sqlite3_int64.
+** <li> [SQLITE_FLOAT]: A is an array of double.
+** <li> [SQLITE_TEXT]: A is an array of pointers to UTF-8 text.
+** <li> [SQLITE_BLOB]: A is an array of pointers to BLOB content.
+** </ul>
+**
+** ^Array N, which may be NULL except for BLOBs, holds one integer per
+** row.  ^For TEXT and BLOB arrays it is the size of the value in bytes;
+** a negative size for TEXT means the text is zero-terminated.  ^A
+** negative size for a BLOB is an error: sqlite3_step_batch() stops at
+** that row and returns SQLITE_MISUSE.  ^For INTEGER and FLOAT arrays a
+** negative entry binds NULL to that row.
+** ^A NULL pointer in a TEXT or BLOB array also binds NULL.  ^The arrays
+** are not copied.  The application must keep them unchanged until the
+** parameter is rebound, the bindings are cleared, or the statement is
+** finalized.  ^Binding an ordinary value to a parameter replaces any
+** array bound to it.  Parameters that are not bound to arrays keep their
+** ordinary value for every row.
+**
+** ^The sqlite3_step_batch(S,R,E) interface runs statement S once for each
+** of the first R rows of its bound arrays.  All rows are executed by a
+** single activation of the virtual machine, and the statement is reset
+** once at the end, ready for the next batch.  ^Any rows of results
+** produced by S are discarded.  ^In [autocommit mode], all rows of the
+** batch are part of a single transaction.
+**
+** ^A row that fails a constraint has no effect, unless the conflict
+** resolution algorithm is [ON CONFLICT | FAIL], and does not prevent the
+** remaining rows from running.  ^If E is not NULL, it must point to an
+** array of R integers, and E[i] is set to the result code of row i:
+** SQLITE_OK on success, an [extended result code] for a constraint
+** failure, or [SQLITE_ABORT] if the row was never run.
+**
+** ^sqlite3_step_batch() returns [SQLITE_DONE] if every row succeeded.
+** ^If all rows ran but some of them failed constraints, it returns the
+** result code of the first row to fail, and the changes made by the other
+** rows stand.  ^Any other error, including a constraint failure using the
+** [ON CONFLICT | ROLLBACK] algorithm, abandons the batch, and the error
+** code is returned as [sqlite3_step()] would return it.  ^It is an error
+** (SQLITE_RANGE) to ask for more rows than were bound to any array, and
+** SQLITE_MISUSE to call sqlite3_step_batch() on a statement that has been
+** stepped but not reset.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_bind_array(
+  sqlite3_stmt*,
+  int iParam,
+  int eType,
+  const void *aValue,
+  const int *anByte,
+  int nRow
+);
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_step_batch(
+  sqlite3_stmt*,
+  int nRow,
+  int *aRowRc
+);
+
 /*
 ** CAPI3REF: Number Of Columns In A Result Set
 **
@@ -3849,6 +4084,126 @@ SQLITE_API const void *sqlite3_column_text16(sqlite3_stmt*, int iCol);
 SQLITE_API int sqlite3_column_type(sqlite3_stmt*, int iCol);
 SQLITE_API sqlite3_value *sqlite3_column_value(sqlite3_stmt*, int iCol);
 
+/*
+** CAPI3REF: Fetching Many Rows Into Column Buffers
+**
+** ^The sqlite3_fetch_batch(S,N,C,K,P) interface steps [prepared statement]
+** S up to N times and stores the first K columns of each row it produces
+** in the caller-supplied buffers C[0] through C[K-1], one
+** sqlite3_fetch_column object per column.  ^The number of rows stored is
+** written to *P.  This has the same effect as calling [sqlite3_step()]
+** and the [sqlite3_column_int64 | sqlite3_column()] routines for every row
+** and column, but without the overhead of one interface call per value.
+**
+** ^The eType field of each sqlite3_fetch_column selects the format the
+** column is converted to, using the same conversions as the
+** sqlite3_column() routines:
+**
+** <ul>
+** <li> [SQLITE_INTEGER]: aValue is an array of N sqlite3_int64.
+** <li> [SQLITE_FLOAT]: aValue is an array of N doubles.
+** <li> [SQLITE_TEXT] or [SQLITE_BLOB]: aValue is an array of N+1 ints.
+**      The content of row i is stored in zArena[] starting at offset
+**      aValue[i] and ending just before offset aValue[i+1].  ^Text is
+**      UTF-8 and is not zero-terminated.
+** <li> [SQLITE_NULL]: the column is skipped.
+** </ul>
+**
+** ^Any other eType, a NULL aValue for a column that is not skipped, or a
+** negative nArena causes sqlite3_fetch_batch() to return [SQLITE_MISUSE]
+** without stepping the statement.
+**
+** ^If aNull is not NULL, it must point to an array of (N+7)/8 bytes.  Bit
+** (i&7) of byte aNull[i/8] is set if the value of the column in row i is
+** NULL and cleared otherwise.  ^NULL values are stored as 0, 0.0 or an
+** empty string.  ^Before returning, nArenaUsed is set to the number of
+** bytes of zArena[] in use.
+**
+** ^sqlite3_fetch_batch() returns [SQLITE_ROW] if it stopped because N
+** rows were fetched or because the next row would not fit in a zArena[]
+** buffer.  Call it again to continue.  ^In the second case the row that did
+** not fit is kept, and it is the first row stored by the next call.
+** ^If the row does not fit even in empty buffers, [SQLITE_TOOBIG] is
+** returned and the row is again kept, so the call can be retried with
+** larger buffers.  ^[SQLITE_DONE] is returned when the statement has
+** finished, and any other value is the error code that [sqlite3_step()]
+** would have returned.  ^The rows stored before an error or SQLITE_DONE
+** are valid and are counted in *P.
+*/
+typedef struct sqlite3_fetch_column sqlite3_fetch_column;
+struct sqlite3_fetch_column {
+  int eType;               /* SQLITE_INTEGER, FLOAT, TEXT, BLOB or NULL */
+  void *aValue;            /* Values, or TEXT and BLOB offsets */
+  unsigned char *aNull;    /* NULL bitmap, or NULL */
+  char *zArena;            /* Space for TEXT and BLOB content */
+  int nArena;              /* Size of zArena[] in bytes */
+  int nArenaUsed;          /* OUT: Bytes of zArena[] used */
+};
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_fetch_batch(
+  sqlite3_stmt*,
+  int nRow,
+  sqlite3_fetch_column *aCol,
+  int nCol,
+  int *pnFetched
+);
+
+/*
+** CAPI3REF: Zero-Copy Column Values
+**
+** ^The sqlite3_stmt_zerocopy(S,X) interface enables (X>0) or disables
+** (X==0) zero-copy column access for [prepared statement] S.  ^If X is
+** negative, the current setting is returned without changing it.  ^The
+** return value is the new setting.  ^Zero-copy access can only be enabled
+** for statements that do not write to the database (see
+** [sqlite3_stmt_readonly()]).  ^For other statements, the request is
+** ignored and 0 is returned.
+**
+** ^While zero-copy access is enabled, TEXT and BLOB result values that
+** are read directly from a table or index, and that do not spill onto
+** overflow pages, are not copied out of the database page.
+** ^[sqlite3_column_blob()] returns a pointer into the page cache, or into
+** the memory-mapped file, for such values.  This is true even for TEXT
+** values, so calling sqlite3_column_blob() and then
+** [sqlite3_column_bytes()] reads text without copying it.
+**
+** ^A borrowed value is not zero-terminated.  [sqlite3_column_text()] and
+** the other text-returning routines must return zero-terminated text, so
+** they copy a borrowed value into memory owned by the statement the first
+** time they are called for it.  Zero-copy access therefore saves nothing
+** for applications that read text with sqlite3_column_text().  Such
+** applications should use [sqlite3_column_text_nocopy()] instead.
+**
+** The pointers returned are valid only until the next call to
+** [sqlite3_step()], [sqlite3_reset()] or [sqlite3_finalize()] on S.  They
+** also become invalid if the database is modified, by S's connection or
+** any other, while they are held.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_stmt_zerocopy(sqlite3_stmt*, int onoff);
+
+/*
+** CAPI3REF: Unterminated Column Text
+**
+** ^The sqlite3_column_text_nocopy(S,I,N) interface returns the text of
+** column I of the current result row of [prepared statement] S as UTF-8
+** and writes its length in bytes to *N, if N is not NULL.  ^Unlike
+** [sqlite3_column_text()], the text returned is not necessarily
+** zero-terminated.  ^A UTF-8 TEXT value is returned as it is stored,
+** which for a value borrowed by [sqlite3_stmt_zerocopy | zero-copy
+** access] means a pointer into the database page, with no copy.  ^Other
+** values are converted exactly as by sqlite3_column_text(), and in that
+** case the text is zero-terminated.  ^NULL is returned for an SQL NULL.
+**
+** The pointer returned is valid for as long as one returned by
+** sqlite3_column_text() would be, and for a borrowed value no longer
+** than described for [sqlite3_stmt_zerocopy()].  This interface is
+** omitted if SQLite is compiled with SQLITE_OMIT_ZEROCOPY.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL const char *sqlite3_column_text_nocopy(
+  sqlite3_stmt*,
+  int iCol,
+  int *pnByte
+);
+
 /*
 ** CAPI3REF: Destroy A Prepared Statement Object
 **
@@ -5165,6 +5520,23 @@ SQLITE_API int sqlite3_cancel_auto_extension(void (*xEntryPoint)(void));
 */
 SQLITE_API void sqlite3_reset_auto_extension(void);
 
+/*
+** CAPI3REF: Discard Cached Schema Snapshots
+**
+** ^When a database connection loads the schema of a database file, SQLite
+** keeps a process-wide snapshot of the parsed schema so that the next
+** connection that opens the same file with the same schema can skip
+** parsing the CREATE statements in sqlite_master.  ^This interface
+** discards every snapshot and releases the memory that they use.
+** ^Snapshots that are being read by a connection loading its schema are
+** freed once that connection is finished with them.
+**
+** Applications that need all memory to be released should call this
+** routine before [sqlite3_shutdown()].  ^Snapshots are not used and no
+** memory is held if SQLite is compiled with SQLITE_OMIT_SCHEMA_SNAPSHOT.
+*/
+SQLITE_API void sqlite3_reset_schema_snapshots(void);
+
 /*
 ** The interface to the virtual-table mechanism is currently considered
 ** to be experimental.  The interface might change in incompatible ways.
@@ -6200,6 +6572,11 @@ SQLITE_API int sqlite3_db_status(sqlite3*, int op, int *pCur, int *pHiwtr, int r
 ** The [sqlite3_db_status()] interface will return a non-zero error code
 ** if a discontinued or unsupported verb is invoked.
 **
+** The verbs that are not part of upstream SQLite, starting with
+** SQLITE_DBSTATUS_DEFRAG_FULL, are numbered from 1000 so that they never
+** collide with a verb added by a later upstream release.
+** [SQLITE_DBSTATUS_MAX] is the largest of the other verbs.
+**
 ** <dl>
 ** [[SQLITE_DBSTATUS_LOOKASIDE_USED]] ^(<dt>SQLITE_DBSTATUS_LOOKASIDE_USED</dt>
 ** <dd>This parameter returns the number of lookaside memory slots currently
@@ -6275,6 +6652,39 @@ SQLITE_API int sqlite3_db_status(sqlite3*, int op, int *pCur, int *pHiwtr, int r
 ** all foreign key constraints (deferred or immediate) have been
 ** resolved.)^  ^The highwater mark is always 0.
 ** </dd>
+**
+** [[SQLITE_DBSTATUS_DEFRAG_FULL]] ^(<dt>SQLITE_DBSTATUS_DEFRAG_FULL</dt>
+** <dd>This parameter returns the number of b-tree pages that had to be
+** rebuilt from scratch to gather their free space together.)^  ^The
+** highwater mark associated with SQLITE_DBSTATUS_DEFRAG_FULL is always 0.
+** </dd>
+**
+** [[SQLITE_DBSTATUS_DEFRAG_INPLACE]] ^(<dt>SQLITE_DBSTATUS_DEFRAG_INPLACE</dt>
+** <dd>This parameter returns the number of b-tree pages whose free space
+** was gathered together by moving only the cells above one or two free
+** blocks.)^  ^The highwater mark associated with
+** SQLITE_DBSTATUS_DEFRAG_INPLACE is always 0.
+** </dd>
+**
+** [[SQLITE_DBSTATUS_STMTCACHE_HIT]] ^(<dt>SQLITE_DBSTATUS_STMTCACHE_HIT</dt>
+** <dd>This parameter returns the number of calls to [sqlite3_prepare_v2()]
+** that were satisfied from the [sqlite3_stmt_cache | statement cache].)^
+** ^The highwater mark associated with SQLITE_DBSTATUS_STMTCACHE_HIT is
+** always 0.
+** </dd>
+**
+** [[SQLITE_DBSTATUS_STMTCACHE_MISS]] ^(<dt>SQLITE_DBSTATUS_STMTCACHE_MISS</dt>
+** <dd>This parameter returns the number of calls to [sqlite3_prepare_v2()]
+** that had to compile a statement while the statement cache was
+** enabled.)^ ^The highwater mark associated with
+** SQLITE_DBSTATUS_STMTCACHE_MISS is always 0.
+** </dd>
+**
+** [[SQLITE_DBSTATUS_STMTCACHE_USED]] ^(<dt>SQLITE_DBSTATUS_STMTCACHE_USED</dt>
+** <dd>This parameter returns the number of statements currently held in
+** the statement cache.)^  ^The highwater mark is the size limit set by
+** [sqlite3_stmt_cache()].
+** </dd>
 ** </dl>
 */
 #define SQLITE_DBSTATUS_LOOKASIDE_USED       0
@@ -6289,6 +6699,11 @@ SQLITE_API int sqlite3_db_status(sqlite3*, int op, int *pCur, int *pHiwtr, int r
 #define SQLITE_DBSTATUS_CACHE_WRITE          9
 #define SQLITE_DBSTATUS_DEFERRED_FKS        10
 #define SQLITE_DBSTATUS_MAX                 10   /* Largest defined DBSTATUS */
+#define SQLITE_DBSTATUS_DEFRAG_FULL       1000
+#define SQLITE_DBSTATUS_DEFRAG_INPLACE    1001
+#define SQLITE_DBSTATUS_STMTCACHE_HIT     1002
+#define SQLITE_DBSTATUS_STMTCACHE_MISS    1003
+#define SQLITE_DBSTATUS_STMTCACHE_USED    1004
 
 
 /*
@@ -6358,6 +6773,66 @@ SQLITE_API int sqlite3_stmt_status(sqlite3_stmt*, int op,int resetFlg);
 #define SQLITE_STMTSTATUS_AUTOINDEX         3
 #define SQLITE_STMTSTATUS_VM_STEP           4
 
+/*
+** CAPI3REF: Per-Instruction Profiling Of Prepared Statements
+**
+** ^The sqlite3_stmt_profile(S,X) interface enables (X>0) or disables (X==0)
+** the collection of execution counts and elapsed clock ticks for each
+** virtual machine instruction of [prepared statement] S.  ^If X is
+** negative, the interface returns true if profiling is currently enabled
+** for S and false otherwise.
+**
+** ^Enabling profiling on a statement for which it is already enabled
+** resets the collected statistics to zero.  ^Statistics cannot be
+** discarded while the statement is running, so disabling profiling on a
+** statement that has been stepped but not [sqlite3_reset()] returns
+** SQLITE_BUSY.  ^Statistics survive an automatic re-prepare of the
+** statement but are reset to zero by it, since the program changes.
+** Instructions of trigger programs are not profiled individually.
+**
+** ^The first time profiling is enabled for a statement on a
+** [database connection], the "stmt_profile" [virtual table] module is
+** registered with that connection.  Each row of a stmt_profile table
+** describes one instruction of one profiled statement, with columns
+** "stmt", "sql", "addr", "opcode", "p1", "p2", "p3", "nexec" and "ncycle".
+** The "addr" and "opcode" columns correspond to those output by
+** [EXPLAIN], so the two can be joined.  The unit of "ncycle" is CPU
+** cycles where a cycle counter is available and the ticks of a
+** monotonic timer otherwise.
+**
+** This interface is omitted if SQLite is compiled with
+** SQLITE_OMIT_OPCODE_PROFILE.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_stmt_profile(sqlite3_stmt*, int onoff);
+
+/*
+** CAPI3REF: Reading Per-Instruction Statistics
+**
+** ^The sqlite3_stmt_profile_op(S,A,Z,N,C) interface reads the statistics
+** that [sqlite3_stmt_profile()] has collected for the instruction at
+** address A of [prepared statement] S, without the need for a
+** stmt_profile virtual table.  ^The name of the opcode is written to *Z,
+** the number of times the instruction has run to *N and the clock ticks
+** spent in it to *C.  ^Any of Z, N and C may be NULL.
+**
+** ^The return value is SQLITE_RANGE if A is not the address of an
+** instruction of S, and SQLITE_OK otherwise, so an application can read
+** a whole program by incrementing A from zero until SQLITE_RANGE is
+** returned.  ^The counts are zero if profiling is not enabled for S or
+** S has not run since it was enabled.  ^*Z is set to NULL if SQLite was
+** compiled without opcode names.
+**
+** This interface is omitted if SQLite is compiled with
+** SQLITE_OMIT_OPCODE_PROFILE.
+*/
+SQLITE_API SQLITE_EXPERIMENTAL int sqlite3_stmt_profile_op(
+  sqlite3_stmt*,          /* Profiled statement */
+  int iAddr,              /* Address of the instruction */
+  const char **pzOpcode,  /* OUT: Name of the opcode */
+  sqlite3_int64 *pnExec,  /* OUT: Number of times run */
+  sqlite3_int64 *pnCycle  /* OUT: Clock ticks spent in it */
+);
+
 /*
 ** CAPI3REF: Custom Page Cache Object
 **
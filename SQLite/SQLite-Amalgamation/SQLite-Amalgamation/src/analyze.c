@@ -1147,6 +1147,7 @@ static void analyzeDatabase(Parse *pParse, int iDb){
     iMem = pParse->nMem+1;
     iTab = pParse->nTab;
     assert( sqlite3SchemaMutexHeld(db, iDb, 0) );
+    sqlite3LazySchemaLoadAll(db, iDb);
     for(k=sqliteHashFirst(&pSchema->tblHash); k; k=sqliteHashNext(k)){
         Table *pTab = (Table*)sqliteHashData(k);
         analyzeOneTable(pParse, pTab, 0, iStatCur, iMem, iTab);
@@ -1326,6 +1327,11 @@ static int analysisLoader(void *pData, int argc, char **argv, char **NotUsed){
     if( argv==0 || argv[0]==0 || argv[2]==0 ){
         return 0;
     }
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+    if( sqlite3LazySchemaStat(pInfo->db, pInfo->zDatabase, argv) ){
+        return 0;
+    }
+#endif
     pTable = sqlite3FindTable(pInfo->db, argv[0], pInfo->zDatabase);
     if( pTable==0 ){
         return 0;
@@ -1350,6 +1356,20 @@ static int analysisLoader(void *pData, int argc, char **argv, char **NotUsed){
     return 0;
 }
 
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+/*
+ ** Apply a row of sqlite_stat1 for a table of database iDb that was set
+ ** aside by sqlite3AnalysisLoad() because the table had not been parsed
+ ** at the time.  argv[] is as for analysisLoader().
+ */
+SQLITE_PRIVATE void sqlite3AnalysisLoadRow(sqlite3 *db, int iDb, char **argv){
+    analysisInfo sInfo;
+    sInfo.db = db;
+    sInfo.zDatabase = db->aDb[iDb].zName;
+    analysisLoader(&sInfo, 3, argv, 0);
+}
+#endif
+
 /*
  ** If the Index.aSample variable is not NULL, delete the aSample[] array
  ** and its contents.
@@ -1609,6 +1629,9 @@ SQLITE_PRIVATE int sqlite3AnalysisLoad(sqlite3 *db, int iDb){
         pIdx->aSample = 0;
 #endif
     }
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+    sqlite3LazySchemaStat(db, db->aDb[iDb].zName, 0);
+#endif
     
     /* Check to make sure the sqlite_stat1 table exists */
     sInfo.db = db;
@@ -155,6 +155,11 @@ static void attachFunc(
                                      "attached databases must use the same text encoding as main database");
             rc = SQLITE_ERROR;
         }
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+        if( rc==SQLITE_OK && sqlite3LazySchemaEnabled(db->aDb[0].pSchema) ){
+            sqlite3LazySchemaEnable(aNew->pSchema, 1);
+        }
+#endif
         pPager = sqlite3BtreePager(aNew->pBt);
         sqlite3PagerLockingMode(pPager, db->dfltLockMode);
         sqlite3BtreeSecureDelete(aNew->pBt,
@@ -46,6 +46,18 @@ int sqlite3BtreeTrace=1;  /* True to enable tracing */
  */
 #define get2byteNotZero(X)  (((((int)get2byte(X))-1)&0xffff)+1)
 
+/*
+ ** Vector instructions used to search the decoded keys of intkey pages.
+ ** See btreeKeyCountLess().
+ */
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+# if defined(__SSE4_2__)
+#  include <nmmintrin.h>
+# elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+# endif
+#endif
+
 /*
  ** Values passed as the 5th argument to allocateBtreePage()
  */
@@ -1096,8 +1108,16 @@ static void ptrmapPutOvflPtr(MemPage *pPage, u8 *pCell, int *pRC){
  ** end of the page and all free space is collected into one
  ** big FreeBlk that occurs in between the header and cell
  ** pointer array and the cell content area.
+ **
+ ** If the page has no more than two freeblocks and no more than nMaxFrag
+ ** fragmented bytes, the freeblocks are closed up in place instead: the
+ ** cell content above each freeblock is slid towards the end of the page
+ ** with memmove() and the affected cell pointers adjusted.  This touches
+ ** only the bytes between the start of the cell content area and the
+ ** freeblocks, rather than copying the whole page out to temp space and
+ ** rebuilding it, but leaves any fragmented bytes where they are.
  */
-static int defragmentPage(MemPage *pPage){
+static int defragmentPage(MemPage *pPage, int nMaxFrag){
     int i;                     /* Loop counter */
     int pc;                    /* Address of a i-th cell */
     int hdr;                   /* Offset to the page header */
@@ -1117,17 +1137,70 @@ static int defragmentPage(MemPage *pPage){
     assert( pPage->pBt->usableSize <= SQLITE_MAX_PAGE_SIZE );
     assert( pPage->nOverflow==0 );
     assert( sqlite3_mutex_held(pPage->pBt->mutex) );
-    temp = sqlite3PagerTempSpace(pPage->pBt->pPager);
+    assert( nMaxFrag>=0 );
     data = pPage->aData;
     hdr = pPage->hdrOffset;
     cellOffset = pPage->cellOffset;
     nCell = pPage->nCell;
     assert( nCell==get2byte(&data[hdr+3]) );
     usableSize = pPage->pBt->usableSize;
+    iCellFirst = cellOffset + 2*nCell;
+    
+    if( (int)data[hdr+7]<=nMaxFrag ){
+        int iFree = get2byte(&data[hdr+1]);
+        int iFree2 = 0;
+        if( iFree>usableSize-4 ){
+            return SQLITE_CORRUPT_BKPT;
+        }
+        if( iFree ){
+            iFree2 = get2byte(&data[iFree]);
+            if( iFree2>usableSize-4 ){
+                return SQLITE_CORRUPT_BKPT;
+            }
+        }
+        if( iFree && (iFree2==0 || get2byte(&data[iFree2])==0) ){
+            int sz = get2byte(&data[iFree+2]);    /* Total bytes reclaimed */
+            int sz2 = 0;                          /* Size of second freeblock */
+            int top = get2byteNotZero(&data[hdr+5]);
+            if( top>=iFree ){
+                return SQLITE_CORRUPT_BKPT;
+            }
+            if( iFree2 ){
+                if( iFree+sz>iFree2 ){
+                    return SQLITE_CORRUPT_BKPT;
+                }
+                sz2 = get2byte(&data[iFree2+2]);
+                if( iFree2+sz2>usableSize ){
+                    return SQLITE_CORRUPT_BKPT;
+                }
+                memmove(&data[iFree+sz+sz2], &data[iFree+sz], iFree2-(iFree+sz));
+                sz += sz2;
+            }else if( iFree+sz>usableSize ){
+                return SQLITE_CORRUPT_BKPT;
+            }
+            cbrk = top+sz;
+            if( cbrk<iCellFirst ){
+                return SQLITE_CORRUPT_BKPT;
+            }
+            memmove(&data[cbrk], &data[top], iFree-top);
+            for(i=0; i<nCell; i++){
+                u8 *pAddr = &data[cellOffset + i*2];
+                pc = get2byte(pAddr);
+                if( pc<iFree ){
+                    put2byte(pAddr, pc+sz);
+                }else if( pc<iFree2 ){
+                    put2byte(pAddr, pc+sz2);
+                }
+            }
+            pPage->pBt->aDefragStat[BTREE_DEFRAG_INPLACE]++;
+            goto defragment_out;
+        }
+    }
+    
+    temp = sqlite3PagerTempSpace(pPage->pBt->pPager);
     cbrk = get2byte(&data[hdr+5]);
     memcpy(&temp[cbrk], &data[cbrk], usableSize - cbrk);
     cbrk = usableSize;
-    iCellFirst = cellOffset + 2*nCell;
     iCellLast = usableSize - 4;
     for(i=0; i<nCell; i++){
         u8 *pAddr;     /* The i-th cell pointer */
@@ -1161,14 +1234,17 @@ static int defragmentPage(MemPage *pPage){
         memcpy(&data[cbrk], &temp[pc], size);
         put2byte(pAddr, cbrk);
     }
+    data[hdr+7] = 0;
+    pPage->pBt->aDefragStat[BTREE_DEFRAG_FULL]++;
+    
+defragment_out:
     assert( cbrk>=iCellFirst );
     put2byte(&data[hdr+5], cbrk);
     data[hdr+1] = 0;
     data[hdr+2] = 0;
-    data[hdr+7] = 0;
     memset(&data[iCellFirst], 0, cbrk-iCellFirst);
     assert( sqlite3PagerIswriteable(pPage->pDbPage) );
-    if( cbrk-iCellFirst!=pPage->nFree ){
+    if( data[hdr+7]+cbrk-iCellFirst!=pPage->nFree ){
         return SQLITE_CORRUPT_BKPT;
     }
     return SQLITE_OK;
@@ -1216,49 +1292,65 @@ static int allocateSpace(MemPage *pPage, int nByte, int *pIdx){
     
     if( nFrag>=60 ){
         /* Always defragment highly fragmented pages */
-        rc = defragmentPage(pPage);
+        rc = defragmentPage(pPage, 0);
         if( rc ) return rc;
         top = get2byteNotZero(&data[hdr+5]);
     }else if( gap+2<=top ){
         /* Search the freelist looking for a free slot big enough to satisfy
-         ** the request. The allocation is made from the first free slot in
-         ** the list that is large enough to accommodate it.
+         ** the request. The allocation is made from the smallest free slot
+         ** in the list that is large enough to accommodate it, so that large
+         ** slots are kept for large cells.  A slot that fits to within 3
+         ** bytes is taken as soon as it is seen.
          */
         int pc, addr;
+        int iBest = 0;       /* Offset of the best slot so far, or 0 */
+        int iBestPrev = 0;   /* Offset of the pointer to slot iBest */
+        int szBest = 0;      /* Size of slot iBest */
         for(addr=hdr+1; (pc = get2byte(&data[addr]))>0; addr=pc){
             int size;            /* Size of the free slot */
             if( pc>usableSize-4 || pc<addr+4 ){
                 return SQLITE_CORRUPT_BKPT;
             }
             size = get2byte(&data[pc+2]);
-            if( size>=nByte ){
-                int x = size - nByte;
-                testcase( x==4 );
-                testcase( x==3 );
-                if( x<4 ){
-                    /* Remove the slot from the free-list. Update the number of
-                     ** fragmented bytes within the page. */
-                    memcpy(&data[addr], &data[pc], 2);
-                    data[hdr+7] = (u8)(nFrag + x);
-                }else if( size+pc > usableSize ){
-                    return SQLITE_CORRUPT_BKPT;
-                }else{
-                    /* The slot remains on the free-list. Reduce its size to account
-                     ** for the portion used by the new allocation. */
-                    put2byte(&data[pc+2], x);
-                }
-                *pIdx = pc + x;
-                return SQLITE_OK;
+            if( size>=nByte && (iBest==0 || size<szBest) ){
+                iBest = pc;
+                iBestPrev = addr;
+                szBest = size;
+                if( size-nByte<4 ) break;
             }
         }
+        if( iBest ){
+            int x = szBest - nByte;
+            testcase( x==4 );
+            testcase( x==3 );
+            if( x<4 ){
+                /* Remove the slot from the free-list. Update the number of
+                 ** fragmented bytes within the page. */
+                memcpy(&data[iBestPrev], &data[iBest], 2);
+                data[hdr+7] = (u8)(nFrag + x);
+            }else if( szBest+iBest > usableSize ){
+                return SQLITE_CORRUPT_BKPT;
+            }else{
+                /* The slot remains on the free-list. Reduce its size to account
+                 ** for the portion used by the new allocation. */
+                put2byte(&data[iBest+2], x);
+            }
+            *pIdx = iBest + x;
+            return SQLITE_OK;
+        }
     }
     
     /* Check to make sure there is enough space in the gap to satisfy
-     ** the allocation.  If not, defragment.
+     ** the allocation.  If not, defragment.  Up to 4 fragmented bytes may
+     ** be left behind by an in-place defragmentation, provided the gap is
+     ** still large enough afterwards.
      */
     testcase( gap+2+nByte==top );
     if( gap+2+nByte>top ){
-        rc = defragmentPage(pPage);
+        int nMaxFrag = pPage->nFree - (2+nByte);
+        if( nMaxFrag>4 ) nMaxFrag = 4;
+        if( nMaxFrag<0 ) nMaxFrag = 0;
+        rc = defragmentPage(pPage, nMaxFrag);
         if( rc ) return rc;
         top = get2byteNotZero(&data[hdr+5]);
         assert( gap+nByte<=top );
@@ -1435,6 +1527,7 @@ static int btreeInitPage(MemPage *pPage){
         int iCellLast;     /* Last possible cell or freeblock offset */
         
         pBt = pPage->pBt;
+        btreeKeyCacheInvalidate(pPage);
         
         hdr = pPage->hdrOffset;
         data = pPage->aData;
@@ -1556,6 +1649,7 @@ static void zeroPage(MemPage *pPage, int flags){
     pPage->maskPage = (u16)(pBt->pageSize - 1);
     pPage->nCell = 0;
     pPage->isInit = 1;
+    btreeKeyCacheInvalidate(pPage);
 }
 
 
@@ -1694,6 +1788,7 @@ static void pageReinit(DbPage *pData){
     if( pPage->isInit ){
         assert( sqlite3_mutex_held(pPage->pBt->mutex) );
         pPage->isInit = 0;
+        btreeKeyCacheInvalidate(pPage);
         if( sqlite3PagerPageRefcount(pData)>1 ){
             /* pPage might not be a btree page;  it might be an overflow page
              ** or ptrmap page or a free page.  In those cases, the following
@@ -1898,6 +1993,7 @@ SQLITE_PRIVATE int sqlite3BtreeOpen(
 #ifdef SQLITE_SECURE_DELETE
         pBt->btsFlags |= BTS_SECURE_DELETE;
 #endif
+        pBt->fillFactor = SQLITE_DEFAULT_FILLFACTOR;
         pBt->pageSize = (zDbHeader[16]<<8) | (zDbHeader[17]<<16);
         if( pBt->pageSize<512 || pBt->pageSize>SQLITE_MAX_PAGE_SIZE
            || ((pBt->pageSize-1)&pBt->pageSize)!=0 ){
@@ -2071,13 +2167,258 @@ static void allocateTempSpace(BtShared *pBt){
 }
 
 /*
- ** Free the pBt->pTmpSpace allocation
+ ** Free the pBt->pTmpSpace allocation and the balancing workspaces, all
+ ** of which are sized according to the page size.
  */
 static void freeTempSpace(BtShared *pBt){
     sqlite3PageFree( pBt->pTmpSpace);
     pBt->pTmpSpace = 0;
+    sqlite3PageFree(pBt->apOvflSpace[0]);
+    sqlite3PageFree(pBt->apOvflSpace[1]);
+    pBt->apOvflSpace[0] = pBt->apOvflSpace[1] = 0;
+    sqlite3_free(pBt->pBalanceSpace);
+    pBt->pBalanceSpace = 0;
+    pBt->szBalanceSpace = 0;
+}
+
+/*
+ ** Return a pointer to at least nByte bytes of 8-byte aligned workspace
+ ** for balance_nonroot(), or NULL if a malloc fails.  The workspace belongs
+ ** to the BtShared and is kept from one call to the next, so that steady
+ ** insert and delete traffic does not allocate memory on every rebalance.
+ ** It only ever grows until the page size changes or pBt is closed.
+ */
+static u8 *btreeBalanceSpace(BtShared *pBt, int nByte){
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    if( pBt->szBalanceSpace<nByte ){
+        sqlite3_free(pBt->pBalanceSpace);
+        pBt->pBalanceSpace = (u8*)sqlite3Malloc(nByte);
+        pBt->szBalanceSpace = pBt->pBalanceSpace ? nByte : 0;
+    }
+    return pBt->pBalanceSpace;
+}
+
+/*
+ ** Return the i-th (0 or 1) page-size buffer used by balance() to hold
+ ** the overflow cells balance_nonroot() leaves in a parent page, allocating
+ ** it if necessary.  Return NULL if a malloc fails.
+ */
+static u8 *btreeOvflSpace(BtShared *pBt, int i){
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    assert( i==0 || i==1 );
+    if( pBt->apOvflSpace[i]==0 ){
+        pBt->apOvflSpace[i] = sqlite3PageMalloc(pBt->pageSize);
+    }
+    return pBt->apOvflSpace[i];
+}
+
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+/*
+ ** Free the decoded key arrays in pBt->aKeyCache[], if any.
+ */
+static void btreeKeyCacheFree(BtShared *pBt){
+    if( pBt->aKeyCache ){
+        int i;
+        for(i=0; i<BTREE_KEYCACHE_NSLOT; i++){
+            sqlite3_free(pBt->aKeyCache[i].aKey);
+        }
+        sqlite3_free(pBt->aKeyCache);
+        pBt->aKeyCache = 0;
+    }
+}
+
+/*
+ ** Return an array containing the integer key of each cell on intkey page
+ ** pPage, in cell order, or NULL if the keys of pPage should be searched
+ ** directly on the page.
+ **
+ ** A page is only decoded the second time it is searched while it remains
+ ** in the page cache, so that a lookup does not pay for decoding a page it
+ ** will not visit again.  This also means that pages accessed through
+ ** memory-mapped I/O, which get a fresh MemPage on every fetch, are never
+ ** decoded unless the cursor holds on to them (as it does the root page).
+ ** If a memory allocation fails, NULL is returned and the page is searched
+ ** directly.
+ */
+static const i64 *btreeKeyCacheGet(BtShared *pBt, MemPage *pPage){
+    BtKeyCache *p;
+    int i;
+    
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    assert( pPage->intKey && pPage->nOverflow==0 );
+    if( pPage->nCell<BTREE_KEYCACHE_MINCELL ) return 0;
+    if( pBt->aKeyCache==0 ){
+        pBt->aKeyCache = (BtKeyCache*)sqlite3MallocZero(
+                                                       BTREE_KEYCACHE_NSLOT*sizeof(BtKeyCache)
+                                                       );
+        if( pBt->aKeyCache==0 ) return 0;
+    }
+    p = &pBt->aKeyCache[pPage->pgno % BTREE_KEYCACHE_NSLOT];
+    if( pPage->iKeyGen!=0 && pPage->iKeyGen==p->iGen && p->pgno==pPage->pgno ){
+        return p->aKey;
+    }
+    if( pPage->nSearch==0 ){
+        pPage->nSearch = 1;
+        return 0;
+    }
+    
+    if( p->nAlloc<pPage->nCell ){
+        i64 *aNew = (i64*)sqlite3Realloc(p->aKey, pPage->nCell*sizeof(i64));
+        if( aNew==0 ) return 0;
+        p->aKey = aNew;
+        p->nAlloc = pPage->nCell;
+    }
+    for(i=0; i<pPage->nCell; i++){
+        u8 *pCell = findCell(pPage, i) + pPage->childPtrSize;
+        if( pPage->hasData ){
+            u32 dummy;
+            pCell += getVarint32(pCell, dummy);
+        }
+        getVarint(pCell, (u64*)&p->aKey[i]);
+    }
+    if( ++pBt->iKeyGen==0 ) pBt->iKeyGen = 1;
+    p->iGen = pPage->iKeyGen = pBt->iKeyGen;
+    p->pgno = pPage->pgno;
+    pPage->nSearch = 0;
+    return p->aKey;
 }
 
+/*
+ ** Return the number of entries in aKey[0..nKey-1] that are less than iKey.
+ ** On targets with 64-bit vector compares, two keys are compared at once.
+ */
+static int btreeKeyCountLess(const i64 *aKey, int nKey, i64 iKey){
+    int i = 0;
+    int nLess = 0;
+#if defined(__SSE4_2__)
+    __m128i vKey = _mm_set1_epi64x(iKey);
+    for(; i+2<=nKey; i+=2){
+        __m128i v = _mm_loadu_si128((const __m128i*)&aKey[i]);
+        int m = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(vKey, v)));
+        nLess += (m & 1) + (m >> 1);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    int64x2_t vKey = vdupq_n_s64(iKey);
+    for(; i+2<=nKey; i+=2){
+        uint64x2_t m = vcltq_s64(vld1q_s64(&aKey[i]), vKey);
+        nLess += (int)(vgetq_lane_u64(m, 0) & 1) + (int)(vgetq_lane_u64(m, 1) & 1);
+    }
+#endif
+    for(; i<nKey; i++){
+        nLess += (aKey[i]<iKey);
+    }
+    return nLess;
+}
+
+/*
+ ** Return the index of the first entry in sorted array aKey[0..nKey-1]
+ ** that is greater than or equal to iKey, or nKey if there is no such
+ ** entry.  A binary search narrows the range down to a block of at most
+ ** 16 keys (two cache lines), which is then scanned with vector compares.
+ */
+static int btreeKeyLowerBound(const i64 *aKey, int nKey, i64 iKey){
+    int lwr = 0;
+    int n = nKey;
+    while( n>16 ){
+        int half = n/2;
+        if( aKey[lwr+half]<iKey ){
+            lwr += half+1;
+            n -= half+1;
+        }else{
+            n = half;
+        }
+    }
+    return lwr + btreeKeyCountLess(&aKey[lwr], n, iKey);
+}
+#else
+# define btreeKeyCacheFree(X)
+#endif /* SQLITE_OMIT_BTREE_KEYCACHE */
+
+#ifndef SQLITE_OMIT_BTREE_OVFLINDEX
+/*
+ ** Discard every entry in pBt->aOvflIndex[] and free the cache itself.
+ */
+static void btreeOvflIndexClear(BtShared *pBt){
+    if( pBt->aOvflIndex ){
+        int i;
+        for(i=0; i<BTREE_OVFLINDEX_NSLOT; i++){
+            sqlite3_free(pBt->aOvflIndex[i].aPgno);
+        }
+        sqlite3_free(pBt->aOvflIndex);
+        pBt->aOvflIndex = 0;
+    }
+}
+
+/*
+ ** Called at the start of each read transaction, once pBt->pPage1 has been
+ ** loaded.  Discard pBt->aOvflIndex[] if the file may have been changed by
+ ** another connection since the cache was built: either the pager has
+ ** discarded its page cache or the file change counter has moved on.
+ */
+static void btreeOvflIndexCheck(BtShared *pBt){
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    assert( pBt->pPage1!=0 );
+    if( pBt->aOvflIndex
+       && (pBt->iOvflReset!=sqlite3PagerResetCount(pBt->pPager)
+           || pBt->iOvflChange!=get4byte(&pBt->pPage1->aData[24]))
+       ){
+        btreeOvflIndexClear(pBt);
+    }
+}
+
+/*
+ ** The overflow chain that begins on page iFirst is about to be freed.
+ ** Discard its entry in pBt->aOvflIndex[], if any.
+ */
+static void btreeOvflIndexDrop(BtShared *pBt, Pgno iFirst){
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    if( pBt->aOvflIndex ){
+        BtOvflIndex *p = &pBt->aOvflIndex[iFirst % BTREE_OVFLINDEX_NSLOT];
+        if( p->iFirst==iFirst ){
+            sqlite3_free(p->aPgno);
+            memset(p, 0, sizeof(*p));
+        }
+    }
+}
+
+/*
+ ** Return the page-list array for the nOvfl page overflow chain that
+ ** begins on page iFirst, allocating it (with all entries "not yet known")
+ ** if the chain is not already in the cache.  Any other chain that maps to
+ ** the same slot is evicted.  Return NULL if a malloc fails - the caller
+ ** then simply walks the chain.
+ */
+static Pgno *btreeOvflIndexGet(BtShared *pBt, Pgno iFirst, u32 nOvfl){
+    BtOvflIndex *p;
+    
+    assert( sqlite3_mutex_held(pBt->mutex) );
+    assert( nOvfl>0 );
+    assert( pBt->pPage1!=0 );
+    if( pBt->aOvflIndex==0 ){
+        pBt->aOvflIndex = (BtOvflIndex*)sqlite3MallocZero(
+                                      sizeof(BtOvflIndex)*BTREE_OVFLINDEX_NSLOT
+                                      );
+        if( pBt->aOvflIndex==0 ) return 0;
+        pBt->iOvflReset = sqlite3PagerResetCount(pBt->pPager);
+        pBt->iOvflChange = get4byte(&pBt->pPage1->aData[24]);
+    }
+    p = &pBt->aOvflIndex[iFirst % BTREE_OVFLINDEX_NSLOT];
+    if( p->iFirst!=iFirst || p->nOvfl!=nOvfl ){
+        sqlite3_free(p->aPgno);
+        memset(p, 0, sizeof(*p));
+        p->aPgno = (Pgno*)sqlite3MallocZero(sizeof(Pgno)*nOvfl);
+        if( p->aPgno==0 ) return 0;
+        p->iFirst = iFirst;
+        p->nOvfl = nOvfl;
+    }
+    return p->aPgno;
+}
+#else
+# define btreeOvflIndexClear(X)
+# define btreeOvflIndexCheck(X)
+# define btreeOvflIndexDrop(X,Y)
+#endif /* SQLITE_OMIT_BTREE_OVFLINDEX */
+
 /*
  ** Close an open database and invalidate all cursors.
  */
@@ -2085,8 +2426,17 @@ SQLITE_PRIVATE int sqlite3BtreeClose(Btree *p){
     BtShared *pBt = p->pBt;
     BtCursor *pCur;
     
-    /* Close all cursors opened via this handle.  */
+    /* Free the data attached to this handle by sqlite3BtreeConnData().
+     ** The destructor may still use the database connection, so do this
+     ** before anything else is torn down.  */
     assert( sqlite3_mutex_held(p->db->mutex) );
+    if( p->pConnData ){
+        if( p->xFreeConnData ) p->xFreeConnData(p->pConnData);
+        sqlite3_free(p->pConnData);
+        p->pConnData = 0;
+    }
+    
+    /* Close all cursors opened via this handle.  */
     sqlite3BtreeEnter(p);
     pCur = pBt->pCursor;
     while( pCur ){
@@ -2122,6 +2472,8 @@ SQLITE_PRIVATE int sqlite3BtreeClose(Btree *p){
         }
         sqlite3DbFree(0, pBt->pSchema);
         freeTempSpace(pBt);
+        btreeKeyCacheFree(pBt);
+        btreeOvflIndexClear(pBt);
         sqlite3_free(pBt);
     }
     
@@ -2326,8 +2678,50 @@ SQLITE_PRIVATE int sqlite3BtreeSecureDelete(Btree *p, int newFlag){
     sqlite3BtreeLeave(p);
     return b;
 }
+
+/*
+ ** Set the percentage of each page that is filled when a b-tree is bulk
+ ** loaded to iFill.  Values outside the range 10..100 are clamped.  If
+ ** iFill is negative, make no changes.  Always return the fill factor
+ ** in effect after the change.
+ */
+SQLITE_PRIVATE int sqlite3BtreeFillFactor(Btree *p, int iFill){
+    int n;
+    if( p==0 ) return SQLITE_DEFAULT_FILLFACTOR;
+    sqlite3BtreeEnter(p);
+    if( iFill>=0 ){
+        if( iFill<10 ) iFill = 10;
+        if( iFill>100 ) iFill = 100;
+        p->pBt->fillFactor = (u8)iFill;
+    }
+    n = p->pBt->fillFactor;
+    sqlite3BtreeLeave(p);
+    return n;
+}
 #endif /* !defined(SQLITE_OMIT_PAGER_PRAGMAS) || !defined(SQLITE_OMIT_VACUUM) */
 
+/*
+ ** Add the number of page defragmentations of the kind selected by eStat
+ ** (SQLITE_DBSTATUS_DEFRAG_FULL or SQLITE_DBSTATUS_DEFRAG_INPLACE) to *pnVal.
+ ** If the reset flag is set, zero the counter afterwards.
+ */
+SQLITE_PRIVATE void sqlite3BtreeDefragStat(Btree *p, int eStat, int reset, int *pnVal){
+    BtShared *pBt = p->pBt;
+    
+    assert( eStat==SQLITE_DBSTATUS_DEFRAG_FULL
+           || eStat==SQLITE_DBSTATUS_DEFRAG_INPLACE
+           );
+    assert( SQLITE_DBSTATUS_DEFRAG_FULL+1==SQLITE_DBSTATUS_DEFRAG_INPLACE );
+    assert( BTREE_DEFRAG_FULL==0 && BTREE_DEFRAG_INPLACE==1 );
+    
+    sqlite3BtreeEnter(p);
+    *pnVal += pBt->aDefragStat[eStat - SQLITE_DBSTATUS_DEFRAG_FULL];
+    if( reset ){
+        pBt->aDefragStat[eStat - SQLITE_DBSTATUS_DEFRAG_FULL] = 0;
+    }
+    sqlite3BtreeLeave(p);
+}
+
 /*
  ** Change the 'auto-vacuum' property of the database. If the 'autoVacuum'
  ** parameter is non-zero, then auto-vacuum mode is enabled. If zero, it
@@ -2523,6 +2917,7 @@ static int lockBtree(BtShared *pBt){
     assert( pBt->maxLeaf + 23 <= MX_CELL_SIZE(pBt) );
     pBt->pPage1 = pPage1;
     pBt->nPage = nPage;
+    btreeOvflIndexCheck(pBt);
     return SQLITE_OK;
     
 page1_init_failed:
@@ -2943,6 +3338,7 @@ static int relocatePage(
     /* Move page iDbPage from its current location to page number iFreePage */
     TRACE(("AUTOVACUUM: Moving %d to free page %d (ptr page %d type %d)\n",
            iDbPage, iFreePage, iPtrPage, eType));
+    btreeOvflIndexClear(pBt);
     rc = sqlite3PagerMovepage(pPager, pDbPage->pDbPage, iFreePage, isCommit);
     if( rc!=SQLITE_OK ){
         return rc;
@@ -3368,6 +3764,7 @@ SQLITE_PRIVATE int sqlite3BtreeCommitPhaseTwo(Btree *p, int bCleanup){
         }
         pBt->inTransaction = TRANS_READ;
         btreeClearHasContent(pBt);
+        btreeOvflIndexClear(pBt);
     }
     
     btreeEndTransaction(p);
@@ -3452,6 +3849,7 @@ SQLITE_PRIVATE int sqlite3BtreeRollback(Btree *p, int tripCode){
         int rc2;
         
         assert( TRANS_WRITE==pBt->inTransaction );
+        btreeOvflIndexClear(pBt);
         rc2 = sqlite3PagerRollback(pBt->pPager);
         if( rc2!=SQLITE_OK ){
             rc = rc2;
@@ -3534,6 +3932,7 @@ SQLITE_PRIVATE int sqlite3BtreeSavepoint(Btree *p, int op, int iSavepoint){
         assert( op==SAVEPOINT_RELEASE || op==SAVEPOINT_ROLLBACK );
         assert( iSavepoint>=0 || (iSavepoint==-1 && op==SAVEPOINT_ROLLBACK) );
         sqlite3BtreeEnter(p);
+        if( op==SAVEPOINT_ROLLBACK ) btreeOvflIndexClear(pBt);
         rc = sqlite3PagerSavepoint(pBt->pPager, op, iSavepoint);
         if( rc==SQLITE_OK ){
             if( iSavepoint<0 && (pBt->btsFlags & BTS_INITIALLY_EMPTY)!=0 ){
@@ -3970,6 +4369,12 @@ static int copyPayload(
  **   * An incremental vacuum,
  **   * A commit in auto_vacuum="full" mode,
  **   * Creating a table (may require moving an overflow page).
+ **
+ ** For any other cursor, if the entry has a chain of at least
+ ** BTREE_OVFLINDEX_MINPAGE overflow pages, the page-list array from the
+ ** shared BtShared.aOvflIndex[] cache is used in the same way.  That array
+ ** survives cursor movement, so later reads of the same entry skip
+ ** directly to the overflow page that holds the requested offset.
  */
 static int accessPayload(
                          BtCursor *pCur,      /* Cursor pointing to entry to read from */
@@ -4018,6 +4423,7 @@ static int accessPayload(
     if( rc==SQLITE_OK && amt>0 ){
         const u32 ovflSize = pBt->usableSize - 4;  /* Bytes content per ovfl page */
         Pgno nextPage;
+        Pgno *aOvfl = 0;                           /* Overflow page-list, if any */
         
         nextPage = get4byte(&aPayload[pCur->info.nLocal]);
         
@@ -4038,27 +4444,37 @@ static int accessPayload(
                 rc = SQLITE_NOMEM;
             }
         }
+        aOvfl = pCur->aOverflow;
+#endif
         
-        /* If the overflow page-list cache has been allocated and the
-         ** entry for the first required overflow page is valid, skip
-         ** directly to it.
+#ifndef SQLITE_OMIT_BTREE_OVFLINDEX
+        /* Otherwise, use the shared overflow page-list cache for entries
+         ** with long overflow chains.
          */
-        if( pCur->aOverflow && pCur->aOverflow[offset/ovflSize] ){
+        if( aOvfl==0 ){
+            u32 nOvfl = (pCur->info.nPayload-pCur->info.nLocal+ovflSize-1)/ovflSize;
+            if( nOvfl>=BTREE_OVFLINDEX_MINPAGE ){
+                aOvfl = btreeOvflIndexGet(pBt, nextPage, nOvfl);
+            }
+        }
+#endif
+        
+        /* If an overflow page-list cache is available and the entry for the
+         ** first required overflow page is valid, skip directly to it.
+         */
+        if( aOvfl && aOvfl[offset/ovflSize] ){
             iIdx = (offset/ovflSize);
-            nextPage = pCur->aOverflow[iIdx];
+            nextPage = aOvfl[iIdx];
             offset = (offset%ovflSize);
         }
-#endif
         
         for( ; rc==SQLITE_OK && amt>0 && nextPage; iIdx++){
             
-#ifndef SQLITE_OMIT_INCRBLOB
             /* If required, populate the overflow page-list cache. */
-            if( pCur->aOverflow ){
-                assert(!pCur->aOverflow[iIdx] || pCur->aOverflow[iIdx]==nextPage);
-                pCur->aOverflow[iIdx] = nextPage;
+            if( aOvfl ){
+                assert(!aOvfl[iIdx] || aOvfl[iIdx]==nextPage);
+                aOvfl[iIdx] = nextPage;
             }
-#endif
             
             if( offset>=ovflSize ){
                 /* The only reason to read this page is to obtain the page
@@ -4067,11 +4483,9 @@ static int accessPayload(
                  ** page-list cache, if any, then fall back to the getOverflowPage()
                  ** function.
                  */
-#ifndef SQLITE_OMIT_INCRBLOB
-                if( pCur->aOverflow && pCur->aOverflow[iIdx+1] ){
-                    nextPage = pCur->aOverflow[iIdx+1];
+                if( aOvfl && aOvfl[iIdx+1] ){
+                    nextPage = aOvfl[iIdx+1];
                 } else
-#endif
                     rc = getOverflowPage(pBt, nextPage, 0, &nextPage);
                 offset -= ovflSize;
             }else{
@@ -4615,12 +5029,16 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
                                               int *pRes                /* Write search results here */
 ){
     int rc;
+    RecordCompare xRecordCompare;  /* Record comparison function for pIdxKey */
     
     assert( cursorHoldsMutex(pCur) );
     assert( sqlite3_mutex_held(pCur->pBtree->db->mutex) );
     assert( pRes );
     assert( (pIdxKey==0)==(pCur->pKeyInfo==0) );
     
+    /* Choose the comparison routine once, rather than once per cell */
+    xRecordCompare = pIdxKey ? sqlite3VdbeFindCompare(pIdxKey) : 0;
+    
     /* If the cursor is already positioned at the point we are trying
      ** to move to, then just return without doing any work */
     if( pCur->eState==CURSOR_VALID && pCur->validNKey
@@ -4636,6 +5054,31 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
         }
     }
     
+    /* A cursor that is bulk loading an index is usually left pointing at
+     ** the last entry by the previous insert. If the new key sorts after
+     ** that entry, there is no need to search the tree for it. Only records
+     ** stored entirely on the leaf page are checked here. */
+    if( pIdxKey && pCur->eState==CURSOR_VALID && pCur->atLast
+       && (pCur->hints & BTREE_BULKLOAD)
+       ){
+        MemPage *pPage = pCur->apPage[pCur->iPage];
+        u8 *pCell = findCell(pPage, pCur->aiIdx[pCur->iPage]);
+        int nCell = pCell[0];
+        int c = 0;
+        assert( pPage->leaf );
+        if( nCell<=pPage->max1bytePayload ){
+            c = xRecordCompare(nCell, (void*)&pCell[1], pIdxKey);
+        }else if( !(pCell[1] & 0x80)
+                 && (nCell = ((nCell&0x7f)<<7) + pCell[1])<=pPage->maxLocal
+                 ){
+            c = xRecordCompare(nCell, (void*)&pCell[2], pIdxKey);
+        }
+        if( c<0 ){
+            *pRes = -1;
+            return SQLITE_OK;
+        }
+    }
+    
     rc = moveToRoot(pCur);
     if( rc ){
         return rc;
@@ -4665,6 +5108,33 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
         assert( pPage->intKey==(pIdxKey==0) );
         lwr = 0;
         upr = pPage->nCell-1;
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+        if( pPage->intKey ){
+            const i64 *aKey = btreeKeyCacheGet(pCur->pBt, pPage);
+            if( aKey ){
+                /* Search the decoded keys of the page. lwr is set to the index
+                 ** of the first cell with a key greater than or equal to intKey,
+                 ** exactly as the binary search below would leave it. */
+                lwr = btreeKeyLowerBound(aKey, pPage->nCell, intKey);
+                if( pPage->leaf ){
+                    if( lwr<pPage->nCell ){
+                        c = (aKey[lwr]==intKey) ? 0 : +1;
+                    }else{
+                        lwr = pPage->nCell-1;
+                        c = -1;
+                    }
+                    pCur->aiIdx[pCur->iPage] = (u16)lwr;
+                    pCur->info.nSize = 0;
+                    pCur->validNKey = 1;
+                    pCur->info.nKey = aKey[lwr];
+                    *pRes = c;
+                    rc = SQLITE_OK;
+                    goto moveto_finish;
+                }
+                goto moveto_next_layer;
+            }
+        }
+#endif
         if( biasRight ){
             pCur->aiIdx[pCur->iPage] = (u16)(idx = upr);
         }else{
@@ -4710,7 +5180,7 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
                      ** single byte varint and the record fits entirely on the main
                      ** b-tree page.  */
                     testcase( pCell+nCell+1==pPage->aDataEnd );
-                    c = sqlite3VdbeRecordCompare(nCell, (void*)&pCell[1], pIdxKey);
+                    c = xRecordCompare(nCell, (void*)&pCell[1], pIdxKey);
                 }else if( !(pCell[1] & 0x80)
                          && (nCell = ((nCell&0x7f)<<7) + pCell[1])<=pPage->maxLocal
                          /* && (pCell+nCell+2)<=pPage->aDataEnd */
@@ -4718,7 +5188,7 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
                     /* The record-size field is a 2 byte varint and the record
                      ** fits entirely on the main b-tree page.  */
                     testcase( pCell+nCell+2==pPage->aDataEnd );
-                    c = sqlite3VdbeRecordCompare(nCell, (void*)&pCell[2], pIdxKey);
+                    c = xRecordCompare(nCell, (void*)&pCell[2], pIdxKey);
                 }else{
                     /* The record flows over onto one or more overflow pages. In
                      ** this case the whole cell needs to be parsed, a buffer allocated
@@ -4738,7 +5208,7 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
                         sqlite3_free(pCellKey);
                         goto moveto_finish;
                     }
-                    c = sqlite3VdbeRecordCompare(nCell, pCellKey, pIdxKey);
+                    c = xRecordCompare(nCell, pCellKey, pIdxKey);
                     sqlite3_free(pCellKey);
                 }
             }
@@ -4762,6 +5232,9 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
             }
             pCur->aiIdx[pCur->iPage] = (u16)(idx = (lwr+upr)/2);
         }
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+    moveto_next_layer:
+#endif
         assert( lwr==upr+1 || (pPage->intKey && !pPage->leaf) );
         assert( pPage->isInit );
         if( pPage->leaf ){
@@ -4803,6 +5276,41 @@ SQLITE_PRIVATE int sqlite3BtreeEof(BtCursor *pCur){
     return (CURSOR_VALID!=pCur->eState);
 }
 
+#if SQLITE_BTREE_PREFETCH>0
+/*
+ ** The cursor has just stepped onto a new leaf page.  Ask the pager to
+ ** start reading the next SQLITE_BTREE_PREFETCH sibling leaves in the
+ ** direction of the scan - forward if bNext is true or backward otherwise -
+ ** so that the following leaf transitions do not each stall on I/O.  The
+ ** page numbers of the siblings are taken from the parent page, so only
+ ** children of the same parent are considered.
+ */
+static void btreePrefetchSiblings(BtCursor *pCur, int bNext){
+    MemPage *pParent;
+    int iIdx;
+    int i;
+    
+    assert( cursorHoldsMutex(pCur) );
+    assert( pCur->eState==CURSOR_VALID );
+    if( pCur->iPage<1 || !pCur->apPage[pCur->iPage]->leaf ) return;
+    pParent = pCur->apPage[pCur->iPage-1];
+    iIdx = pCur->aiIdx[pCur->iPage-1];
+    for(i=0; i<SQLITE_BTREE_PREFETCH; i++){
+        Pgno pgno;
+        iIdx += (bNext ? 1 : -1);
+        if( iIdx<0 || iIdx>pParent->nCell ) break;
+        if( iIdx==pParent->nCell ){
+            pgno = get4byte(&pParent->aData[pParent->hdrOffset+8]);
+        }else{
+            pgno = get4byte(findCell(pParent, iIdx));
+        }
+        sqlite3PagerPrefetch(pCur->pBt->pPager, pgno);
+    }
+}
+#else
+# define btreePrefetchSiblings(X,Y)
+#endif
+
 /*
  ** Advance the cursor to the next entry in the database.  If
  ** successful then set *pRes=0.  If the cursor
@@ -4860,6 +5368,7 @@ SQLITE_PRIVATE int sqlite3BtreeNext(BtCursor *pCur, int *pRes){
                 return rc;
             }
             rc = moveToLeftmost(pCur);
+            if( rc==SQLITE_OK ) btreePrefetchSiblings(pCur, 1);
             *pRes = 0;
             return rc;
         }
@@ -4885,6 +5394,7 @@ SQLITE_PRIVATE int sqlite3BtreeNext(BtCursor *pCur, int *pRes){
         return SQLITE_OK;
     }
     rc = moveToLeftmost(pCur);
+    if( rc==SQLITE_OK ) btreePrefetchSiblings(pCur, 1);
     return rc;
 }
 
@@ -4937,6 +5447,7 @@ SQLITE_PRIVATE int sqlite3BtreePrevious(BtCursor *pCur, int *pRes){
             return rc;
         }
         rc = moveToRightmost(pCur);
+        if( rc==SQLITE_OK ) btreePrefetchSiblings(pCur, 0);
     }else{
         while( pCur->aiIdx[pCur->iPage]==0 ){
             if( pCur->iPage==0 ){
@@ -5450,6 +5961,7 @@ static int clearCell(MemPage *pPage, unsigned char *pCell){
         return SQLITE_CORRUPT_BKPT;  /* Cell extends past end of page */
     }
     ovflPgno = get4byte(&pCell[info.iOverflow]);
+    btreeOvflIndexDrop(pBt, ovflPgno);
     assert( pBt->usableSize > 4 );
     ovflPageSize = pBt->usableSize - 4;
     nOvfl = (info.nPayload - info.nLocal + ovflPageSize - 1)/ovflPageSize;
@@ -5703,6 +6215,7 @@ static void dropCell(MemPage *pPage, int idx, int sz, int *pRC){
     pPage->nCell--;
     put2byte(&data[hdr+3], pPage->nCell);
     pPage->nFree += 2;
+    btreeKeyCacheInvalidate(pPage);
 }
 
 /*
@@ -5743,6 +6256,7 @@ static void insertCell(
     int nSkip = (iChild ? 4 : 0);
     
     if( *pRC ) return;
+    btreeKeyCacheInvalidate(pPage);
     
     assert( i>=0 && i<=pPage->nCell+pPage->nOverflow );
     assert( pPage->nCell<=MX_CELL(pPage->pBt) && MX_CELL(pPage->pBt)<=10921 );
@@ -5850,6 +6364,7 @@ static void assemblePage(
     put2byte(&data[hdr+5], cellbody);
     pPage->nFree -= (nCell*2 + nUsable - cellbody);
     pPage->nCell = (u16)nCell;
+    btreeKeyCacheInvalidate(pPage);
 }
 
 /*
@@ -5891,8 +6406,18 @@ static void assemblePage(
  ** byte page number followed by a variable length integer. In other
  ** words, at most 13 bytes. Hence the pSpace buffer must be at
  ** least 13 bytes in size.
+ **
+ ** If successful, *ppNew is set to point to the new right-most leaf page
+ ** and the caller is responsible for calling releasePage() on it. This
+ ** allows the cursor to be left on the new page, so that the next append
+ ** does not need to seek from the root. On error, *ppNew is set to 0.
  */
-static int balance_quick(MemPage *pParent, MemPage *pPage, u8 *pSpace){
+static int balance_quick(
+                         MemPage *pParent,   /* Parent of pPage */
+                         MemPage *pPage,     /* Right-most leaf with overflow cell */
+                         u8 *pSpace,         /* Space for the divider cell */
+                         MemPage **ppNew     /* OUT: The new right-most leaf */
+){
     BtShared *const pBt = pPage->pBt;    /* B-Tree Database */
     MemPage *pNew;                       /* Newly allocated page */
     int rc;                              /* Return Code */
@@ -5902,6 +6427,8 @@ static int balance_quick(MemPage *pParent, MemPage *pPage, u8 *pSpace){
     assert( sqlite3PagerIswriteable(pParent->pDbPage) );
     assert( pPage->nOverflow==1 );
     
+    *ppNew = 0;
+    
     /* This error condition is now caught prior to reaching this function */
     if( pPage->nCell==0 ) return SQLITE_CORRUPT_BKPT;
     
@@ -5965,8 +6492,8 @@ static int balance_quick(MemPage *pParent, MemPage *pPage, u8 *pSpace){
         /* Set the right-child pointer of pParent to point to the new page. */
         put4byte(&pParent->aData[pParent->hdrOffset+8], pgnoNew);
         
-        /* Release the reference to the new page. */
-        releasePage(pNew);
+        /* Pass the reference to the new page back to the caller. */
+        *ppNew = pNew;
     }
     
     return rc;
@@ -6146,6 +6673,7 @@ static int balance_nonroot(
     u8 *apDiv[NB-1];             /* Divider cells in pParent */
     int cntNew[NB+2];            /* Index in aCell[] of cell after i-th page */
     int szNew[NB+2];             /* Combined size of cells place on i-th page */
+    int aFirstOld[NB];           /* Index in apCell[] of first cell of apOld[i] */
     u8 **apCell = 0;             /* All cells begin balanced */
     u16 *szCell;                 /* Local size of all cells in apCell[] */
     u8 *aSpace1;                 /* Space for copies of dividers cells */
@@ -6265,7 +6793,7 @@ static int balance_nonroot(
     + nMaxCells*sizeof(u16)                       /* szCell */
     + pBt->pageSize                               /* aSpace1 */
     + k*nOld;                                     /* Page copies (apCopy) */
-    apCell = sqlite3ScratchMalloc( szScratch );
+    apCell = (u8**)btreeBalanceSpace(pBt, szScratch);
     if( apCell==0 ){
         rc = SQLITE_NOMEM;
         goto balance_cleanup;
@@ -6304,6 +6832,7 @@ static int balance_nonroot(
         pOld->aData = (void*)&pOld[1];
         memcpy(pOld->aData, apOld[i]->aData, pBt->pageSize);
         
+        aFirstOld[i] = nCell;
         limit = pOld->nCell+pOld->nOverflow;
         if( pOld->nOverflow>0 ){
             for(j=0; j<limit; j++){
@@ -6529,8 +7058,22 @@ static int balance_nonroot(
         /* Assemble the new sibling page. */
         MemPage *pNew = apNew[i];
         assert( j<nMaxCells );
-        zeroPage(pNew, pageFlags);
-        assemblePage(pNew, cntNew[i]-j, &apCell[j], &szCell[j]);
+        if( nNew>1 && i<nOld
+           && pNew->pgno==apCopy[i]->pgno
+           && apCopy[i]->nOverflow==0
+           && apCopy[i]->aData[0]==pageFlags
+           && j==aFirstOld[i]
+           && cntNew[i]-j==apCopy[i]->nCell
+           ){
+            /* This sibling keeps exactly the cells it held before balancing,
+             ** in the same order and on the same page, so there is no need to
+             ** rebuild it.  This is the usual case for the left sibling when
+             ** appending in key order.  */
+            assert( pNew->nCell==apCopy[i]->nCell );
+        }else{
+            zeroPage(pNew, pageFlags);
+            assemblePage(pNew, cntNew[i]-j, &apCell[j], &szCell[j]);
+        }
         assert( pNew->nCell>0 || (nNew==1 && cntNew[0]==0) );
         assert( pNew->nOverflow==0 );
         
@@ -6736,7 +7279,6 @@ static int balance_nonroot(
      ** Cleanup before returning.
      */
 balance_cleanup:
-    sqlite3ScratchFree(apCell);
     for(i=0; i<nOld; i++){
         releasePage(apOld[i]);
     }
@@ -6826,12 +7368,21 @@ static int balance_deeper(MemPage *pRoot, MemPage **ppChild){
  **   balance_quick()
  **   balance_deeper()
  **   balance_nonroot()
+ **
+ ** If the only balancing required was a call to balance_quick() that
+ ** left the parent page neither overfull nor underfull, the cursor is
+ ** left pointing at the new right-most leaf page created by
+ ** balance_quick(), with pCur->aiIdx[] set to the first cell of that page.
+ ** Otherwise pCur->apPage[pCur->iPage] is an interior page of the tree
+ ** and the caller must treat the cursor position as invalid.
  */
 static int balance(BtCursor *pCur){
     int rc = SQLITE_OK;
     const int nMin = pCur->pBt->usableSize * 2 / 3;
     u8 aBalanceQuickSpace[13];
-    u8 *pFree = 0;
+    int iOvflSpace = 0;           /* Next of BtShared.apOvflSpace[] to use */
+    MemPage *pQuick = 0;          /* New leaf created by balance_quick() */
+    int iQuick = 0;               /* Level of pQuick in pCur->apPage[] */
     
     TESTONLY( int balance_quick_called = 0 );
     TESTONLY( int balance_deeper_called = 0 );
@@ -6848,6 +7399,10 @@ static int balance(BtCursor *pCur){
                  ** next iteration of the do-loop will balance the child page.
                  */
                 assert( (balance_deeper_called++)==0 );
+                if( pQuick ){
+                    releasePage(pQuick);
+                    pQuick = 0;
+                }
                 rc = balance_deeper(pPage, &pCur->apPage[1]);
                 if( rc==SQLITE_OK ){
                     pCur->iPage = 1;
@@ -6887,7 +7442,8 @@ static int balance(BtCursor *pCur){
                      ** of the aBalanceQuickSpace[] might sneak in.
                      */
                     assert( (balance_quick_called++)==0 );
-                    rc = balance_quick(pParent, pPage, aBalanceQuickSpace);
+                    rc = balance_quick(pParent, pPage, aBalanceQuickSpace, &pQuick);
+                    iQuick = iPage;
                 }else
 #endif
                 {
@@ -6898,30 +7454,25 @@ static int balance(BtCursor *pCur){
                      ** will balance the parent page to correct this.
                      **
                      ** If the parent page becomes overfull, the overflow cell or cells
-                     ** are stored in the pSpace buffer allocated immediately below.
+                     ** are stored in the pSpace buffer selected immediately below.
                      ** A subsequent iteration of the do-loop will deal with this by
                      ** calling balance_nonroot() (balance_deeper() may be called first,
                      ** but it doesn't deal with overflow cells - just moves them to a
                      ** different page). Once this subsequent call to balance_nonroot()
-                     ** has completed, it is safe to release the pSpace buffer used by
-                     ** the previous call, as the overflow cell data will have been
+                     ** has completed, the pSpace buffer used by the previous call is
+                     ** no longer referenced, as the overflow cell data will have been
                      ** copied either into the body of a database page or into the new
                      ** pSpace buffer passed to the latter call to balance_nonroot().
+                     ** So the two page buffers in BtShared.apOvflSpace[] are used
+                     ** alternately.
                      */
-                    u8 *pSpace = sqlite3PageMalloc(pCur->pBt->pageSize);
-                    rc = balance_nonroot(pParent, iIdx, pSpace, iPage==1, pCur->hints);
-                    if( pFree ){
-                        /* If pFree is not NULL, it points to the pSpace buffer used
-                         ** by a previous call to balance_nonroot(). Its contents are
-                         ** now stored either on real database pages or within the
-                         ** new pSpace buffer, so it may be safely freed here. */
-                        sqlite3PageFree(pFree);
+                    u8 *pSpace = btreeOvflSpace(pCur->pBt, iOvflSpace);
+                    iOvflSpace = !iOvflSpace;
+                    if( pQuick ){
+                        releasePage(pQuick);
+                        pQuick = 0;
                     }
-                    
-                    /* The pSpace buffer will be freed after the next call to
-                     ** balance_nonroot(), or just before this function returns, whichever
-                     ** comes first. */
-                    pFree = pSpace;
+                    rc = balance_nonroot(pParent, iIdx, pSpace, iPage==1, pCur->hints);
                 }
             }
             
@@ -6933,13 +7484,237 @@ static int balance(BtCursor *pCur){
         }
     }while( rc==SQLITE_OK );
     
-    if( pFree ){
-        sqlite3PageFree(pFree);
+    if( pQuick ){
+        if( rc==SQLITE_OK ){
+            /* No other balancing routine ran after balance_quick(), so the
+             ** loop stopped at the parent of the page passed to balance_quick()
+             ** and the new leaf is still the right-most child of that parent. */
+            assert( pCur->iPage==iQuick-1 );
+            assert( pCur->apPage[iQuick-1]->nOverflow==0 );
+            pCur->aiIdx[iQuick-1] = pCur->apPage[iQuick-1]->nCell;
+            pCur->apPage[iQuick] = pQuick;
+            pCur->aiIdx[iQuick] = 0;
+            pCur->iPage = iQuick;
+        }else{
+            releasePage(pQuick);
+        }
     }
     return rc;
 }
 
 
+/*
+ ** Return true if cursor pCur points to the last entry of its b-tree, or
+ ** if the b-tree is empty and pCur points to its root page.  In either
+ ** case an entry that sorts after every existing key may be appended to
+ ** the right-hand edge of the tree without searching for its position.
+ */
+static int btreeCursorIsRightmost(BtCursor *pCur){
+    int i;
+    MemPage *pLeaf = pCur->apPage[pCur->iPage];
+    for(i=0; i<pCur->iPage; i++){
+        if( pCur->aiIdx[i]!=pCur->apPage[i]->nCell ) return 0;
+    }
+    if( !pLeaf->leaf ) return 0;
+    if( pLeaf->nCell==0 ) return pCur->iPage==0;
+    return pCur->aiIdx[pCur->iPage]==pLeaf->nCell-1;
+}
+
+/*
+ ** Return true if a cell of szCell bytes may be appended to page pPage
+ ** without exceeding the fill factor configured for bulk loads.  A page
+ ** always accepts at least two cells (if they physically fit) so that
+ ** btreeBulkAppend() can always move the last cell of a full page up
+ ** into its parent without leaving the page empty.
+ */
+static int btreeBulkFits(MemPage *pPage, int szCell){
+    BtShared *pBt = pPage->pBt;
+    int nReserve;                 /* Bytes to leave free on each page */
+    
+    if( szCell+2>pPage->nFree ) return 0;
+    if( pPage->nCell<2 ) return 1;
+    nReserve = (int)(pBt->usableSize * (100 - pBt->fillFactor) / 100);
+    return (pPage->nFree - szCell - 2)>=nReserve;
+}
+
+/*
+ ** Append cell pCell, szCell bytes in size, to the right-hand edge of the
+ ** b-tree that cursor pCur is open on.  The cursor must point to the last
+ ** entry in the tree (see btreeCursorIsRightmost()) and the new cell must
+ ** sort after it.
+ **
+ ** This is the building block for loading a b-tree from presorted input.
+ ** Instead of redistributing cells between siblings the way balance()
+ ** does, a page that reaches the fill factor is simply closed off and a
+ ** new right-most page started.  The closed page is never visited again,
+ ** so every page except the right-most at each level of the tree is left
+ ** filled to BtShared.fillFactor percent and each interior page is
+ ** assembled exactly once, from left to right.
+ **
+ ** When the page at some level of the tree is full, a new right sibling is
+ ** allocated to hold the incoming cell and a divider is pushed up into the
+ ** parent:
+ **
+ **   * For an intkey leaf the divider is the largest key on the full page.
+ **
+ **   * Otherwise (index pages and all interior pages) the last cell of the
+ **     full page is removed and becomes the divider.  On an interior page
+ **     the child pointer of that cell becomes the new right-child pointer
+ **     of the full page.
+ **
+ ** If the root page is full, its content is first moved into a new child
+ ** page so that the root page number never changes.  The cursor path in
+ ** pCur->apPage[] is kept pointing at the right-hand edge throughout, so on
+ ** success the cursor points to the newly appended entry.
+ */
+static int btreeBulkAppend(BtCursor *pCur, u8 *pCell, int szCell){
+    BtShared * const pBt = pCur->pBt;   /* The b-tree */
+    int rc = SQLITE_OK;                 /* Return code */
+    int iPage = pCur->iPage;            /* Level of the tree being modified */
+    u8 *pDiv = pCell;                   /* Cell to append at level iPage */
+    int szDiv = szCell;                 /* Size of pDiv in bytes */
+    Pgno pgnoRight = 0;                 /* New right-child at level iPage */
+    u8 *pSpace = 0;                     /* Space for two divider cells */
+    int iSpace = 0;                     /* Half of pSpace[] to use next */
+    
+    assert( cursorHoldsMutex(pCur) );
+    assert( btreeCursorIsRightmost(pCur) );
+    assert( pCur->pgnoRoot!=1 );
+    
+    for(;;){
+        MemPage *pPage = pCur->apPage[iPage];
+        MemPage *pParent;
+        MemPage *pNew = 0;
+        Pgno pgnoNew = 0;
+        u8 *pUp;                          /* Divider to push into pParent */
+        int szUp;                         /* Size of pUp in bytes */
+        
+        assert( pPage->nOverflow==0 );
+        if( btreeBulkFits(pPage, szDiv) ){
+            rc = sqlite3PagerWrite(pPage->pDbPage);
+            if( rc ) break;
+            insertCell(pPage, pPage->nCell, pDiv, szDiv, 0, 0, &rc);
+            if( pPage->leaf ){
+                pCur->aiIdx[iPage] = pPage->nCell-1;
+            }else{
+                put4byte(&pPage->aData[pPage->hdrOffset+8], pgnoRight);
+                if( ISAUTOVACUUM ){
+                    ptrmapPut(pBt, pgnoRight, PTRMAP_BTREE, pPage->pgno, &rc);
+                }
+                pCur->aiIdx[iPage] = pPage->nCell;
+            }
+            break;
+        }
+        
+        if( iPage==0 ){
+            /* The root page is full. Copy its content into a new child page
+             ** and make the root an empty interior page whose right-child is
+             ** the new page. The next iteration of the loop splits the child. */
+            MemPage *pChild = 0;
+            Pgno pgnoChild = 0;
+            if( pCur->iPage>=BTCURSOR_MAX_DEPTH-1 ){
+                rc = SQLITE_CORRUPT_BKPT;
+                break;
+            }
+            rc = sqlite3PagerWrite(pPage->pDbPage);
+            if( rc==SQLITE_OK ){
+                rc = allocateBtreePage(pBt, &pChild, &pgnoChild, pPage->pgno, 0);
+            }
+            copyNodeContent(pPage, pChild, &rc);
+            if( ISAUTOVACUUM ){
+                ptrmapPut(pBt, pgnoChild, PTRMAP_BTREE, pPage->pgno, &rc);
+            }
+            if( rc ){
+                releasePage(pChild);
+                break;
+            }
+            TRACE(("BULKLOAD: copy root %d into %d\n", pPage->pgno, pgnoChild));
+            zeroPage(pPage, pChild->aData[0] & ~PTF_LEAF);
+            put4byte(&pPage->aData[pPage->hdrOffset+8], pgnoChild);
+            memmove(&pCur->apPage[2], &pCur->apPage[1],
+                    pCur->iPage*sizeof(pCur->apPage[0]));
+            memmove(&pCur->aiIdx[1], &pCur->aiIdx[0],
+                    (pCur->iPage+1)*sizeof(pCur->aiIdx[0]));
+            pCur->apPage[1] = pChild;
+            pCur->aiIdx[0] = 0;
+            pCur->iPage++;
+            iPage = 1;
+            continue;
+        }
+        
+        /* Page pPage is full. Allocate its new right sibling pNew. */
+        pParent = pCur->apPage[iPage-1];
+        rc = sqlite3PagerWrite(pParent->pDbPage);
+        if( rc==SQLITE_OK ){
+            rc = sqlite3PagerWrite(pPage->pDbPage);
+        }
+        if( rc==SQLITE_OK && pSpace==0 ){
+            /* A divider cell is never larger than a quarter of a page (see
+             ** the comments above balance_nonroot()), so a single page
+             ** buffer holds both the divider currently being inserted and
+             ** the divider being built for the level above. */
+            pSpace = btreeOvflSpace(pBt, 0);
+            if( pSpace==0 ) rc = SQLITE_NOMEM;
+        }
+        if( rc==SQLITE_OK ){
+            rc = allocateBtreePage(pBt, &pNew, &pgnoNew, pPage->pgno, 0);
+        }
+        if( rc ) break;
+        zeroPage(pNew, pPage->aData[pPage->hdrOffset]);
+        
+        /* Build the divider cell that will be pushed into pParent. */
+        pUp = &pSpace[iSpace * (pBt->pageSize/2)];
+        iSpace = !iSpace;
+        if( pPage->intKey && pPage->leaf ){
+            CellInfo info;
+            btreeParseCellPtr(pPage, findCell(pPage, pPage->nCell-1), &info);
+            szUp = 4 + putVarint(&pUp[4], *(u64*)&info.nKey);
+        }else{
+            int iLast = pPage->nCell-1;
+            u8 *pLast = findCell(pPage, iLast);
+            u16 szLast = cellSizePtr(pPage, pLast);
+            assert( iLast>0 );
+            if( pPage->leaf ){
+                memcpy(&pUp[4], pLast, szLast);
+                szUp = cellSizePtr(pParent, pUp);
+            }else{
+                memcpy(pUp, pLast, szLast);
+                szUp = szLast;
+                put4byte(&pPage->aData[pPage->hdrOffset+8], get4byte(pUp));
+            }
+            dropCell(pPage, iLast, szLast, &rc);
+        }
+        put4byte(pUp, pPage->pgno);
+        
+        /* Move the pending cell to the new page. If this is an interior
+         ** level, the left-child of the pending divider was the right-child
+         ** of pPage, so both children of pNew have a new parent. */
+        insertCell(pNew, 0, pDiv, szDiv, 0, 0, &rc);
+        if( !pNew->leaf ){
+            put4byte(&pNew->aData[pNew->hdrOffset+8], pgnoRight);
+            if( ISAUTOVACUUM ){
+                ptrmapPut(pBt, get4byte(pDiv), PTRMAP_BTREE, pgnoNew, &rc);
+                ptrmapPut(pBt, pgnoRight, PTRMAP_BTREE, pgnoNew, &rc);
+            }
+        }
+        TRACE(("BULKLOAD: page %d full, new right sibling %d\n",
+               pPage->pgno, pgnoNew));
+        
+        /* pNew replaces pPage on the right-hand edge of the tree. */
+        releasePage(pPage);
+        pCur->apPage[iPage] = pNew;
+        pCur->aiIdx[iPage] = pNew->leaf ? 0 : 1;
+        if( rc ) break;
+        
+        pDiv = pUp;
+        szDiv = szUp;
+        pgnoRight = pgnoNew;
+        iPage--;
+    }
+    
+    return rc;
+}
+
 /*
  ** Insert a new record into the BTree.  The key is given by (pKey,nKey)
  ** and the data is given by (pData,nData).  The cursor is used only to
@@ -6974,6 +7749,7 @@ SQLITE_PRIVATE int sqlite3BtreeInsert(
     int loc = seekResult;          /* -1: before desired location  +1: after */
     int szNew = 0;
     int idx;
+    int bAppend = 0;               /* True if appending to an intkey table */
     MemPage *pPage;
     Btree *p = pCur->pBtree;
     BtShared *pBt = p->pBt;
@@ -7039,6 +7815,30 @@ SQLITE_PRIVATE int sqlite3BtreeInsert(
     if( rc ) goto end_insert;
     assert( szNew==cellSizePtr(pPage, newCell) );
     assert( szNew <= MX_CELL_SIZE(pBt) );
+    
+    /* If this cursor is bulk loading presorted data and the new entry sorts
+     ** after the last entry in the tree, append it to the right-hand edge of
+     ** the tree and leave the cursor pointing at it. If the next entry is
+     ** also an append, btreeMoveto() does not need to search for it. */
+    if( loc<0 && (pCur->hints & BTREE_BULKLOAD)
+       && pCur->pgnoRoot!=1 && btreeCursorIsRightmost(pCur)
+       ){
+        rc = btreeBulkAppend(pCur, newCell, szNew);
+        pCur->info.nSize = 0;
+        pCur->validNKey = 0;
+        if( rc==SQLITE_OK ){
+            pCur->eState = CURSOR_VALID;
+            pCur->atLast = 1;
+            if( pCur->pKeyInfo==0 ){
+                pCur->validNKey = 1;
+                pCur->info.nKey = nKey;
+            }
+        }else{
+            pCur->eState = CURSOR_INVALID;
+        }
+        goto end_insert;
+    }
+    
     idx = pCur->aiIdx[pCur->iPage];
     if( loc==0 ){
         u16 szOld;
@@ -7057,6 +7857,7 @@ SQLITE_PRIVATE int sqlite3BtreeInsert(
         if( rc ) goto end_insert;
     }else if( loc<0 && pPage->nCell>0 ){
         assert( pPage->leaf );
+        bAppend = pPage->intKey && btreeCursorIsRightmost(pCur);
         idx = ++pCur->aiIdx[pCur->iPage];
     }else{
         assert( pPage->leaf );
@@ -7095,9 +7896,31 @@ SQLITE_PRIVATE int sqlite3BtreeInsert(
          ** from trying to save the current position of the cursor.  */
         pCur->apPage[pCur->iPage]->nOverflow = 0;
         pCur->eState = CURSOR_INVALID;
+        
+        /* If the new row was appended to the table and balance() was able to
+         ** leave the cursor on the new right-most leaf created for it by
+         ** balance_quick(), the cursor still points at the last entry. */
+        if( rc==SQLITE_OK && bAppend && pCur->apPage[pCur->iPage]->leaf ){
+            assert( pCur->aiIdx[pCur->iPage]==0 );
+            assert( pCur->apPage[pCur->iPage]->nCell==1 );
+            pCur->eState = CURSOR_VALID;
+        }else{
+            bAppend = 0;
+        }
     }
     assert( pCur->apPage[pCur->iPage]->nOverflow==0 );
     
+    /* Leave the cursor marked as pointing to the last entry, with the key
+     ** of that entry cached, so that if the next row inserted has a larger
+     ** integer key, sqlite3BtreeMovetoUnpacked() does not need to search the
+     ** tree from the root. This is the common case for tables that are only
+     ** ever appended to.  */
+    if( bAppend && rc==SQLITE_OK ){
+        pCur->atLast = 1;
+        pCur->validNKey = 1;
+        pCur->info.nKey = nKey;
+    }
+    
 end_insert:
     return rc;
 }
@@ -7219,6 +8042,133 @@ SQLITE_PRIVATE int sqlite3BtreeDelete(BtCursor *pCur){
     return rc;
 }
 
+/*
+ ** Delete every entry of the intkey table b-tree opened by write cursor
+ ** pCur whose integer key lies in the closed range iLo..iHi.  If pnChange
+ ** is not NULL, *pnChange is incremented by the number of entries removed.
+ **
+ ** Rather than seeking and rebalancing once per entry as a sequence of
+ ** sqlite3BtreeDelete() calls would, each pass of the loop below removes
+ ** the whole run of qualifying cells from one leaf.  If that run reaches
+ ** the end of the leaf, the cursor path is then walked upwards and any
+ ** complete sibling sub-trees whose divider keys show they lie entirely
+ ** inside the range are returned to the freelist with clearDatabasePage()
+ ** without visiting their cells one at a time.  The tree is balanced once
+ ** per pass.  Right-child pointers are never removed and no interior page
+ ** is left without cells, so the structure balance() expects is preserved.
+ **
+ ** The update hook is not invoked for the rows removed.  Incrblob cursors
+ ** open on the table are invalidated, as for sqlite3BtreeClearTable().
+ ** On success the cursor is left pointing at the root page.
+ */
+SQLITE_PRIVATE int sqlite3BtreeDeleteRange(
+    BtCursor *pCur,                      /* Write cursor on an intkey table */
+    i64 iLo,                             /* Smallest key to delete */
+    i64 iHi,                             /* Largest key to delete */
+    int *pnChange                        /* Add number of entries deleted */
+){
+    Btree *p = pCur->pBtree;
+    BtShared *pBt = p->pBt;
+    int rc;                              /* Return code */
+    int nChange = 0;                     /* Number of entries deleted */
+    
+    assert( cursorHoldsMutex(pCur) );
+    assert( pBt->inTransaction==TRANS_WRITE );
+    assert( (pBt->btsFlags & BTS_READ_ONLY)==0 );
+    assert( pCur->wrFlag );
+    assert( pCur->pKeyInfo==0 );
+    assert( hasSharedCacheTableLock(p, pCur->pgnoRoot, 0, 2) );
+    assert( !hasReadConflicts(p, pCur->pgnoRoot) );
+    
+    if( iLo>iHi ) return SQLITE_OK;
+    
+    rc = saveAllCursors(pBt, pCur->pgnoRoot, pCur);
+    if( rc ) return rc;
+    invalidateIncrblobCursors(p, 0, 1);
+    
+    while( rc==SQLITE_OK ){
+        MemPage *pLeaf;                  /* Leaf page the cursor points to */
+        int iFirst;                      /* First cell of pLeaf to delete */
+        int iEnd;                        /* One past the last cell to delete */
+        int nCell;                       /* Number of cells on pLeaf initially */
+        int iLevel;                      /* Depth of interior page being pruned */
+        int i;
+        int res;
+        CellInfo info;
+        
+        rc = sqlite3BtreeMovetoUnpacked(pCur, 0, iLo, 0, &res);
+        if( rc || pCur->eState!=CURSOR_VALID ) break;
+        if( res<0 ){
+            rc = sqlite3BtreeNext(pCur, &res);
+            if( rc || res ) break;
+        }
+        
+        /* Find the run of cells on the current leaf with keys no greater
+         ** than iHi and remove them, last first so that dropCell() shifts
+         ** as few cell pointers as possible.  */
+        pLeaf = pCur->apPage[pCur->iPage];
+        if( NEVER(!pLeaf->leaf || !pLeaf->hasData) ){
+            rc = SQLITE_CORRUPT_BKPT;
+            break;
+        }
+        nCell = pLeaf->nCell;
+        iFirst = pCur->aiIdx[pCur->iPage];
+        for(iEnd=iFirst; iEnd<nCell; iEnd++){
+            btreeParseCell(pLeaf, iEnd, &info);
+            if( info.nKey>iHi ) break;
+        }
+        if( iEnd==iFirst ) break;
+        
+        rc = sqlite3PagerWrite(pLeaf->pDbPage);
+        for(i=iEnd-1; rc==SQLITE_OK && i>=iFirst; i--){
+            unsigned char *pCell = findCell(pLeaf, i);
+            rc = clearCell(pLeaf, pCell);
+            dropCell(pLeaf, i, cellSizePtr(pLeaf, pCell), &rc);
+        }
+        if( rc ) break;
+        nChange += iEnd - iFirst;
+        
+        /* If every key from iFirst to the end of the leaf was deleted, the
+         ** sub-trees that follow the cursor path at each level may also lie
+         ** wholly within the range.  A sibling sub-tree to the right of the
+         ** path holds keys greater than those just deleted and no greater
+         ** than its divider key, so it can be dropped whenever that divider
+         ** is no greater than iHi.  Move up a level only while the path
+         ** follows the right-child pointer, as only then has everything to
+         ** the right of the path at the lower level been consumed.  */
+        for(iLevel=pCur->iPage-1; iEnd==nCell && iLevel>=0; iLevel--){
+            MemPage *pParent = pCur->apPage[iLevel];
+            int iIdx = pCur->aiIdx[iLevel];
+            
+            if( iIdx+1<pParent->nCell ){
+                rc = sqlite3PagerWrite(pParent->pDbPage);
+            }
+            while( rc==SQLITE_OK && iIdx+1<pParent->nCell ){
+                unsigned char *pCell = findCell(pParent, iIdx+1);
+                btreeParseCellPtr(pParent, pCell, &info);
+                if( info.nKey>iHi ) break;
+                rc = clearDatabasePage(pBt, get4byte(pCell), 1, &nChange);
+                dropCell(pParent, iIdx+1, cellSizePtr(pParent, pCell), &rc);
+            }
+            if( rc || iIdx<pParent->nCell ) break;
+        }
+        if( rc ) break;
+        
+        rc = balance(pCur);
+        if( rc==SQLITE_OK ){
+            moveToRoot(pCur);
+        }
+    }
+    
+    if( rc==SQLITE_OK ){
+        moveToRoot(pCur);
+    }
+    if( pnChange ){
+        *pnChange += nChange;
+    }
+    return rc;
+}
+
 /*
  ** Create a new BTree table.  Write into *piTable the page
  ** number for the root page of the new table.
@@ -7731,6 +8681,122 @@ SQLITE_PRIVATE int sqlite3BtreeCount(BtCursor *pCur, i64 *pnEntry){
 }
 #endif
 
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+/*
+ ** When sqlite3BtreeSplitKeys() divides a b-tree into nPart ranges, it
+ ** looks below the root page if the root page has fewer than this many
+ ** children for each range.
+ */
+#define BTREE_SPLIT_MIN 4
+
+/*
+ ** Append the key of cell iCell of interior intkey page pPage to the
+ ** array *paKey, which holds *pnKey keys and has space for *pnAlloc.
+ */
+static int splitKeyAppend(
+    MemPage *pPage,                      /* Interior page of an intkey b-tree */
+    int iCell,                           /* Cell to read the key from */
+    i64 **paKey,                         /* IN/OUT: Array of keys */
+    int *pnKey,                          /* IN/OUT: Keys in *paKey */
+    int *pnAlloc                         /* IN/OUT: Allocated size of *paKey */
+){
+    i64 iKey;
+    if( *pnKey>=*pnAlloc ){
+        int nNew = *pnAlloc ? *pnAlloc*2 : 256;
+        i64 *aNew = (i64*)sqlite3Realloc(*paKey, nNew*sizeof(i64));
+        if( aNew==0 ) return SQLITE_NOMEM;
+        *paKey = aNew;
+        *pnAlloc = nNew;
+    }
+    getVarint(findCell(pPage, iCell)+4, (u64*)&iKey);
+    (*paKey)[(*pnKey)++] = iKey;
+    return SQLITE_OK;
+}
+
+/*
+ ** The first argument, pCur, is a cursor opened on an intkey b-tree.  Find
+ ** up to nPart-1 keys that divide the b-tree into nPart ranges of roughly
+ ** equal numbers of pages, write them to aKey[] in increasing order, and
+ ** set *pnKey to the number written.  Range i holds the entries with keys
+ ** greater than aKey[i-1] (if i>0) and no greater than aKey[i] (if
+ ** i<*pnKey).
+ **
+ ** The keys are taken from the interior cells of the root page and, if the
+ ** root page has too few children to divide the b-tree evenly, from the
+ ** interior cells of its children.  A b-tree of fewer than three levels
+ ** is not worth dividing, and *pnKey is set to zero for it.
+ **
+ ** On return the cursor does not point at a valid entry.
+ */
+SQLITE_PRIVATE int sqlite3BtreeSplitKeys(
+    BtCursor *pCur,                      /* Cursor on an intkey b-tree */
+    int nPart,                           /* Number of ranges wanted */
+    i64 *aKey,                           /* OUT: nPart-1 or fewer keys */
+    int *pnKey                           /* OUT: Number of keys in aKey[] */
+){
+    i64 *aDiv = 0;                       /* Dividing keys, in order */
+    int nDiv = 0;                        /* Number of keys in aDiv[] */
+    int nAlloc = 0;                      /* Allocated size of aDiv[] */
+    int bDeep;                           /* True to read the root's children */
+    MemPage *pRoot;                      /* Root page of the b-tree */
+    int nKey = 0;
+    int i, j;
+    int rc;
+    
+    *pnKey = 0;
+    if( pCur->pgnoRoot==0 || nPart<2 ) return SQLITE_OK;
+    rc = moveToRoot(pCur);
+    if( rc!=SQLITE_OK ) return rc;
+    pRoot = pCur->apPage[0];
+    if( pRoot->leaf || !pRoot->intKey ) return SQLITE_OK;
+    bDeep = (pRoot->nCell+1 < nPart*BTREE_SPLIT_MIN);
+    
+    for(i=0; rc==SQLITE_OK && i<=pRoot->nCell; i++){
+        MemPage *pChild;
+        Pgno pgno;
+        if( i==0 || bDeep ){
+            if( i<pRoot->nCell ){
+                pgno = get4byte(findCell(pRoot, i));
+            }else{
+                pgno = get4byte(&pRoot->aData[pRoot->hdrOffset+8]);
+            }
+            pCur->aiIdx[0] = (u16)i;
+            rc = moveToChild(pCur, pgno);
+            if( rc!=SQLITE_OK ) break;
+            pChild = pCur->apPage[1];
+            if( pChild->leaf ){
+                /* All children of the root are leaves */
+                moveToParent(pCur);
+                break;
+            }
+            for(j=0; bDeep && rc==SQLITE_OK && j<pChild->nCell; j++){
+                rc = splitKeyAppend(pChild, j, &aDiv, &nDiv, &nAlloc);
+            }
+            moveToParent(pCur);
+        }
+        if( rc==SQLITE_OK && i<pRoot->nCell ){
+            rc = splitKeyAppend(pRoot, i, &aDiv, &nDiv, &nAlloc);
+        }
+    }
+    
+    /* If the loop above ran to completion, aDiv[] divides the b-tree into
+     ** nDiv+1 subtrees of similar size.  Pick every (nDiv+1)/nPart'th key,
+     ** skipping any that are out of order in a corrupt b-tree. */
+    if( rc==SQLITE_OK && i>pRoot->nCell ){
+        for(j=1; j<nPart; j++){
+            int iDiv = (int)(((i64)j*(nDiv+1))/nPart) - 1;
+            if( iDiv>=0 && iDiv<nDiv && (nKey==0 || aDiv[iDiv]>aKey[nKey-1]) ){
+                aKey[nKey++] = aDiv[iDiv];
+            }
+        }
+    }
+    sqlite3_free(aDiv);
+    pCur->eState = CURSOR_INVALID;
+    *pnKey = nKey;
+    return rc;
+}
+#endif
+
 /*
  ** Return the pager associated with a BTree.  This routine is used for
  ** testing and debugging only.
@@ -7787,6 +8853,32 @@ static void setPageReferenced(IntegrityCk *pCheck, Pgno iPg){
     pCheck->aPgRef[iPg/8] |= (1 << (iPg & 0x07));
 }
 
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+/*
+ ** Add page iPg to the list of pages marked by the tree being checked.
+ ** Runs of consecutive pages are stored as a single range.
+ */
+static void checkRecordPage(IntegrityCk *pCheck, Pgno iPg){
+    int n = pCheck->nRange;
+    if( n>0 && pCheck->aRange[n*2-1]+1==iPg ){
+        pCheck->aRange[n*2-1] = iPg;
+        return;
+    }
+    if( n>=pCheck->nRangeAlloc ){
+        int nNew = pCheck->nRangeAlloc ? pCheck->nRangeAlloc*2 : 64;
+        Pgno *aNew = (Pgno*)sqlite3_realloc(pCheck->aRange, nNew*2*sizeof(Pgno));
+        if( aNew==0 ){
+            pCheck->mallocFailed = 1;
+            return;
+        }
+        pCheck->aRange = aNew;
+        pCheck->nRangeAlloc = nNew;
+    }
+    pCheck->aRange[n*2] = iPg;
+    pCheck->aRange[n*2+1] = iPg;
+    pCheck->nRange++;
+}
+#endif
 
 /*
  ** Add 1 to the reference count for page iPage.  If this is the second
@@ -7807,6 +8899,9 @@ static int checkRef(IntegrityCk *pCheck, Pgno iPage, char *zContext){
         return 1;
     }
     setPageReferenced(pCheck, iPage);
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    if( pCheck->bRecord ) checkRecordPage(pCheck, iPage);
+#endif
     return 0;
 }
 
@@ -7914,6 +9009,31 @@ static void checkList(
 #endif /* SQLITE_OMIT_INTEGRITY_CHECK */
 
 #ifndef SQLITE_OMIT_INTEGRITY_CHECK
+/*
+ ** pPage is an interior page that checkTreePage() is about to descend
+ ** through.  Ask the pager to start reading every child page that has not
+ ** been checked yet, so that the reads of a whole level of the tree are
+ ** issued to the operating system together rather than one at a time as
+ ** the recursion reaches each child.  The checks themselves still run in
+ ** the usual order, so the error report is unchanged.
+ */
+static void checkPrefetchChildren(IntegrityCk *pCheck, MemPage *pPage){
+    int i;
+    Pgno pgno;
+    
+    assert( !pPage->leaf );
+    for(i=0; i<=pPage->nCell; i++){
+        if( i==pPage->nCell ){
+            pgno = get4byte(&pPage->aData[pPage->hdrOffset+8]);
+        }else{
+            pgno = get4byte(findCell(pPage, i));
+        }
+        if( pgno>0 && pgno<=pCheck->nPage && !getPageReferenced(pCheck, pgno) ){
+            sqlite3PagerPrefetch(pCheck->pPager, pgno);
+        }
+    }
+}
+
 /*
  ** Do various sanity checks on a single page of a tree.  Return
  ** the tree depth.  Root pages return 0.  Parents of root pages
@@ -7976,6 +9096,10 @@ static int checkTreePage(
         return 0;
     }
     
+    if( !pPage->leaf ){
+        checkPrefetchChildren(pCheck, pPage);
+    }
+    
     /* Check out all the cells.
      */
     depth = 0;
@@ -8142,6 +9266,154 @@ static int checkTreePage(
 }
 #endif /* SQLITE_OMIT_INTEGRITY_CHECK */
 
+#if !defined(SQLITE_OMIT_INTEGRITY_CHECK) && !defined(SQLITE_OMIT_PARALLEL_SCAN)
+/*
+ ** Check trees of btree p, each one on its own as if it were the only
+ ** tree in the file, for a parallel integrity check.  xNext(pArg) is
+ ** called to obtain the index in aRoot[] of each tree to check, until it
+ ** returns a negative value.  The result for tree i is written to
+ ** apTree[i], which is left NULL if the tree could not be checked.  At
+ ** most mxErr messages are reported for each tree.
+ **
+ ** Several threads may run this at once, each with its own connection to
+ ** the same database file, as long as xNext() never returns the same
+ ** index twice.  A read transaction must be open on p.
+ */
+SQLITE_PRIVATE void sqlite3BtreeIntegrityTrees(
+    Btree *p,                       /* The btree to be checked */
+    int *aRoot,                     /* Root pages of the trees */
+    int mxErr,                      /* Stop reporting errors after this many */
+    int (*xNext)(void*),            /* Return the next tree to check */
+    void *pArg,                     /* First argument to xNext() */
+    IntegrityTree **apTree          /* OUT: One result for each aRoot[] */
+){
+    IntegrityCk sCheck;
+    BtShared *pBt = p->pBt;
+    char zErr[100];
+    int iTree;
+    Pgno i;
+    
+    sqlite3BtreeEnter(p);
+    assert( p->inTrans>TRANS_NONE && pBt->inTransaction>TRANS_NONE );
+    memset(&sCheck, 0, sizeof(sCheck));
+    sCheck.pBt = pBt;
+    sCheck.pPager = pBt->pPager;
+    sCheck.nPage = btreePagecount(pBt);
+    if( sCheck.nPage==0 ){
+        sqlite3BtreeLeave(p);
+        return;
+    }
+    sCheck.aPgRef = sqlite3MallocZero((sCheck.nPage / 8)+ 1);
+    if( !sCheck.aPgRef ){
+        sqlite3BtreeLeave(p);
+        return;
+    }
+    i = PENDING_BYTE_PAGE(pBt);
+    if( i<=sCheck.nPage ) setPageReferenced(&sCheck, i);
+    sCheck.bRecord = 1;
+    
+    while( (iTree = xNext(pArg))>=0 ){
+        IntegrityTree *pTree;
+        char *z;
+        int j;
+        
+        sCheck.mxErr = mxErr;
+        sCheck.nErr = 0;
+        sCheck.mallocFailed = 0;
+        sCheck.nRange = 0;
+        sqlite3StrAccumInit(&sCheck.errMsg, zErr, sizeof(zErr), SQLITE_MAX_LENGTH);
+        sCheck.errMsg.useMalloc = 2;
+        checkTreePage(&sCheck, aRoot[iTree], "List of tree roots: ", NULL, NULL);
+        
+        /* Clear the bits set by this tree, so that the next one is checked
+         ** as if it were the first. */
+        for(j=0; j<sCheck.nRange; j++){
+            for(i=sCheck.aRange[j*2]; i<=sCheck.aRange[j*2+1]; i++){
+                sCheck.aPgRef[i/8] &= ~(1 << (i & 0x07));
+            }
+        }
+        
+        z = sCheck.nErr ? sqlite3StrAccumFinish(&sCheck.errMsg) : 0;
+        if( sCheck.nErr==0 ) sqlite3StrAccumReset(&sCheck.errMsg);
+        pTree = 0;
+        if( !sCheck.mallocFailed && sCheck.errMsg.accError==0 ){
+            pTree = (IntegrityTree*)sqlite3MallocZero(
+                          sizeof(IntegrityTree) + sCheck.nRange*2*sizeof(Pgno));
+        }
+        if( pTree==0 ){
+            sqlite3_free(z);
+            continue;
+        }
+        pTree->nPage = sCheck.nPage;
+        pTree->nErr = sCheck.nErr;
+        pTree->zErr = z;
+        pTree->nRange = sCheck.nRange;
+        pTree->aRange = (Pgno*)&pTree[1];
+        if( sCheck.nRange ){
+            memcpy(pTree->aRange, sCheck.aRange, sCheck.nRange*2*sizeof(Pgno));
+        }
+        apTree[iTree] = pTree;
+    }
+    
+    sqlite3BtreeLeave(p);
+    sqlite3_free(sCheck.aRange);
+    sqlite3_free(sCheck.aPgRef);
+}
+
+/*
+ ** Free a result returned by sqlite3BtreeIntegrityTrees().
+ */
+SQLITE_PRIVATE void sqlite3BtreeIntegrityTreeFree(IntegrityTree *pTree){
+    if( pTree ){
+        sqlite3_free(pTree->zErr);
+        sqlite3_free(pTree);
+    }
+}
+
+/*
+ ** Add the result of checking a tree on its own to pCheck, if that gives
+ ** exactly what checking the tree in place would have given, and return
+ ** true.  Otherwise return false, and the caller checks the tree itself.
+ **
+ ** Checking a tree only depends on the pages already marked when it
+ ** reaches them.  If none of the pages the tree marked on its own were
+ ** marked by the freelist or by an earlier tree, the check in place would
+ ** have visited the same pages and reported the same messages.  The
+ ** report is only used if it stops short of the remaining error limit,
+ ** because in place the check stops once that limit is reached.
+ */
+static int checkMergeTree(IntegrityCk *pCheck, IntegrityTree *pTree){
+    Pgno iPg;
+    int j;
+    
+    if( pTree==0 || pTree->nPage!=pCheck->nPage || pTree->nErr>=pCheck->mxErr ){
+        return 0;
+    }
+    for(j=0; j<pTree->nRange; j++){
+        for(iPg=pTree->aRange[j*2]; iPg<=pTree->aRange[j*2+1]; iPg++){
+            if( getPageReferenced(pCheck, iPg) ) return 0;
+        }
+    }
+    for(j=0; j<pTree->nRange; j++){
+        for(iPg=pTree->aRange[j*2]; iPg<=pTree->aRange[j*2+1]; iPg++){
+            setPageReferenced(pCheck, iPg);
+        }
+    }
+    if( pTree->nErr ){
+        if( pCheck->errMsg.nChar ){
+            sqlite3StrAccumAppend(&pCheck->errMsg, "\n", 1);
+        }
+        sqlite3StrAccumAppend(&pCheck->errMsg, pTree->zErr, -1);
+        if( pCheck->errMsg.accError==STRACCUM_NOMEM ){
+            pCheck->mallocFailed = 1;
+        }
+        pCheck->nErr += pTree->nErr;
+        pCheck->mxErr -= pTree->nErr;
+    }
+    return 1;
+}
+#endif
+
 #ifndef SQLITE_OMIT_INTEGRITY_CHECK
 /*
  ** This routine does a complete check of the given BTree file.  aRoot[] is
@@ -8151,6 +9423,12 @@ static int checkTreePage(
  ** A read-only or read-write transaction must be opened before calling
  ** this function.
  **
+ ** If apTree is not NULL, apTree[i] may hold the result of checking tree
+ ** aRoot[i] on its own, made by sqlite3BtreeIntegrityTrees() on another
+ ** thread.  Each such result is used if it is the same as checking the
+ ** tree here would give, so the report does not depend on whether or how
+ ** the work was divided.
+ **
  ** Write the number of error seen in *pnErr.  Except for some memory
  ** allocation errors,  an error message held in memory obtained from
  ** malloc is returned if *pnErr is non-zero.  If *pnErr==0 then NULL is
@@ -8161,7 +9439,8 @@ SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(
                                                 int *aRoot,   /* An array of root pages numbers for individual trees */
                                                 int nRoot,    /* Number of entries in aRoot[] */
                                                 int mxErr,    /* Stop reporting errors after this many */
-                                                int *pnErr    /* Write number of errors seen to this variable */
+                                                int *pnErr,   /* Write number of errors seen to this variable */
+                                                IntegrityTree **apTree /* Trees checked on other threads, or NULL */
 ){
     Pgno i;
     int nRef;
@@ -8169,6 +9448,9 @@ SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(
     BtShared *pBt = p->pBt;
     char zErr[100];
     
+#ifdef SQLITE_OMIT_PARALLEL_SCAN
+    UNUSED_PARAMETER(apTree);
+#endif
     sqlite3BtreeEnter(p);
     assert( p->inTrans>TRANS_NONE && pBt->inTransaction>TRANS_NONE );
     nRef = sqlite3PagerRefcount(pBt->pPager);
@@ -8178,6 +9460,9 @@ SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(
     sCheck.mxErr = mxErr;
     sCheck.nErr = 0;
     sCheck.mallocFailed = 0;
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    sCheck.bRecord = 0;
+#endif
     *pnErr = 0;
     if( sCheck.nPage==0 ){
         sqlite3BtreeLeave(p);
@@ -8208,6 +9493,9 @@ SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(
         if( pBt->autoVacuum && aRoot[i]>1 ){
             checkPtrmap(&sCheck, aRoot[i], PTRMAP_ROOTPAGE, 0, 0);
         }
+#endif
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+        if( apTree && checkMergeTree(&sCheck, apTree[i]) ) continue;
 #endif
         checkTreePage(&sCheck, aRoot[i], "List of tree roots: ", NULL, NULL);
     }
@@ -8285,6 +9573,78 @@ SQLITE_PRIVATE const char *sqlite3BtreeGetJournalname(Btree *p){
     return sqlite3PagerJournalname(p->pBt->pPager);
 }
 
+#ifndef SQLITE_OMIT_SCHEMA_SNAPSHOT
+/*
+ ** Compute a checksum of the content of the sqlite_master table, that is
+ ** of the rowid and record of every row, and write it to *pCksum.  A read
+ ** transaction must be open.  Rows are hashed whatever pages they are
+ ** stored on, so the result does not depend on how the table is laid out
+ ** and does not miss a change made to a page other than page 1.  Together
+ ** with the schema cookie this tells whether a schema snapshot taken
+ ** earlier describes this file.
+ **
+ ** This reads every page of sqlite_master, but does not parse any of the
+ ** CREATE statements.  SQLITE_OK is returned on success, or an error code
+ ** if the table cannot be read.
+ */
+SQLITE_PRIVATE int sqlite3BtreeSchemaChecksum(Btree *p, u32 *pCksum){
+    BtCursor *pCur;
+    u32 h = 0x811c9dc5;
+    int res = 0;
+    int rc;
+    
+    assert( sqlite3BtreeHoldsMutex(p) );
+    assert( p->inTrans>TRANS_NONE );
+    pCur = (BtCursor*)sqlite3MallocZero(sizeof(BtCursor));
+    if( pCur==0 ) return SQLITE_NOMEM;
+    rc = btreeCursor(p, MASTER_ROOT, 0, 0, pCur);
+    if( rc==SQLITE_OK ){
+        rc = sqlite3BtreeFirst(pCur, &res);
+    }
+    while( rc==SQLITE_OK && res==0 ){
+        u8 aBuf[512];
+        const u8 *a;
+        i64 iKey;
+        u32 nData;
+        u32 iOff;
+        int nLocal;
+        int i;
+        
+        VVA_ONLY(rc =) sqlite3BtreeKeySize(pCur, &iKey);
+        assert( rc==SQLITE_OK );
+        VVA_ONLY(rc =) sqlite3BtreeDataSize(pCur, &nData);
+        assert( rc==SQLITE_OK );
+        for(i=0; i<8; i++){
+            h = (h ^ (u8)(iKey>>(i*8))) * 0x01000193;
+        }
+        h = (h ^ nData) * 0x01000193;
+        
+        /* Hash the part of the record on the b-tree page in place, then
+         ** copy the overflow part out in chunks. */
+        a = (const u8*)sqlite3BtreeDataFetch(pCur, &nLocal);
+        if( a==0 || (u32)nLocal>nData ) nLocal = 0;
+        for(i=0; i<nLocal; i++){
+            h = (h ^ a[i]) * 0x01000193;
+        }
+        for(iOff=nLocal; rc==SQLITE_OK && iOff<nData; iOff+=sizeof(aBuf)){
+            u32 n = nData - iOff;
+            if( n>sizeof(aBuf) ) n = sizeof(aBuf);
+            rc = sqlite3BtreeData(pCur, iOff, n, aBuf);
+            for(i=0; rc==SQLITE_OK && i<(int)n; i++){
+                h = (h ^ aBuf[i]) * 0x01000193;
+            }
+        }
+        if( rc==SQLITE_OK ){
+            rc = sqlite3BtreeNext(pCur, &res);
+        }
+    }
+    sqlite3BtreeCloseCursor(pCur);
+    sqlite3_free(pCur);
+    *pCksum = h;
+    return rc;
+}
+#endif
+
 /*
  ** Return non-zero if a transaction is active.
  */
@@ -8364,6 +9724,27 @@ SQLITE_PRIVATE void *sqlite3BtreeSchema(Btree *p, int nBytes, void(*xFree)(void
     return pBt->pSchema;
 }
 
+/*
+ ** This function is like sqlite3BtreeSchema(), except that the blob of
+ ** memory belongs to the Btree handle p rather than to the shared-btree.
+ ** Each connection that opens the database gets a blob of its own, even
+ ** when the shared-btree itself is shared between connections.
+ **
+ ** As for sqlite3BtreeSchema(), nBytes is ignored once the blob has been
+ ** allocated, and a null pointer is returned if nBytes is 0 and it has
+ ** not.  The xFree function is invoked on the blob when the handle is
+ ** closed, before any of its cursors or transactions are.  It should not
+ ** call sqlite3_free() on the blob itself.
+ */
+SQLITE_PRIVATE void *sqlite3BtreeConnData(Btree *p, int nBytes, void(*xFree)(void *)){
+    assert( sqlite3_mutex_held(p->db->mutex) );
+    if( !p->pConnData && nBytes ){
+        p->pConnData = sqlite3MallocZero(nBytes);
+        p->xFreeConnData = xFree;
+    }
+    return p->pConnData;
+}
+
 /*
  ** Return SQLITE_LOCKED_SHAREDCACHE if another user of the same shared 
  ** btree as the argument handle holds an exclusive lock on the 
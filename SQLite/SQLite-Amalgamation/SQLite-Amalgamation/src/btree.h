@@ -34,12 +34,24 @@
 #define BTREE_AUTOVACUUM_FULL 1        /* Do full auto-vacuum */
 #define BTREE_AUTOVACUUM_INCR 2        /* Incremental vacuum */
 
+/*
+ ** The percentage of each b-tree page that is filled with cells when a
+ ** b-tree is bulk loaded from presorted input (see BTREE_BULKLOAD).  The
+ ** remainder is left free so that later out-of-order inserts do not
+ ** immediately split every page.  May be changed at run-time using
+ ** "PRAGMA fill_factor".
+ */
+#ifndef SQLITE_DEFAULT_FILLFACTOR
+#define SQLITE_DEFAULT_FILLFACTOR 100
+#endif
+
 /*
  ** Forward declarations of structure
  */
 typedef struct Btree Btree;
 typedef struct BtCursor BtCursor;
 typedef struct BtShared BtShared;
+typedef struct IntegrityTree IntegrityTree;
 
 
 SQLITE_PRIVATE int sqlite3BtreeOpen(
@@ -72,6 +84,8 @@ SQLITE_PRIVATE int sqlite3BtreeGetPageSize(Btree*);
 SQLITE_PRIVATE int sqlite3BtreeMaxPageCount(Btree*,int);
 SQLITE_PRIVATE u32 sqlite3BtreeLastPage(Btree*);
 SQLITE_PRIVATE int sqlite3BtreeSecureDelete(Btree*,int);
+SQLITE_PRIVATE int sqlite3BtreeFillFactor(Btree*,int);
+SQLITE_PRIVATE void sqlite3BtreeDefragStat(Btree*,int,int,int*);
 SQLITE_PRIVATE int sqlite3BtreeGetReserve(Btree*);
 #if defined(SQLITE_HAS_CODEC) || defined(SQLITE_DEBUG)
 SQLITE_PRIVATE int sqlite3BtreeGetReserveNoMutex(Btree *p);
@@ -89,12 +103,16 @@ SQLITE_PRIVATE int sqlite3BtreeIsInTrans(Btree*);
 SQLITE_PRIVATE int sqlite3BtreeIsInReadTrans(Btree*);
 SQLITE_PRIVATE int sqlite3BtreeIsInBackup(Btree*);
 SQLITE_PRIVATE void *sqlite3BtreeSchema(Btree *, int, void(*)(void *));
+SQLITE_PRIVATE void *sqlite3BtreeConnData(Btree *, int, void(*)(void *));
 SQLITE_PRIVATE int sqlite3BtreeSchemaLocked(Btree *pBtree);
 SQLITE_PRIVATE int sqlite3BtreeLockTable(Btree *pBtree, int iTab, u8 isWriteLock);
 SQLITE_PRIVATE int sqlite3BtreeSavepoint(Btree *, int, int);
 
 SQLITE_PRIVATE const char *sqlite3BtreeGetFilename(Btree *);
 SQLITE_PRIVATE const char *sqlite3BtreeGetJournalname(Btree *);
+#ifndef SQLITE_OMIT_SCHEMA_SNAPSHOT
+SQLITE_PRIVATE int sqlite3BtreeSchemaChecksum(Btree*, u32*);
+#endif
 SQLITE_PRIVATE int sqlite3BtreeCopyFile(Btree *, Btree *);
 
 SQLITE_PRIVATE int sqlite3BtreeIncrVacuum(Btree *);
@@ -169,6 +187,7 @@ SQLITE_PRIVATE int sqlite3BtreeMovetoUnpacked(
                                               );
 SQLITE_PRIVATE int sqlite3BtreeCursorHasMoved(BtCursor*, int*);
 SQLITE_PRIVATE int sqlite3BtreeDelete(BtCursor*);
+SQLITE_PRIVATE int sqlite3BtreeDeleteRange(BtCursor*, i64 iLo, i64 iHi, int *pnChange);
 SQLITE_PRIVATE int sqlite3BtreeInsert(BtCursor*, const void *pKey, i64 nKey,
                                       const void *pData, int nData,
                                       int nZero, int bias, int seekResult);
@@ -186,7 +205,8 @@ SQLITE_PRIVATE int sqlite3BtreeData(BtCursor*, u32 offset, u32 amt, void*);
 SQLITE_PRIVATE void sqlite3BtreeSetCachedRowid(BtCursor*, sqlite3_int64);
 SQLITE_PRIVATE sqlite3_int64 sqlite3BtreeGetCachedRowid(BtCursor*);
 
-SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(Btree*, int *aRoot, int nRoot, int, int*);
+SQLITE_PRIVATE char *sqlite3BtreeIntegrityCheck(Btree*, int *aRoot, int nRoot, int, int*,
+                                                IntegrityTree**);
 SQLITE_PRIVATE struct Pager *sqlite3BtreePager(Btree*);
 
 SQLITE_PRIVATE int sqlite3BtreePutData(BtCursor*, u32 offset, u32 amt, void*);
@@ -202,6 +222,20 @@ SQLITE_PRIVATE int sqlite3BtreeCursorIsValid(BtCursor*);
 #ifndef SQLITE_OMIT_BTREECOUNT
 SQLITE_PRIVATE int sqlite3BtreeCount(BtCursor *, i64 *);
 #endif
+/*
+ ** The parallel table scan is part of OP_AggScan.
+ */
+#if defined(SQLITE_OMIT_BATCH_AGGREGATE) && !defined(SQLITE_OMIT_PARALLEL_SCAN)
+# define SQLITE_OMIT_PARALLEL_SCAN 1
+#endif
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+SQLITE_PRIVATE int sqlite3BtreeSplitKeys(BtCursor*, int, i64*, int*);
+# ifndef SQLITE_OMIT_INTEGRITY_CHECK
+SQLITE_PRIVATE void sqlite3BtreeIntegrityTrees(Btree*, int*, int, int (*)(void*), void*,
+                                               IntegrityTree**);
+SQLITE_PRIVATE void sqlite3BtreeIntegrityTreeFree(IntegrityTree*);
+# endif
+#endif
 
 #ifdef SQLITE_TEST
 SQLITE_PRIVATE int sqlite3BtreeCursorInfo(BtCursor*, int*, int);
@@ -231,6 +231,8 @@
 /* Forward declarations */
 typedef struct MemPage MemPage;
 typedef struct BtLock BtLock;
+typedef struct BtKeyCache BtKeyCache;
+typedef struct BtOvflIndex BtOvflIndex;
 
 /*
  ** This is a magic string that appears at the beginning of every
@@ -294,6 +296,10 @@ struct MemPage {
     u8 *aCellIdx;        /* The cell index area */
     DbPage *pDbPage;     /* Pager page handle */
     Pgno pgno;           /* Page number for this page */
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+    u32 iKeyGen;         /* BtKeyCache.iGen of decoded keys.  0 if none */
+    u8 nSearch;          /* Searches of this page since keys last decoded */
+#endif
 };
 
 /*
@@ -303,6 +309,84 @@ struct MemPage {
  */
 #define EXTRA_SIZE sizeof(MemPage)
 
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+/*
+ ** The integer keys of frequently searched intkey pages are decoded into
+ ** an array of the following structures so that sqlite3BtreeMovetoUnpacked()
+ ** can search a contiguous i64 array instead of parsing a varint for every
+ ** probe of its binary search.  BtShared.aKeyCache[] is a direct-mapped cache
+ ** of BTREE_KEYCACHE_NSLOT entries indexed by page number.
+ **
+ ** The decoded keys of page P are valid only while P->iKeyGen is non-zero
+ ** and equal to the iGen of the slot for P.  Every routine that changes the
+ ** set of cells on a page or reloads its content sets MemPage.iKeyGen to
+ ** zero, and MemPage.iKeyGen is also zero for a page that has just been
+ ** read into the cache, so stale entries are never used.
+ */
+struct BtKeyCache {
+    Pgno pgno;           /* Page number whose keys are stored in aKey[] */
+    u32 iGen;            /* Generation.  Matches MemPage.iKeyGen if valid */
+    int nAlloc;          /* Number of entries allocated for aKey[] */
+    i64 *aKey;           /* Integer key of each cell, in cell order */
+};
+
+#ifndef BTREE_KEYCACHE_NSLOT
+# define BTREE_KEYCACHE_NSLOT 64
+#endif
+
+/* Pages with fewer cells than this are searched without decoding keys */
+#define BTREE_KEYCACHE_MINCELL 16
+
+/* Discard the decoded keys, if any, of page P */
+# define btreeKeyCacheInvalidate(P) ((P)->iKeyGen = 0)
+#else
+# define btreeKeyCacheInvalidate(P)
+#endif
+
+#ifndef SQLITE_OMIT_BTREE_OVFLINDEX
+/*
+ ** The page numbers of the overflow chains of recently accessed large
+ ** payloads are remembered in BtShared.aOvflIndex[], a direct-mapped cache
+ ** of BTREE_OVFLINDEX_NSLOT entries indexed by the first page of the chain.
+ ** accessPayload() uses it to jump straight to the overflow page that
+ ** holds a given payload offset instead of walking the chain from its
+ ** start, which makes partial reads at large offsets into big blobs cost
+ ** the same as reads near the start.
+ **
+ ** Unlike BtCursor.aOverflow[], an entry outlives cursor movement and
+ ** read transactions.  The whole cache is discarded when a write
+ ** transaction commits or rolls back, whenever autovacuum relocates a page,
+ ** and when the BtShared is closed.  It is also discarded at the start of
+ ** a read transaction if the pager cache has been reset or the file change
+ ** counter differs from its value when the cache was built, either of
+ ** which means some other connection may have rewritten the file.  The
+ ** entry for a single chain is dropped by clearCell() when the chain is
+ ** freed.
+ */
+struct BtOvflIndex {
+    Pgno iFirst;         /* First page of the overflow chain.  0 if unused */
+    u32 nOvfl;           /* Number of pages in the chain */
+    Pgno *aPgno;         /* aPgno[i] is page i of the chain, or 0 if unknown */
+};
+
+#ifndef BTREE_OVFLINDEX_NSLOT
+# define BTREE_OVFLINDEX_NSLOT 16
+#endif
+
+/* Chains shorter than this are walked without using BtShared.aOvflIndex */
+#define BTREE_OVFLINDEX_MINPAGE 8
+#endif
+
+/*
+ ** When sqlite3BtreeNext() or sqlite3BtreePrevious() steps onto a new leaf,
+ ** the pager is asked to prefetch this many of the following sibling leaves
+ ** (those next in the direction of the scan, as recorded in the parent page).
+ ** Set to 0 to disable.
+ */
+#ifndef SQLITE_BTREE_PREFETCH
+# define SQLITE_BTREE_PREFETCH 2
+#endif
+
 /*
  ** A linked list of the following structures is stored at BtShared.pLock.
  ** Locks are added (or upgraded from READ_LOCK to WRITE_LOCK) when a cursor
@@ -352,6 +436,8 @@ struct Btree {
     int nBackup;       /* Number of backup operations reading this btree */
     Btree *pNext;      /* List of other sharable Btrees from the same db */
     Btree *pPrev;      /* Back pointer of the same list */
+    void *pConnData;   /* Per-handle data. See sqlite3BtreeConnData() */
+    void (*xFreeConnData)(void*);  /* Destructor for pConnData */
 #ifndef SQLITE_OMIT_SHARED_CACHE
     BtLock lock;       /* Object used to lock page 1 */
 #endif
@@ -416,6 +502,7 @@ struct BtShared {
 #endif
     u8 inTransaction;     /* Transaction state */
     u8 max1bytePayload;   /* Maximum first byte of cell for a 1-byte payload */
+    u8 fillFactor;        /* Percent of each page used by bulk loads */
     u16 btsFlags;         /* Boolean parameters.  See BTS_* macros below */
     u16 maxLocal;         /* Maximum local payload in non-LEAFDATA tables */
     u16 minLocal;         /* Minimum local payload in non-LEAFDATA tables */
@@ -436,8 +523,31 @@ struct BtShared {
     Btree *pWriter;       /* Btree with currently open write transaction */
 #endif
     u8 *pTmpSpace;        /* BtShared.pageSize bytes of space for tmp use */
+    u8 *pBalanceSpace;    /* Reusable workspace for balance_nonroot() */
+    int szBalanceSpace;   /* Bytes allocated at pBalanceSpace */
+    u8 *apOvflSpace[2];   /* Page-size parent overflow buffers for balance() */
+#ifndef SQLITE_OMIT_BTREE_KEYCACHE
+    BtKeyCache *aKeyCache; /* Decoded keys of intkey pages, or NULL */
+    u32 iKeyGen;          /* Last generation assigned to a BtKeyCache slot */
+#endif
+#ifndef SQLITE_OMIT_BTREE_OVFLINDEX
+    BtOvflIndex *aOvflIndex; /* Overflow chains of large payloads, or NULL */
+    u32 iOvflReset;       /* sqlite3PagerResetCount() when aOvflIndex built */
+    u32 iOvflChange;      /* File change counter when aOvflIndex built */
+#endif
+    u32 aDefragStat[2];   /* Page defragmentations. BTREE_DEFRAG_xxx index */
 };
 
+/*
+ ** Indexes into BtShared.aDefragStat[].  BTREE_DEFRAG_FULL counts pages
+ ** rebuilt through the temp-space copy in defragmentPage(), and
+ ** BTREE_DEFRAG_INPLACE counts pages whose freeblocks were closed up in
+ ** place.  These are reported as SQLITE_DBSTATUS_DEFRAG_FULL and
+ ** SQLITE_DBSTATUS_DEFRAG_INPLACE.
+ */
+#define BTREE_DEFRAG_FULL     0
+#define BTREE_DEFRAG_INPLACE  1
+
 /*
  ** Allowed values for BtShared.btsFlags
  */
@@ -657,7 +767,31 @@ struct IntegrityCk {
     int nErr;         /* Number of messages written to zErrMsg so far */
     int mallocFailed; /* A memory allocation error has occurred */
     StrAccum errMsg;  /* Accumulate the error message text here */
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    u8 bRecord;       /* True to record the pages marked in aRange[] */
+    int nRange;       /* Number of ranges in aRange[] */
+    int nRangeAlloc;  /* Number of ranges allocated */
+    Pgno *aRange;     /* First and last page of each range marked */
+#endif
+};
+
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+/*
+ ** The result of checking a single tree on its own, as if no other tree
+ ** had been checked, by sqlite3BtreeIntegrityTrees().  aRange[] holds
+ ** nRange pairs of page numbers, the first and last pages of each run of
+ ** pages that the check marked as referenced.  zErr holds the nErr
+ ** messages reported, separated by newlines, or is NULL if there were
+ ** none.  aRange[] is allocated in the same block as the object itself.
+ */
+struct IntegrityTree {
+    Pgno nPage;       /* Size of the database as seen by the check */
+    int nErr;         /* Number of messages in zErr */
+    char *zErr;       /* Messages reported */
+    int nRange;       /* Number of ranges in aRange[] */
+    Pgno *aRange;     /* First and last page of each range */
 };
+#endif
 
 /*
  ** Routines to read or write a two- and four-byte big-endian integer values.
@@ -279,6 +279,9 @@ SQLITE_PRIVATE Table *sqlite3FindTable(sqlite3 *db, const char *zName, const cha
         if( zDatabase!=0 && sqlite3StrICmp(zDatabase, db->aDb[j].zName) ) continue;
         assert( sqlite3SchemaMutexHeld(db, j, 0) );
         p = sqlite3HashFind(&db->aDb[j].pSchema->tblHash, zName, nName);
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+        if( p==0 ) p = sqlite3LazySchemaTable(db, j, zName);
+#endif
         if( p ) break;
     }
     return p;
@@ -371,6 +374,9 @@ SQLITE_PRIVATE Index *sqlite3FindIndex(sqlite3 *db, const char *zName, const cha
         if( zDb && sqlite3StrICmp(zDb, db->aDb[j].zName) ) continue;
         assert( sqlite3SchemaMutexHeld(db, j, 0) );
         p = sqlite3HashFind(&pSchema->idxHash, zName, nName);
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+        if( p==0 ) p = sqlite3LazySchemaIndex(db, j, zName);
+#endif
         if( p ) break;
     }
     return p;
@@ -1983,6 +1989,9 @@ SQLITE_PRIVATE void sqlite3RootPageMoved(sqlite3 *db, int iDb, int iFrom, int iT
             pIdx->tnum = iTo;
         }
     }
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+    sqlite3LazySchemaRootPageMoved(pDb->pSchema, iFrom, iTo);
+#endif
 }
 #endif
 
@@ -3778,6 +3787,7 @@ static void reindexDatabases(Parse *pParse, char const *zColl){
     assert( sqlite3BtreeHoldsAllMutexes(db) );  /* Needed for schema access */
     for(iDb=0, pDb=db->aDb; iDb<db->nDb; iDb++, pDb++){
         assert( pDb!=0 );
+        sqlite3LazySchemaLoadAll(db, iDb);
         for(k=sqliteHashFirst(&pDb->pSchema->tblHash);  k; k=sqliteHashNext(k)){
             pTab = (Table*)sqliteHashData(k);
             reindexTable(pParse, pTab, zColl);
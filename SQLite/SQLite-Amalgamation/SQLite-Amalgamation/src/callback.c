@@ -419,6 +419,478 @@ SQLITE_PRIVATE FuncDef *sqlite3FindFunction(
     return 0;
 }
 
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+/*
+ ** Lazily loaded schemas.
+ **
+ ** When lazy loading is enabled on a database by sqlite3_lazy_schema(),
+ ** sqlite3InitOne() does not parse the CREATE TABLE statement of each
+ ** ordinary table.  It records the name, root page and SQL text of the
+ ** table as "pending" instead, along with the sqlite_master rows of the
+ ** indexes on the table.  The first time sqlite3FindTable() looks for a
+ ** pending table, or sqlite3FindIndex() looks for one of its indexes, the
+ ** saved rows are passed to sqlite3InitCallback() just as they would have
+ ** been when the schema was loaded.
+ **
+ ** Views, triggers, virtual tables, tables with a FOREIGN KEY clause and
+ ** tables whose names begin with "sqlite_" are parsed when the schema is
+ ** loaded, as usual.  Parsing a trigger looks up its table, so a table
+ ** with triggers is never pending for long.  A table with foreign keys
+ ** must be parsed so that Schema.fkeyHash is complete.
+ **
+ ** The pending state of a Schema lives in a SchemaLazy object allocated
+ ** immediately after it by sqlite3SchemaGet().  The rows of sqlite_stat1
+ ** that describe a pending table are set aside by sqlite3AnalysisLoad()
+ ** and applied when the table is parsed.
+ **
+ ** Code that walks every table or index of a schema calls
+ ** sqlite3LazySchemaLoadAll() first.
+ */
+typedef struct LazyTable LazyTable;
+typedef struct SchemaLazy SchemaLazy;
+
+/*
+ ** A pending table.  aRow[0] is the sqlite_master row of the table
+ ** itself.  The rows of its indexes follow, in sqlite_master order.
+ ** No connection's lookaside memory is used, as the object belongs to a
+ ** Schema that may be shared by several connections.
+ */
+struct LazyTable {
+    int nRow;                 /* Number of entries in aRow[] */
+    int nStat;                /* Number of entries in aStat[] */
+    struct LazyRow {          /* Saved rows of sqlite_master */
+        char *zName;            /* sqlite_master.name */
+        char *zSql;             /* sqlite_master.sql.  NULL for some indexes */
+        int tnum;               /* sqlite_master.rootpage */
+    } *aRow;
+    struct LazyStat {         /* Saved rows of sqlite_stat1 */
+        char *zIdx;             /* sqlite_stat1.idx.  May be NULL */
+        char *zStat;            /* sqlite_stat1.stat */
+    } *aStat;
+};
+
+/*
+ ** The pending tables of a Schema.  The key of each entry in tblHash is
+ ** the name of a pending table, and of each entry in idxHash the name of
+ ** an index on a pending table.  The data is the LazyTable in both cases.
+ */
+struct SchemaLazy {
+    u8 bEnabled;              /* True if sqlite3_lazy_schema() enabled this */
+    Hash tblHash;             /* Pending tables */
+    Hash idxHash;             /* Indexes of pending tables */
+};
+
+/*
+ ** The SchemaLazy object that follows Schema p.
+ */
+#define schemaLazy(p) ((SchemaLazy*)&((Schema*)(p))[1])
+#define SCHEMA_ALLOC_SIZE (sizeof(Schema)+sizeof(SchemaLazy))
+
+/*
+ ** Free a LazyTable that has already been removed from its hash tables.
+ */
+static void lazyTableFree(LazyTable *p){
+    int i;
+    for(i=0; i<p->nRow; i++){
+        sqlite3DbFree(0, p->aRow[i].zName);
+        sqlite3DbFree(0, p->aRow[i].zSql);
+    }
+    for(i=0; i<p->nStat; i++){
+        sqlite3DbFree(0, p->aStat[i].zIdx);
+        sqlite3DbFree(0, p->aStat[i].zStat);
+    }
+    sqlite3_free(p->aRow);
+    sqlite3_free(p->aStat);
+    sqlite3DbFree(0, p);
+}
+
+/*
+ ** Append a row of sqlite_master to pending table p.  Return SQLITE_OK,
+ ** or SQLITE_NOMEM if a malloc fails, in which case p is unchanged.
+ */
+static int lazyTableAddRow(
+    LazyTable *p,                 /* Pending table to add the row to */
+    const char *zName,            /* sqlite_master.name */
+    int tnum,                     /* sqlite_master.rootpage */
+    const char *zSql              /* sqlite_master.sql */
+){
+    struct LazyRow *aNew;
+    char *zNameCopy;
+    char *zSqlCopy = 0;
+    
+    aNew = (struct LazyRow*)sqlite3_realloc(p->aRow, (p->nRow+1)*sizeof(*aNew));
+    if( aNew==0 ) return SQLITE_NOMEM;
+    p->aRow = aNew;
+    zNameCopy = sqlite3DbStrDup(0, zName);
+    if( zSql ) zSqlCopy = sqlite3DbStrDup(0, zSql);
+    if( zNameCopy==0 || (zSql && zSqlCopy==0) ){
+        sqlite3DbFree(0, zNameCopy);
+        sqlite3DbFree(0, zSqlCopy);
+        return SQLITE_NOMEM;
+    }
+    aNew[p->nRow].zName = zNameCopy;
+    aNew[p->nRow].zSql = zSqlCopy;
+    aNew[p->nRow].tnum = tnum;
+    p->nRow++;
+    return SQLITE_OK;
+}
+
+/*
+ ** Return true if the CREATE TABLE statement zSql might contain a
+ ** FOREIGN KEY clause.  A column that happens to be named "references"
+ ** gives a false positive, which only means the table is parsed early.
+ */
+static int lazyHasForeignKey(const char *zSql){
+    const char *z;
+    for(z=zSql; *z; z++){
+        if( (*z=='r' || *z=='R') && sqlite3_strnicmp(z, "references", 10)==0 ){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ ** Discard all pending tables of schema p.  Called by sqlite3SchemaClear().
+ ** Whether or not lazy loading is enabled is not changed.
+ */
+static void lazySchemaClear(Schema *p){
+    SchemaLazy *pLazy = schemaLazy(p);
+    Hash temp;
+    HashElem *pElem;
+    
+    temp = pLazy->tblHash;
+    sqlite3HashInit(&pLazy->tblHash);
+    sqlite3HashClear(&pLazy->idxHash);
+    for(pElem=sqliteHashFirst(&temp); pElem; pElem=sqliteHashNext(pElem)){
+        lazyTableFree((LazyTable*)sqliteHashData(pElem));
+    }
+    sqlite3HashClear(&temp);
+}
+
+/*
+ ** Return true if lazy loading is enabled on schema p.
+ */
+SQLITE_PRIVATE int sqlite3LazySchemaEnabled(Schema *p){
+    return schemaLazy(p)->bEnabled;
+}
+
+/*
+ ** Enable or disable lazy loading on schema p.  This takes effect the
+ ** next time the schema is loaded.
+ */
+SQLITE_PRIVATE void sqlite3LazySchemaEnable(Schema *p, int onoff){
+    schemaLazy(p)->bEnabled = (u8)(onoff!=0);
+}
+
+/*
+ ** This is used in place of sqlite3InitCallback() by sqlite3InitOne() when
+ ** lazy loading is enabled.  There are two more columns:
+ **
+ **     argv[3] = sqlite_master.type
+ **     argv[4] = sqlite_master.tbl_name
+ **
+ ** Rows that belong to a pending table are saved.  All others are passed
+ ** on to sqlite3InitCallback().
+ */
+SQLITE_PRIVATE int sqlite3LazySchemaCallback(void *pInit, int argc, char **argv, char **NotUsed){
+    InitData *pData = (InitData*)pInit;
+    sqlite3 *db = pData->db;
+    int iDb = pData->iDb;
+    SchemaLazy *pLazy = schemaLazy(db->aDb[iDb].pSchema);
+    LazyTable *p;
+    int tnum = 0;
+    int nName;
+    
+    assert( argc==5 );
+    UNUSED_PARAMETER(argc);
+    if( argv==0 || db->mallocFailed || argv[0]==0 || argv[1]==0
+     || argv[3]==0 || argv[4]==0 || sqlite3GetInt32(argv[1], &tnum)==0 ){
+        return sqlite3InitCallback(pInit, 3, argv, NotUsed);
+    }
+    
+    nName = sqlite3Strlen30(argv[0]);
+    if( sqlite3StrICmp(argv[3], "table")==0 ){
+        if( tnum>0 && argv[2] && argv[2][0]
+         && sqlite3_strnicmp(argv[0], "sqlite_", 7)!=0
+         && !lazyHasForeignKey(argv[2])
+         && sqlite3HashFind(&pLazy->tblHash, argv[0], nName)==0
+        ){
+            p = (LazyTable*)sqlite3DbMallocZero(0, sizeof(LazyTable));
+            if( p==0 || lazyTableAddRow(p, argv[0], tnum, argv[2])
+             || sqlite3HashInsert(&pLazy->tblHash, p->aRow[0].zName, nName, p)
+            ){
+                if( p ) lazyTableFree(p);
+                db->mallocFailed = 1;
+            }else{
+                DbClearProperty(db, iDb, DB_Empty);
+                return 0;
+            }
+        }
+    }else if( sqlite3StrICmp(argv[3], "index")==0 && pLazy->tblHash.count
+           && sqlite3HashFind(&pLazy->idxHash, argv[0], nName)==0 ){
+        p = (LazyTable*)sqlite3HashFind(&pLazy->tblHash, argv[4],
+                                        sqlite3Strlen30(argv[4]));
+        if( p ){
+            if( lazyTableAddRow(p, argv[0], tnum, argv[2])
+             || sqlite3HashInsert(&pLazy->idxHash, p->aRow[p->nRow-1].zName,
+                                  nName, p)
+            ){
+                db->mallocFailed = 1;
+            }else{
+                return 0;
+            }
+        }
+    }
+    return sqlite3InitCallback(pInit, 3, argv, NotUsed);
+}
+
+/*
+ ** Parse the saved rows of pending table p of database iDb, then apply
+ ** any sqlite_stat1 rows set aside for it.  The LazyTable is removed from
+ ** the pending lists first, so that the lookups made by the parser do
+ ** not find it again, and then freed.
+ **
+ ** This may be called from within the parser, or while the schema of
+ ** another database is being loaded, so the parts of db->init used by
+ ** sqlite3InitCallback() are saved and restored.  The objects created
+ ** are part of the committed schema, so the SQLITE_InternChanges flag is
+ ** restored as well.
+ */
+static void lazyTableLoad(sqlite3 *db, int iDb, LazyTable *p){
+    Schema *pSchema = db->aDb[iDb].pSchema;
+    SchemaLazy *pLazy = schemaLazy(pSchema);
+    int savedInternChanges = db->flags & SQLITE_InternChanges;
+    u8 savedBusy = db->init.busy;
+    u8 savedIDb = db->init.iDb;
+    int savedNewTnum = db->init.newTnum;
+    u8 savedOrphanTrigger = db->init.orphanTrigger;
+    InitData initData;
+    char *zErrMsg = 0;
+    int i;
+    
+    assert( sqlite3SchemaMutexHeld(db, iDb, 0) );
+    for(i=1; i<p->nRow; i++){
+        sqlite3HashInsert(&pLazy->idxHash, p->aRow[i].zName,
+                          sqlite3Strlen30(p->aRow[i].zName), 0);
+    }
+    sqlite3HashInsert(&pLazy->tblHash, p->aRow[0].zName,
+                      sqlite3Strlen30(p->aRow[0].zName), 0);
+    
+    initData.db = db;
+    initData.iDb = iDb;
+    initData.rc = SQLITE_OK;
+    initData.pzErrMsg = &zErrMsg;
+    db->init.busy = 1;
+    for(i=0; i<p->nRow && initData.rc==SQLITE_OK; i++){
+        char zTnum[16];
+        char *azArg[3];
+        sqlite3_snprintf(sizeof(zTnum), zTnum, "%d", p->aRow[i].tnum);
+        azArg[0] = p->aRow[i].zName;
+        azArg[1] = zTnum;
+        azArg[2] = p->aRow[i].zSql;
+        sqlite3InitCallback(&initData, 3, azArg, 0);
+    }
+    db->init.busy = savedBusy;
+    db->init.iDb = savedIDb;
+    db->init.newTnum = savedNewTnum;
+    db->init.orphanTrigger = savedOrphanTrigger;
+    sqlite3DbFree(db, zErrMsg);
+    
+#ifndef SQLITE_OMIT_ANALYZE
+    if( initData.rc==SQLITE_OK ){
+        for(i=0; i<p->nStat; i++){
+            char *azArg[3];
+            azArg[0] = p->aRow[0].zName;
+            azArg[1] = p->aStat[i].zIdx;
+            azArg[2] = p->aStat[i].zStat;
+            sqlite3AnalysisLoadRow(db, iDb, azArg);
+        }
+    }
+#endif
+    if( !savedInternChanges ) db->flags &= ~SQLITE_InternChanges;
+    lazyTableFree(p);
+}
+
+/*
+ ** Return the table named zName in database iDb, parsing it first if it
+ ** is pending.  Return NULL if database iDb has no such table.  This is
+ ** called by sqlite3FindTable() after a lookup in Schema.tblHash fails.
+ */
+SQLITE_PRIVATE Table *sqlite3LazySchemaTable(sqlite3 *db, int iDb, const char *zName){
+    Schema *pSchema = db->aDb[iDb].pSchema;
+    SchemaLazy *pLazy = schemaLazy(pSchema);
+    int nName;
+    LazyTable *p;
+    
+    if( pLazy->tblHash.count==0 ) return 0;
+    nName = sqlite3Strlen30(zName);
+    p = (LazyTable*)sqlite3HashFind(&pLazy->tblHash, zName, nName);
+    if( p==0 ) return 0;
+    lazyTableLoad(db, iDb, p);
+    return (Table*)sqlite3HashFind(&pSchema->tblHash, zName, nName);
+}
+
+/*
+ ** Return the index named zName in database iDb, parsing the table it
+ ** belongs to first if that table is pending.  Return NULL if database
+ ** iDb has no such index.  This is called by sqlite3FindIndex() after a
+ ** lookup in Schema.idxHash fails.
+ */
+SQLITE_PRIVATE Index *sqlite3LazySchemaIndex(sqlite3 *db, int iDb, const char *zName){
+    Schema *pSchema = db->aDb[iDb].pSchema;
+    SchemaLazy *pLazy = schemaLazy(pSchema);
+    int nName;
+    LazyTable *p;
+    
+    if( pLazy->idxHash.count==0 ) return 0;
+    nName = sqlite3Strlen30(zName);
+    p = (LazyTable*)sqlite3HashFind(&pLazy->idxHash, zName, nName);
+    if( p==0 ) return 0;
+    lazyTableLoad(db, iDb, p);
+    return (Index*)sqlite3HashFind(&pSchema->idxHash, zName, nName);
+}
+
+/*
+ ** Parse every pending table of database iDb.
+ */
+SQLITE_PRIVATE void sqlite3LazySchemaLoadAll(sqlite3 *db, int iDb){
+    SchemaLazy *pLazy = schemaLazy(db->aDb[iDb].pSchema);
+    HashElem *pElem;
+    while( (pElem = sqliteHashFirst(&pLazy->tblHash))!=0 ){
+        lazyTableLoad(db, iDb, (LazyTable*)sqliteHashData(pElem));
+    }
+}
+
+#ifndef SQLITE_OMIT_AUTOVACUUM
+/*
+ ** Change the root page number of any pending table or index that has
+ ** root page iFrom to iTo.  See sqlite3RootPageMoved().
+ */
+SQLITE_PRIVATE void sqlite3LazySchemaRootPageMoved(Schema *pSchema, int iFrom, int iTo){
+    SchemaLazy *pLazy = schemaLazy(pSchema);
+    HashElem *pElem;
+    for(pElem=sqliteHashFirst(&pLazy->tblHash); pElem; pElem=sqliteHashNext(pElem)){
+        LazyTable *p = (LazyTable*)sqliteHashData(pElem);
+        int i;
+        for(i=0; i<p->nRow; i++){
+            if( p->aRow[i].tnum==iFrom ) p->aRow[i].tnum = iTo;
+        }
+    }
+}
+#endif
+
+#ifndef SQLITE_OMIT_ANALYZE
+/*
+ ** This is called by sqlite3AnalysisLoad() for each row of sqlite_stat1
+ ** in database zDb, with argv[] as passed to analysisLoader().  If the
+ ** row describes a pending table, save a copy of it and return non-zero.
+ ** Otherwise return zero.
+ **
+ ** If argv is NULL, discard every row saved for database zDb instead.
+ */
+SQLITE_PRIVATE int sqlite3LazySchemaStat(sqlite3 *db, const char *zDb, char **argv){
+    int iDb = sqlite3FindDbName(db, zDb);
+    SchemaLazy *pLazy;
+    LazyTable *p;
+    struct LazyStat *aNew;
+    
+    if( iDb<0 ) return 0;
+    pLazy = schemaLazy(db->aDb[iDb].pSchema);
+    if( argv==0 ){
+        HashElem *pElem;
+        for(pElem=sqliteHashFirst(&pLazy->tblHash); pElem; pElem=sqliteHashNext(pElem)){
+            int i;
+            p = (LazyTable*)sqliteHashData(pElem);
+            for(i=0; i<p->nStat; i++){
+                sqlite3DbFree(0, p->aStat[i].zIdx);
+                sqlite3DbFree(0, p->aStat[i].zStat);
+            }
+            sqlite3_free(p->aStat);
+            p->aStat = 0;
+            p->nStat = 0;
+        }
+        return 0;
+    }
+    if( pLazy->tblHash.count==0 ) return 0;
+    p = (LazyTable*)sqlite3HashFind(&pLazy->tblHash, argv[0],
+                                    sqlite3Strlen30(argv[0]));
+    if( p==0 ) return 0;
+    
+    aNew = (struct LazyStat*)sqlite3_realloc(p->aStat, (p->nStat+1)*sizeof(*aNew));
+    if( aNew==0 ){
+        db->mallocFailed = 1;
+        return 1;
+    }
+    p->aStat = aNew;
+    aNew[p->nStat].zIdx = argv[1] ? sqlite3DbStrDup(0, argv[1]) : 0;
+    aNew[p->nStat].zStat = sqlite3DbStrDup(0, argv[2]);
+    if( aNew[p->nStat].zStat==0 || (argv[1] && aNew[p->nStat].zIdx==0) ){
+        sqlite3DbFree(0, aNew[p->nStat].zIdx);
+        sqlite3DbFree(0, aNew[p->nStat].zStat);
+        db->mallocFailed = 1;
+    }else{
+        p->nStat++;
+    }
+    return 1;
+}
+#endif
+
+/*
+ ** Return the number of bytes of heap used to hold the pending tables of
+ ** schema pSchema.  Used by SQLITE_DBSTATUS_SCHEMA_USED.
+ */
+SQLITE_PRIVATE int sqlite3LazySchemaSize(Schema *pSchema){
+    SchemaLazy *pLazy = schemaLazy(pSchema);
+    HashElem *pElem;
+    int nByte;
+    
+    nByte = sqlite3GlobalConfig.m.xRoundup(sizeof(HashElem)) * (
+        pLazy->tblHash.count + pLazy->idxHash.count
+    );
+    nByte += sqlite3MallocSize(pLazy->tblHash.ht);
+    nByte += sqlite3MallocSize(pLazy->idxHash.ht);
+    for(pElem=sqliteHashFirst(&pLazy->tblHash); pElem; pElem=sqliteHashNext(pElem)){
+        LazyTable *p = (LazyTable*)sqliteHashData(pElem);
+        int i;
+        nByte += sqlite3DbMallocSize(0, p);
+        nByte += sqlite3MallocSize(p->aRow);
+        nByte += sqlite3MallocSize(p->aStat);
+        for(i=0; i<p->nRow; i++){
+            nByte += sqlite3DbMallocSize(0, p->aRow[i].zName);
+            nByte += sqlite3DbMallocSize(0, p->aRow[i].zSql);
+        }
+        for(i=0; i<p->nStat; i++){
+            nByte += sqlite3DbMallocSize(0, p->aStat[i].zIdx);
+            nByte += sqlite3DbMallocSize(0, p->aStat[i].zStat);
+        }
+    }
+    return nByte;
+}
+
+/*
+ ** Enable or disable lazy schema loading on the main database and any
+ ** attached databases of connection db.  Databases attached later inherit
+ ** the setting of the main database.
+ */
+SQLITE_API int sqlite3_lazy_schema(sqlite3 *db, int onoff){
+    int i;
+    if( !sqlite3SafetyCheckOk(db) ) return SQLITE_MISUSE_BKPT;
+    sqlite3_mutex_enter(db->mutex);
+    sqlite3BtreeEnterAll(db);
+    for(i=0; i<db->nDb; i++){
+        Schema *pSchema = db->aDb[i].pSchema;
+        if( i!=1 && pSchema ) sqlite3LazySchemaEnable(pSchema, onoff);
+    }
+    sqlite3BtreeLeaveAll(db);
+    sqlite3_mutex_leave(db->mutex);
+    return SQLITE_OK;
+}
+
+#else
+# define SCHEMA_ALLOC_SIZE sizeof(Schema)
+#endif /* SQLITE_OMIT_LAZY_SCHEMA */
+
 /*
  ** Free all resources held by the schema structure. The void* argument points
  ** at a Schema struct. This function does not call sqlite3DbFree(db, ) on the 
@@ -448,6 +920,9 @@ SQLITE_PRIVATE void sqlite3SchemaClear(void *p){
     }
     sqlite3HashClear(&temp1);
     sqlite3HashClear(&pSchema->fkeyHash);
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+    lazySchemaClear(pSchema);
+#endif
     pSchema->pSeqTab = 0;
     if( pSchema->flags & DB_SchemaLoaded ){
         pSchema->iGeneration++;
@@ -462,9 +937,9 @@ SQLITE_PRIVATE void sqlite3SchemaClear(void *p){
 SQLITE_PRIVATE Schema *sqlite3SchemaGet(sqlite3 *db, Btree *pBt){
     Schema * p;
     if( pBt ){
-        p = (Schema *)sqlite3BtreeSchema(pBt, sizeof(Schema), sqlite3SchemaClear);
+        p = (Schema *)sqlite3BtreeSchema(pBt, SCHEMA_ALLOC_SIZE, sqlite3SchemaClear);
     }else{
-        p = (Schema *)sqlite3DbMallocZero(0, sizeof(Schema));
+        p = (Schema *)sqlite3DbMallocZero(0, SCHEMA_ALLOC_SIZE);
     }
     if( !p ){
         db->mallocFailed = 1;
@@ -473,6 +948,10 @@ SQLITE_PRIVATE Schema *sqlite3SchemaGet(sqlite3 *db, Btree *pBt){
         sqlite3HashInit(&p->idxHash);
         sqlite3HashInit(&p->trigHash);
         sqlite3HashInit(&p->fkeyHash);
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+        sqlite3HashInit(&schemaLazy(p)->tblHash);
+        sqlite3HashInit(&schemaLazy(p)->idxHash);
+#endif
         p->enc = SQLITE_UTF8;
     }
     return p;
@@ -83,6 +83,9 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_ENABLE_COLUMN_METADATA
     "ENABLE_COLUMN_METADATA",
 #endif
+#ifdef SQLITE_ENABLE_COMPUTED_GOTO
+    "ENABLE_COMPUTED_GOTO",
+#endif
 #ifdef SQLITE_ENABLE_EXPENSIVE_ASSERT
     "ENABLE_EXPENSIVE_ASSERT",
 #endif
@@ -202,6 +205,15 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_AUTOVACUUM
     "OMIT_AUTOVACUUM",
 #endif
+#ifdef SQLITE_OMIT_BATCH_AGGREGATE
+    "OMIT_BATCH_AGGREGATE",
+#endif
+#ifdef SQLITE_OMIT_BATCH_EXECUTE
+    "OMIT_BATCH_EXECUTE",
+#endif
+#ifdef SQLITE_OMIT_BATCH_FETCH
+    "OMIT_BATCH_FETCH",
+#endif
 #ifdef SQLITE_OMIT_BETWEEN_OPTIMIZATION
     "OMIT_BETWEEN_OPTIMIZATION",
 #endif
@@ -211,6 +223,12 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_BTREECOUNT
     "OMIT_BTREECOUNT",
 #endif
+#ifdef SQLITE_OMIT_BTREE_KEYCACHE
+    "OMIT_BTREE_KEYCACHE",
+#endif
+#ifdef SQLITE_OMIT_BTREE_OVFLINDEX
+    "OMIT_BTREE_OVFLINDEX",
+#endif
 #ifdef SQLITE_OMIT_BUILTIN_TEST
     "OMIT_BUILTIN_TEST",
 #endif
@@ -241,6 +259,9 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_EXPLAIN
     "OMIT_EXPLAIN",
 #endif
+#ifdef SQLITE_OMIT_FAST_RECORD_COMPARE
+    "OMIT_FAST_RECORD_COMPARE",
+#endif
 #ifdef SQLITE_OMIT_FLAG_PRAGMAS
     "OMIT_FLAG_PRAGMAS",
 #endif
@@ -253,12 +274,21 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_GET_TABLE
     "OMIT_GET_TABLE",
 #endif
+#ifdef SQLITE_OMIT_HASH_AGGREGATE
+    "OMIT_HASH_AGGREGATE",
+#endif
+#ifdef SQLITE_OMIT_HASH_JOIN
+    "OMIT_HASH_JOIN",
+#endif
 #ifdef SQLITE_OMIT_INCRBLOB
     "OMIT_INCRBLOB",
 #endif
 #ifdef SQLITE_OMIT_INTEGRITY_CHECK
     "OMIT_INTEGRITY_CHECK",
 #endif
+#ifdef SQLITE_OMIT_LAZY_SCHEMA
+    "OMIT_LAZY_SCHEMA",
+#endif
 #ifdef SQLITE_OMIT_LIKE_OPTIMIZATION
     "OMIT_LIKE_OPTIMIZATION",
 #endif
@@ -274,12 +304,21 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_MEMORYDB
     "OMIT_MEMORYDB",
 #endif
+#ifdef SQLITE_OMIT_OPCODE_FUSION
+    "OMIT_OPCODE_FUSION",
+#endif
+#ifdef SQLITE_OMIT_OPCODE_PROFILE
+    "OMIT_OPCODE_PROFILE",
+#endif
 #ifdef SQLITE_OMIT_OR_OPTIMIZATION
     "OMIT_OR_OPTIMIZATION",
 #endif
 #ifdef SQLITE_OMIT_PAGER_PRAGMAS
     "OMIT_PAGER_PRAGMAS",
 #endif
+#ifdef SQLITE_OMIT_PARALLEL_SCAN
+    "OMIT_PARALLEL_SCAN",
+#endif
 #ifdef SQLITE_OMIT_PRAGMA
     "OMIT_PRAGMA",
 #endif
@@ -289,21 +328,33 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_QUICKBALANCE
     "OMIT_QUICKBALANCE",
 #endif
+#ifdef SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION
+    "OMIT_RANGE_DELETE_OPTIMIZATION",
+#endif
 #ifdef SQLITE_OMIT_REINDEX
     "OMIT_REINDEX",
 #endif
 #ifdef SQLITE_OMIT_SCHEMA_PRAGMAS
     "OMIT_SCHEMA_PRAGMAS",
 #endif
+#ifdef SQLITE_OMIT_SCHEMA_SNAPSHOT
+    "OMIT_SCHEMA_SNAPSHOT",
+#endif
 #ifdef SQLITE_OMIT_SCHEMA_VERSION_PRAGMAS
     "OMIT_SCHEMA_VERSION_PRAGMAS",
 #endif
 #ifdef SQLITE_OMIT_SHARED_CACHE
     "OMIT_SHARED_CACHE",
 #endif
+#ifdef SQLITE_OMIT_STMT_CACHE
+    "OMIT_STMT_CACHE",
+#endif
 #ifdef SQLITE_OMIT_SUBQUERY
     "OMIT_SUBQUERY",
 #endif
+#ifdef SQLITE_OMIT_SUBQUERY_CACHE
+    "OMIT_SUBQUERY_CACHE",
+#endif
 #ifdef SQLITE_OMIT_TCL_VARIABLE
     "OMIT_TCL_VARIABLE",
 #endif
@@ -340,6 +391,9 @@ static const char * const azCompileOpt[] = {
 #ifdef SQLITE_OMIT_XFER_OPT
     "OMIT_XFER_OPT",
 #endif
+#ifdef SQLITE_OMIT_ZEROCOPY
+    "OMIT_ZEROCOPY",
+#endif
 #ifdef SQLITE_PERFORMANCE_TRACE
     "PERFORMANCE_TRACE",
 #endif
@@ -1133,6 +1133,9 @@ SQLITE_PRIVATE void sqlite3RegisterDateTimeFunctions(void){
     FuncDef *aFunc = (FuncDef*)&GLOBAL(FuncDef, aDateTimeFuncs);
     
     for(i=0; i<ArraySize(aDateTimeFuncs); i++){
+        /* Every one of these functions may read the current time, which
+         ** changes between calls to sqlite3_step(). */
+        aFunc[i].funcFlags |= SQLITE_FUNC_VOLATILE;
         sqlite3FuncDefInsert(pHash, &aFunc[i]);
     }
 }
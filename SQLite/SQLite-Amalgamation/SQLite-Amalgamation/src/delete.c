@@ -212,6 +212,122 @@ limit_where_cleanup_2:
 }
 #endif /* defined(SQLITE_ENABLE_UPDATE_DELETE_LIMIT) && !defined(SQLITE_OMIT_SUBQUERY) */
 
+#ifndef SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION
+/*
+ ** If expression pExpr is an integer literal, or the negation of one, that
+ ** fits in a 64-bit signed integer, write its value into *piVal and
+ ** return 1.  Otherwise return 0.
+ */
+static int deleteRangeConstant(Expr *pExpr, i64 *piVal){
+    int negFlag = 0;
+    int c;
+    i64 value;
+    if( pExpr->op==TK_UMINUS ){
+        negFlag = 1;
+        pExpr = pExpr->pLeft;
+    }
+    if( pExpr->op!=TK_INTEGER ) return 0;
+    if( pExpr->flags & EP_IntValue ){
+        value = pExpr->u.iValue;
+        *piVal = negFlag ? -value : value;
+        return 1;
+    }
+    c = sqlite3Atoi64(pExpr->u.zToken, &value, sqlite3Strlen30(pExpr->u.zToken),
+                      SQLITE_UTF8);
+    if( c==0 ){
+        *piVal = negFlag ? -value : value;
+        return 1;
+    }
+    if( c==2 && negFlag ){
+        *piVal = SMALLEST_INT64;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ ** Narrow the rowid range *piLo..*piHi by the constraints of the WHERE
+ ** clause pWhere on table cursor iCur.  Return 1 if pWhere consists
+ ** entirely of comparisons between the rowid of iCur and integer literals
+ ** connected by AND, so that the rows it selects are exactly those with a
+ ** rowid in the resulting range.  Return 0 if the WHERE clause has any
+ ** other form.
+ */
+static int deleteRangeFromWhere(Expr *pWhere, int iCur, i64 *piLo, i64 *piHi){
+    Expr *pLeft;
+    Expr *pRight;
+    i64 iVal;
+    int op = pWhere->op;
+    
+    if( op==TK_AND ){
+        return deleteRangeFromWhere(pWhere->pLeft, iCur, piLo, piHi)
+            && deleteRangeFromWhere(pWhere->pRight, iCur, piLo, piHi);
+    }
+    pLeft = pWhere->pLeft;
+    if( pLeft==0 ) return 0;
+    if( op==TK_BETWEEN ){
+        ExprList *pList = pWhere->x.pList;
+        i64 iLo, iHi;
+        if( ExprHasProperty(pWhere, EP_xIsSelect) || pList==0 || pList->nExpr!=2 ){
+            return 0;
+        }
+        if( pLeft->op!=TK_COLUMN || pLeft->iTable!=iCur || pLeft->iColumn>=0
+           || !deleteRangeConstant(pList->a[0].pExpr, &iLo)
+           || !deleteRangeConstant(pList->a[1].pExpr, &iHi)
+           ){
+            return 0;
+        }
+        if( iLo>*piLo ) *piLo = iLo;
+        if( iHi<*piHi ) *piHi = iHi;
+        return 1;
+    }
+    if( op!=TK_LT && op!=TK_LE && op!=TK_GT && op!=TK_GE && op!=TK_EQ ){
+        return 0;
+    }
+    pRight = pWhere->pRight;
+    if( pRight==0 ) return 0;
+    if( pRight->op==TK_COLUMN ){
+        /* Constant on the left: "5<rowid" is the same as "rowid>5". */
+        Expr *pTmp = pLeft;
+        pLeft = pRight;
+        pRight = pTmp;
+        switch( op ){
+            case TK_LT: op = TK_GT; break;
+            case TK_LE: op = TK_GE; break;
+            case TK_GT: op = TK_LT; break;
+            case TK_GE: op = TK_LE; break;
+        }
+    }
+    if( pLeft->op!=TK_COLUMN || pLeft->iTable!=iCur || pLeft->iColumn>=0
+       || !deleteRangeConstant(pRight, &iVal)
+       ){
+        return 0;
+    }
+    switch( op ){
+        case TK_LT:
+            if( iVal==SMALLEST_INT64 ) return 0;
+            iVal--;
+            /* Fall through */
+        case TK_LE:
+            if( iVal<*piHi ) *piHi = iVal;
+            break;
+        case TK_GT:
+            if( iVal==LARGEST_INT64 ) return 0;
+            iVal++;
+            /* Fall through */
+        case TK_GE:
+            if( iVal>*piLo ) *piLo = iVal;
+            break;
+        default:
+            assert( op==TK_EQ );
+            if( iVal>*piLo ) *piLo = iVal;
+            if( iVal<*piHi ) *piHi = iVal;
+            break;
+    }
+    return 1;
+}
+#endif /* SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION */
+
 /*
  ** Generate code for a DELETE FROM statement.
  **
@@ -238,6 +354,10 @@ SQLITE_PRIVATE void sqlite3DeleteFrom(
     int iDb;               /* Database number */
     int memCnt = -1;       /* Memory cell used for change counting */
     int rcauth;            /* Value returned by authorization callback */
+#ifndef SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION
+    i64 iLo = SMALLEST_INT64;  /* Smallest rowid selected by WHERE */
+    i64 iHi = LARGEST_INT64;   /* Largest rowid selected by WHERE */
+#endif
     
 #ifndef SQLITE_OMIT_TRIGGER
     int isView;                  /* True if attempting to delete from a view */
@@ -360,6 +480,31 @@ SQLITE_PRIVATE void sqlite3DeleteFrom(
         }
     }else
 #endif /* SQLITE_OMIT_TRUNCATE_OPTIMIZATION */
+#ifndef SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION
+    /* Special case: The WHERE clause only restricts the rowid to a range
+     ** bounded by integer literals, and there are no indexes, triggers or
+     ** foreign keys that need to see each row as it is deleted.  Remove the
+     ** range directly from the table b-tree instead of collecting rowids
+     ** into a RowSet and deleting them one by one.  */
+    if( rcauth==SQLITE_OK && pWhere!=0 && !pTrigger && !isView
+       && !IsVirtual(pTab) && pTab->pIndex==0
+       && 0==sqlite3FkRequired(pParse, pTab, 0, 0)
+       && deleteRangeFromWhere(pWhere, iCur, &iLo, &iHi)
+       ){
+        int regLo = ++pParse->nMem;     /* Register holding smallest rowid */
+        int regHi = ++pParse->nMem;     /* Register holding largest rowid */
+        
+        sqlite3OpenTable(pParse, iCur, iDb, pTab, OP_OpenWrite);
+        sqlite3VdbeAddOp4Dup8(v, OP_Int64, 0, regLo, 0, (u8*)&iLo, P4_INT64);
+        sqlite3VdbeAddOp4Dup8(v, OP_Int64, 0, regHi, 0, (u8*)&iHi, P4_INT64);
+        sqlite3VdbeAddOp3(v, OP_DeleteRange, iCur, regLo, memCnt);
+        if( pParse->nested==0 ){
+            sqlite3VdbeChangeP4(v, -1, pTab->zName, P4_STATIC);
+            sqlite3VdbeChangeP5(v, OPFLAG_NCHANGE);
+        }
+        sqlite3VdbeAddOp1(v, OP_Close, iCur);
+    }else
+#endif /* SQLITE_OMIT_RANGE_DELETE_OPTIMIZATION */
     /* The usual case: There is a WHERE clause so we have to scan through
      ** the table and pick which records to delete.
      */
@@ -1630,6 +1630,138 @@ SQLITE_PRIVATE int sqlite3FindInIndex(Parse *pParse, Expr *pX, int *prNotFound){
 }
 #endif
 
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+/*
+ ** The largest number of outer column values that a cached subquery may
+ ** depend on, and the largest number of FROM clause terms it may have,
+ ** counting those of its own subqueries.
+ */
+#define SUBQUERY_CACHE_MAX_KEY  8
+#define SUBQUERY_CACHE_MAX_CSR  32
+
+/*
+ ** The outer column references found in a correlated subquery by
+ ** subqueryRefsSelect().
+ */
+typedef struct SubqueryRefs SubqueryRefs;
+struct SubqueryRefs {
+    sqlite3 *db;                            /* Database connection */
+    int nCsr;                               /* Number of entries in aiCsr[] */
+    int aiCsr[SUBQUERY_CACHE_MAX_CSR];      /* Cursors of the subquery tables */
+    int nRef;                               /* Number of entries in apRef[] */
+    Expr *apRef[SUBQUERY_CACHE_MAX_KEY];    /* Distinct outer column references */
+};
+
+static int subqueryRefsSelect(Select*, SubqueryRefs*);
+
+/*
+ ** Add the outer column references in expression p to pRefs.  Return zero
+ ** if the value of p may depend on anything other than those columns and
+ ** the tables read by the subquery: an aggregate of the outer query, or a
+ ** function marked SQLITE_FUNC_VOLATILE.  Also return zero if there are
+ ** too many references.
+ */
+static int subqueryRefsExpr(Expr *p, SubqueryRefs *pRefs){
+    int i;
+    
+    if( p==0 ) return 1;
+    switch( p->op ){
+        case TK_COLUMN:
+        case TK_AGG_COLUMN: {
+            for(i=0; i<pRefs->nCsr; i++){
+                if( pRefs->aiCsr[i]==p->iTable ) return 1;
+            }
+            for(i=0; i<pRefs->nRef; i++){
+                Expr *pRef = pRefs->apRef[i];
+                if( pRef->op==p->op && pRef->iTable==p->iTable
+                   && pRef->iColumn==p->iColumn ){
+                    return 1;
+                }
+            }
+            if( pRefs->nRef>=SUBQUERY_CACHE_MAX_KEY ) return 0;
+            pRefs->apRef[pRefs->nRef++] = p;
+            return 1;
+        }
+        case TK_AGG_FUNCTION: {
+            if( p->op2>0 ) return 0;
+            /* Fall through */
+        }
+        case TK_FUNCTION: {
+            sqlite3 *db = pRefs->db;
+            int nArg = p->x.pList ? p->x.pList->nExpr : 0;
+            FuncDef *pDef;
+            assert( !ExprHasProperty(p, EP_IntValue) );
+            assert( !ExprHasProperty(p, EP_xIsSelect) );
+            pDef = sqlite3FindFunction(db, p->u.zToken, sqlite3Strlen30(p->u.zToken),
+                                       nArg, ENC(db), 0);
+            if( pDef==0 || (pDef->funcFlags & SQLITE_FUNC_VOLATILE)!=0 ) return 0;
+            break;
+        }
+    }
+    if( ExprHasProperty(p, EP_TokenOnly) ) return 1;
+    if( !subqueryRefsExpr(p->pLeft, pRefs) || !subqueryRefsExpr(p->pRight, pRefs) ){
+        return 0;
+    }
+    if( ExprHasProperty(p, EP_xIsSelect) ){
+        return subqueryRefsSelect(p->x.pSelect, pRefs);
+    }else if( p->x.pList ){
+        for(i=0; i<p->x.pList->nExpr; i++){
+            if( !subqueryRefsExpr(p->x.pList->a[i].pExpr, pRefs) ) return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ ** Add the outer column references in the expressions of list pList to
+ ** pRefs.  Return zero if subqueryRefsExpr() does for any of them.
+ */
+static int subqueryRefsList(ExprList *pList, SubqueryRefs *pRefs){
+    int i;
+    for(i=0; pList && i<pList->nExpr; i++){
+        if( !subqueryRefsExpr(pList->a[i].pExpr, pRefs) ) return 0;
+    }
+    return 1;
+}
+
+/*
+ ** Find the columns of outer queries that the correlated subquery p refers
+ ** to and add them to pRefs.  Return zero if the result of p may depend on
+ ** anything other than the values of those columns and the contents of
+ ** the tables it reads, or if it reads a virtual table.
+ */
+static int subqueryRefsSelect(Select *p, SubqueryRefs *pRefs){
+    for(; p; p=p->pPrior){
+        SrcList *pSrc = p->pSrc;
+        int i;
+        for(i=0; pSrc && i<pSrc->nSrc; i++){
+            Table *pTab = pSrc->a[i].pTab;
+            if( pTab && IsVirtual(pTab) ) return 0;
+            if( pRefs->nCsr>=SUBQUERY_CACHE_MAX_CSR ) return 0;
+            pRefs->aiCsr[pRefs->nCsr++] = pSrc->a[i].iCursor;
+        }
+        for(i=0; pSrc && i<pSrc->nSrc; i++){
+            if( !subqueryRefsSelect(pSrc->a[i].pSelect, pRefs)
+               || !subqueryRefsExpr(pSrc->a[i].pOn, pRefs)
+               ){
+                return 0;
+            }
+        }
+        if( !subqueryRefsList(p->pEList, pRefs)
+           || !subqueryRefsExpr(p->pWhere, pRefs)
+           || !subqueryRefsList(p->pGroupBy, pRefs)
+           || !subqueryRefsExpr(p->pHaving, pRefs)
+           || !subqueryRefsList(p->pOrderBy, pRefs)
+           || !subqueryRefsExpr(p->pLimit, pRefs)
+           || !subqueryRefsExpr(p->pOffset, pRefs)
+           ){
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif /* SQLITE_OMIT_SUBQUERY_CACHE */
+
 /*
  ** Generate code for scalar subqueries used as a subquery expression, EXISTS,
  ** or IN operators.  Examples:
@@ -1830,6 +1962,13 @@ SQLITE_PRIVATE int sqlite3CodeSubselect(
              */
             Select *pSel;                         /* SELECT statement to encode */
             SelectDest dest;                      /* How to deal with SELECt result */
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+            SubqueryRefs sRefs;                   /* Outer columns the result depends on */
+            int nMemo = 0;                        /* Size of the result cache, or 0 */
+            int iMemo = 0;                        /* Cursor of the result cache */
+            int rKey = 0;                         /* First register of the cache key */
+            int addrHit = 0;                      /* The OP_MemoLookup instruction */
+#endif
             
             testcase( pExpr->op==TK_EXISTS );
             testcase( pExpr->op==TK_SELECT );
@@ -1837,7 +1976,41 @@ SQLITE_PRIVATE int sqlite3CodeSubselect(
             
             assert( ExprHasProperty(pExpr, EP_xIsSelect) );
             pSel = pExpr->x.pSelect;
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+            /* A correlated subquery runs again for each row of the outer query.
+             ** If the connection has a result cache size set, look the result
+             ** up by the values of the outer columns it refers to first.  The
+             ** key registers are allocated just before the result register,
+             ** as OP_MemoLookup and OP_MemoStore expect. */
+            memset(&sRefs, 0, sizeof(sRefs));
+            sRefs.db = pParse->db;
+            if( testAddr<0 && (nMemo = sqlite3VdbeMemoSize(pParse->db))>0
+               && subqueryRefsSelect(pSel, &sRefs) && sRefs.nRef>0
+               ){
+                rKey = pParse->nMem+1;
+                pParse->nMem += sRefs.nRef;
+            }else{
+                nMemo = 0;
+            }
+#endif
             sqlite3SelectDestInit(&dest, 0, ++pParse->nMem);
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+            if( nMemo ){
+                int addrOnce;
+                int i;
+                assert( dest.iSDParm==rKey+sRefs.nRef );
+                iMemo = pParse->nTab++;
+                addrOnce = sqlite3CodeOnce(pParse);
+                sqlite3VdbeAddOp3(v, OP_MemoOpen, iMemo, sRefs.nRef, nMemo);
+                sqlite3VdbeJumpHere(v, addrOnce);
+                for(i=0; i<sRefs.nRef; i++){
+                    int r = sqlite3ExprCodeTarget(pParse, sRefs.apRef[i], rKey+i);
+                    if( r!=rKey+i ) sqlite3VdbeAddOp2(v, OP_Copy, r, rKey+i);
+                }
+                addrHit = sqlite3VdbeAddOp3(v, OP_MemoLookup, iMemo, 0, rKey);
+                VdbeComment((v, "subquery result cache"));
+            }
+#endif
             if( pExpr->op==TK_SELECT ){
                 dest.eDest = SRT_Mem;
                 sqlite3VdbeAddOp2(v, OP_Null, 0, dest.iSDParm);
@@ -1855,6 +2028,12 @@ SQLITE_PRIVATE int sqlite3CodeSubselect(
                 return 0;
             }
             rReg = dest.iSDParm;
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+            if( nMemo ){
+                sqlite3VdbeAddOp3(v, OP_MemoStore, iMemo, 0, rKey);
+                sqlite3VdbeJumpHere(v, addrHit);
+            }
+#endif
             ExprSetVVAProperty(pExpr, EP_NoReduce);
             break;
         }
@@ -2003,17 +2182,6 @@ static void sqlite3ExprCodeIN(
 }
 #endif /* SQLITE_OMIT_SUBQUERY */
 
-/*
- ** Duplicate an 8-byte value
- */
-static char *dup8bytes(Vdbe *v, const char *in){
-    char *out = sqlite3DbMallocRaw(sqlite3VdbeDb(v), 8);
-    if( out ){
-        memcpy(out, in, 8);
-    }
-    return out;
-}
-
 #ifndef SQLITE_OMIT_FLOATING_POINT
 /*
  ** Generate an instruction that will put the floating point
@@ -2026,12 +2194,10 @@ static char *dup8bytes(Vdbe *v, const char *in){
 static void codeReal(Vdbe *v, const char *z, int negateFlag, int iMem){
     if( ALWAYS(z!=0) ){
         double value;
-        char *zV;
         sqlite3AtoF(z, &value, sqlite3Strlen30(z), SQLITE_UTF8);
         assert( !sqlite3IsNaN(value) ); /* The new AtoF never returns NaN */
         if( negateFlag ) value = -value;
-        zV = dup8bytes(v, (char*)&value);
-        sqlite3VdbeAddOp4(v, OP_Real, 0, iMem, 0, zV, P4_REAL);
+        sqlite3VdbeAddOp4Dup8(v, OP_Real, 0, iMem, 0, (u8*)&value, P4_REAL);
     }
 }
 #endif
@@ -2057,10 +2223,8 @@ static void codeInteger(Parse *pParse, Expr *pExpr, int negFlag, int iMem){
         assert( z!=0 );
         c = sqlite3Atoi64(z, &value, sqlite3Strlen30(z), SQLITE_UTF8);
         if( c==0 || (c==2 && negFlag) ){
-            char *zV;
             if( negFlag ){ value = c==2 ? SMALLEST_INT64 : -value; }
-            zV = dup8bytes(v, (char*)&value);
-            sqlite3VdbeAddOp4(v, OP_Int64, 0, iMem, 0, zV, P4_INT64);
+            sqlite3VdbeAddOp4Dup8(v, OP_Int64, 0, iMem, 0, (u8*)&value, P4_INT64);
         }else{
 #ifdef SQLITE_OMIT_FLOATING_POINT
             sqlite3ErrorMsg(pParse, "oversized integer: %s%s", negFlag ? "-" : "", z);
@@ -1483,6 +1483,30 @@ static void minMaxFinalize(sqlite3_context *context){
     }
 }
 
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+/*
+ ** If pFunc is the built-in count(), sum(), total(), avg(), or the single
+ ** argument min() or max() aggregate, return the AGGSCAN_* code that the
+ ** OP_AggScan instruction uses for it.  Otherwise, including when one of
+ ** these names has been overloaded by an application-defined function,
+ ** return 0.
+ */
+SQLITE_PRIVATE int sqlite3AggScanKind(FuncDef *pFunc){
+    if( pFunc->xStep==countStep && pFunc->xFinalize==countFinalize ){
+        return AGGSCAN_COUNT;
+    }
+    if( pFunc->xStep==sumStep ){
+        if( pFunc->xFinalize==sumFinalize ) return AGGSCAN_SUM;
+        if( pFunc->xFinalize==totalFinalize ) return AGGSCAN_TOTAL;
+        if( pFunc->xFinalize==avgFinalize ) return AGGSCAN_AVG;
+    }
+    if( pFunc->xStep==minmaxStep && pFunc->xFinalize==minMaxFinalize ){
+        return pFunc->pUserData ? AGGSCAN_MAX : AGGSCAN_MIN;
+    }
+    return 0;
+}
+#endif /* SQLITE_OMIT_BATCH_AGGREGATE */
+
 /*
  ** group_concat(EXPR, ?SEPARATOR?)
  */
@@ -1665,28 +1689,28 @@ SQLITE_PRIVATE void sqlite3RegisterGlobalFunctions(void){
         FUNCTION2(ifnull,            2, 0, 0, noopFunc,  SQLITE_FUNC_COALESCE),
         FUNCTION2(unlikely,          1, 0, 0, noopFunc,  SQLITE_FUNC_UNLIKELY),
         FUNCTION2(likelihood,        2, 0, 0, noopFunc,  SQLITE_FUNC_UNLIKELY),
-        FUNCTION(random,             0, 0, 0, randomFunc       ),
-        FUNCTION(randomblob,         1, 0, 0, randomBlob       ),
+        FUNCTION2(random,            0, 0, 0, randomFunc,  SQLITE_FUNC_VOLATILE),
+        FUNCTION2(randomblob,        1, 0, 0, randomBlob,  SQLITE_FUNC_VOLATILE),
         FUNCTION(nullif,             2, 0, 1, nullifFunc       ),
         FUNCTION(sqlite_version,     0, 0, 0, versionFunc      ),
         FUNCTION(sqlite_source_id,   0, 0, 0, sourceidFunc     ),
-        FUNCTION(sqlite_log,         2, 0, 0, errlogFunc       ),
+        FUNCTION2(sqlite_log,        2, 0, 0, errlogFunc,  SQLITE_FUNC_VOLATILE),
 #ifndef SQLITE_OMIT_COMPILEOPTION_DIAGS
         FUNCTION(sqlite_compileoption_used,1, 0, 0, compileoptionusedFunc  ),
         FUNCTION(sqlite_compileoption_get, 1, 0, 0, compileoptiongetFunc  ),
 #endif /* SQLITE_OMIT_COMPILEOPTION_DIAGS */
         FUNCTION(quote,              1, 0, 0, quoteFunc        ),
-        FUNCTION(last_insert_rowid,  0, 0, 0, last_insert_rowid),
-        FUNCTION(changes,            0, 0, 0, changes          ),
-        FUNCTION(total_changes,      0, 0, 0, total_changes    ),
+        FUNCTION2(last_insert_rowid, 0, 0, 0, last_insert_rowid, SQLITE_FUNC_VOLATILE),
+        FUNCTION2(changes,           0, 0, 0, changes,     SQLITE_FUNC_VOLATILE),
+        FUNCTION2(total_changes,     0, 0, 0, total_changes, SQLITE_FUNC_VOLATILE),
         FUNCTION(replace,            3, 0, 0, replaceFunc      ),
         FUNCTION(zeroblob,           1, 0, 0, zeroblobFunc     ),
 #ifdef SQLITE_SOUNDEX
         FUNCTION(soundex,            1, 0, 0, soundexFunc      ),
 #endif
 #ifndef SQLITE_OMIT_LOAD_EXTENSION
-        FUNCTION(load_extension,     1, 0, 0, loadExt          ),
-        FUNCTION(load_extension,     2, 0, 0, loadExt          ),
+        FUNCTION2(load_extension,    1, 0, 0, loadExt,     SQLITE_FUNC_VOLATILE),
+        FUNCTION2(load_extension,    2, 0, 0, loadExt,     SQLITE_FUNC_VOLATILE),
 #endif
         AGGREGATE(sum,               1, 0, 0, sumStep,         sumFinalize    ),
         AGGREGATE(total,             1, 0, 0, sumStep,         totalFinalize    ),
@@ -1841,6 +1841,7 @@ static int xferOptimization(
     iDest = pParse->nTab++;
     regAutoinc = autoIncBegin(pParse, iDbDest, pDest);
     sqlite3OpenTable(pParse, iDest, iDbDest, pDest, OP_OpenWrite);
+    sqlite3VdbeChangeP5(v, OPFLAG_BULKCSR);
     if( (pDest->iPKey<0 && pDest->pIndex!=0)          /* (1) */
        || destHasUniqueIdx                              /* (2) */
        || (onError!=OE_Abort && onError!=OE_Rollback)   /* (3) */
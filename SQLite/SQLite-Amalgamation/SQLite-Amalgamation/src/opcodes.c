@@ -155,6 +155,18 @@ SQLITE_PRIVATE const char *sqlite3OpcodeName(int i){
         /* 148 */ "Trace",
         /* 149 */ "Noop",
         /* 150 */ "Explain",
+        /* 151 */ "DeleteRange",
+        /* 152 */ "AggScan",
+        /* 153 */ "HashOpen",
+        /* 154 */ "HashInsert",
+        /* 155 */ "HashProbe",
+        /* 156 */ "HashNext",
+        /* 157 */ "HashGroup",
+        /* 158 */ "HashSort",
+        /* 159 */ "HashGroupNext",
+        /* 160 */ "MemoOpen",
+        /* 161 */ "MemoLookup",
+        /* 162 */ "MemoStore",
     };
     return azName[i];
 }
@@ -151,6 +151,18 @@
 #define OP_Trace                              148
 #define OP_Noop                               149
 #define OP_Explain                            150
+#define OP_DeleteRange                        151
+#define OP_AggScan                            152
+#define OP_HashOpen                           153
+#define OP_HashInsert                         154
+#define OP_HashProbe                          155
+#define OP_HashNext                           156
+#define OP_HashGroup                          157
+#define OP_HashSort                           158
+#define OP_HashGroupNext                      159
+#define OP_MemoOpen                           160
+#define OP_MemoLookup                         161
+#define OP_MemoStore                          162
 
 
 /* Properties such as "out2" or "jump" that are specified in
@@ -183,6 +195,8 @@
 /* 120 */ 0x15, 0x01, 0x02, 0x00, 0x01, 0x08, 0x05, 0x05,\
 /* 128 */ 0x05, 0x00, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00,\
 /* 136 */ 0x00, 0x00, 0x00, 0x01, 0x00, 0x04, 0x04, 0x04,\
-/* 144 */ 0x04, 0x04, 0x02, 0x02, 0x00, 0x00, 0x00,}
+/* 144 */ 0x04, 0x04, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00,\
+/* 152 */ 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01,\
+/* 160 */ 0x00, 0x01, 0x00,}
 
 /************** End of opcodes.h *********************************************/
\ No newline at end of file
@@ -3755,6 +3755,30 @@ static void unixModeBit(unixFile *pFile, unsigned char mask, int *pArg){
     }
 }
 
+/*
+ ** Advise the operating system that the nAmt bytes of file pFile
+ ** beginning at offset iOff are likely to be read soon, so that it may
+ ** start reading them in the background.  If the range lies within the
+ ** memory mapping it is advised through madvise(), otherwise through
+ ** posix_fadvise().  This is only a hint, so any error is ignored.
+ */
+static void unixPrefetchHint(unixFile *pFile, i64 iOff, i64 nAmt){
+    if( iOff<0 || nAmt<=0 ) return;
+#if SQLITE_MAX_MMAP_SIZE>0 && defined(MADV_WILLNEED)
+    if( pFile->pMapRegion && iOff+nAmt<=pFile->mmapSize ){
+        i64 szSyspage = (i64)sysconf(_SC_PAGESIZE);
+        i64 iStart = iOff;
+        if( szSyspage>0 ) iStart -= (iOff % szSyspage);
+        madvise(&((u8 *)pFile->pMapRegion)[iStart],
+                (size_t)(iOff+nAmt-iStart), MADV_WILLNEED);
+        return;
+    }
+#endif
+#if defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(pFile->h, (off_t)iOff, (off_t)nAmt, POSIX_FADV_WILLNEED);
+#endif
+}
+
 /* Forward declaration */
 static int unixGetTempname(int nBuf, char *zBuf);
 
@@ -3783,6 +3807,11 @@ static int unixFileControl(sqlite3_file *id, int op, void *pArg){
             SimulateIOErrorBenign(0);
             return rc;
         }
+        case SQLITE_FCNTL_PREFETCH: {
+            i64 *aRange = (i64*)pArg;
+            unixPrefetchHint(pFile, aRange[0], aRange[1]);
+            return SQLITE_OK;
+        }
         case SQLITE_FCNTL_PERSIST_WAL: {
             unixModeBit(pFile, UNIXFILE_PERSIST_WAL, (int*)pArg);
             return SQLITE_OK;
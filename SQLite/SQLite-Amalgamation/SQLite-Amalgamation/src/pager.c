@@ -685,6 +685,7 @@ struct Pager {
     int (*xBusyHandler)(void*); /* Function to call when busy */
     void *pBusyHandlerArg;      /* Context argument for xBusyHandler */
     int aStat[3];               /* Total cache hits, misses and writes */
+    u32 nReset;                 /* Number of calls to pager_reset() */
 #ifdef SQLITE_TEST
     int nRead;                  /* Database pages read */
 #endif
@@ -1699,6 +1700,7 @@ static PgHdr *pager_lookup(Pager *pPager, Pgno pgno){
  ** Discard the entire contents of the in-memory page-cache.
  */
 static void pager_reset(Pager *pPager){
+    pPager->nReset++;
     sqlite3BackupRestart(pPager->pBackup);
     sqlite3PcacheClear(pPager->pPCache);
 }
@@ -5402,6 +5404,44 @@ SQLITE_PRIVATE DbPage *sqlite3PagerLookup(Pager *pPager, Pgno pgno){
     return pPg;
 }
 
+/*
+ ** Hint that page pgno of the database file is likely to be requested
+ ** by sqlite3PagerAcquire() in the near future.  If the page is not
+ ** already in the page cache and its current content is in the database
+ ** file (not the WAL), ask the VFS to begin reading it in the background.
+ **
+ ** This routine never reads the page itself and never fails.  It is a
+ ** no-op for in-memory and temporary databases that have no file yet.
+ */
+SQLITE_PRIVATE void sqlite3PagerPrefetch(Pager *pPager, Pgno pgno){
+    DbPage *pPg;
+    i64 aRange[2];
+    
+    assert( pPager!=0 );
+    assert( pPager->eState>=PAGER_READER );
+    if( pPager->errCode || MEMDB || !isOpen(pPager->fd) ) return;
+    if( pgno==0 || pgno>pPager->dbSize || pgno==PAGER_MJ_PGNO(pPager) ) return;
+#ifdef SQLITE_HAS_CODEC
+    if( pPager->xCodec ) return;
+#endif
+    
+    /* Pages already in the cache need no help.  The lookup never allocates,
+     ** but it does take a reference, so release it again straight away.  */
+    pPg = sqlite3PagerLookup(pPager, pgno);
+    if( pPg ){
+        sqlite3PagerUnref(pPg);
+        return;
+    }
+    if( pagerUseWal(pPager) ){
+        u32 iFrame = 0;
+        if( sqlite3WalFindFrame(pPager->pWal, pgno, &iFrame) || iFrame ) return;
+    }
+    
+    aRange[0] = (i64)(pgno-1) * pPager->pageSize;
+    aRange[1] = pPager->pageSize;
+    sqlite3OsFileControlHint(pPager->fd, SQLITE_FCNTL_PREFETCH, (void*)aRange);
+}
+
 /*
  ** Release a page reference.
  **
@@ -6331,6 +6371,15 @@ SQLITE_PRIVATE u8 sqlite3PagerIsreadonly(Pager *pPager){
     return pPager->readOnly;
 }
 
+/*
+ ** Return the number of times the page cache has been discarded since the
+ ** pager was opened.  The b-tree layer compares successive values to learn
+ ** whether content it derived from the cache may have gone stale.
+ */
+SQLITE_PRIVATE u32 sqlite3PagerResetCount(Pager *pPager){
+    return pPager->nReset;
+}
+
 /*
  ** Return the number of references to the pager.
  */
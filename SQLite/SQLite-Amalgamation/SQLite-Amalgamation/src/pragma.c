@@ -70,6 +70,7 @@
 #define PragTyp_REKEY                         38
 #define PragTyp_LOCK_STATUS                   39
 #define PragTyp_PARSER_TRACE                  40
+#define PragTyp_FILL_FACTOR                   41
 #define PragFlag_NeedSchema           0x01
 static const struct sPragmaNames {
     const char *const zName;  /* Name of pragma */
@@ -173,6 +174,12 @@ static const struct sPragmaNames {
         /* ePragFlag: */ 0,
         /* iArg:      */ 0 },
 #endif
+#if !defined(SQLITE_OMIT_PAGER_PRAGMAS)
+    { /* zName:     */ "fill_factor",
+        /* ePragTyp:  */ PragTyp_FILL_FACTOR,
+        /* ePragFlag: */ 0,
+        /* iArg:      */ 0 },
+#endif
 #if !defined(SQLITE_OMIT_FOREIGN_KEY) && !defined(SQLITE_OMIT_TRIGGER)
     { /* zName:     */ "foreign_key_check",
         /* ePragTyp:  */ PragTyp_FOREIGN_KEY_CHECK,
@@ -567,11 +574,7 @@ static int changeTempStorage(Parse *pParse, const char *zStorageType){
 static void returnSingleInt(Parse *pParse, const char *zLabel, i64 value){
     Vdbe *v = sqlite3GetVdbe(pParse);
     int mem = ++pParse->nMem;
-    i64 *pI64 = sqlite3DbMallocRaw(pParse->db, sizeof(value));
-    if( pI64 ){
-        memcpy(pI64, &value, sizeof(value));
-    }
-    sqlite3VdbeAddOp4(v, OP_Int64, 0, mem, 0, (char*)pI64, P4_INT64);
+    sqlite3VdbeAddOp4Dup8(v, OP_Int64, 0, mem, 0, (u8*)&value, P4_INT64);
     sqlite3VdbeSetNumCols(v, 1);
     sqlite3VdbeSetColName(v, 0, COLNAME_NAME, zLabel, SQLITE_STATIC);
     sqlite3VdbeAddOp2(v, OP_ResultRow, mem, 1);
@@ -875,6 +878,36 @@ SQLITE_PRIVATE void sqlite3Pragma(
             break;
         }
             
+            /*
+             **  PRAGMA [database.]fill_factor
+             **  PRAGMA [database.]fill_factor=N
+             **
+             ** The first form reports the percentage of each b-tree page that
+             ** is filled when a table or index is bulk loaded from presorted
+             ** input (CREATE INDEX, REINDEX, VACUUM and INSERT INTO ... SELECT
+             ** transfers).  The second form changes the setting.  If no
+             ** database name is given, the setting is changed for all attached
+             ** databases.  Both forms return the new setting.
+             */
+        case PragTyp_FILL_FACTOR: {
+            Btree *pBt = pDb->pBt;
+            int n = -1;
+            assert( pBt!=0 );
+            if( zRight ){
+                n = sqlite3Atoi(zRight);
+                if( n<0 ) n = 0;
+            }
+            if( pId2->n==0 && n>=0 ){
+                int ii;
+                for(ii=0; ii<db->nDb; ii++){
+                    sqlite3BtreeFillFactor(db->aDb[ii].pBt, n);
+                }
+            }
+            n = sqlite3BtreeFillFactor(pBt, n);
+            returnSingleInt(pParse, "fill_factor", n);
+            break;
+        }
+            
             /*
              **  PRAGMA [database.]max_page_count
              **  PRAGMA [database.]max_page_count=N
@@ -1444,6 +1477,7 @@ SQLITE_PRIVATE void sqlite3Pragma(
             sqlite3VdbeSetColName(v, 1, COLNAME_NAME, "index", SQLITE_STATIC);
             sqlite3VdbeSetColName(v, 2, COLNAME_NAME, "width", SQLITE_STATIC);
             sqlite3VdbeSetColName(v, 3, COLNAME_NAME, "height", SQLITE_STATIC);
+            sqlite3LazySchemaLoadAll(db, iDb);
             for(i=sqliteHashFirst(&pDb->pSchema->tblHash); i; i=sqliteHashNext(i)){
                 Table *pTab = sqliteHashData(i);
                 sqlite3VdbeAddOp4(v, OP_String8, 0, 1, 0, pTab->zName, 0);
@@ -1810,6 +1844,7 @@ SQLITE_PRIVATE void sqlite3Pragma(
                  ** for all tables and indices in the database.
                  */
                 assert( sqlite3SchemaMutexHeld(db, i, 0) );
+                sqlite3LazySchemaLoadAll(db, i);
                 pTbls = &db->aDb[i].pSchema->tblHash;
                 for(x=sqliteHashFirst(pTbls); x; x=sqliteHashNext(x)){
                     Table *pTab = sqliteHashData(x);
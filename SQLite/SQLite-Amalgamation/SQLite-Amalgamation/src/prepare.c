@@ -124,6 +124,748 @@ SQLITE_PRIVATE int sqlite3InitCallback(void *pInit, int argc, char **argv, char
     return 0;
 }
 
+#ifndef SQLITE_OMIT_SCHEMA_SNAPSHOT
+/*
+ ** Schema snapshots.
+ **
+ ** Loading the schema of a database file normally runs a SELECT against
+ ** sqlite_master and parses every CREATE statement it returns.  When there
+ ** are thousands of objects, the parsing is most of the cost of opening a
+ ** connection.  So once a schema has been loaded, a compact binary
+ ** description of the Table and Index objects the parser built is kept in
+ ** a process-wide cache.  The next connection that loads the schema of the
+ ** same file rebuilds those objects directly from the snapshot.
+ **
+ ** A snapshot is a list of records in sqlite_master order.  There are
+ ** three kinds of record:
+ **
+ **    SNAP_ROW    A row of sqlite_master (name, rootpage, sql), replayed
+ **                through sqlite3InitCallback().  Views, triggers, virtual
+ **                tables, partial indexes and tables with CHECK or FOREIGN
+ **                KEY constraints or non-literal defaults are stored this
+ **                way.  So are the rows with a NULL sql column that hold
+ **                the root pages of automatic indexes.
+ **
+ **    SNAP_TABLE  An ordinary table with its columns and the automatic
+ **                indexes created for its PRIMARY KEY and UNIQUE
+ **                constraints.
+ **
+ **    SNAP_INDEX  An index created by CREATE INDEX, other than a partial
+ **                index.
+ **
+ ** A snapshot is only used if the file name, schema cookie, file format,
+ ** text encoding and a checksum of the rows of sqlite_master all match.
+ ** The checksum rejects a different file that has been opened under the
+ ** same name and happens to have the same cookie.  Computing it reads
+ ** sqlite_master but does not parse the CREATE statements, which is most
+ ** of the cost of loading a schema.
+ **
+ ** Snapshots are taken before sqlite_stat1 is read, so they contain the
+ ** default row estimates.  sqlite3AnalysisLoad() runs as usual after a
+ ** schema has been built from a snapshot.
+ */
+
+/*
+ ** The number of snapshots kept by the process.  Only the most recent
+ ** snapshot of each file is kept.
+ */
+#ifndef SQLITE_SCHEMA_SNAPSHOT_MAX
+# define SQLITE_SCHEMA_SNAPSHOT_MAX 8
+#endif
+
+/*
+ ** Record types
+ */
+#define SNAP_ROW     1
+#define SNAP_TABLE   2
+#define SNAP_INDEX   3
+
+typedef struct SchemaSnap SchemaSnap;
+typedef struct SnapBuf SnapBuf;
+typedef struct SnapReader SnapReader;
+typedef struct SnapInit SnapInit;
+
+/*
+ ** A snapshot of the schema of one database file.  Once published, a
+ ** snapshot is never modified, so it may be decoded without holding any
+ ** mutex as long as a reference is held.
+ */
+struct SchemaSnap {
+    char *zFile;              /* Full pathname of the database file */
+    u32 iCookie;              /* Schema cookie */
+    u32 cksum;                /* sqlite3BtreeSchemaChecksum() */
+    u8 enc;                   /* Text encoding of the database */
+    u8 file_format;           /* Schema format number */
+    int nRef;                 /* References, including one from the list */
+    int nData;                /* Number of bytes in aData[] */
+    u8 *aData;                /* The records */
+    SchemaSnap *pNext;        /* Next snapshot, most recently used first */
+};
+
+/*
+ ** List of cached snapshots.  Access is protected by
+ ** SQLITE_MUTEX_STATIC_MASTER.  The list is emptied by
+ ** sqlite3_reset_schema_snapshots().
+ */
+static SchemaSnap *SQLITE_WSD schemaSnapList = 0;
+#define schemaSnapList GLOBAL(SchemaSnap *, schemaSnapList)
+
+/*
+ ** A buffer that records are appended to.
+ */
+struct SnapBuf {
+    u8 *a;                    /* Content */
+    int n;                    /* Bytes used */
+    int nAlloc;               /* Bytes allocated */
+    int bErr;                 /* True after a malloc failure */
+};
+
+/*
+ ** A cursor reading records out of a snapshot.
+ */
+struct SnapReader {
+    const u8 *a;              /* Content */
+    int n;                    /* Size of a[] */
+    int i;                    /* Offset of the next byte to read */
+};
+
+/*
+ ** Context for the sqlite_master callback while a schema is loaded the
+ ** slow way.  The sqlite_master rows are copied into a buffer so that a
+ ** snapshot can be made afterwards.
+ */
+struct SnapInit {
+    InitData init;            /* Must be first.  For sqlite3InitCallback() */
+    SnapBuf rows;             /* Copy of the sqlite_master rows */
+};
+
+static void snapPutBytes(SnapBuf *p, const void *z, int n){
+    if( p->bErr ) return;
+    if( p->n+n>p->nAlloc ){
+        int nNew = p->nAlloc ? p->nAlloc*2 : 4096;
+        u8 *aNew;
+        while( nNew<p->n+n ) nNew *= 2;
+        aNew = (u8*)sqlite3_realloc(p->a, nNew);
+        if( aNew==0 ){
+            p->bErr = 1;
+            return;
+        }
+        p->a = aNew;
+        p->nAlloc = nNew;
+    }
+    memcpy(&p->a[p->n], z, n);
+    p->n += n;
+}
+
+static void snapPutVarint(SnapBuf *p, u64 v){
+    u8 a[9];
+    snapPutBytes(p, a, sqlite3PutVarint(a, v));
+}
+
+/*
+ ** Strings are written as a varint holding one more than their length
+ ** (zero for a NULL pointer) followed by the bytes and a nul terminator,
+ ** so that a reader can use them in place.
+ */
+static void snapPutString(SnapBuf *p, const char *z){
+    if( z==0 ){
+        snapPutVarint(p, 0);
+    }else{
+        int n = sqlite3Strlen30(z);
+        snapPutVarint(p, n+1);
+        snapPutBytes(p, z, n+1);
+    }
+}
+
+static u64 snapGetVarint(SnapReader *p){
+    u64 v;
+    assert( p->i<p->n );
+    p->i += sqlite3GetVarint(&p->a[p->i], &v);
+    return v;
+}
+
+static const char *snapGetString(SnapReader *p){
+    int n = (int)snapGetVarint(p);
+    const char *z;
+    if( n==0 ) return 0;
+    z = (const char*)&p->a[p->i];
+    p->i += n;
+    assert( p->i<=p->n && z[n-1]==0 );
+    return z;
+}
+
+/*
+ ** Return true if the default value expression pDflt can be stored in a
+ ** snapshot.  Only the literals the parser builds as a single Expr node
+ ** are stored.
+ */
+static int schemaSnapIsLiteral(Expr *pDflt){
+    switch( pDflt->op ){
+        case TK_INTEGER:
+        case TK_FLOAT:
+        case TK_STRING:
+        case TK_BLOB:
+        case TK_NULL:
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ ** Write the definition of index pIdx, without the name of its table.
+ ** Collation sequences that are the default for the column are not
+ ** written.
+ */
+static void schemaSnapPutIndex(SnapBuf *p, Index *pIdx){
+    Column *aCol = pIdx->pTable->aCol;
+    int i;
+    snapPutString(p, pIdx->zName);
+    snapPutVarint(p, pIdx->tnum);
+    snapPutVarint(p, pIdx->onError);
+    snapPutVarint(p, pIdx->autoIndex);
+    snapPutVarint(p, pIdx->uniqNotNull);
+    snapPutVarint(p, (u16)pIdx->szIdxRow);
+    snapPutVarint(p, pIdx->nColumn);
+    for(i=0; i<pIdx->nColumn; i++){
+        const char *zDflt = aCol[pIdx->aiColumn[i]].zColl;
+        if( zDflt==0 ) zDflt = "BINARY";
+        snapPutVarint(p, pIdx->aiColumn[i]);
+        snapPutVarint(p, pIdx->aSortOrder[i]);
+        snapPutString(p, sqlite3StrICmp(pIdx->azColl[i], zDflt) ? pIdx->azColl[i] : 0);
+    }
+}
+
+/*
+ ** Write a SNAP_TABLE record for pTab and return true, or return false
+ ** without writing anything if pTab has to be stored as a SNAP_ROW.
+ */
+static int schemaSnapPutTable(SnapBuf *p, Table *pTab){
+    Index *pIdx;
+    int nAuto = 0;
+    int i;
+    
+    if( pTab->pSelect || IsVirtual(pTab) || pTab->pCheck || pTab->pFKey ){
+        return 0;
+    }
+    for(i=0; i<pTab->nCol; i++){
+        Expr *pDflt = pTab->aCol[i].pDflt;
+        if( pDflt && !schemaSnapIsLiteral(pDflt) ) return 0;
+    }
+    for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+        if( pIdx->autoIndex ) nAuto++;
+    }
+    
+    snapPutVarint(p, SNAP_TABLE);
+    snapPutString(p, pTab->zName);
+    snapPutVarint(p, pTab->tnum);
+    snapPutVarint(p, pTab->iPKey+1);
+    snapPutVarint(p, pTab->keyConf);
+    snapPutVarint(p, pTab->tabFlags & (TF_HasPrimaryKey|TF_Autoincrement));
+    snapPutVarint(p, pTab->nRowEst);
+    snapPutVarint(p, (u16)pTab->szTabRow);
+    snapPutVarint(p, pTab->addColOffset);
+    snapPutVarint(p, pTab->nCol);
+    for(i=0; i<pTab->nCol; i++){
+        Column *pCol = &pTab->aCol[i];
+        snapPutString(p, pCol->zName);
+        snapPutString(p, pCol->zType);
+        snapPutString(p, pCol->zColl);
+        snapPutString(p, pCol->zDflt);
+        if( pCol->pDflt ){
+            Expr *pDflt = pCol->pDflt;
+            snapPutVarint(p, pDflt->op);
+            if( ExprHasProperty(pDflt, EP_IntValue) ){
+                char zNum[20];
+                sqlite3_snprintf(sizeof(zNum), zNum, "%d", pDflt->u.iValue);
+                snapPutString(p, zNum);
+            }else{
+                snapPutString(p, pDflt->u.zToken);
+            }
+        }else{
+            snapPutVarint(p, 0);
+        }
+        snapPutVarint(p, pCol->notNull);
+        snapPutVarint(p, (u8)pCol->affinity);
+        snapPutVarint(p, pCol->szEst);
+        snapPutVarint(p, pCol->colFlags);
+    }
+    snapPutVarint(p, nAuto);
+    for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+        if( pIdx->autoIndex ) schemaSnapPutIndex(p, pIdx);
+    }
+    return 1;
+}
+
+/*
+ ** Build a snapshot of database iDb, which has just been loaded from the
+ ** sqlite_master rows copied into pRows, in pOut.
+ */
+static void schemaSnapEncode(sqlite3 *db, int iDb, SnapBuf *pRows, SnapBuf *pOut){
+    const char *zDb = db->aDb[iDb].zName;
+    SnapReader r;
+    
+    r.a = pRows->a;
+    r.n = pRows->n;
+    r.i = 0;
+    while( r.i<r.n && !pOut->bErr ){
+        const char *zName = snapGetString(&r);
+        const char *zRoot = snapGetString(&r);
+        const char *zSql = snapGetString(&r);
+    
+        if( zName && zRoot && zSql && zSql[0] ){
+            int iRoot = sqlite3Atoi(zRoot);
+            Table *pTab = sqlite3FindTable(db, zName, zDb);
+            Index *pIdx;
+            if( pTab && pTab->tnum==iRoot && iRoot>0 ){
+                if( schemaSnapPutTable(pOut, pTab) ) continue;
+            }
+            pIdx = sqlite3FindIndex(db, zName, zDb);
+            if( pIdx && pIdx->tnum==iRoot && iRoot>0
+             && pIdx->autoIndex==0 && pIdx->pPartIdxWhere==0 ){
+                snapPutVarint(pOut, SNAP_INDEX);
+                snapPutString(pOut, pIdx->pTable->zName);
+                schemaSnapPutIndex(pOut, pIdx);
+                continue;
+            }
+        }
+        snapPutVarint(pOut, SNAP_ROW);
+        snapPutString(pOut, zName);
+        snapPutString(pOut, zRoot);
+        snapPutString(pOut, zSql);
+    }
+}
+
+/*
+ ** Link index pIndex into the list of indices of its table the way
+ ** sqlite3CreateIndex() does: indices labeled OE_Replace come last.
+ */
+static void schemaSnapLinkIndex(Table *pTab, Index *pIndex){
+    if( pIndex->onError!=OE_Replace || pTab->pIndex==0
+       || pTab->pIndex->onError==OE_Replace ){
+        pIndex->pNext = pTab->pIndex;
+        pTab->pIndex = pIndex;
+    }else{
+        Index *pOther = pTab->pIndex;
+        while( pOther->pNext && pOther->pNext->onError!=OE_Replace ){
+            pOther = pOther->pNext;
+        }
+        pIndex->pNext = pOther->pNext;
+        pOther->pNext = pIndex;
+    }
+}
+
+/*
+ ** Read an index definition written by schemaSnapPutIndex() and build the
+ ** Index object for table pTab, laid out as sqlite3CreateIndex() would.
+ ** The index is added to the schema hash table but not to the list of
+ ** indices of pTab.  Return NULL if a malloc fails.
+ */
+static Index *schemaSnapGetIndex(sqlite3 *db, Table *pTab, SnapReader *r){
+    const char *zName = snapGetString(r);
+    int tnum = (int)snapGetVarint(r);
+    u8 onError = (u8)snapGetVarint(r);
+    u8 autoIndex = (u8)snapGetVarint(r);
+    u8 uniqNotNull = (u8)snapGetVarint(r);
+    LogEst szIdxRow = (LogEst)(u16)snapGetVarint(r);
+    int nCol = (int)snapGetVarint(r);
+    int nName = sqlite3Strlen30(zName);
+    int nExtra = 0;
+    int iStart = r->i;
+    char *zExtra;
+    Index *pIndex;
+    int i;
+    
+    /* Find the space needed for explicit collation sequence names */
+    for(i=0; i<nCol; i++){
+        const char *zColl;
+        snapGetVarint(r);
+        snapGetVarint(r);
+        zColl = snapGetString(r);
+        if( zColl ) nExtra += sqlite3Strlen30(zColl) + 1;
+    }
+    r->i = iStart;
+    
+    pIndex = sqlite3DbMallocZero(db,
+                                 ROUND8(sizeof(Index)) +              /* Index structure  */
+                                 ROUND8(sizeof(tRowcnt)*(nCol+1)) +   /* Index.aiRowEst   */
+                                 sizeof(char *)*nCol +                /* Index.azColl     */
+                                 sizeof(int)*nCol +                   /* Index.aiColumn   */
+                                 sizeof(u8)*nCol +                    /* Index.aSortOrder */
+                                 nName + 1 +                          /* Index.zName      */
+                                 nExtra                               /* Collation sequence names */
+                                 );
+    if( pIndex==0 ) return 0;
+    zExtra = (char*)pIndex;
+    pIndex->aiRowEst = (tRowcnt*)&zExtra[ROUND8(sizeof(Index))];
+    pIndex->azColl = (char**)
+    ((char*)pIndex->aiRowEst + ROUND8(sizeof(tRowcnt)*(nCol+1)));
+    pIndex->aiColumn = (int *)(&pIndex->azColl[nCol]);
+    pIndex->aSortOrder = (u8 *)(&pIndex->aiColumn[nCol]);
+    pIndex->zName = (char *)(&pIndex->aSortOrder[nCol]);
+    zExtra = (char *)(&pIndex->zName[nName+1]);
+    memcpy(pIndex->zName, zName, nName+1);
+    pIndex->pTable = pTab;
+    pIndex->nColumn = (u16)nCol;
+    pIndex->onError = onError;
+    pIndex->uniqNotNull = uniqNotNull;
+    pIndex->autoIndex = autoIndex;
+    pIndex->szIdxRow = szIdxRow;
+    pIndex->tnum = tnum;
+    pIndex->pSchema = pTab->pSchema;
+    for(i=0; i<nCol; i++){
+        int j = (int)snapGetVarint(r);
+        const char *zColl;
+        pIndex->aiColumn[i] = j;
+        pIndex->aSortOrder[i] = (u8)snapGetVarint(r);
+        zColl = snapGetString(r);
+        if( zColl ){
+            int nColl = sqlite3Strlen30(zColl) + 1;
+            memcpy(zExtra, zColl, nColl);
+            pIndex->azColl[i] = zExtra;
+            zExtra += nColl;
+        }else{
+            pIndex->azColl[i] = pTab->aCol[j].zColl;
+            if( !pIndex->azColl[i] ) pIndex->azColl[i] = "BINARY";
+        }
+    }
+    sqlite3DefaultRowEst(pIndex);
+    if( sqlite3HashInsert(&pIndex->pSchema->idxHash, pIndex->zName, nName, pIndex) ){
+        /* Malloc must have failed inside HashInsert(), as the names were
+         ** unique when the snapshot was made */
+        db->mallocFailed = 1;
+        sqlite3DbFree(db, pIndex);
+        return 0;
+    }
+    return pIndex;
+}
+
+/*
+ ** Read a SNAP_TABLE record and add the table it describes to the schema
+ ** of database iDb.  Return SQLITE_OK or SQLITE_NOMEM.
+ */
+static int schemaSnapGetTable(sqlite3 *db, int iDb, SnapReader *r){
+    Schema *pSchema = db->aDb[iDb].pSchema;
+    Table *pTab;
+    Index *pLast = 0;
+    int nCol;
+    int nAuto;
+    int i;
+    
+    pTab = sqlite3DbMallocZero(db, sizeof(Table));
+    if( pTab==0 ) return SQLITE_NOMEM;
+    pTab->nRef = 1;
+    pTab->pSchema = pSchema;
+    pTab->zName = sqlite3DbStrDup(db, snapGetString(r));
+    pTab->tnum = (int)snapGetVarint(r);
+    pTab->iPKey = (i16)(snapGetVarint(r) - 1);
+    pTab->keyConf = (u8)snapGetVarint(r);
+    pTab->tabFlags = (u8)snapGetVarint(r);
+    pTab->nRowEst = (tRowcnt)snapGetVarint(r);
+    pTab->szTabRow = (LogEst)(u16)snapGetVarint(r);
+    pTab->addColOffset = (int)snapGetVarint(r);
+    nCol = (int)snapGetVarint(r);
+    pTab->aCol = sqlite3DbMallocZero(db, ((nCol+7)&~7)*sizeof(Column));
+    if( pTab->zName==0 || pTab->aCol==0 ) goto snap_table_nomem;
+    pTab->nCol = (i16)nCol;
+    for(i=0; i<nCol; i++){
+        Column *pCol = &pTab->aCol[i];
+        int op;
+        pCol->zName = sqlite3DbStrDup(db, snapGetString(r));
+        pCol->zType = sqlite3DbStrDup(db, snapGetString(r));
+        pCol->zColl = sqlite3DbStrDup(db, snapGetString(r));
+        pCol->zDflt = sqlite3DbStrDup(db, snapGetString(r));
+        op = (int)snapGetVarint(r);
+        if( op ){
+            Expr *pTmp = sqlite3Expr(db, op, snapGetString(r));
+            pCol->pDflt = sqlite3ExprDup(db, pTmp, EXPRDUP_REDUCE);
+            sqlite3ExprDelete(db, pTmp);
+        }
+        pCol->notNull = (u8)snapGetVarint(r);
+        pCol->affinity = (char)snapGetVarint(r);
+        pCol->szEst = (u8)snapGetVarint(r);
+        pCol->colFlags = (u16)snapGetVarint(r);
+    }
+    if( db->mallocFailed ) goto snap_table_nomem;
+    
+    /* The automatic indices were written in list order */
+    nAuto = (int)snapGetVarint(r);
+    for(i=0; i<nAuto; i++){
+        Index *pIdx = schemaSnapGetIndex(db, pTab, r);
+        if( pIdx==0 ) goto snap_table_nomem;
+        if( pLast ){
+            pLast->pNext = pIdx;
+        }else{
+            pTab->pIndex = pIdx;
+        }
+        pLast = pIdx;
+    }
+    
+    if( sqlite3HashInsert(&pSchema->tblHash, pTab->zName,
+                          sqlite3Strlen30(pTab->zName), pTab) ){
+        goto snap_table_nomem;
+    }
+#ifndef SQLITE_OMIT_AUTOINCREMENT
+    if( strcmp(pTab->zName, "sqlite_sequence")==0 ){
+        pSchema->pSeqTab = pTab;
+    }
+#endif
+    db->flags |= SQLITE_InternChanges;
+    return SQLITE_OK;
+    
+snap_table_nomem:
+    db->mallocFailed = 1;
+    sqlite3DeleteTable(db, pTab);
+    return SQLITE_NOMEM;
+}
+
+/*
+ ** Rebuild the schema of database pData->iDb from snapshot pSnap.  Errors
+ ** are left in pData->rc, as sqlite3InitCallback() does.
+ */
+static void schemaSnapLoad(InitData *pData, SchemaSnap *pSnap){
+    sqlite3 *db = pData->db;
+    int iDb = pData->iDb;
+    const char *zDb = db->aDb[iDb].zName;
+    SnapReader r;
+    
+    r.a = pSnap->aData;
+    r.n = pSnap->nData;
+    r.i = 0;
+    DbClearProperty(db, iDb, DB_Empty);
+    while( r.i<r.n && pData->rc==SQLITE_OK ){
+        int eType = (int)snapGetVarint(&r);
+        if( eType==SNAP_ROW ){
+            const char *azArg[3];
+            azArg[0] = snapGetString(&r);
+            azArg[1] = snapGetString(&r);
+            azArg[2] = snapGetString(&r);
+            sqlite3InitCallback(pData, 3, (char**)azArg, 0);
+        }else if( eType==SNAP_TABLE ){
+            pData->rc = schemaSnapGetTable(db, iDb, &r);
+        }else{
+            const char *zTab = snapGetString(&r);
+            Table *pTab = sqlite3FindTable(db, zTab, zDb);
+            Index *pIdx;
+            assert( eType==SNAP_INDEX );
+            if( pTab==0 ){
+                corruptSchema(pData, zTab, "schema snapshot");
+                break;
+            }
+            pIdx = schemaSnapGetIndex(db, pTab, &r);
+            if( pIdx==0 ){
+                pData->rc = SQLITE_NOMEM;
+                break;
+            }
+            schemaSnapLinkIndex(pTab, pIdx);
+            db->flags |= SQLITE_InternChanges;
+        }
+    }
+}
+
+/*
+ ** Drop a reference to snapshot p.  The caller holds the master mutex.
+ */
+static void schemaSnapUnref(SchemaSnap *p){
+    if( --p->nRef==0 ){
+        sqlite3_free(p->aData);
+        sqlite3_free(p);
+    }
+}
+
+/*
+ ** Look for a cached snapshot of the schema of database file zFile.  If
+ ** one matches the other arguments, return it with an extra reference.
+ ** Any snapshot of zFile that does not match is discarded.
+ */
+static SchemaSnap *schemaSnapFind(
+    const char *zFile,            /* Full pathname of the database file */
+    u32 iCookie,                  /* Schema cookie */
+    u32 cksum,                    /* sqlite3BtreeSchemaChecksum() */
+    u8 enc,                       /* Text encoding */
+    u8 file_format                /* Schema format number */
+){
+    MUTEX_LOGIC( sqlite3_mutex *pMaster = sqlite3MutexAlloc(SQLITE_MUTEX_STATIC_MASTER); )
+    SchemaSnap **pp;
+    SchemaSnap *p;
+    
+    sqlite3_mutex_enter(pMaster);
+    for(pp=&schemaSnapList; (p = *pp)!=0; pp=&p->pNext){
+        if( strcmp(p->zFile, zFile)==0 ) break;
+    }
+    if( p ){
+        *pp = p->pNext;
+        if( p->iCookie==iCookie && p->cksum==cksum
+         && p->enc==enc && p->file_format==file_format ){
+            p->pNext = schemaSnapList;
+            schemaSnapList = p;
+            p->nRef++;
+        }else{
+            schemaSnapUnref(p);
+            p = 0;
+        }
+    }
+    sqlite3_mutex_leave(pMaster);
+    return p;
+}
+
+/*
+ ** Release a snapshot returned by schemaSnapFind().  If bDiscard is true,
+ ** also remove it from the cache.
+ */
+static void schemaSnapRelease(SchemaSnap *p, int bDiscard){
+    MUTEX_LOGIC( sqlite3_mutex *pMaster = sqlite3MutexAlloc(SQLITE_MUTEX_STATIC_MASTER); )
+    sqlite3_mutex_enter(pMaster);
+    if( bDiscard ){
+        SchemaSnap **pp;
+        for(pp=&schemaSnapList; *pp; pp=&(*pp)->pNext){
+            if( *pp==p ){
+                *pp = p->pNext;
+                schemaSnapUnref(p);
+                break;
+            }
+        }
+    }
+    schemaSnapUnref(p);
+    sqlite3_mutex_leave(pMaster);
+}
+
+/*
+ ** Add a snapshot to the cache, taking ownership of the buffer pBuf->a.
+ ** The least recently used snapshots are discarded if there are too many.
+ */
+static void schemaSnapPublish(
+    const char *zFile,            /* Full pathname of the database file */
+    u32 iCookie,                  /* Schema cookie */
+    u32 cksum,                    /* sqlite3BtreeSchemaChecksum() */
+    u8 enc,                       /* Text encoding */
+    u8 file_format,               /* Schema format number */
+    SnapBuf *pBuf                 /* Encoded records */
+){
+    MUTEX_LOGIC( sqlite3_mutex *pMaster = sqlite3MutexAlloc(SQLITE_MUTEX_STATIC_MASTER); )
+    int nFile = sqlite3Strlen30(zFile);
+    SchemaSnap *pNew;
+    SchemaSnap **pp;
+    int n;
+    
+    pNew = (SchemaSnap*)sqlite3MallocZero(sizeof(SchemaSnap) + nFile + 1);
+    if( pNew==0 ){
+        sqlite3_free(pBuf->a);
+        return;
+    }
+    pNew->zFile = (char*)&pNew[1];
+    memcpy(pNew->zFile, zFile, nFile+1);
+    pNew->iCookie = iCookie;
+    pNew->cksum = cksum;
+    pNew->enc = enc;
+    pNew->file_format = file_format;
+    pNew->nRef = 1;
+    pNew->nData = pBuf->n;
+    pNew->aData = pBuf->a;
+    
+    sqlite3_mutex_enter(pMaster);
+    pNew->pNext = schemaSnapList;
+    schemaSnapList = pNew;
+    for(pp=&pNew->pNext, n=1; *pp; ){
+        SchemaSnap *p = *pp;
+        if( n>=SQLITE_SCHEMA_SNAPSHOT_MAX || strcmp(p->zFile, zFile)==0 ){
+            *pp = p->pNext;
+            schemaSnapUnref(p);
+        }else{
+            pp = &p->pNext;
+            n++;
+        }
+    }
+    sqlite3_mutex_leave(pMaster);
+}
+
+/*
+ ** Callback for the sqlite_master query when no snapshot was available.
+ ** Copy the row before passing it to sqlite3InitCallback().
+ */
+static int schemaSnapCallback(void *pArg, int argc, char **argv, char **NotUsed){
+    SnapInit *p = (SnapInit*)pArg;
+    if( argv ){
+        snapPutString(&p->rows, argv[0]);
+        snapPutString(&p->rows, argv[1]);
+        snapPutString(&p->rows, argv[2]);
+    }
+    return sqlite3InitCallback(&p->init, argc, argv, NotUsed);
+}
+
+/*
+ ** Load the schema of database pData->iDb, from a snapshot if a suitable
+ ** one is cached and by running query zSql against sqlite_master if not.
+ ** In the second case, a snapshot is made of the schema loaded.  The
+ ** return value is that of sqlite3_exec(), and errors found while
+ ** building the schema are left in pData->rc.
+ */
+static int schemaSnapInit(InitData *pData, const char *zSql){
+    sqlite3 *db = pData->db;
+    int iDb = pData->iDb;
+    Btree *pBt = db->aDb[iDb].pBt;
+    Schema *pSchema = db->aDb[iDb].pSchema;
+    const char *zFile = sqlite3BtreeGetFilename(pBt);
+    u32 iCookie = (u32)pSchema->schema_cookie;
+    SchemaSnap *pSnap;
+    SnapInit sInit;
+    u32 cksum;
+    int rc;
+    
+    if( SQLITE_SCHEMA_SNAPSHOT_MAX<=0 || zFile==0 || zFile[0]==0 ){
+        return sqlite3_exec(db, zSql, sqlite3InitCallback, pData, 0);
+    }
+    if( sqlite3BtreeSchemaChecksum(pBt, &cksum)!=SQLITE_OK ){
+        return sqlite3_exec(db, zSql, sqlite3InitCallback, pData, 0);
+    }
+    pSnap = schemaSnapFind(zFile, iCookie, cksum, pSchema->enc, pSchema->file_format);
+    if( pSnap ){
+        schemaSnapLoad(pData, pSnap);
+        schemaSnapRelease(pSnap, pData->rc!=SQLITE_OK && !db->mallocFailed);
+        return SQLITE_OK;
+    }
+    
+    memset(&sInit, 0, sizeof(sInit));
+    sInit.init = *pData;
+    rc = sqlite3_exec(db, zSql, schemaSnapCallback, &sInit, 0);
+    pData->rc = sInit.init.rc;
+    if( rc==SQLITE_OK && pData->rc==SQLITE_OK && !db->mallocFailed
+     && sInit.rows.n>0 && !sInit.rows.bErr ){
+        SnapBuf out;
+        memset(&out, 0, sizeof(out));
+        schemaSnapEncode(db, iDb, &sInit.rows, &out);
+        if( out.bErr ){
+            sqlite3_free(out.a);
+        }else{
+            schemaSnapPublish(zFile, iCookie, cksum, pSchema->enc,
+                              pSchema->file_format, &out);
+        }
+    }
+    sqlite3_free(sInit.rows.a);
+    return rc;
+}
+#endif /* SQLITE_OMIT_SCHEMA_SNAPSHOT */
+
+/*
+ ** Discard all cached schema snapshots.
+ */
+SQLITE_API void sqlite3_reset_schema_snapshots(void){
+#ifndef SQLITE_OMIT_SCHEMA_SNAPSHOT
+#ifndef SQLITE_OMIT_AUTOINIT
+    if( sqlite3_initialize()==SQLITE_OK )
+#endif
+    {
+        MUTEX_LOGIC( sqlite3_mutex *pMaster = sqlite3MutexAlloc(SQLITE_MUTEX_STATIC_MASTER); )
+        SchemaSnap *p;
+        sqlite3_mutex_enter(pMaster);
+        while( (p = schemaSnapList)!=0 ){
+            schemaSnapList = p->pNext;
+            schemaSnapUnref(p);
+        }
+        sqlite3_mutex_leave(pMaster);
+    }
+#endif
+}
+
 /*
  ** Attempt to read the database schema and initialize internal
  ** data structures for a single database file.  The index of the
@@ -324,16 +1066,33 @@ static int sqlite3InitOne(sqlite3 *db, int iDb, char **pzErrMsg){
     assert( db->init.busy );
     {
         char *zSql;
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+        int bLazy = sqlite3LazySchemaEnabled(db->aDb[iDb].pSchema);
+        zSql = sqlite3MPrintf(db,
+                              "SELECT name, rootpage, sql%s FROM '%q'.%s ORDER BY rowid",
+                              bLazy ? ", type, tbl_name" : "",
+                              db->aDb[iDb].zName, zMasterName);
+#else
         zSql = sqlite3MPrintf(db,
                               "SELECT name, rootpage, sql FROM '%q'.%s ORDER BY rowid",
                               db->aDb[iDb].zName, zMasterName);
+#endif
 #ifndef SQLITE_OMIT_AUTHORIZATION
         {
             int (*xAuth)(void*,int,const char*,const char*,const char*,const char*);
             xAuth = db->xAuth;
             db->xAuth = 0;
 #endif
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+            if( bLazy ){
+                rc = sqlite3_exec(db, zSql, sqlite3LazySchemaCallback, &initData, 0);
+            }else
+#endif
+#ifndef SQLITE_OMIT_SCHEMA_SNAPSHOT
+            rc = schemaSnapInit(&initData, zSql);
+#else
             rc = sqlite3_exec(db, zSql, sqlite3InitCallback, &initData, 0);
+#endif
 #ifndef SQLITE_OMIT_AUTHORIZATION
             db->xAuth = xAuth;
         }
@@ -697,18 +1456,35 @@ static int sqlite3LockAndPrepare(
                                  const char **pzTail       /* OUT: End of parsed string */
 ){
     int rc;
+#ifndef SQLITE_OMIT_STMT_CACHE
+    u32 iCacheKey = 0;
+#endif
     assert( ppStmt!=0 );
     *ppStmt = 0;
     if( !sqlite3SafetyCheckOk(db) ){
         return SQLITE_MISUSE_BKPT;
     }
     sqlite3_mutex_enter(db->mutex);
+#ifndef SQLITE_OMIT_STMT_CACHE
+    if( saveSqlFlag && pOld==0 ){
+        Vdbe *pCached = sqlite3VdbeCacheLookup(db, zSql, nBytes, pzTail, &iCacheKey);
+        if( pCached ){
+            *ppStmt = (sqlite3_stmt*)pCached;
+            sqlite3Error(db, SQLITE_OK, 0);
+            sqlite3_mutex_leave(db->mutex);
+            return SQLITE_OK;
+        }
+    }
+#endif
     sqlite3BtreeEnterAll(db);
     rc = sqlite3Prepare(db, zSql, nBytes, saveSqlFlag, pOld, ppStmt, pzTail);
     if( rc==SQLITE_SCHEMA ){
         sqlite3_finalize(*ppStmt);
         rc = sqlite3Prepare(db, zSql, nBytes, saveSqlFlag, pOld, ppStmt, pzTail);
     }
+#ifndef SQLITE_OMIT_STMT_CACHE
+    if( *ppStmt ) sqlite3VdbeCacheSetKey((Vdbe*)*ppStmt, iCacheKey);
+#endif
     sqlite3BtreeLeaveAll(db);
     sqlite3_mutex_leave(db->mutex);
     assert( rc==SQLITE_OK || *ppStmt==0 );
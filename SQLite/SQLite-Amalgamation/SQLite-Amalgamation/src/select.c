@@ -3932,6 +3932,616 @@ static const char *columnTypeImpl(
 # define explainSimpleCount(a,b,c)
 #endif
     
+#if !defined(SQLITE_OMIT_EXPLAIN) && !defined(SQLITE_OMIT_BATCH_AGGREGATE)
+    /*
+     ** Add a single OP_Explain instruction to the VDBE to explain an aggregate
+     ** query coded by batchAggregate().
+     */
+    static void explainBatchAggregate(Parse *pParse, Table *pTab){
+        if( pParse->explain==2 ){
+            char *zEqp = sqlite3MPrintf(pParse->db, "SCAN TABLE %s (BATCH AGGREGATE)",
+                                        pTab->zName);
+            sqlite3VdbeAddOp4(
+                              pParse->pVdbe, OP_Explain, pParse->iSelectId, 0, 0, zEqp, P4_DYNAMIC
+                              );
+        }
+    }
+#else
+# define explainBatchAggregate(a,b)
+#endif
+    
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+    /*
+     ** Maximum number of WHERE clause terms that OP_AggScan will evaluate.
+     */
+#define AGGSCAN_MAX_TERM 8
+    
+    /*
+     ** Split expression pExpr, which is part of a WHERE clause, into the
+     ** operands of its top-level AND operators and append them to apTerm[].
+     ** Return zero if there are more than AGGSCAN_MAX_TERM operands.
+     */
+    static int batchAggSplit(Expr *pExpr, Expr **apTerm, int *pnTerm){
+        if( pExpr->op==TK_AND ){
+            return batchAggSplit(pExpr->pLeft, apTerm, pnTerm)
+                && batchAggSplit(pExpr->pRight, apTerm, pnTerm);
+        }
+        if( *pnTerm>=AGGSCAN_MAX_TERM ) return 0;
+        apTerm[(*pnTerm)++] = pExpr;
+        return 1;
+    }
+    
+    /*
+     ** Return the index of table column iColumn in aiCol[], adding it to the
+     ** end of the array if it is not already present.
+     */
+    static int batchAggColumn(int *aiCol, int *pnCol, int iColumn){
+        int i;
+        for(i=0; i<*pnCol; i++){
+            if( aiCol[i]==iColumn ) return i;
+        }
+        aiCol[i] = iColumn;
+        (*pnCol)++;
+        return i;
+    }
+    
+    /*
+     ** Return true if collating sequence pColl is BINARY (or is NULL, which
+     ** means the same thing).
+     */
+    static int batchAggIsBinary(CollSeq *pColl){
+        return pColl==0 || sqlite3StrICmp(pColl->zName, "BINARY")==0;
+    }
+    
+    /*
+     ** The select statement passed as the second argument is an aggregate
+     ** query without a GROUP BY clause.  This function tests whether it is
+     ** of the form:
+     **
+     **   SELECT <aggregates> FROM <tbl> WHERE <col> <op> <expr> AND ...
+     **
+     ** where:
+     **
+     **    * <tbl> is a real table, not a view, sub-select or virtual table,
+     **    * each aggregate is count(*) or one of the built-in count(), sum(),
+     **      total(), avg(), min() or max() applied to a column of <tbl>,
+     **      without DISTINCT,
+     **    * the result set refers to no column outside of an aggregate,
+     **    * each <op> is one of =, <>, <, <=, > and >=, each <expr> is a
+     **      constant, and no index on <tbl> starts with any <col>,
+     **    * all comparisons use the BINARY collating sequence.
+     **
+     ** If so, code the query as a single OP_AggScan instruction, which
+     ** decodes the rows of <tbl> in batches and evaluates the comparisons
+     ** and aggregates over whole batches at a time, and return non-zero.
+     ** OP_AggScan leaves the final value of each aggregate in its register,
+     ** so the caller should not code an accumulator reset, loop or
+     ** OP_AggFinal.  If the query does not qualify, return zero without
+     ** generating any code.
+     */
+    static int batchAggregate(Parse *pParse, Select *p, AggInfo *pAggInfo){
+        sqlite3 *db = pParse->db;
+        Vdbe *v = pParse->pVdbe;
+        struct SrcList_item *pItem = &p->pSrc->a[0];
+        Table *pTab = pItem->pTab;
+        int iCur = pItem->iCursor;
+        Expr *apTerm[AGGSCAN_MAX_TERM];          /* Terms of the WHERE clause */
+        char aAff[AGGSCAN_MAX_TERM];             /* Affinity of each comparison */
+        int aiCol[AGGSCAN_MAX_TERM*2];           /* Table columns used */
+        int nTerm = 0;
+        int nCol = 0;
+        int nByte;
+        int iDb;
+        int i;
+        Index *pIdx;
+        AggScan *pScan;
+        
+        if( p->pSrc->nSrc!=1 || pItem->pSelect || pItem->zIndex ) return 0;
+        if( pTab==0 || IsVirtual(pTab) ) return 0;
+        if( pAggInfo->nAccumulator || pAggInfo->nFunc==0 ) return 0;
+        if( pAggInfo->nFunc>AGGSCAN_MAX_TERM ) return 0;
+        if( p->pWhere && !batchAggSplit(p->pWhere, apTerm, &nTerm) ) return 0;
+        
+        /* Check that each WHERE clause term is a comparison between a column
+         ** and a constant, and that there is no index that where.c might use
+         ** to evaluate it more efficiently than a full table scan. */
+        for(i=0; i<nTerm; i++){
+            Expr *pTerm = apTerm[i];
+            Expr *pCol = pTerm->pLeft;
+            Expr *pVal = pTerm->pRight;
+            char aff;
+            
+            if( pTerm->op<TK_NE || pTerm->op>TK_GE ) return 0;
+            if( pCol->op!=TK_COLUMN ){
+                pCol = pTerm->pRight;
+                pVal = pTerm->pLeft;
+            }
+            if( pCol->op!=TK_COLUMN || pCol->iTable!=iCur || pCol->iColumn<0 ){
+                return 0;
+            }
+            if( pTab->aCol[pCol->iColumn].pDflt ) return 0;
+            if( !sqlite3ExprIsConstant(pVal) ) return 0;
+            if( !batchAggIsBinary(
+                    sqlite3BinaryCompareCollSeq(pParse, pTerm->pLeft, pTerm->pRight)) ){
+                return 0;
+            }
+            
+            /* Column values are stored with the column affinity already
+             ** applied.  So the comparison is equivalent to comparing them with
+             ** the constant after applying the comparison affinity to it alone,
+             ** provided that affinity would not change a stored value. */
+            aff = sqlite3CompareAffinity(pVal, pTab->aCol[pCol->iColumn].affinity);
+            if( aff!=SQLITE_AFF_NONE
+               && aff!=pTab->aCol[pCol->iColumn].affinity
+               && !(sqlite3IsNumericAffinity(aff)
+                    && sqlite3IsNumericAffinity(pTab->aCol[pCol->iColumn].affinity))
+               ){
+                return 0;
+            }
+            aAff[i] = aff;
+            
+            for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+                if( pIdx->aiColumn[0]==pCol->iColumn ) return 0;
+            }
+            batchAggColumn(aiCol, &nCol, pCol->iColumn);
+        }
+        
+        /* Check the aggregate functions */
+        for(i=0; i<pAggInfo->nFunc; i++){
+            struct AggInfo_func *pF = &pAggInfo->aFunc[i];
+            ExprList *pList = pF->pExpr->x.pList;
+            int eKind;
+            Expr *pArg;
+            
+            if( pF->iDistinct>=0 || (pF->pExpr->flags & EP_Distinct) ) return 0;
+            eKind = sqlite3AggScanKind(pF->pFunc);
+            if( eKind==0 ) return 0;
+            if( pList==0 || pList->nExpr==0 ){
+                assert( eKind==AGGSCAN_COUNT );
+                continue;
+            }
+            if( pList->nExpr!=1 ) return 0;
+            pArg = pList->a[0].pExpr;
+            if( pArg->op!=TK_AGG_COLUMN || pArg->iTable!=iCur ) return 0;
+            if( pArg->iColumn>=0 && pTab->aCol[pArg->iColumn].pDflt ) return 0;
+            if( eKind==AGGSCAN_MIN || eKind==AGGSCAN_MAX ){
+                if( !batchAggIsBinary(sqlite3ExprCollSeq(pParse, pArg)) ) return 0;
+                
+                /* Leave "SELECT min(x) FROM ..." to the min/max optimization if
+                 ** there is an index it could use. */
+                if( pAggInfo->nFunc==1 && p->pHaving==0 ){
+                    if( pArg->iColumn<0 ) return 0;
+                    for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+                        if( pIdx->aiColumn[0]==pArg->iColumn ) return 0;
+                    }
+                }
+            }
+            batchAggColumn(aiCol, &nCol, pArg->iColumn);
+        }
+        
+        /* Build the AggScan object */
+        nByte = sizeof(AggScan) + nCol*sizeof(struct AggScanCol)
+              + nTerm*sizeof(struct AggScanTerm)
+              + pAggInfo->nFunc*sizeof(struct AggScanAgg);
+        pScan = (AggScan*)sqlite3DbMallocZero(db, nByte);
+        if( pScan==0 ) return 0;
+        pScan->nCol = nCol;
+        pScan->nTerm = nTerm;
+        pScan->nAgg = pAggInfo->nFunc;
+        pScan->iRoot = pTab->tnum;
+        pScan->aCol = (struct AggScanCol*)&pScan[1];
+        pScan->aTerm = (struct AggScanTerm*)&pScan->aCol[nCol];
+        pScan->aAgg = (struct AggScanAgg*)&pScan->aTerm[nTerm];
+        for(i=0; i<nCol; i++){
+            pScan->aCol[i].iColumn = aiCol[i];
+            pScan->aCol[i].bReal = (u8)(aiCol[i]>=0
+                                        && pTab->aCol[aiCol[i]].affinity==SQLITE_AFF_REAL);
+        }
+        
+        iDb = sqlite3SchemaToIndex(db, pTab->pSchema);
+        sqlite3CodeVerifySchema(pParse, iDb);
+        sqlite3TableLock(pParse, iDb, pTab->tnum, 0, pTab->zName);
+        
+        /* Evaluate the right-hand side of each comparison into a register */
+        for(i=0; i<nTerm; i++){
+            Expr *pTerm = apTerm[i];
+            struct AggScanTerm *pST = &pScan->aTerm[i];
+            Expr *pCol = pTerm->pLeft;
+            Expr *pVal = pTerm->pRight;
+            int op = pTerm->op;
+            if( pCol->op!=TK_COLUMN ){
+                pCol = pTerm->pRight;
+                pVal = pTerm->pLeft;
+                switch( op ){
+                    case TK_LT:  op = TK_GT;  break;
+                    case TK_LE:  op = TK_GE;  break;
+                    case TK_GT:  op = TK_LT;  break;
+                    case TK_GE:  op = TK_LE;  break;
+                }
+            }
+            assert( OP_Eq==TK_EQ && OP_Ne==TK_NE && OP_Lt==TK_LT );
+            assert( OP_Le==TK_LE && OP_Gt==TK_GT && OP_Ge==TK_GE );
+            pST->op = (u8)op;
+            pST->iCol = batchAggColumn(aiCol, &nCol, pCol->iColumn);
+            pST->iReg = ++pParse->nMem;
+            sqlite3ExprCode(pParse, pVal, pST->iReg);
+            if( aAff[i]!=SQLITE_AFF_NONE ){
+                sqlite3VdbeAddOp4(v, OP_Affinity, pST->iReg, 1, 0, &aAff[i], 1);
+            }
+        }
+        for(i=0; i<pAggInfo->nFunc; i++){
+            struct AggInfo_func *pF = &pAggInfo->aFunc[i];
+            ExprList *pList = pF->pExpr->x.pList;
+            struct AggScanAgg *pSA = &pScan->aAgg[i];
+            pSA->eKind = (u8)sqlite3AggScanKind(pF->pFunc);
+            pSA->iMem = pF->iMem;
+            if( pList && pList->nExpr==1 ){
+                pSA->iCol = batchAggColumn(aiCol, &nCol, pList->a[0].pExpr->iColumn);
+            }else{
+                pSA->iCol = -1;
+            }
+        }
+        assert( nCol==pScan->nCol );
+        
+        sqlite3OpenTable(pParse, iCur, iDb, pTab, OP_OpenRead);
+        sqlite3VdbeAddOp4(v, OP_AggScan, iCur, 0, 0, (char*)pScan, P4_AGGSCAN);
+        sqlite3VdbeAddOp1(v, OP_Close, iCur);
+        explainBatchAggregate(pParse, pTab);
+        return 1;
+    }
+#endif /* SQLITE_OMIT_BATCH_AGGREGATE */
+    
+#if !defined(SQLITE_OMIT_EXPLAIN) && !defined(SQLITE_OMIT_HASH_JOIN)
+    /*
+     ** Add a single OP_Explain instruction to the VDBE to explain the build
+     ** phase of a join coded by hashJoin().
+     */
+    static void explainHashJoin(Parse *pParse, Table *pTab){
+        if( pParse->explain==2 ){
+            char *zEqp = sqlite3MPrintf(pParse->db, "SCAN TABLE %s (HASH JOIN BUILD)",
+                                        pTab->zName);
+            sqlite3VdbeAddOp4(
+                              pParse->pVdbe, OP_Explain, pParse->iSelectId, 0, 0, zEqp, P4_DYNAMIC
+                              );
+        }
+    }
+#else
+# define explainHashJoin(a,b)
+#endif
+    
+#ifndef SQLITE_OMIT_HASH_JOIN
+    /*
+     ** Maximum number of WHERE clause terms in a query coded by hashJoin().
+     */
+#define HASHJOIN_MAX_TERM 16
+    
+    /*
+     ** Split expression pExpr, which is part of a WHERE clause, into the
+     ** operands of its top-level AND operators and append them to apTerm[].
+     ** Return zero if there are more than HASHJOIN_MAX_TERM operands.
+     */
+    static int hashJoinSplit(Expr *pExpr, Expr **apTerm, int *pnTerm){
+        if( pExpr->op==TK_AND ){
+            return hashJoinSplit(pExpr->pLeft, apTerm, pnTerm)
+                && hashJoinSplit(pExpr->pRight, apTerm, pnTerm);
+        }
+        if( *pnTerm>=HASHJOIN_MAX_TERM ) return 0;
+        apTerm[(*pnTerm)++] = pExpr;
+        return 1;
+    }
+    
+    /*
+     ** Return a mask of the tables that expression p refers to: 0x01 if it
+     ** refers to a column of cursor iCurA, and 0x02 if it refers to a column
+     ** of cursor iCurB.  A sub-select is assumed to refer to both.
+     */
+    static int hashJoinRefs(Expr *p, int iCurA, int iCurB){
+        int m;
+        if( p==0 ) return 0;
+        if( p->op==TK_COLUMN ){
+            if( p->iTable==iCurA ) return 0x01;
+            if( p->iTable==iCurB ) return 0x02;
+            return 0;
+        }
+        if( ExprHasProperty(p, EP_TokenOnly) ) return 0;
+        m = hashJoinRefs(p->pLeft, iCurA, iCurB) | hashJoinRefs(p->pRight, iCurA, iCurB);
+        if( ExprHasProperty(p, EP_xIsSelect) ){
+            m |= 0x03;
+        }else if( p->x.pList ){
+            int i;
+            for(i=0; i<p->x.pList->nExpr; i++){
+                m |= hashJoinRefs(p->x.pList->a[i].pExpr, iCurA, iCurB);
+            }
+        }
+        return m;
+    }
+    
+    /*
+     ** Return true if pCol, a TK_COLUMN expression that refers to table pTab,
+     ** may be used as a hash join key.  It may not be if an index or the
+     ** INTEGER PRIMARY KEY could be used to look up rows by its value, as
+     ** then a nested loop join seeking that index is as good or better.
+     */
+    static int hashJoinKeyOk(Table *pTab, Expr *pCol){
+        Index *pIdx;
+        if( pCol->iColumn<0 || pCol->iColumn==pTab->iPKey ) return 0;
+        for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+            if( pIdx->aiColumn[0]==pCol->iColumn ) return 0;
+        }
+        return 1;
+    }
+    
+    /*
+     ** The select statement passed as the second argument is a query without
+     ** aggregates or a GROUP BY clause.  This function tests whether it is an
+     ** inner join of two tables of the form:
+     **
+     **   SELECT ... FROM <a>, <b> WHERE <a>.<x> = <b>.<y> AND ...
+     **
+     ** where <a> and <b> are real tables, not views, sub-selects or virtual
+     ** tables, each equality uses the BINARY collating sequence, and there
+     ** is no index on either table that where.c could use to evaluate an
+     ** equality by seeking one table for each row of the other.  Without such
+     ** an index, the join would otherwise be coded as a nested loop that scans
+     ** the inner table once for each row of the outer one, or that builds an
+     ** automatic index on it.
+     **
+     ** If so, code the join as a hash join and return non-zero:
+     **
+     **    1. The smaller of the two tables (the "build" table) is scanned and
+     **       the key values and rowid of each row that satisfies the WHERE
+     **       clause terms that refer to it alone are added to a hash table.
+     **
+     **    2. A where.c loop scans the other (the "probe") table, using the
+     **       WHERE clause terms that refer to it alone.  For each row, the
+     **       hash table is searched for build table rowids with matching keys.
+     **       The build table is positioned on each such rowid, the remaining
+     **       WHERE clause terms are tested and, if they are true, the result
+     **       row is output.
+     **
+     ** The hash table is held in memory unless it grows larger than the page
+     ** cache, in which case it is moved to a temporary b-tree.  See vdbehash.c.
+     **
+     ** Rows are never claimed to be in ORDER BY or DISTINCT order, so the
+     ** caller's sorter and DISTINCT table are used as for any other query.
+     ** If the query does not qualify, return zero without generating any code.
+     */
+    static int hashJoin(
+                        Parse *pParse,          /* The parser context */
+                        Select *p,              /* The SELECT statement being coded */
+                        Expr *pWhere,           /* The WHERE clause of p */
+                        ExprList *pOrderBy,     /* If not NULL, sort results using this key */
+                        DistinctCtx *pDistinct, /* Info on how to process DISTINCT */
+                        SelectDest *pDest       /* How to dispose of the results */
+    ){
+        sqlite3 *db = pParse->db;
+        Vdbe *v = pParse->pVdbe;
+        SrcList *pTabList = p->pSrc;
+        Expr *apTerm[HASHJOIN_MAX_TERM];         /* Terms of the WHERE clause */
+        u8 aRefs[HASHJOIN_MAX_TERM];             /* hashJoinRefs() of each term */
+        Expr *apKeyA[HASHJOIN_MAX_TERM];         /* Probe table key expressions */
+        Expr *apKeyB[HASHJOIN_MAX_TERM];         /* Build table key expressions */
+        char zAff[HASHJOIN_MAX_TERM+1];          /* Affinity of each key */
+        int nTerm = 0;
+        int nKey = 0;
+        int iA, iB;                              /* Probe and build in pTabList->a[] */
+        Table *pTabA, *pTabB;
+        int iCurA, iCurB;
+        int iHash;                               /* Cursor for the hash table */
+        int regKey;                              /* First register of the key */
+        int iDb;
+        int i;
+        int addrTop;
+        int addrMatch;
+        int lblBuildNext, lblBuildEnd, lblNext;
+        Expr *pWhereA = 0;                       /* WHERE clause for the probe loop */
+        SrcList sA;                              /* FROM clause for the probe loop */
+        WhereInfo *pWInfo;
+        
+        if( pTabList->nSrc!=2 || pWhere==0 ) return 0;
+        for(i=0; i<2; i++){
+            struct SrcList_item *pItem = &pTabList->a[i];
+            if( pItem->pSelect || pItem->zIndex ) return 0;
+            if( pItem->pTab==0 || IsVirtual(pItem->pTab) ) return 0;
+            if( pItem->jointype & (JT_LEFT|JT_RIGHT|JT_OUTER) ) return 0;
+        }
+        
+        /* Choose the build table.  A CROSS JOIN fixes the order of the tables
+         ** in the loop, so the right-hand table is the one that is looked up. */
+        if( (pTabList->a[1].jointype & JT_CROSS)!=0
+         || pTabList->a[1].pTab->nRowEst<=pTabList->a[0].pTab->nRowEst
+        ){
+            iA = 0;
+            iB = 1;
+        }else{
+            iA = 1;
+            iB = 0;
+        }
+        pTabA = pTabList->a[iA].pTab;
+        pTabB = pTabList->a[iB].pTab;
+        iCurA = pTabList->a[iA].iCursor;
+        iCurB = pTabList->a[iB].iCursor;
+        
+        /* Find the key equalities and classify the other WHERE clause terms */
+        if( !hashJoinSplit(pWhere, apTerm, &nTerm) ) return 0;
+        for(i=0; i<nTerm; i++){
+            Expr *pTerm = apTerm[i];
+            aRefs[i] = (u8)hashJoinRefs(pTerm, iCurA, iCurB);
+            if( pTerm->op==TK_EQ
+             && pTerm->pLeft->op==TK_COLUMN && pTerm->pRight->op==TK_COLUMN
+             && aRefs[i]==0x03
+            ){
+                Expr *pA = pTerm->pLeft;
+                Expr *pB = pTerm->pRight;
+                CollSeq *pColl;
+                if( pA->iTable!=iCurA ){
+                    pA = pTerm->pRight;
+                    pB = pTerm->pLeft;
+                }
+                assert( pA->iTable==iCurA && pB->iTable==iCurB );
+                if( !hashJoinKeyOk(pTabA, pA) || !hashJoinKeyOk(pTabB, pB) ) return 0;
+                pColl = sqlite3BinaryCompareCollSeq(pParse, pTerm->pLeft, pTerm->pRight);
+                if( pColl && sqlite3StrICmp(pColl->zName, "BINARY")!=0 ) continue;
+                apKeyA[nKey] = pA;
+                apKeyB[nKey] = pB;
+                zAff[nKey] = sqlite3CompareAffinity(pA, sqlite3ExprAffinity(pB));
+                nKey++;
+            }
+        }
+        if( nKey==0 ) return 0;
+        zAff[nKey] = 0;
+        
+        iDb = sqlite3SchemaToIndex(db, pTabB->pSchema);
+        sqlite3CodeVerifySchema(pParse, iDb);
+        sqlite3TableLock(pParse, iDb, pTabB->tnum, 0, pTabB->zName);
+        iHash = pParse->nTab++;
+        regKey = pParse->nMem+1;
+        pParse->nMem += nKey+1;
+        
+        /* Build phase: add each qualifying row of the build table to the
+         ** hash table. */
+        sqlite3VdbeAddOp2(v, OP_HashOpen, iHash, nKey);
+        sqlite3OpenTable(pParse, iCurB, iDb, pTabB, OP_OpenRead);
+        explainHashJoin(pParse, pTabB);
+        lblBuildNext = sqlite3VdbeMakeLabel(v);
+        lblBuildEnd = sqlite3VdbeMakeLabel(v);
+        addrTop = sqlite3VdbeAddOp2(v, OP_Rewind, iCurB, lblBuildEnd);
+        sqlite3ExprCachePush(pParse);
+        for(i=0; i<nTerm; i++){
+            if( aRefs[i]==0x02 ){
+                sqlite3ExprIfFalse(pParse, apTerm[i], lblBuildNext, SQLITE_JUMPIFNULL);
+            }
+        }
+        for(i=0; i<nKey; i++){
+            sqlite3ExprCode(pParse, apKeyB[i], regKey+i);
+        }
+        sqlite3VdbeAddOp4(v, OP_Affinity, regKey, nKey, 0, zAff, nKey);
+        sqlite3ExprCacheAffinityChange(pParse, regKey, nKey);
+        sqlite3VdbeAddOp2(v, OP_Rowid, iCurB, regKey+nKey);
+        sqlite3VdbeAddOp2(v, OP_HashInsert, iHash, regKey);
+        sqlite3ExprCachePop(pParse, 1);
+        sqlite3VdbeResolveLabel(v, lblBuildNext);
+        sqlite3VdbeAddOp2(v, OP_Next, iCurB, addrTop+1);
+        sqlite3VdbeChangeP5(v, SQLITE_STMTSTATUS_FULLSCAN_STEP);
+        sqlite3VdbeResolveLabel(v, lblBuildEnd);
+        
+        /* Probe phase: loop through the probe table using where.c, with the
+         ** WHERE clause terms that do not refer to the build table. */
+        for(i=0; i<nTerm; i++){
+            if( aRefs[i]==0x01 || aRefs[i]==0 ){
+                Expr *pDup = sqlite3ExprDup(db, apTerm[i], 0);
+                if( pDup ) pDup->flags &= ~EP_FromJoin;
+                pWhereA = sqlite3ExprAnd(db, pWhereA, pDup);
+            }
+        }
+        memset(&sA, 0, sizeof(sA));
+        sA.nSrc = sA.nAlloc = 1;
+        sA.a[0] = pTabList->a[iA];
+        sA.a[0].jointype = 0;
+        pWInfo = sqlite3WhereBegin(pParse, &sA, pWhereA, 0, 0, 0, 0);
+        if( pWInfo==0 ){
+            sqlite3ExprDelete(db, pWhereA);
+            return 1;
+        }
+        if( sqlite3WhereOutputRowCount(pWInfo) < p->nSelectRow ){
+            p->nSelectRow = sqlite3WhereOutputRowCount(pWInfo);
+        }
+        for(i=0; i<nKey; i++){
+            sqlite3ExprCode(pParse, apKeyA[i], regKey+i);
+        }
+        sqlite3VdbeAddOp4(v, OP_Affinity, regKey, nKey, 0, zAff, nKey);
+        sqlite3ExprCacheAffinityChange(pParse, regKey, nKey);
+        sqlite3VdbeAddOp3(v, OP_HashProbe, iHash, sqlite3WhereContinueLabel(pWInfo),
+                          regKey);
+        
+        /* For each candidate rowid, seek the build table and test the terms
+         ** that refer to both tables, including the key equalities, before
+         ** running the inner loop. */
+        lblNext = sqlite3VdbeMakeLabel(v);
+        addrMatch = sqlite3VdbeAddOp3(v, OP_NotExists, iCurB, lblNext, regKey+nKey);
+        sqlite3ExprCachePush(pParse);
+        for(i=0; i<nTerm; i++){
+            if( aRefs[i]==0x03 ){
+                sqlite3ExprIfFalse(pParse, apTerm[i], lblNext, SQLITE_JUMPIFNULL);
+            }
+        }
+        selectInnerLoop(pParse, p, p->pEList, 0, 0, pOrderBy, pDistinct, pDest,
+                        lblNext, sqlite3WhereBreakLabel(pWInfo));
+        sqlite3ExprCachePop(pParse, 1);
+        sqlite3VdbeResolveLabel(v, lblNext);
+        sqlite3VdbeAddOp3(v, OP_HashNext, iHash, addrMatch, regKey);
+        sqlite3WhereEnd(pWInfo);
+        sqlite3ExprDelete(db, pWhereA);
+        
+        sqlite3VdbeAddOp1(v, OP_Close, iCurB);
+        sqlite3VdbeAddOp1(v, OP_Close, iHash);
+        return 1;
+    }
+#endif /* SQLITE_OMIT_HASH_JOIN */
+    
+#if !defined(SQLITE_OMIT_EXPLAIN) && !defined(SQLITE_OMIT_HASH_AGGREGATE)
+    /*
+     ** Add a single OP_Explain instruction to the VDBE to explain a GROUP BY
+     ** coded using hash aggregation.
+     */
+    static void explainHashAggregate(Parse *pParse){
+        if( pParse->explain==2 ){
+            sqlite3VdbeAddOp4(pParse->pVdbe, OP_Explain, pParse->iSelectId, 0, 0,
+                              "USE HASH TABLE FOR GROUP BY", P4_STATIC);
+        }
+    }
+#else
+# define explainHashAggregate(a)
+#endif
+    
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+    /*
+     ** The select statement passed as the second argument is an aggregate
+     ** query with a GROUP BY clause, and pOrderBy is its ORDER BY clause, or
+     ** NULL if there is none or it has been dropped because it is the same as
+     ** the GROUP BY.  The nAcc registers starting at iAcc are the accumulators
+     ** allocated for pAggInfo.
+     **
+     ** Return true if the GROUP BY may be coded using hash aggregation, which
+     ** keeps the accumulators for each group in a hash table keyed by the
+     ** GROUP BY values instead of sorting the input rows.  This requires:
+     **
+     **    * that the output not be required in GROUP BY order, as groups that
+     **      do not fit in memory are output after the others,
+     **    * that the GROUP BY values use the BINARY collating sequence, and
+     **    * that no aggregate use DISTINCT, as the ephemeral table for that is
+     **      shared by all groups.
+     */
+    static int hashAggregateOk(
+                               Parse *pParse,          /* The parser context */
+                               Select *p,              /* The SELECT statement */
+                               ExprList *pOrderBy,     /* ORDER BY still to be coded */
+                               AggInfo *pAggInfo,      /* Aggregate information for p */
+                               int iAcc,               /* First accumulator register */
+                               int nAcc                /* Number of accumulator registers */
+    ){
+        ExprList *pGroupBy = pAggInfo->pGroupBy;
+        int i;
+        
+        if( p->pOrderBy && pOrderBy==0 ) return 0;
+        if( nAcc<=0 ) return 0;
+        for(i=0; i<pGroupBy->nExpr; i++){
+            CollSeq *pColl = sqlite3ExprCollSeq(pParse, pGroupBy->a[i].pExpr);
+            if( pColl && sqlite3StrICmp(pColl->zName, "BINARY")!=0 ) return 0;
+        }
+        for(i=0; i<pAggInfo->nFunc; i++){
+            struct AggInfo_func *pF = &pAggInfo->aFunc[i];
+            if( pF->iDistinct>=0 ) return 0;
+            if( pF->iMem<iAcc || pF->iMem>=iAcc+nAcc ) return 0;
+        }
+        for(i=0; i<pAggInfo->nColumn; i++){
+            int iMem = pAggInfo->aCol[i].iMem;
+            if( iMem<iAcc || iMem>=iAcc+nAcc ) return 0;
+        }
+        return 1;
+    }
+#endif /* SQLITE_OMIT_HASH_AGGREGATE */
+    
     /*
      ** Generate code for the SELECT statement given in the p argument.
      **
@@ -4293,6 +4903,14 @@ static const char *columnTypeImpl(
             sDistinct.eTnctType = WHERE_DISTINCT_NOOP;
         }
         
+#ifndef SQLITE_OMIT_HASH_JOIN
+        if( !isAgg && pGroupBy==0
+         && hashJoin(pParse, p, pWhere, pOrderBy, &sDistinct, pDest)
+        ){
+            /* A two-table join coded by hashJoin() */
+            if( pParse->nErr || db->mallocFailed ) goto select_end;
+        }else
+#endif
         if( !isAgg && pGroupBy==0 ){
             /* No aggregate functions and no GROUP BY clause */
             u16 wctrlFlags = (sDistinct.isTnct ? WHERE_WANT_DISTINCT : 0);
@@ -4340,6 +4958,10 @@ static const char *columnTypeImpl(
             int addrEnd;        /* End of processing for this SELECT */
             int sortPTab = 0;   /* Pseudotable used to decode sorting results */
             int sortOut = 0;    /* Output register from the sorter */
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+            int iAcc;           /* First accumulator register */
+            int nAcc;           /* Number of accumulator registers */
+#endif
             
             /* Remove any and all aliases between the result set and the
              ** GROUP BY clause.
@@ -4373,6 +4995,9 @@ static const char *columnTypeImpl(
             sNC.pAggInfo = &sAggInfo;
             sAggInfo.nSortingColumn = pGroupBy ? pGroupBy->nExpr+1 : 0;
             sAggInfo.pGroupBy = pGroupBy;
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+            iAcc = pParse->nMem+1;
+#endif
             sqlite3ExprAnalyzeAggList(&sNC, pEList);
             sqlite3ExprAnalyzeAggList(&sNC, pOrderBy);
             if( pHaving ){
@@ -4385,6 +5010,9 @@ static const char *columnTypeImpl(
                 sqlite3ExprAnalyzeAggList(&sNC, sAggInfo.aFunc[i].pExpr->x.pList);
                 sNC.ncFlags &= ~NC_InAggFunc;
             }
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+            nAcc = pParse->nMem+1-iAcc;
+#endif
             if( db->mallocFailed ) goto select_end;
             
             /* Processing for aggregates with GROUP BY is very different and
@@ -4400,6 +5028,8 @@ static const char *columnTypeImpl(
                 int addrSortingIdx; /* The OP_OpenEphemeral for the sorting index */
                 int addrReset;      /* Subroutine for resetting the accumulator */
                 int regReset;       /* Return address register for reset subroutine */
+                int iHash = -1;     /* Hash aggregation table, or -1 if not used */
+                int addrHashOpen = -1;  /* The OP_HashOpen for the hash table */
                 
                 /* If there is a GROUP BY clause we might need a sorting index to
                  ** implement it.  Allocate that sorting index now.  If it turns out
@@ -4430,6 +5060,16 @@ static const char *columnTypeImpl(
                 VdbeComment((v, "indicate accumulator empty"));
                 sqlite3VdbeAddOp3(v, OP_Null, 0, iAMem, iAMem+pGroupBy->nExpr-1);
                 
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+                /* If hash aggregation may be used, open the hash table.  It is
+                 ** cancelled below if the rows are delivered in GROUP BY order. */
+                if( hashAggregateOk(pParse, p, pOrderBy, &sAggInfo, iAcc, nAcc) ){
+                    iHash = pParse->nTab++;
+                    addrHashOpen = sqlite3VdbeAddOp3(v, OP_HashOpen, iHash,
+                                                     pGroupBy->nExpr, nAcc);
+                }
+#endif
+                
                 /* Begin a loop that will extract all source rows in GROUP BY order.
                  ** This might involve two separate loops with an OP_Sort in between, or
                  ** it might be a single loop that uses an index to extract information
@@ -4445,6 +5085,10 @@ static const char *columnTypeImpl(
                      ** cancelled later because we still need to use the pKeyInfo
                      */
                     groupBySort = 0;
+                    if( addrHashOpen>=0 ){
+                        sqlite3VdbeChangeToNoop(v, addrHashOpen);
+                        iHash = -1;
+                    }
                 }else{
                     /* Rows are coming out in undetermined order.  We have to push
                      ** each row into a sorting index, terminate the first loop,
@@ -4455,10 +5099,15 @@ static const char *columnTypeImpl(
                     int regRecord;
                     int nCol;
                     int nGroupBy;
+                    int addrHashDone = 0;
                     
-                    explainTempTable(pParse, 
-                                     (sDistinct.isTnct && (p->selFlags&SF_Distinct)==0) ?
-                                     "DISTINCT" : "GROUP BY");
+                    if( iHash>=0 ){
+                        explainHashAggregate(pParse);
+                    }else{
+                        explainTempTable(pParse, 
+                                         (sDistinct.isTnct && (p->selFlags&SF_Distinct)==0) ?
+                                         "DISTINCT" : "GROUP BY");
+                    }
                     
                     groupBySort = 1;
                     nGroupBy = pGroupBy->nExpr;
@@ -4470,6 +5119,23 @@ static const char *columnTypeImpl(
                             j++;
                         }
                     }
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+                    if( iHash>=0 ){
+                        /* Load the accumulators of the row's group and update
+                         ** them.  If the group is new and the hash table is full,
+                         ** fall through to pass the row to the sorter instead. */
+                        int regKey = sqlite3GetTempRange(pParse, nGroupBy);
+                        int addrHashGroup;
+                        sqlite3ExprCacheClear(pParse);
+                        sqlite3ExprCodeExprList(pParse, pGroupBy, regKey, 0);
+                        addrHashGroup = sqlite3VdbeAddOp4Int(v, OP_HashGroup, iHash, 0,
+                                                             regKey, iAcc);
+                        sqlite3ReleaseTempRange(pParse, regKey, nGroupBy);
+                        updateAccumulator(pParse, &sAggInfo);
+                        addrHashDone = sqlite3VdbeAddOp0(v, OP_Goto);
+                        sqlite3VdbeJumpHere(v, addrHashGroup);
+                    }
+#endif
                     regBase = sqlite3GetTempRange(pParse, nCol);
                     sqlite3ExprCacheClear(pParse);
                     sqlite3ExprCodeExprList(pParse, pGroupBy, regBase, 0);
@@ -4494,7 +5160,29 @@ static const char *columnTypeImpl(
                     sqlite3VdbeAddOp2(v, OP_SorterInsert, sAggInfo.sortingIdx, regRecord);
                     sqlite3ReleaseTempReg(pParse, regRecord);
                     sqlite3ReleaseTempRange(pParse, regBase, nCol);
+                    if( addrHashDone ){
+                        sqlite3VdbeJumpHere(v, addrHashDone);
+                        sqlite3ExprCacheClear(pParse);
+                    }
                     sqlite3WhereEnd(pWInfo);
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+                    if( iHash>=0 ){
+                        /* Output the groups in the hash table, in GROUP BY order.
+                         ** Then reset the accumulators and go on to aggregate the
+                         ** rows passed to the sorter, if there are any. */
+                        int addrHashSort;
+                        addrHashSort = sqlite3VdbeAddOp3(v, OP_HashSort, iHash, 0, iAcc);
+                        sqlite3VdbeAddOp2(v, OP_Integer, 1, iUseFlag);
+                        sqlite3VdbeAddOp2(v, OP_Gosub, regOutputRow, addrOutputRow);
+                        VdbeComment((v, "output one hashed group"));
+                        sqlite3VdbeAddOp2(v, OP_IfPos, iAbortFlag, addrEnd);
+                        sqlite3VdbeAddOp3(v, OP_HashGroupNext, iHash, addrHashSort+1, iAcc);
+                        sqlite3VdbeJumpHere(v, addrHashSort);
+                        sqlite3VdbeAddOp1(v, OP_Close, iHash);
+                        sqlite3VdbeAddOp2(v, OP_Integer, 0, iUseFlag);
+                        sqlite3VdbeAddOp2(v, OP_Gosub, regReset, addrReset);
+                    }
+#endif
                     sAggInfo.sortingIdxPTab = sortPTab = pParse->nTab++;
                     sortOut = sqlite3GetTempReg(pParse);
                     sqlite3VdbeAddOp3(v, OP_OpenPseudo, sortPTab, sortOut, nCol);
@@ -4663,6 +5351,12 @@ static const char *columnTypeImpl(
                     explainSimpleCount(pParse, pTab, pBest);
                 }else
 #endif /* SQLITE_OMIT_BTREECOUNT */
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+                if( batchAggregate(pParse, p, &sAggInfo) ){
+                    /* The OP_AggScan coded by batchAggregate() has stored the
+                     ** final value of each aggregate function. */
+                }else
+#endif /* SQLITE_OMIT_BATCH_AGGREGATE */
                 {
                     /* Check if the query is of one of the following forms:
                      **
@@ -184,6 +184,9 @@ SQLITE_API int sqlite3_db_status(
                     nByte += sqlite3MallocSize(pSchema->trigHash.ht);
                     nByte += sqlite3MallocSize(pSchema->idxHash.ht);
                     nByte += sqlite3MallocSize(pSchema->fkeyHash.ht);
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+                    nByte += sqlite3LazySchemaSize(pSchema);
+#endif
                     
                     for(p=sqliteHashFirst(&pSchema->trigHash); p; p=sqliteHashNext(p)){
                         sqlite3DeleteTrigger(db, (Trigger*)sqliteHashData(p));
@@ -247,6 +250,26 @@ SQLITE_API int sqlite3_db_status(
             break;
         }
             
+            /*
+             ** Set *pCurrent to the total number of b-tree page defragmentations
+             ** of the requested kind on all databases the handle is connected to.
+             ** *pHighwater is always set to zero.
+             */
+        case SQLITE_DBSTATUS_DEFRAG_FULL:
+        case SQLITE_DBSTATUS_DEFRAG_INPLACE: {
+            int i;
+            int nRet = 0;
+            
+            for(i=0; i<db->nDb; i++){
+                if( db->aDb[i].pBt ){
+                    sqlite3BtreeDefragStat(db->aDb[i].pBt, op, resetFlag, &nRet);
+                }
+            }
+            *pHighwater = 0;
+            *pCurrent = nRet;
+            break;
+        }
+            
             /* Set *pCurrent to non-zero if there are unresolved deferred foreign
              ** key constraints.  Set *pCurrent to zero if all foreign key constraints
              ** have been satisfied.  The *pHighwater is always set to zero.
@@ -257,6 +280,18 @@ SQLITE_API int sqlite3_db_status(
             break;
         }
             
+#ifndef SQLITE_OMIT_STMT_CACHE
+            /*
+             ** Statement cache statistics.  See sqlite3_stmt_cache().
+             */
+        case SQLITE_DBSTATUS_STMTCACHE_HIT:
+        case SQLITE_DBSTATUS_STMTCACHE_MISS:
+        case SQLITE_DBSTATUS_STMTCACHE_USED: {
+            sqlite3VdbeCacheStatus(db, op, resetFlag, pCurrent, pHighwater);
+            break;
+        }
+#endif
+            
         default: {
             rc = SQLITE_ERROR;
         }
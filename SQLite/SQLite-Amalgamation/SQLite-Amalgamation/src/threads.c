@@ -0,0 +1,118 @@
+/************** Begin file threads.c *****************************************/
+/*
+ ** 2013 November 4
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file contains a minimal interface for running a task on a new
+ ** thread and waiting for it to finish.  It is used by the parallel table
+ ** scan and the parallel integrity check in vdbeagg.c.
+ **
+ ** If SQLite is not threadsafe, if it is configured single-threaded, or
+ ** if a thread cannot be started, sqlite3ThreadCreate() runs the task to
+ ** completion before it returns.  So callers work the same either way,
+ ** only more slowly.
+ */
+
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+
+#if defined(SQLITE_MUTEX_PTHREADS)
+#include <pthread.h>
+#elif defined(SQLITE_MUTEX_W32)
+#include <process.h>
+#endif
+
+/*
+ ** A task started by sqlite3ThreadCreate().
+ */
+struct SQLiteThread {
+#if defined(SQLITE_MUTEX_PTHREADS)
+    pthread_t tid;                  /* Thread running the task */
+#elif defined(SQLITE_MUTEX_W32)
+    HANDLE tid;                     /* Thread running the task */
+#endif
+    int done;                       /* True if the task has already run */
+    void *(*xTask)(void*);          /* The task */
+    void *pIn;                      /* Argument passed to xTask */
+    void *pOut;                     /* Value returned by xTask */
+};
+
+#if defined(SQLITE_MUTEX_W32)
+/*
+ ** Thread entry point used on Win32.
+ */
+static unsigned __stdcall sqlite3ThreadProc(void *pArg){
+    SQLiteThread *p = (SQLiteThread*)pArg;
+    p->pOut = p->xTask(p->pIn);
+    return 0;
+}
+#endif
+
+/*
+ ** Run xTask(pIn), on a new thread if possible, and write a handle for it
+ ** to *ppThread.  The handle must be passed to sqlite3ThreadJoin().
+ */
+SQLITE_PRIVATE int sqlite3ThreadCreate(
+    SQLiteThread **ppThread,        /* OUT: Handle for the task */
+    void *(*xTask)(void*),          /* Function to run */
+    void *pIn                       /* Argument passed to xTask */
+){
+    SQLiteThread *p;
+    int rc = 1;
+    
+    *ppThread = 0;
+    p = (SQLiteThread*)sqlite3MallocZero(sizeof(*p));
+    if( p==0 ) return SQLITE_NOMEM;
+    p->xTask = xTask;
+    p->pIn = pIn;
+    if( sqlite3GlobalConfig.bCoreMutex ){
+#if defined(SQLITE_MUTEX_PTHREADS)
+        rc = pthread_create(&p->tid, 0, xTask, pIn);
+#elif defined(SQLITE_MUTEX_W32)
+        unsigned id;
+        p->tid = (HANDLE)_beginthreadex(0, 0, sqlite3ThreadProc, p, 0, &id);
+        rc = (p->tid==0);
+#endif
+    }
+    if( rc ){
+        p->done = 1;
+        p->pOut = xTask(pIn);
+    }
+    *ppThread = p;
+    return SQLITE_OK;
+}
+
+/*
+ ** Wait for the task started by sqlite3ThreadCreate() to finish, write the
+ ** value it returned to *ppOut and free the handle.
+ */
+SQLITE_PRIVATE int sqlite3ThreadJoin(SQLiteThread *p, void **ppOut){
+    int rc = SQLITE_OK;
+    
+    assert( p!=0 );
+    if( p->done ){
+        *ppOut = p->pOut;
+    }else{
+#if defined(SQLITE_MUTEX_PTHREADS)
+        rc = pthread_join(p->tid, ppOut) ? SQLITE_ERROR : SQLITE_OK;
+#elif defined(SQLITE_MUTEX_W32)
+        rc = WaitForSingleObject(p->tid, INFINITE)==WAIT_OBJECT_0
+             ? SQLITE_OK : SQLITE_ERROR;
+        CloseHandle(p->tid);
+        *ppOut = p->pOut;
+#endif
+    }
+    sqlite3_free(p);
+    return rc;
+}
+
+#endif /* SQLITE_OMIT_PARALLEL_SCAN */
+
+/************** End of threads.c *********************************************/
@@ -213,11 +213,13 @@ static VdbeCursor *allocateCursor(
     Mem *pMem = &p->aMem[p->nMem-iCur];
     
     int nByte;
+    int nHdrCache;        /* Bytes for aType[nField] and aOffset[nField+1] */
     VdbeCursor *pCx = 0;
+    nHdrCache = ROUND8((2*nField+1)*sizeof(u32));
     nByte =
     ROUND8(sizeof(VdbeCursor)) +
     (isBtreeCursor?sqlite3BtreeCursorSize():0) +
-    2*nField*sizeof(u32);
+    nHdrCache;
     
     assert( iCur<p->nCursor );
     if( p->apCsr[iCur] ){
@@ -234,7 +236,7 @@ static VdbeCursor *allocateCursor(
         }
         if( isBtreeCursor ){
             pCx->pCursor = (BtCursor*)
-            &pMem->z[ROUND8(sizeof(VdbeCursor))+2*nField*sizeof(u32)];
+            &pMem->z[ROUND8(sizeof(VdbeCursor))+nHdrCache];
             sqlite3BtreeCursorZero(pCx->pCursor);
         }
     }
@@ -555,6 +557,42 @@ SQLITE_PRIVATE   sqlite_uint64 sqlite3Hwtime(void){ return ((sqlite_uint64)0); }
 
 #endif
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+# include <intrin.h>
+#elif defined(__APPLE__)
+# include <mach/mach_time.h>
+#else
+# include <time.h>
+#endif
+
+/*
+ ** Return the clock used to measure the cost of each instruction of a
+ ** statement with opcode profiling enabled.  Unlike sqlite3Hwtime(), which
+ ** is only built for VDBE_PROFILE and only exists for some CPUs, this is
+ ** always available.  It reads the CPU cycle counter on x86, and otherwise
+ ** falls back to the finest monotonic timer the platform offers.  If there
+ ** is none, it returns 0 and only execution counts are collected.
+ */
+static u64 vdbeOpClock(void){
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    unsigned int lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (u64)hi << 32 | lo;
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    return (u64)__rdtsc();
+#elif defined(__APPLE__)
+    return (u64)mach_absolute_time();
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if( clock_gettime(CLOCK_MONOTONIC, &ts) ) return 0;
+    return (u64)ts.tv_sec*1000000000 + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+#endif /* SQLITE_OMIT_OPCODE_PROFILE */
+
 /*
  ** The CHECK_FOR_INTERRUPT macro defined here looks to see if the
  ** sqlite3_interrupt() routine has been called.  If it has been, then
@@ -568,6 +606,203 @@ SQLITE_PRIVATE   sqlite_uint64 sqlite3Hwtime(void){ return ((sqlite_uint64)0); }
 #define CHECK_FOR_INTERRUPT \
 if( db->u1.isInterrupted ) goto abort_due_to_interrupt;
 
+#ifdef SQLITE_DEBUG
+/*
+ ** Print instruction pOp, about to be run at address pc, on the trace
+ ** output of p.  Called from VDBE_OP_PROLOGUE when vdbe_trace is on.
+ */
+static void vdbeTraceOp(Vdbe *p, int pc, Op *pOp){
+    if( p->trace ){
+        if( pc==0 ){
+            printf("VDBE Execution Trace:\n");
+            sqlite3VdbePrintSql(p);
+        }
+        sqlite3VdbePrintOp(p->trace, pc, pOp);
+    }
+}
+
+/*
+ ** Sanity checking on the operands of pOp, which is about to be run.
+ */
+static void vdbeCheckOperands(Vdbe *p, Op *pOp){
+    Mem *aMem = p->aMem;
+    if( (pOp->opflags & OPFLG_IN1)!=0 ){
+        assert( pOp->p1>0 );
+        assert( pOp->p1<=(p->nMem-p->nCursor) );
+        assert( memIsValid(&aMem[pOp->p1]) );
+        REGISTER_TRACE(pOp->p1, &aMem[pOp->p1]);
+    }
+    if( (pOp->opflags & OPFLG_IN2)!=0 ){
+        assert( pOp->p2>0 );
+        assert( pOp->p2<=(p->nMem-p->nCursor) );
+        assert( memIsValid(&aMem[pOp->p2]) );
+        REGISTER_TRACE(pOp->p2, &aMem[pOp->p2]);
+    }
+    if( (pOp->opflags & OPFLG_IN3)!=0 ){
+        assert( pOp->p3>0 );
+        assert( pOp->p3<=(p->nMem-p->nCursor) );
+        assert( memIsValid(&aMem[pOp->p3]) );
+        REGISTER_TRACE(pOp->p3, &aMem[pOp->p3]);
+    }
+    if( (pOp->opflags & OPFLG_OUT2)!=0 ){
+        assert( pOp->p2>0 );
+        assert( pOp->p2<=(p->nMem-p->nCursor) );
+        memAboutToChange(p, &aMem[pOp->p2]);
+    }
+    if( (pOp->opflags & OPFLG_OUT3)!=0 ){
+        assert( pOp->p3>0 );
+        assert( pOp->p3<=(p->nMem-p->nCursor) );
+        memAboutToChange(p, &aMem[pOp->p3]);
+    }
+}
+
+/*
+ ** Print the return code and output registers of pOp, which has just
+ ** been run, on the trace output of p.
+ */
+static void vdbeTraceResult(Vdbe *p, int rc, Op *pOp){
+    if( p->trace ){
+        if( rc!=0 ) fprintf(p->trace,"rc=%d\n",rc);
+        if( pOp->opflags & (OPFLG_OUT2_PRERELEASE|OPFLG_OUT2) ){
+            registerTrace(p->trace, pOp->p2, &p->aMem[pOp->p2]);
+        }
+        if( pOp->opflags & OPFLG_OUT3 ){
+            registerTrace(p->trace, pOp->p3, &p->aMem[pOp->p3]);
+        }
+    }
+}
+# define VDBE_TRACE_OP          vdbeTraceOp(p, pc, pOp);
+# define VDBE_CHECK_OPERANDS    vdbeCheckOperands(p, pOp);
+# define VDBE_TRACE_RESULT      vdbeTraceResult(p, rc, pOp);
+#else
+# define VDBE_TRACE_OP
+# define VDBE_CHECK_OPERANDS
+# define VDBE_TRACE_RESULT
+#endif
+
+/*
+ ** Check to see if we need to simulate an interrupt.  This only happens
+ ** if we have a special test build.
+ */
+#ifdef SQLITE_TEST
+# define VDBE_TEST_INTERRUPT \
+    if( sqlite3_interrupt_count>0 ){ \
+        sqlite3_interrupt_count--; \
+        if( sqlite3_interrupt_count==0 ){ \
+            sqlite3_interrupt(db); \
+        } \
+    }
+#else
+# define VDBE_TEST_INTERRUPT
+#endif
+
+#ifdef VDBE_PROFILE
+# define VDBE_PROFILE_START \
+    origPc = pc; \
+    start = sqlite3Hwtime();
+# define VDBE_PROFILE_END { \
+    u64 elapsed = sqlite3Hwtime() - start; \
+    pOp->cycles += elapsed; \
+    pOp->cnt++; \
+}
+#else
+# define VDBE_PROFILE_START
+# define VDBE_PROFILE_END
+#endif
+
+/*
+ ** Statistics for sqlite3_stmt_opcode_profile() are only kept for the
+ ** main program.  Instructions run by trigger sub-programs have no entry
+ ** in aOpStat[].
+ */
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+# define VDBE_OPSTAT_START \
+    if( p->aOpStat && p->pFrame==0 ){ \
+        pOpStat = &p->aOpStat[pc]; \
+        iOpStart = vdbeOpClock(); \
+    }
+# define VDBE_OPSTAT_END \
+    if( pOpStat ){ \
+        pOpStat->nExec++; \
+        pOpStat->nCycle += vdbeOpClock() - iOpStart; \
+        pOpStat = 0; \
+    }
+#else
+# define VDBE_OPSTAT_START
+# define VDBE_OPSTAT_END
+#endif
+
+/*
+ ** VDBE_OP_PROLOGUE is run by sqlite3VdbeExec() before the instruction at
+ ** address pc, and VDBE_OP_EPILOGUE after it.  On any opcode with the
+ ** "out2-prerelease" tag the prologue frees any external allocations out
+ ** of mem[p2] and sets mem[p2] to be an undefined integer.  Opcodes will
+ ** either fill in the integer value or convert mem[p2] to a different
+ ** type.
+ */
+#define VDBE_OP_PROLOGUE \
+    assert( pc>=0 && pc<p->nOp ); \
+    if( db->mallocFailed ) goto no_mem; \
+    VDBE_PROFILE_START \
+    nVmStep++; \
+    pOp = &aOp[pc]; \
+    VDBE_OPSTAT_START \
+    VDBE_TRACE_OP \
+    VDBE_TEST_INTERRUPT \
+    assert( (pOp->opflags & ~OPFLG_FUSED)==sqlite3OpcodeProperty[pOp->opcode] ); \
+    if( pOp->opflags & OPFLG_OUT2_PRERELEASE ){ \
+        assert( pOp->p2>0 ); \
+        assert( pOp->p2<=(p->nMem-p->nCursor) ); \
+        pOut = &aMem[pOp->p2]; \
+        memAboutToChange(p, pOut); \
+        VdbeMemRelease(pOut); \
+        pOut->flags = MEM_Int; \
+    } \
+    VDBE_CHECK_OPERANDS
+#define VDBE_OP_EPILOGUE \
+    VDBE_PROFILE_END \
+    VDBE_OPSTAT_END \
+    assert( pc>=-1 && pc<p->nOp ); \
+    VDBE_TRACE_RESULT
+
+/*
+ ** When compiled with SQLITE_ENABLE_COMPUTED_GOTO using GCC or Clang,
+ ** sqlite3VdbeExec() uses threaded dispatch.  Each case of the big switch
+ ** statement is also given a label of the form L_OP_xxx by VDBE_OPLABEL(),
+ ** and each case ends with VDBE_DISPATCH() rather than "break".  That
+ ** macro runs the epilogue of the current instruction and the prologue of
+ ** the next, then jumps straight to the label of the next opcode found in
+ ** the aOpLabel[] table using the "labels as values" extension.  So the
+ ** switch range check is avoided and the branch predictor sees a separate
+ ** indirect jump at the end of every opcode, which can learn which opcode
+ ** usually follows that one, rather than a single shared jump.
+ **
+ ** Paths that leave a case some other way (a "break" nested inside a
+ ** conditional block, or a fall through to the end of the switch) still
+ ** reach the bottom of the for(;;) loop, which runs the same epilogue and
+ ** prologue.  Without SQLITE_ENABLE_COMPUTED_GOTO, VDBE_DISPATCH() is
+ ** just "break" and the switch is the portable dispatcher.
+ **
+ ** Every opcode that has no case of its own (OP_Noop and OP_Explain, and
+ ** opcodes whose implementations have been omitted from the build) maps
+ ** to the default case.
+ */
+#if defined(SQLITE_ENABLE_COMPUTED_GOTO) && defined(__GNUC__)
+# define VDBE_COMPUTED_GOTO 1
+# define VDBE_OPLABEL(X) L_##X:
+# define VDBE_DISPATCH() { \
+    VDBE_OP_EPILOGUE \
+    pc++; \
+    if( rc!=SQLITE_OK ) goto vdbe_error_halt; \
+    VDBE_OP_PROLOGUE \
+    assert( pOp->opcode<ArraySize(aOpLabel) && aOpLabel[pOp->opcode]!=0 ); \
+    goto *aOpLabel[pOp->opcode]; \
+}
+#else
+# define VDBE_OPLABEL(X)
+# define VDBE_DISPATCH() break
+#endif
+
 
 #ifndef NDEBUG
 /*
@@ -646,6 +881,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
 #ifdef VDBE_PROFILE
     u64 start;                 /* CPU clock count at start of opcode */
     int origPc;                /* Program counter at start of opcode */
+#endif
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    VdbeOpStat *pOpStat = 0;   /* Statistics for the current instruction */
+    u64 iOpStart = 0;          /* vdbeOpClock() at start of the instruction */
 #endif
     /********************************************************************
      ** Automatically generated code
@@ -969,6 +1208,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
             int nErr;       /* Number of errors reported */
             char *z;        /* Text of the error report */
             Mem *pnErr;     /* Register keeping track of errors remaining */
+            IntegrityTree **apTree; /* Trees checked by other threads */
         } ca;
         struct OP_RowSetRead_stack_vars {
             i64 val;
@@ -1074,9 +1314,250 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
             char *zTrace;
             char *z;
         } cs;
+        struct OP_DeleteRange_stack_vars {
+            VdbeCursor *pC;
+            int nChange;
+            i64 iKey;
+            int res;
+        } ct;
+        struct OP_AggScan_stack_vars {
+            VdbeCursor *pC;
+        } cu;
+        struct OP_HashOpen_stack_vars {
+            VdbeCursor *pCx;
+        } cv;
+        struct OP_HashInsert_stack_vars {
+            VdbeCursor *pC;
+        } cw;
+        struct OP_HashProbe_stack_vars {
+            VdbeCursor *pC;
+            int bFound;
+        } cx;
+        struct OP_HashGroup_stack_vars {
+            VdbeCursor *pC;
+            int bFull;
+        } cy;
+        struct OP_HashSort_stack_vars {
+            VdbeCursor *pC;
+            int bFound;
+        } cz;
+        struct OP_MemoOpen_stack_vars {
+            VdbeCursor *pCx;
+        } da;
+        struct OP_MemoLookup_stack_vars {
+            VdbeCursor *pC;
+            int bFound;
+        } db;
+        struct OP_MemoStore_stack_vars {
+            VdbeCursor *pC;
+        } dc;
     } u;
     /* End automatically generated code
      ********************************************************************/
+#ifdef VDBE_COMPUTED_GOTO
+    /* Address of the implementation of each opcode within the big switch
+     ** statement below, indexed by opcode.  See VDBE_COMPUTED_GOTO above. */
+    static void *const aOpLabel[] = {
+        [OP_Goto] = &&L_OP_Goto, [OP_Gosub] = &&L_OP_Gosub,
+        [OP_Return] = &&L_OP_Return, [OP_Yield] = &&L_OP_Yield,
+        [OP_HaltIfNull] = &&L_OP_HaltIfNull, [OP_Halt] = &&L_OP_Halt,
+        [OP_Integer] = &&L_OP_Integer, [OP_Int64] = &&L_OP_Int64,
+#ifndef SQLITE_OMIT_FLOATING_POINT
+        [OP_Real] = &&L_OP_Real,
+#else
+        [OP_Real] = &&L_OP_Noop,
+#endif
+        [OP_String8] = &&L_OP_String8, [OP_String] = &&L_OP_String,
+        [OP_Null] = &&L_OP_Null, [OP_Blob] = &&L_OP_Blob,
+        [OP_Variable] = &&L_OP_Variable, [OP_Move] = &&L_OP_Move,
+        [OP_Copy] = &&L_OP_Copy, [OP_SCopy] = &&L_OP_SCopy,
+        [OP_ResultRow] = &&L_OP_ResultRow, [OP_Concat] = &&L_OP_Concat,
+        [OP_Add] = &&L_OP_Add, [OP_Subtract] = &&L_OP_Subtract,
+        [OP_Multiply] = &&L_OP_Multiply, [OP_Divide] = &&L_OP_Divide,
+        [OP_Remainder] = &&L_OP_Remainder, [OP_CollSeq] = &&L_OP_CollSeq,
+        [OP_Function] = &&L_OP_Function, [OP_BitAnd] = &&L_OP_BitAnd,
+        [OP_BitOr] = &&L_OP_BitOr, [OP_ShiftLeft] = &&L_OP_ShiftLeft,
+        [OP_ShiftRight] = &&L_OP_ShiftRight, [OP_AddImm] = &&L_OP_AddImm,
+        [OP_MustBeInt] = &&L_OP_MustBeInt,
+#ifndef SQLITE_OMIT_FLOATING_POINT
+        [OP_RealAffinity] = &&L_OP_RealAffinity,
+#else
+        [OP_RealAffinity] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_CAST
+        [OP_ToText] = &&L_OP_ToText, [OP_ToBlob] = &&L_OP_ToBlob,
+        [OP_ToNumeric] = &&L_OP_ToNumeric,
+#else
+        [OP_ToText] = &&L_OP_Noop, [OP_ToBlob] = &&L_OP_Noop,
+        [OP_ToNumeric] = &&L_OP_Noop,
+#endif
+        [OP_ToInt] = &&L_OP_ToInt,
+#if !defined(SQLITE_OMIT_CAST) && !defined(SQLITE_OMIT_FLOATING_POINT)
+        [OP_ToReal] = &&L_OP_ToReal,
+#else
+        [OP_ToReal] = &&L_OP_Noop,
+#endif
+        [OP_Eq] = &&L_OP_Eq, [OP_Ne] = &&L_OP_Ne, [OP_Lt] = &&L_OP_Lt,
+        [OP_Le] = &&L_OP_Le, [OP_Gt] = &&L_OP_Gt, [OP_Ge] = &&L_OP_Ge,
+        [OP_Permutation] = &&L_OP_Permutation, [OP_Compare] = &&L_OP_Compare,
+        [OP_Jump] = &&L_OP_Jump, [OP_And] = &&L_OP_And, [OP_Or] = &&L_OP_Or,
+        [OP_Not] = &&L_OP_Not, [OP_BitNot] = &&L_OP_BitNot,
+        [OP_Once] = &&L_OP_Once, [OP_If] = &&L_OP_If, [OP_IfNot] = &&L_OP_IfNot,
+        [OP_IsNull] = &&L_OP_IsNull, [OP_NotNull] = &&L_OP_NotNull,
+        [OP_Column] = &&L_OP_Column, [OP_Affinity] = &&L_OP_Affinity,
+        [OP_MakeRecord] = &&L_OP_MakeRecord,
+#ifndef SQLITE_OMIT_BTREECOUNT
+        [OP_Count] = &&L_OP_Count,
+#else
+        [OP_Count] = &&L_OP_Noop,
+#endif
+        [OP_Savepoint] = &&L_OP_Savepoint, [OP_AutoCommit] = &&L_OP_AutoCommit,
+        [OP_Transaction] = &&L_OP_Transaction,
+        [OP_ReadCookie] = &&L_OP_ReadCookie, [OP_SetCookie] = &&L_OP_SetCookie,
+        [OP_VerifyCookie] = &&L_OP_VerifyCookie,
+        [OP_OpenRead] = &&L_OP_OpenRead, [OP_OpenWrite] = &&L_OP_OpenWrite,
+        [OP_OpenAutoindex] = &&L_OP_OpenAutoindex,
+        [OP_OpenEphemeral] = &&L_OP_OpenEphemeral,
+        [OP_SorterOpen] = &&L_OP_SorterOpen,
+        [OP_OpenPseudo] = &&L_OP_OpenPseudo, [OP_Close] = &&L_OP_Close,
+        [OP_SeekLt] = &&L_OP_SeekLt, [OP_SeekLe] = &&L_OP_SeekLe,
+        [OP_SeekGe] = &&L_OP_SeekGe, [OP_SeekGt] = &&L_OP_SeekGt,
+        [OP_Seek] = &&L_OP_Seek, [OP_NotFound] = &&L_OP_NotFound,
+        [OP_Found] = &&L_OP_Found, [OP_IsUnique] = &&L_OP_IsUnique,
+        [OP_NotExists] = &&L_OP_NotExists, [OP_Sequence] = &&L_OP_Sequence,
+        [OP_NewRowid] = &&L_OP_NewRowid, [OP_Insert] = &&L_OP_Insert,
+        [OP_InsertInt] = &&L_OP_InsertInt, [OP_Delete] = &&L_OP_Delete,
+        [OP_DeleteRange] = &&L_OP_DeleteRange,
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+        [OP_AggScan] = &&L_OP_AggScan,
+#else
+        [OP_AggScan] = &&L_OP_Noop,
+#endif
+#if !defined(SQLITE_OMIT_HASH_JOIN) || !defined(SQLITE_OMIT_HASH_AGGREGATE)
+        [OP_HashOpen] = &&L_OP_HashOpen,
+#else
+        [OP_HashOpen] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_HASH_JOIN
+        [OP_HashInsert] = &&L_OP_HashInsert,
+        [OP_HashProbe] = &&L_OP_HashProbe, [OP_HashNext] = &&L_OP_HashNext,
+#else
+        [OP_HashInsert] = &&L_OP_Noop,
+        [OP_HashProbe] = &&L_OP_Noop, [OP_HashNext] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+        [OP_HashGroup] = &&L_OP_HashGroup,
+        [OP_HashSort] = &&L_OP_HashSort, [OP_HashGroupNext] = &&L_OP_HashGroupNext,
+#else
+        [OP_HashGroup] = &&L_OP_Noop,
+        [OP_HashSort] = &&L_OP_Noop, [OP_HashGroupNext] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+        [OP_MemoOpen] = &&L_OP_MemoOpen,
+        [OP_MemoLookup] = &&L_OP_MemoLookup, [OP_MemoStore] = &&L_OP_MemoStore,
+#else
+        [OP_MemoOpen] = &&L_OP_Noop,
+        [OP_MemoLookup] = &&L_OP_Noop, [OP_MemoStore] = &&L_OP_Noop,
+#endif
+        [OP_ResetCount] = &&L_OP_ResetCount,
+        [OP_SorterCompare] = &&L_OP_SorterCompare,
+        [OP_SorterData] = &&L_OP_SorterData, [OP_RowKey] = &&L_OP_RowKey,
+        [OP_RowData] = &&L_OP_RowData, [OP_Rowid] = &&L_OP_Rowid,
+        [OP_NullRow] = &&L_OP_NullRow, [OP_Last] = &&L_OP_Last,
+        [OP_SorterSort] = &&L_OP_SorterSort, [OP_Sort] = &&L_OP_Sort,
+        [OP_Rewind] = &&L_OP_Rewind, [OP_SorterNext] = &&L_OP_SorterNext,
+        [OP_Prev] = &&L_OP_Prev, [OP_Next] = &&L_OP_Next,
+        [OP_SorterInsert] = &&L_OP_SorterInsert,
+        [OP_IdxInsert] = &&L_OP_IdxInsert, [OP_IdxDelete] = &&L_OP_IdxDelete,
+        [OP_IdxRowid] = &&L_OP_IdxRowid, [OP_IdxLT] = &&L_OP_IdxLT,
+        [OP_IdxGE] = &&L_OP_IdxGE, [OP_Destroy] = &&L_OP_Destroy,
+        [OP_Clear] = &&L_OP_Clear, [OP_CreateIndex] = &&L_OP_CreateIndex,
+        [OP_CreateTable] = &&L_OP_CreateTable,
+        [OP_ParseSchema] = &&L_OP_ParseSchema,
+#if !defined(SQLITE_OMIT_ANALYZE)
+        [OP_LoadAnalysis] = &&L_OP_LoadAnalysis,
+#else
+        [OP_LoadAnalysis] = &&L_OP_Noop,
+#endif
+        [OP_DropTable] = &&L_OP_DropTable, [OP_DropIndex] = &&L_OP_DropIndex,
+        [OP_DropTrigger] = &&L_OP_DropTrigger,
+#ifndef SQLITE_OMIT_INTEGRITY_CHECK
+        [OP_IntegrityCk] = &&L_OP_IntegrityCk,
+#else
+        [OP_IntegrityCk] = &&L_OP_Noop,
+#endif
+        [OP_RowSetAdd] = &&L_OP_RowSetAdd, [OP_RowSetRead] = &&L_OP_RowSetRead,
+        [OP_RowSetTest] = &&L_OP_RowSetTest,
+#ifndef SQLITE_OMIT_TRIGGER
+        [OP_Program] = &&L_OP_Program, [OP_Param] = &&L_OP_Param,
+#else
+        [OP_Program] = &&L_OP_Noop, [OP_Param] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_FOREIGN_KEY
+        [OP_FkCounter] = &&L_OP_FkCounter, [OP_FkIfZero] = &&L_OP_FkIfZero,
+#else
+        [OP_FkCounter] = &&L_OP_Noop, [OP_FkIfZero] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_AUTOINCREMENT
+        [OP_MemMax] = &&L_OP_MemMax,
+#else
+        [OP_MemMax] = &&L_OP_Noop,
+#endif
+        [OP_IfPos] = &&L_OP_IfPos, [OP_IfNeg] = &&L_OP_IfNeg,
+        [OP_IfZero] = &&L_OP_IfZero, [OP_AggStep] = &&L_OP_AggStep,
+        [OP_AggFinal] = &&L_OP_AggFinal,
+#ifndef SQLITE_OMIT_WAL
+        [OP_Checkpoint] = &&L_OP_Checkpoint,
+#else
+        [OP_Checkpoint] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_PRAGMA
+        [OP_JournalMode] = &&L_OP_JournalMode,
+#else
+        [OP_JournalMode] = &&L_OP_Noop,
+#endif
+#if !defined(SQLITE_OMIT_VACUUM) && !defined(SQLITE_OMIT_ATTACH)
+        [OP_Vacuum] = &&L_OP_Vacuum,
+#else
+        [OP_Vacuum] = &&L_OP_Noop,
+#endif
+#if !defined(SQLITE_OMIT_AUTOVACUUM)
+        [OP_IncrVacuum] = &&L_OP_IncrVacuum,
+#else
+        [OP_IncrVacuum] = &&L_OP_Noop,
+#endif
+        [OP_Expire] = &&L_OP_Expire,
+#ifndef SQLITE_OMIT_SHARED_CACHE
+        [OP_TableLock] = &&L_OP_TableLock,
+#else
+        [OP_TableLock] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_VIRTUALTABLE
+        [OP_VBegin] = &&L_OP_VBegin, [OP_VCreate] = &&L_OP_VCreate,
+        [OP_VDestroy] = &&L_OP_VDestroy, [OP_VOpen] = &&L_OP_VOpen,
+        [OP_VFilter] = &&L_OP_VFilter, [OP_VColumn] = &&L_OP_VColumn,
+        [OP_VNext] = &&L_OP_VNext, [OP_VRename] = &&L_OP_VRename,
+        [OP_VUpdate] = &&L_OP_VUpdate,
+#else
+        [OP_VBegin] = &&L_OP_Noop, [OP_VCreate] = &&L_OP_Noop,
+        [OP_VDestroy] = &&L_OP_Noop, [OP_VOpen] = &&L_OP_Noop,
+        [OP_VFilter] = &&L_OP_Noop, [OP_VColumn] = &&L_OP_Noop,
+        [OP_VNext] = &&L_OP_Noop, [OP_VRename] = &&L_OP_Noop,
+        [OP_VUpdate] = &&L_OP_Noop,
+#endif
+#ifndef  SQLITE_OMIT_PAGER_PRAGMAS
+        [OP_Pagecount] = &&L_OP_Pagecount, [OP_MaxPgcnt] = &&L_OP_MaxPgcnt,
+#else
+        [OP_Pagecount] = &&L_OP_Noop, [OP_MaxPgcnt] = &&L_OP_Noop,
+#endif
+#ifndef SQLITE_OMIT_TRACE
+        [OP_Trace] = &&L_OP_Trace,
+#else
+        [OP_Trace] = &&L_OP_Noop,
+#endif
+        [OP_Noop] = &&L_OP_Noop, [OP_Explain] = &&L_OP_Noop
+    };
+#endif
     
     assert( p->magic==VDBE_MAGIC_RUN );  /* sqlite3_step() verifies this */
     sqlite3VdbeEnter(p);
@@ -1088,6 +1569,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
     assert( p->rc==SQLITE_OK || p->rc==SQLITE_BUSY );
     assert( p->bIsReader || p->readOnly!=0 );
     p->rc = SQLITE_OK;
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    if( p->bOpProfile && p->aOpStat==0 ){
+        /* If this allocation fails, just run without collecting statistics */
+        p->aOpStat = sqlite3DbMallocZero(db, p->nOp*sizeof(VdbeOpStat));
+    }
+#endif
     p->iCurrentTime = 0;
     assert( p->explain==0 );
     p->pResultSet = 0;
@@ -1118,87 +1605,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
     sqlite3EndBenignMalloc();
 #endif
     for(pc=p->pc; rc==SQLITE_OK; pc++){
-        assert( pc>=0 && pc<p->nOp );
-        if( db->mallocFailed ) goto no_mem;
-#ifdef VDBE_PROFILE
-        origPc = pc;
-        start = sqlite3Hwtime();
-#endif
-        nVmStep++;
-        pOp = &aOp[pc];
+        VDBE_OP_PROLOGUE
         
-        /* Only allow tracing if SQLITE_DEBUG is defined.
-         */
-#ifdef SQLITE_DEBUG
-        if( p->trace ){
-            if( pc==0 ){
-                printf("VDBE Execution Trace:\n");
-                sqlite3VdbePrintSql(p);
-            }
-            sqlite3VdbePrintOp(p->trace, pc, pOp);
-        }
+#ifdef VDBE_COMPUTED_GOTO
+        assert( pOp->opcode<ArraySize(aOpLabel) && aOpLabel[pOp->opcode]!=0 );
+        goto *aOpLabel[pOp->opcode];
 #endif
-        
-        
-        /* Check to see if we need to simulate an interrupt.  This only happens
-         ** if we have a special test build.
-         */
-#ifdef SQLITE_TEST
-        if( sqlite3_interrupt_count>0 ){
-            sqlite3_interrupt_count--;
-            if( sqlite3_interrupt_count==0 ){
-                sqlite3_interrupt(db);
-            }
-        }
-#endif
-        
-        /* On any opcode with the "out2-prerelease" tag, free any
-         ** external allocations out of mem[p2] and set mem[p2] to be
-         ** an undefined integer.  Opcodes will either fill in the integer
-         ** value or convert mem[p2] to a different type.
-         */
-        assert( pOp->opflags==sqlite3OpcodeProperty[pOp->opcode] );
-        if( pOp->opflags & OPFLG_OUT2_PRERELEASE ){
-            assert( pOp->p2>0 );
-            assert( pOp->p2<=(p->nMem-p->nCursor) );
-            pOut = &aMem[pOp->p2];
-            memAboutToChange(p, pOut);
-            VdbeMemRelease(pOut);
-            pOut->flags = MEM_Int;
-        }
-        
-        /* Sanity checking on other operands */
-#ifdef SQLITE_DEBUG
-        if( (pOp->opflags & OPFLG_IN1)!=0 ){
-            assert( pOp->p1>0 );
-            assert( pOp->p1<=(p->nMem-p->nCursor) );
-            assert( memIsValid(&aMem[pOp->p1]) );
-            REGISTER_TRACE(pOp->p1, &aMem[pOp->p1]);
-        }
-        if( (pOp->opflags & OPFLG_IN2)!=0 ){
-            assert( pOp->p2>0 );
-            assert( pOp->p2<=(p->nMem-p->nCursor) );
-            assert( memIsValid(&aMem[pOp->p2]) );
-            REGISTER_TRACE(pOp->p2, &aMem[pOp->p2]);
-        }
-        if( (pOp->opflags & OPFLG_IN3)!=0 ){
-            assert( pOp->p3>0 );
-            assert( pOp->p3<=(p->nMem-p->nCursor) );
-            assert( memIsValid(&aMem[pOp->p3]) );
-            REGISTER_TRACE(pOp->p3, &aMem[pOp->p3]);
-        }
-        if( (pOp->opflags & OPFLG_OUT2)!=0 ){
-            assert( pOp->p2>0 );
-            assert( pOp->p2<=(p->nMem-p->nCursor) );
-            memAboutToChange(p, &aMem[pOp->p2]);
-        }
-        if( (pOp->opflags & OPFLG_OUT3)!=0 ){
-            assert( pOp->p3>0 );
-            assert( pOp->p3<=(p->nMem-p->nCursor) );
-            memAboutToChange(p, &aMem[pOp->p3]);
-        }
-#endif
-        
         switch( pOp->opcode ){
                 
                 /*****************************************************************************
@@ -1243,6 +1655,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the one at index P2 from the beginning of
                  ** the program.
                  */
+            VDBE_OPLABEL(OP_Goto)
             case OP_Goto: {             /* jump */
                 pc = pOp->p2 - 1;
                 
@@ -1278,7 +1691,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
 #endif
                 
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode:  Gosub P1 P2 * * *
@@ -1286,6 +1699,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** Write the current address onto register P1
                  ** and then jump to address P2.
                  */
+            VDBE_OPLABEL(OP_Gosub)
             case OP_Gosub: {            /* jump */
                 assert( pOp->p1>0 && pOp->p1<=(p->nMem-p->nCursor) );
                 pIn1 = &aMem[pOp->p1];
@@ -1295,24 +1709,26 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pIn1->u.i = pc;
                 REGISTER_TRACE(pOp->p1, pIn1);
                 pc = pOp->p2 - 1;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode:  Return P1 * * * *
                  **
                  ** Jump to the next instruction after the address in register P1.
                  */
+            VDBE_OPLABEL(OP_Return)
             case OP_Return: {           /* in1 */
                 pIn1 = &aMem[pOp->p1];
                 assert( pIn1->flags & MEM_Int );
                 pc = (int)pIn1->u.i;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode:  Yield P1 * * * *
                  **
                  ** Swap the program counter with the value in register P1.
                  */
+            VDBE_OPLABEL(OP_Yield)
             case OP_Yield: {            /* in1 */
 #if 0  /* local variables moved into u.aa */
                 int pcDest;
@@ -1324,7 +1740,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pIn1->u.i = pc;
                 REGISTER_TRACE(pOp->p1, pIn1);
                 pc = u.aa.pcDest;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode:  HaltIfNull  P1 P2 P3 P4 *
@@ -1333,9 +1749,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** parameter P1, P2, and P4 as if this were a Halt instruction.  If the
                  ** value in register P3 is not NULL, then this routine is a no-op.
                  */
+            VDBE_OPLABEL(OP_HaltIfNull)
             case OP_HaltIfNull: {      /* in3 */
                 pIn3 = &aMem[pOp->p3];
-                if( (pIn3->flags & MEM_Null)==0 ) break;
+                if( (pIn3->flags & MEM_Null)==0 ) VDBE_DISPATCH();
                 /* Fall through into OP_Halt */
             }
                 
@@ -1358,6 +1775,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** every program.  So a jump past the last instruction of the program
                  ** is the same as executing Halt.
                  */
+            VDBE_OPLABEL(OP_Halt)
             case OP_Halt: {
                 if( pOp->p1==SQLITE_OK && p->pFrame ){
                     /* Halt the sub-program. Return control to the parent frame. */
@@ -1392,6 +1810,17 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     testcase( sqlite3GlobalConfig.xLog!=0 );
                     sqlite3_log(pOp->p1, "constraint failed at %d in [%s]", pc, p->zSql);
                 }
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+                if( sqlite3VdbeBatchRunning(p) && sqlite3VdbeBatchNext(p) ){
+                    /* Run the program again for the next row of the batch. The
+                     ** halt may have come from a trigger program, so reload the
+                     ** instruction and register arrays of the main program. */
+                    aOp = p->aOp;
+                    aMem = p->aMem;
+                    pc = -1;
+                    break;
+                }
+#endif
                 rc = sqlite3VdbeHalt(p);
                 assert( rc==SQLITE_BUSY || rc==SQLITE_OK || rc==SQLITE_ERROR );
                 if( rc==SQLITE_BUSY ){
@@ -1408,9 +1837,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** The 32-bit integer value P1 is written into register P2.
                  */
+            VDBE_OPLABEL(OP_Integer)
             case OP_Integer: {         /* out2-prerelease */
                 pOut->u.i = pOp->p1;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Int64 * P2 * P4 *
@@ -1418,10 +1848,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 is a pointer to a 64-bit integer value.
                  ** Write that value into register P2.
                  */
+            VDBE_OPLABEL(OP_Int64)
             case OP_Int64: {           /* out2-prerelease */
                 assert( pOp->p4.pI64!=0 );
                 pOut->u.i = *pOp->p4.pI64;
-                break;
+                VDBE_DISPATCH();
             }
                 
 #ifndef SQLITE_OMIT_FLOATING_POINT
@@ -1430,11 +1861,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 is a pointer to a 64-bit floating point value.
                  ** Write that value into register P2.
                  */
+            VDBE_OPLABEL(OP_Real)
             case OP_Real: {            /* same as TK_FLOAT, out2-prerelease */
                 pOut->flags = MEM_Real;
                 assert( !sqlite3IsNaN(*pOp->p4.pReal) );
                 pOut->r = *pOp->p4.pReal;
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -1443,6 +1875,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 points to a nul terminated UTF-8 string. This opcode is transformed
                  ** into an OP_String before it is executed for the first time.
                  */
+            VDBE_OPLABEL(OP_String8)
             case OP_String8: {         /* same as TK_STRING, out2-prerelease */
                 assert( pOp->p4.z!=0 );
                 pOp->opcode = OP_String;
@@ -1476,6 +1909,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** The string value P4 of length P1 (bytes) is stored in register P2.
                  */
+            VDBE_OPLABEL(OP_String)
             case OP_String: {          /* out2-prerelease */
                 assert( pOp->p4.z!=0 );
                 pOut->flags = MEM_Str|MEM_Static|MEM_Term;
@@ -1483,7 +1917,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pOut->n = pOp->p1;
                 pOut->enc = encoding;
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Null P1 P2 P3 * *
@@ -1497,6 +1931,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** NULL values will not compare equal even if SQLITE_NULLEQ is set on
                  ** OP_Ne or OP_Eq.
                  */
+            VDBE_OPLABEL(OP_Null)
             case OP_Null: {           /* out2-prerelease */
 #if 0  /* local variables moved into u.ab */
                 int cnt;
@@ -1512,7 +1947,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pOut->flags = u.ab.nullFlag;
                     u.ab.cnt--;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -1521,12 +1956,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 points to a blob of data P1 bytes long.  Store this
                  ** blob in register P2.
                  */
+            VDBE_OPLABEL(OP_Blob)
             case OP_Blob: {                /* out2-prerelease */
                 assert( pOp->p1 <= SQLITE_MAX_LENGTH );
                 sqlite3VdbeMemSetStr(pOut, pOp->p4.z, pOp->p1, 0, 0);
                 pOut->enc = encoding;
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Variable P1 P2 * P4 *
@@ -1536,6 +1972,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If the parameter is named, then its name appears in P4 and P3==1.
                  ** The P4 value is used by sqlite3_bind_parameter_name().
                  */
+            VDBE_OPLABEL(OP_Variable)
             case OP_Variable: {            /* out2-prerelease */
 #if 0  /* local variables moved into u.ac */
                 Mem *pVar;       /* Value being transferred */
@@ -1549,7 +1986,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 sqlite3VdbeMemShallowCopy(pOut, u.ac.pVar, MEM_Static);
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Move P1 P2 P3 * *
@@ -1559,6 +1996,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** left holding a NULL.  It is an error for register ranges
                  ** P1..P1+P3 and P2..P2+P3 to overlap.
                  */
+            VDBE_OPLABEL(OP_Move)
             case OP_Move: {
 #if 0  /* local variables moved into u.ad */
                 char *zMalloc;   /* Holding variable for allocated memory */
@@ -1593,7 +2031,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pIn1++;
                     pOut++;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Copy P1 P2 P3 * *
@@ -1603,6 +2041,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This instruction makes a deep copy of the value.  A duplicate
                  ** is made of any string or blob constant.  See also OP_SCopy.
                  */
+            VDBE_OPLABEL(OP_Copy)
             case OP_Copy: {
 #if 0  /* local variables moved into u.ae */
                 int n;
@@ -1623,7 +2062,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pOut++;
                     pIn1++;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: SCopy P1 P2 * * *
@@ -1638,6 +2077,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** during the lifetime of the copy.  Use OP_Copy to make a complete
                  ** copy.
                  */
+            VDBE_OPLABEL(OP_SCopy)
             case OP_SCopy: {            /* in1, out2 */
                 pIn1 = &aMem[pOp->p1];
                 pOut = &aMem[pOp->p2];
@@ -1647,7 +2087,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( pOut->pScopyFrom==0 ) pOut->pScopyFrom = pIn1;
 #endif
                 REGISTER_TRACE(pOp->p2, pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: ResultRow P1 P2 * * *
@@ -1658,6 +2098,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** structure to provide access to the top P1 values as the result
                  ** row.
                  */
+            VDBE_OPLABEL(OP_ResultRow)
             case OP_ResultRow: {
 #if 0  /* local variables moved into u.af */
                 Mem *pMem;
@@ -1707,6 +2148,16 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.af.pMem = p->pResultSet = &aMem[pOp->p1];
                 for(u.af.i=0; u.af.i<pOp->p2; u.af.i++){
                     assert( memIsValid(&u.af.pMem[u.af.i]) );
+#ifndef SQLITE_OMIT_ZEROCOPY
+                    /* Values borrowed from a b-tree page by OP_Column are left in
+                     ** place.  The sqlite3_column_xxx() routines copy them only if
+                     ** asked for terminated or converted text. */
+                    if( u.af.i<64 && (p->mBorrow & (((u64)1)<<u.af.i))!=0 ){
+                        sqlite3VdbeMemStoreType(&u.af.pMem[u.af.i]);
+                        REGISTER_TRACE(pOp->p1+u.af.i, &u.af.pMem[u.af.i]);
+                        continue;
+                    }
+#endif
                     Deephemeralize(&u.af.pMem[u.af.i]);
                     assert( (u.af.pMem[u.af.i].flags & MEM_Ephem)==0
                            || (u.af.pMem[u.af.i].flags & (MEM_Str|MEM_Blob))==0 );
@@ -1714,6 +2165,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     sqlite3VdbeMemStoreType(&u.af.pMem[u.af.i]);
                     REGISTER_TRACE(pOp->p1+u.af.i, &u.af.pMem[u.af.i]);
                 }
+#ifndef SQLITE_OMIT_ZEROCOPY
+                p->mBorrow = 0;
+#endif
                 if( db->mallocFailed ) goto no_mem;
                 
                 /* Return SQLITE_ROW
@@ -1735,6 +2189,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** if P3 is the same register as P2, the implementation is able
                  ** to avoid a memcpy().
                  */
+            VDBE_OPLABEL(OP_Concat)
             case OP_Concat: {           /* same as TK_CONCAT, in1, in2, out3 */
 #if 0  /* local variables moved into u.ag */
                 i64 nByte;
@@ -1769,7 +2224,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pOut->n = (int)u.ag.nByte;
                 pOut->enc = encoding;
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Add P1 P2 P3 * *
@@ -1805,10 +2260,15 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If the value in register P2 is zero the result is NULL.
                  ** If either operand is NULL, the result is NULL.
                  */
+            VDBE_OPLABEL(OP_Add)
             case OP_Add:                   /* same as TK_PLUS, in1, in2, out3 */
+            VDBE_OPLABEL(OP_Subtract)
             case OP_Subtract:              /* same as TK_MINUS, in1, in2, out3 */
+            VDBE_OPLABEL(OP_Multiply)
             case OP_Multiply:              /* same as TK_STAR, in1, in2, out3 */
+            VDBE_OPLABEL(OP_Divide)
             case OP_Divide:                /* same as TK_SLASH, in1, in2, out3 */
+            VDBE_OPLABEL(OP_Remainder)
             case OP_Remainder: {           /* same as TK_REM, in1, in2, out3 */
 #if 0  /* local variables moved into u.ah */
                 char bIntint;   /* Started out as two integer operands */
@@ -1887,11 +2347,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     }
 #endif
                 }
-                break;
+                VDBE_DISPATCH();
                 
             arithmetic_result_is_null:
                 sqlite3VdbeMemSetNull(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: CollSeq P1 * * P4
@@ -1909,12 +2369,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** to retrieve the collation sequence set by this opcode is not available
                  ** publicly, only to user functions defined in func.c.
                  */
+            VDBE_OPLABEL(OP_CollSeq)
             case OP_CollSeq: {
                 assert( pOp->p4type==P4_COLLSEQ );
                 if( pOp->p1 ){
                     sqlite3VdbeMemSetInt64(&aMem[pOp->p1], 0);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Function P1 P2 P3 P4 P5
@@ -1933,6 +2394,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: AggStep and AggFinal
                  */
+            VDBE_OPLABEL(OP_Function)
             case OP_Function: {
 #if 0  /* local variables moved into u.ai */
                 int i;
@@ -2023,7 +2485,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 
                 REGISTER_TRACE(pOp->p3, pOut);
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: BitAnd P1 P2 P3 * *
@@ -2052,9 +2514,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** Store the result in register P3.
                  ** If either input is NULL, the result is NULL.
                  */
+            VDBE_OPLABEL(OP_BitAnd)
             case OP_BitAnd:                 /* same as TK_BITAND, in1, in2, out3 */
+            VDBE_OPLABEL(OP_BitOr)
             case OP_BitOr:                  /* same as TK_BITOR, in1, in2, out3 */
+            VDBE_OPLABEL(OP_ShiftLeft)
             case OP_ShiftLeft:              /* same as TK_LSHIFT, in1, in2, out3 */
+            VDBE_OPLABEL(OP_ShiftRight)
             case OP_ShiftRight: {           /* same as TK_RSHIFT, in1, in2, out3 */
 #if 0  /* local variables moved into u.aj */
                 i64 iA;
@@ -2103,7 +2569,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 pOut->u.i = u.aj.iA;
                 MemSetTypeFlag(pOut, MEM_Int);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: AddImm  P1 P2 * * *
@@ -2113,12 +2579,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** To force any register to be an integer, just add 0.
                  */
+            VDBE_OPLABEL(OP_AddImm)
             case OP_AddImm: {            /* in1 */
                 pIn1 = &aMem[pOp->p1];
                 memAboutToChange(p, pIn1);
                 sqlite3VdbeMemIntegerify(pIn1);
                 pIn1->u.i += pOp->p2;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: MustBeInt P1 P2 * * *
@@ -2128,6 +2595,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** without data loss, then jump immediately to P2, or if P2==0
                  ** raise an SQLITE_MISMATCH exception.
                  */
+            VDBE_OPLABEL(OP_MustBeInt)
             case OP_MustBeInt: {            /* jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 applyAffinity(pIn1, SQLITE_AFF_NUMERIC, encoding);
@@ -2141,7 +2609,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     MemSetTypeFlag(pIn1, MEM_Int);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
 #ifndef SQLITE_OMIT_FLOATING_POINT
@@ -2154,12 +2622,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** integers, for space efficiency, but after extraction we want them
                  ** to have only a real value.
                  */
+            VDBE_OPLABEL(OP_RealAffinity)
             case OP_RealAffinity: {                  /* in1 */
                 pIn1 = &aMem[pOp->p1];
                 if( pIn1->flags & MEM_Int ){
                     sqlite3VdbeMemRealify(pIn1);
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -2173,10 +2642,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A NULL value is not changed by this routine.  It remains NULL.
                  */
+            VDBE_OPLABEL(OP_ToText)
             case OP_ToText: {                  /* same as TK_TO_TEXT, in1 */
                 pIn1 = &aMem[pOp->p1];
                 memAboutToChange(p, pIn1);
-                if( pIn1->flags & MEM_Null ) break;
+                if( pIn1->flags & MEM_Null ) VDBE_DISPATCH();
                 assert( MEM_Str==(MEM_Blob>>3) );
                 pIn1->flags |= (pIn1->flags&MEM_Blob)>>3;
                 applyAffinity(pIn1, SQLITE_AFF_TEXT, encoding);
@@ -2184,7 +2654,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 assert( pIn1->flags & MEM_Str || db->mallocFailed );
                 pIn1->flags &= ~(MEM_Int|MEM_Real|MEM_Blob|MEM_Zero);
                 UPDATE_MAX_BLOBSIZE(pIn1);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: ToBlob P1 * * * *
@@ -2196,9 +2666,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A NULL value is not changed by this routine.  It remains NULL.
                  */
+            VDBE_OPLABEL(OP_ToBlob)
             case OP_ToBlob: {                  /* same as TK_TO_BLOB, in1 */
                 pIn1 = &aMem[pOp->p1];
-                if( pIn1->flags & MEM_Null ) break;
+                if( pIn1->flags & MEM_Null ) VDBE_DISPATCH();
                 if( (pIn1->flags & MEM_Blob)==0 ){
                     applyAffinity(pIn1, SQLITE_AFF_TEXT, encoding);
                     assert( pIn1->flags & MEM_Str || db->mallocFailed );
@@ -2207,7 +2678,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pIn1->flags &= ~(MEM_TypeMask&~MEM_Blob);
                 }
                 UPDATE_MAX_BLOBSIZE(pIn1);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: ToNumeric P1 * * * *
@@ -2220,10 +2691,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A NULL value is not changed by this routine.  It remains NULL.
                  */
+            VDBE_OPLABEL(OP_ToNumeric)
             case OP_ToNumeric: {                  /* same as TK_TO_NUMERIC, in1 */
                 pIn1 = &aMem[pOp->p1];
                 sqlite3VdbeMemNumerify(pIn1);
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_CAST */
                 
@@ -2236,12 +2708,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A NULL value is not changed by this routine.  It remains NULL.
                  */
+            VDBE_OPLABEL(OP_ToInt)
             case OP_ToInt: {                  /* same as TK_TO_INT, in1 */
                 pIn1 = &aMem[pOp->p1];
                 if( (pIn1->flags & MEM_Null)==0 ){
                     sqlite3VdbeMemIntegerify(pIn1);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
 #if !defined(SQLITE_OMIT_CAST) && !defined(SQLITE_OMIT_FLOATING_POINT)
@@ -2254,13 +2727,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A NULL value is not changed by this routine.  It remains NULL.
                  */
+            VDBE_OPLABEL(OP_ToReal)
             case OP_ToReal: {                  /* same as TK_TO_REAL, in1 */
                 pIn1 = &aMem[pOp->p1];
                 memAboutToChange(p, pIn1);
                 if( (pIn1->flags & MEM_Null)==0 ){
                     sqlite3VdbeMemRealify(pIn1);
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* !defined(SQLITE_OMIT_CAST) && !defined(SQLITE_OMIT_FLOATING_POINT) */
                 
@@ -2340,11 +2814,17 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the content of register P3 is greater than or equal to the content of
                  ** register P1.  See the Lt opcode for additional information.
                  */
+            VDBE_OPLABEL(OP_Eq)
             case OP_Eq:               /* same as TK_EQ, jump, in1, in3 */
+            VDBE_OPLABEL(OP_Ne)
             case OP_Ne:               /* same as TK_NE, jump, in1, in3 */
+            VDBE_OPLABEL(OP_Lt)
             case OP_Lt:               /* same as TK_LT, jump, in1, in3 */
+            VDBE_OPLABEL(OP_Le)
             case OP_Le:               /* same as TK_LE, jump, in1, in3 */
+            VDBE_OPLABEL(OP_Gt)
             case OP_Gt:               /* same as TK_GT, jump, in1, in3 */
+            VDBE_OPLABEL(OP_Ge)
             case OP_Ge: {             /* same as TK_GE, jump, in1, in3 */
 #if 0  /* local variables moved into u.ak */
                 int res;            /* Result of the comparison of pIn1 against pIn3 */
@@ -2353,6 +2833,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u16 flags3;         /* Copy of initial value of pIn3->flags */
 #endif /* local variables moved into u.ak */
                 
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+            op_compare_fused:
+#endif
                 pIn1 = &aMem[pOp->p1];
                 pIn3 = &aMem[pOp->p3];
                 u.ak.flags1 = pIn1->flags;
@@ -2424,7 +2907,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 /* Undo any changes made by applyAffinity() to the input registers. */
                 pIn1->flags = (pIn1->flags&~MEM_TypeMask) | (u.ak.flags1&MEM_TypeMask);
                 pIn3->flags = (pIn3->flags&~MEM_TypeMask) | (u.ak.flags3&MEM_TypeMask);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Permutation * * * P4 *
@@ -2436,11 +2919,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the OPFLAG_PERMUTE bit set in P5. Typically the OP_Permutation should
                  ** occur immediately prior to the OP_Compare.
                  */
+            VDBE_OPLABEL(OP_Permutation)
             case OP_Permutation: {
                 assert( pOp->p4type==P4_INTARRAY );
                 assert( pOp->p4.ai );
                 aPermute = pOp->p4.ai;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Compare P1 P2 P3 P4 P5
@@ -2462,6 +2946,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** NULLs are less than numbers, numbers are less than strings,
                  ** and strings are less than blobs.
                  */
+            VDBE_OPLABEL(OP_Compare)
             case OP_Compare: {
 #if 0  /* local variables moved into u.al */
                 int n;
@@ -2508,7 +2993,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     }
                 }
                 aPermute = 0;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Jump P1 P2 P3 * *
@@ -2517,6 +3002,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** in the most recent OP_Compare instruction the P1 vector was less than
                  ** equal to, or greater than the P2 vector, respectively.
                  */
+            VDBE_OPLABEL(OP_Jump)
             case OP_Jump: {             /* jump */
                 if( iCompare<0 ){
                     pc = pOp->p1 - 1;
@@ -2525,7 +3011,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     pc = pOp->p3 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: And P1 P2 P3 * *
@@ -2546,7 +3032,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** even if the other input is NULL.  A NULL and false or two NULLs
                  ** give a NULL output.
                  */
+            VDBE_OPLABEL(OP_And)
             case OP_And:              /* same as TK_AND, in1, in2, out3 */
+            VDBE_OPLABEL(OP_Or)
             case OP_Or: {             /* same as TK_OR, in1, in2, out3 */
 #if 0  /* local variables moved into u.am */
                 int v1;    /* Left operand:  0==FALSE, 1==TRUE, 2==UNKNOWN or NULL */
@@ -2579,7 +3067,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pOut->u.i = u.am.v1;
                     MemSetTypeFlag(pOut, MEM_Int);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Not P1 P2 * * *
@@ -2588,6 +3076,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** boolean complement in register P2.  If the value in register P1 is
                  ** NULL, then a NULL is stored in P2.
                  */
+            VDBE_OPLABEL(OP_Not)
             case OP_Not: {                /* same as TK_NOT, in1, out2 */
                 pIn1 = &aMem[pOp->p1];
                 pOut = &aMem[pOp->p2];
@@ -2596,7 +3085,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     sqlite3VdbeMemSetInt64(pOut, !sqlite3VdbeIntValue(pIn1));
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: BitNot P1 P2 * * *
@@ -2605,6 +3094,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** ones-complement of the P1 value into register P2.  If P1 holds
                  ** a NULL then store a NULL in P2.
                  */
+            VDBE_OPLABEL(OP_BitNot)
             case OP_BitNot: {             /* same as TK_BITNOT, in1, out2 */
                 pIn1 = &aMem[pOp->p1];
                 pOut = &aMem[pOp->p2];
@@ -2613,7 +3103,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     sqlite3VdbeMemSetInt64(pOut, ~sqlite3VdbeIntValue(pIn1));
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Once P1 P2 * * *
@@ -2621,6 +3111,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** Check if OP_Once flag P1 is set. If so, jump to instruction P2. Otherwise,
                  ** set the flag and fall through to the next instruction.
                  */
+            VDBE_OPLABEL(OP_Once)
             case OP_Once: {             /* jump */
                 assert( pOp->p1<p->nOnceFlag );
                 if( p->aOnceFlag[pOp->p1] ){
@@ -2628,7 +3119,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     p->aOnceFlag[pOp->p1] = 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: If P1 P2 P3 * *
@@ -2643,7 +3134,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** is considered false if it has a numeric value of zero.  If the value
                  ** in P1 is NULL then take the jump if P3 is zero.
                  */
+            VDBE_OPLABEL(OP_If)
             case OP_If:                 /* jump, in1 */
+            VDBE_OPLABEL(OP_IfNot)
             case OP_IfNot: {            /* jump, in1 */
 #if 0  /* local variables moved into u.an */
                 int c;
@@ -2662,31 +3155,33 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.an.c ){
                     pc = pOp->p2-1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IsNull P1 P2 * * *
                  **
                  ** Jump to P2 if the value in register P1 is NULL.
                  */
+            VDBE_OPLABEL(OP_IsNull)
             case OP_IsNull: {            /* same as TK_ISNULL, jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 if( (pIn1->flags & MEM_Null)!=0 ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: NotNull P1 P2 * * *
                  **
                  ** Jump to P2 if the value in register P1 is not NULL.
                  */
+            VDBE_OPLABEL(OP_NotNull)
             case OP_NotNull: {            /* same as TK_NOTNULL, jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 if( (pIn1->flags & MEM_Null)==0 ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Column P1 P2 P3 P4 P5
@@ -2713,6 +3208,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** or typeof() function, respectively.  The loading of large blobs can be
                  ** skipped for length() and all content loading can be skipped for typeof().
                  */
+            VDBE_OPLABEL(OP_Column)
             case OP_Column: {
 #if 0  /* local variables moved into u.ao */
                 u32 payloadSize;   /* Number of bytes in the record */
@@ -2740,6 +3236,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 Mem *pReg;         /* PseudoTable input register */
 #endif /* local variables moved into u.ao */
                 
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+            op_column_fused:
+#endif
                 
                 u.ao.p1 = pOp->p1;
                 u.ao.p2 = pOp->p2;
@@ -2825,12 +3324,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 assert( u.ao.p2<u.ao.nField );
                 
                 /* Read and parse the table header.  Store the results of the parse
-                 ** into the record header cache fields of the cursor.
+                 ** into the record header cache fields of the cursor.  The header is
+                 ** decoded lazily: only as far as column u.ao.p2, and a later OP_Column
+                 ** on the same row resumes the decode from where this one stopped.
                  */
                 u.ao.aType = u.ao.pC->aType;
-                if( u.ao.pC->cacheStatus==p->cacheCtr ){
-                    u.ao.aOffset = u.ao.pC->aOffset;
-                }else{
+                u.ao.aOffset = u.ao.pC->aOffset;
+                u.ao.zData = 0;
+                if( u.ao.pC->cacheStatus!=p->cacheCtr ){
                     assert(u.ao.aType);
                     u.ao.avail = 0;
                     u.ao.pC->aOffset = u.ao.aOffset = &u.ao.aType[u.ao.nField];
@@ -2873,18 +3374,29 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                      ** 3-byte type for each of the maximum of 32768 columns plus three
                      ** extra bytes for the header length itself.  32768*3 + 3 = 98307.
                      */
-                    if( u.ao.offset > 98307 ){
+                    if( u.ao.offset > 98307 || u.ao.offset > u.ao.payloadSize ){
                         rc = SQLITE_CORRUPT_BKPT;
+                        u.ao.pC->cacheStatus = CACHE_STALE;
                         goto op_column_out;
                     }
-                    
+                    u.ao.pC->szHdr = u.ao.offset;
+                    u.ao.pC->iHdrOffset = (u32)u.ao.szHdr;
+                    u.ao.pC->nHdrParsed = 0;
+                    u.ao.aOffset[0] = u.ao.offset;
+                }
+                
+                /* If column u.ao.p2 has not been decoded yet, continue decoding the
+                 ** header from the point where the previous OP_Column on this row
+                 ** stopped.
+                 */
+                if( u.ao.p2>=u.ao.pC->nHdrParsed ){
                     /* Compute in u.ao.len the number of bytes of data we need to read in order
-                     ** to get u.ao.nField type values.  u.ao.offset is an upper bound on this.  But
+                     ** to get u.ao.nField type values.  u.ao.pC->szHdr is an upper bound on this.  But
                      ** u.ao.nField might be significantly less than the true number of columns
-                     ** in the table, and in that case, 5*u.ao.nField+3 might be smaller than u.ao.offset.
+                     ** in the table, and in that case, 5*u.ao.nField+3 might be smaller than u.ao.pC->szHdr.
                      ** We want to minimize u.ao.len in order to limit the size of the memory
-                     ** allocation, especially if a corrupt database file has caused u.ao.offset
-                     ** to be oversized. Offset is limited to 98307 above.  But 98307 might
+                     ** allocation, especially if a corrupt database file has caused the header
+                     ** size to be oversized. It is limited to 98307 above.  But 98307 might
                      ** still exceed Robson memory allocation limits on some configurations.
                      ** On systems that cannot tolerate large memory allocations, u.ao.nField*5+3
                      ** will likely be much smaller since u.ao.nField will likely be less than
@@ -2892,55 +3404,60 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                      ** not exceeded even for corrupt database files.
                      */
                     u.ao.len = u.ao.nField*5 + 3;
-                    if( u.ao.len > (int)u.ao.offset ) u.ao.len = (int)u.ao.offset;
+                    if( u.ao.len > (int)u.ao.pC->szHdr ) u.ao.len = (int)u.ao.pC->szHdr;
                     
-                    /* The KeyFetch() or DataFetch() above are fast and will get the entire
+                    /* The KeyFetch() or DataFetch() calls are fast and will get the entire
                      ** record header in most cases.  But they will fail to get the complete
                      ** record header if the record header does not fit on a single page
                      ** in the B-Tree.  When that happens, use sqlite3VdbeMemFromBtree() to
                      ** acquire the complete header text.
                      */
-                    if( !u.ao.zRec && u.ao.avail<u.ao.len ){
-                        u.ao.sMem.flags = 0;
-                        u.ao.sMem.db = 0;
-                        rc = sqlite3VdbeMemFromBtree(u.ao.pCrsr, 0, u.ao.len, u.ao.pC->isIndex, &u.ao.sMem);
-                        if( rc!=SQLITE_OK ){
-                            goto op_column_out;
+                    if( u.ao.zRec ){
+                        u.ao.zData = u.ao.zRec;
+                    }else{
+                        if( u.ao.zData==0 ){
+                            if( u.ao.pC->isIndex ){
+                                u.ao.zData = (char*)sqlite3BtreeKeyFetch(u.ao.pCrsr, &u.ao.avail);
+                            }else{
+                                u.ao.zData = (char*)sqlite3BtreeDataFetch(u.ao.pCrsr, &u.ao.avail);
+                            }
+                        }
+                        if( u.ao.avail<u.ao.len ){
+                            u.ao.sMem.flags = 0;
+                            u.ao.sMem.db = 0;
+                            rc = sqlite3VdbeMemFromBtree(u.ao.pCrsr, 0, u.ao.len, u.ao.pC->isIndex, &u.ao.sMem);
+                            if( rc!=SQLITE_OK ){
+                                u.ao.pC->cacheStatus = CACHE_STALE;
+                                goto op_column_out;
+                            }
+                            u.ao.zData = u.ao.sMem.z;
                         }
-                        u.ao.zData = u.ao.sMem.z;
                     }
                     u.ao.zEndHdr = (u8 *)&u.ao.zData[u.ao.len];
-                    u.ao.zIdx = (u8 *)&u.ao.zData[u.ao.szHdr];
+                    u.ao.zIdx = (u8 *)&u.ao.zData[u.ao.pC->iHdrOffset];
+                    u.ao.i = u.ao.pC->nHdrParsed;
+                    u.ao.offset = u.ao.aOffset[u.ao.i];
                     
                     /* Scan the header and use it to fill in the u.ao.aType[] and u.ao.aOffset[]
-                     ** arrays.  u.ao.aType[u.ao.i] will contain the type integer for the u.ao.i-th
-                     ** column and u.ao.aOffset[u.ao.i] will contain the u.ao.offset from the beginning
-                     ** of the record to the start of the data for the u.ao.i-th column
+                     ** arrays up to and including column u.ao.p2.  u.ao.aType[u.ao.i] will contain
+                     ** the type integer for the u.ao.i-th column and u.ao.aOffset[u.ao.i] will contain
+                     ** the u.ao.offset from the beginning of the record to the start of the data
+                     ** for the u.ao.i-th column
                      */
-                    for(u.ao.i=0; u.ao.i<u.ao.nField; u.ao.i++){
-                        if( u.ao.zIdx<u.ao.zEndHdr ){
-                            u.ao.aOffset[u.ao.i] = u.ao.offset;
-                            if( u.ao.zIdx[0]<0x80 ){
-                                u.ao.t = u.ao.zIdx[0];
-                                u.ao.zIdx++;
-                            }else{
-                                u.ao.zIdx += sqlite3GetVarint32(u.ao.zIdx, &u.ao.t);
-                            }
-                            u.ao.aType[u.ao.i] = u.ao.t;
-                            u.ao.szField = sqlite3VdbeSerialTypeLen(u.ao.t);
-                            u.ao.offset += u.ao.szField;
-                            if( u.ao.offset<u.ao.szField ){  /* True if u.ao.offset overflows */
-                                u.ao.zIdx = &u.ao.zEndHdr[1];  /* Forces SQLITE_CORRUPT return below */
-                                break;
-                            }
+                    for(; u.ao.i<=u.ao.p2 && u.ao.zIdx<u.ao.zEndHdr; u.ao.i++){
+                        u.ao.aOffset[u.ao.i] = u.ao.offset;
+                        if( u.ao.zIdx[0]<0x80 ){
+                            u.ao.t = u.ao.zIdx[0];
+                            u.ao.zIdx++;
                         }else{
-                            /* If u.ao.i is less that u.ao.nField, then there are fewer fields in this
-                             ** record than SetNumColumns indicated there are columns in the
-                             ** table. Set the u.ao.offset for any extra columns not present in
-                             ** the record to 0. This tells code below to store the default value
-                             ** for the column instead of deserializing a value from the record.
-                             */
-                            u.ao.aOffset[u.ao.i] = 0;
+                            u.ao.zIdx += sqlite3GetVarint32(u.ao.zIdx, &u.ao.t);
+                        }
+                        u.ao.aType[u.ao.i] = u.ao.t;
+                        u.ao.szField = sqlite3VdbeSerialTypeLen(u.ao.t);
+                        u.ao.offset += u.ao.szField;
+                        if( u.ao.offset<u.ao.szField ){  /* True if u.ao.offset overflows */
+                            u.ao.zIdx = &u.ao.zEndHdr[1];  /* Forces SQLITE_CORRUPT return below */
+                            break;
                         }
                     }
                     sqlite3VdbeMemRelease(&u.ao.sMem);
@@ -2955,8 +3472,22 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     if( (u.ao.zIdx > u.ao.zEndHdr) || (u.ao.offset > u.ao.payloadSize)
                        || (u.ao.zIdx==u.ao.zEndHdr && u.ao.offset!=u.ao.payloadSize) ){
                         rc = SQLITE_CORRUPT_BKPT;
+                        u.ao.pC->cacheStatus = CACHE_STALE;
                         goto op_column_out;
                     }
+                    
+                    /* If the header ran out before column u.ao.p2 was reached, there are fewer
+                     ** fields in this record than SetNumColumns indicated there are columns
+                     ** in the table. Set the u.ao.offset for any extra columns not present in
+                     ** the record to 0. This tells code below to store the default value
+                     ** for the column instead of deserializing a value from the record.
+                     */
+                    if( u.ao.zIdx==u.ao.zEndHdr ){
+                        while( u.ao.i<u.ao.nField ) u.ao.aOffset[u.ao.i++] = 0;
+                    }
+                    u.ao.aOffset[u.ao.i] = u.ao.offset;
+                    u.ao.pC->nHdrParsed = u.ao.i;
+                    u.ao.pC->iHdrOffset = (u32)((u8*)u.ao.zIdx - (u8*)u.ao.zData);
                 }
                 
                 /* Get the column information. If u.ao.aOffset[u.ao.p2] is non-zero, then
@@ -3019,12 +3550,57 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     u.ao.pDest->zMalloc = u.ao.sMem.zMalloc;
                 }
                 
+#ifndef SQLITE_OMIT_ZEROCOPY
+                /* If zero-copy access is enabled and this value points into a
+                 ** b-tree page, it does not need to be copied if it goes straight
+                 ** into a result row.  OP_Column cannot jump, so if only OP_Column
+                 ** instructions lie between this one and an OP_ResultRow, that
+                 ** OP_ResultRow is certain to run next.  The result column is
+                 ** recorded in Vdbe.mBorrow so that OP_ResultRow leaves it alone. */
+                if( p->bZeroCopy && (u.ao.pDest->flags & MEM_Ephem)!=0 ){
+                    Op *pRes = pOp+1;
+                    int iRes;
+                    while( pRes->opcode==OP_Column ) pRes++;
+                    iRes = pOp->p3 - pRes->p1;
+                    if( pRes->opcode==OP_ResultRow
+                       && iRes>=0 && iRes<pRes->p2 && iRes<64
+                       ){
+                        p->mBorrow |= ((u64)1)<<iRes;
+                        goto op_column_out;
+                    }
+                }
+#endif
                 rc = sqlite3VdbeMemMakeWriteable(u.ao.pDest);
                 
             op_column_out:
                 UPDATE_MAX_BLOBSIZE(u.ao.pDest);
                 REGISTER_TRACE(pOp->p3, u.ao.pDest);
-                break;
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+                /* If the peephole pass in vdbeaux.c found that the next instruction
+                 ** can be fused with this one, run it now without going back to the
+                 ** top of the loop.  The opcode profiler still counts each execution
+                 ** of the fused instruction, but charges its cycles to this one.  */
+                if( (pOp->opflags & OPFLG_FUSED)!=0 && rc==SQLITE_OK
+#ifdef SQLITE_DEBUG
+                   && p->trace==0
+#endif
+                   ){
+                    pc++;
+                    pOp++;
+                    nVmStep++;
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+                    if( pOpStat ) p->aOpStat[pc].nExec++;
+#endif
+#ifdef SQLITE_DEBUG
+                    if( pOp->opflags & OPFLG_OUT3 ) memAboutToChange(p, &aMem[pOp->p3]);
+#endif
+                    if( pOp->opcode==OP_Column ) goto op_column_fused;
+                    if( pOp->opcode==OP_MakeRecord ) goto op_makerecord_fused;
+                    assert( pOp->opcode>=OP_Ne && pOp->opcode<=OP_Ge );
+                    goto op_compare_fused;
+                }
+#endif
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Affinity P1 P2 * P4 *
@@ -3035,6 +3611,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** string indicates the column affinity that should be used for the nth
                  ** memory cell in the range.
                  */
+            VDBE_OPLABEL(OP_Affinity)
             case OP_Affinity: {
 #if 0  /* local variables moved into u.ap */
                 const char *zAffinity;   /* The affinity to be applied */
@@ -3052,7 +3629,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     applyAffinity(pIn1, u.ap.cAff, encoding);
                     pIn1++;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: MakeRecord P1 P2 P3 P4 *
@@ -3070,6 +3647,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** If P4 is NULL then all index fields have the affinity NONE.
                  */
+            VDBE_OPLABEL(OP_MakeRecord)
             case OP_MakeRecord: {
 #if 0  /* local variables moved into u.aq */
                 u8 *zNewRecord;        /* A buffer to hold the data for the new record */
@@ -3089,6 +3667,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 int len;               /* Length of a field */
 #endif /* local variables moved into u.aq */
                 
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+            op_makerecord_fused:
+#endif
                 /* Assuming the record contains N fields, the record format looks
                  ** like this:
                  **
@@ -3186,7 +3767,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pOut->enc = SQLITE_UTF8;  /* In case the blob is ever converted to text */
                 REGISTER_TRACE(pOp->p3, pOut);
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Count P1 P2 * * *
@@ -3195,6 +3776,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** opened by cursor P1 in register P2
                  */
 #ifndef SQLITE_OMIT_BTREECOUNT
+            VDBE_OPLABEL(OP_Count)
             case OP_Count: {         /* out2-prerelease */
 #if 0  /* local variables moved into u.ar */
                 i64 nEntry;
@@ -3208,7 +3790,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     u.ar.nEntry = 0;
                 }
                 pOut->u.i = u.ar.nEntry;
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -3218,6 +3800,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** on the value of P1. To open a new savepoint, P1==0. To release (commit) an
                  ** existing savepoint, P1==1, or to rollback an existing savepoint P1==2.
                  */
+            VDBE_OPLABEL(OP_Savepoint)
             case OP_Savepoint: {
 #if 0  /* local variables moved into u.as */
                 int p1;                         /* Value of P1 operand */
@@ -3381,7 +3964,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     }
                 }
                 
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: AutoCommit P1 P2 * * *
@@ -3393,6 +3976,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** This instruction causes the VM to halt.
                  */
+            VDBE_OPLABEL(OP_AutoCommit)
             case OP_AutoCommit: {
 #if 0  /* local variables moved into u.at */
                 int desiredAutoCommit;
@@ -3458,7 +4042,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         
                         rc = SQLITE_ERROR;
                     }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Transaction P1 P2 * * *
@@ -3492,6 +4076,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** If P2 is zero, then a read-lock is obtained on the database file.
                  */
+            VDBE_OPLABEL(OP_Transaction)
             case OP_Transaction: {
 #if 0  /* local variables moved into u.au */
                 Btree *pBt;
@@ -3518,8 +4103,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         goto abort_due_to_error;
                     }
                     
+                    /* A batch run by sqlite3_step_batch() always uses statement
+                     ** transactions, so that a failed row can be undone alone. */
                     if( pOp->p2 && p->usesStmtJournal
-                       && (db->autoCommit==0 || db->nVdbeRead>1)
+                       && (db->autoCommit==0 || db->nVdbeRead>1
+                           || sqlite3VdbeBatchRunning(p))
                        ){
                         assert( sqlite3BtreeIsInTrans(u.au.pBt) );
                         if( p->iStatement==0 ){
@@ -3540,7 +4128,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         p->nStmtDefImmCons = db->nDeferredImmCons;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: ReadCookie P1 P2 P3 * *
@@ -3555,6 +4143,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** must be started or there must be an open cursor) before
                  ** executing this instruction.
                  */
+            VDBE_OPLABEL(OP_ReadCookie)
             case OP_ReadCookie: {               /* out2-prerelease */
 #if 0  /* local variables moved into u.av */
                 int iMeta;
@@ -3572,7 +4161,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 
                 sqlite3BtreeGetMeta(db->aDb[u.av.iDb].pBt, u.av.iCookie, (u32 *)&u.av.iMeta);
                 pOut->u.i = u.av.iMeta;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: SetCookie P1 P2 P3 * *
@@ -3585,6 +4174,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A transaction must be started before executing this opcode.
                  */
+            VDBE_OPLABEL(OP_SetCookie)
             case OP_SetCookie: {       /* in3 */
 #if 0  /* local variables moved into u.aw */
                 Db *pDb;
@@ -3614,7 +4204,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     sqlite3ExpirePreparedStatements(db);
                     p->expired = 0;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: VerifyCookie P1 P2 P3 * *
@@ -3635,6 +4225,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** to be executed (to establish a read lock) before this opcode is
                  ** invoked.
                  */
+            VDBE_OPLABEL(OP_VerifyCookie)
             case OP_VerifyCookie: {
 #if 0  /* local variables moved into u.ax */
                 int iMeta;
@@ -3676,7 +4267,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     p->expired = 1;
                     rc = SQLITE_SCHEMA;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: OpenRead P1 P2 P3 P4 P5
@@ -3728,7 +4319,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also OpenRead.
                  */
+            VDBE_OPLABEL(OP_OpenRead)
             case OP_OpenRead:
+            VDBE_OPLABEL(OP_OpenWrite)
             case OP_OpenWrite: {
 #if 0  /* local variables moved into u.ay */
                 int nField;
@@ -3813,7 +4406,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** since moved into the btree layer.  */
                 u.ay.pCur->isTable = pOp->p4type!=P4_KEYINFO;
                 u.ay.pCur->isIndex = !u.ay.pCur->isTable;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: OpenEphemeral P1 P2 * P4 P5
@@ -3846,7 +4439,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** by this opcode will be used for automatically created transient
                  ** indices in joins.
                  */
+            VDBE_OPLABEL(OP_OpenAutoindex)
             case OP_OpenAutoindex:
+            VDBE_OPLABEL(OP_OpenEphemeral)
             case OP_OpenEphemeral: {
 #if 0  /* local variables moved into u.az */
                 VdbeCursor *pCx;
@@ -3892,7 +4487,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 u.az.pCx->isOrdered = (pOp->p5!=BTREE_UNORDERED);
                 u.az.pCx->isIndex = !u.az.pCx->isTable;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: SorterOpen P1 P2 * P4 *
@@ -3901,6 +4496,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** a transient index that is specifically designed to sort large
                  ** tables using an external merge-sort algorithm.
                  */
+            VDBE_OPLABEL(OP_SorterOpen)
             case OP_SorterOpen: {
 #if 0  /* local variables moved into u.ba */
                 VdbeCursor *pCx;
@@ -3912,7 +4508,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.ba.pCx->pKeyInfo->enc = ENC(p->db);
                 u.ba.pCx->isSorter = 1;
                 rc = sqlite3VdbeSorterInit(db, u.ba.pCx);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: OpenPseudo P1 P2 P3 * P5
@@ -3931,6 +4527,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P3 is the number of fields in the records that will be stored by
                  ** the pseudo-table.
                  */
+            VDBE_OPLABEL(OP_OpenPseudo)
             case OP_OpenPseudo: {
 #if 0  /* local variables moved into u.bb */
                 VdbeCursor *pCx;
@@ -3944,7 +4541,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.bb.pCx->isTable = 1;
                 u.bb.pCx->isIndex = 0;
                 u.bb.pCx->multiPseudo = pOp->p5;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Close P1 * * * *
@@ -3952,11 +4549,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** Close a cursor previously opened as P1.  If P1 is not
                  ** currently open, this instruction is a no-op.
                  */
+            VDBE_OPLABEL(OP_Close)
             case OP_Close: {
                 assert( pOp->p1>=0 && pOp->p1<p->nCursor );
                 sqlite3VdbeFreeCursor(p, p->apCsr[pOp->p1]);
                 p->apCsr[pOp->p1] = 0;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: SeekGe P1 P2 P3 P4 *
@@ -4011,9 +4609,13 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Found, NotFound, Distinct, SeekGt, SeekGe, SeekLt
                  */
+            VDBE_OPLABEL(OP_SeekLt)
             case OP_SeekLt:         /* jump, in3 */
+            VDBE_OPLABEL(OP_SeekLe)
             case OP_SeekLe:         /* jump, in3 */
+            VDBE_OPLABEL(OP_SeekGe)
             case OP_SeekGe:         /* jump, in3 */
+            VDBE_OPLABEL(OP_SeekGt)
             case OP_SeekGt: {       /* jump, in3 */
 #if 0  /* local variables moved into u.bc */
                 int res;
@@ -4162,7 +4764,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                      */
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Seek P1 P2 * * *
@@ -4174,6 +4776,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the cursor is used to read a record.  That way, if no reads
                  ** occur, no unnecessary I/O happens.
                  */
+            VDBE_OPLABEL(OP_Seek)
             case OP_Seek: {    /* in2 */
 #if 0  /* local variables moved into u.bd */
                 VdbeCursor *pC;
@@ -4190,7 +4793,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     u.bd.pC->rowidIsValid = 0;
                     u.bd.pC->deferredMoveto = 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -4218,7 +4821,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Found, NotExists, IsUnique
                  */
+            VDBE_OPLABEL(OP_NotFound)
             case OP_NotFound:       /* jump, in3 */
+            VDBE_OPLABEL(OP_Found)
             case OP_Found: {        /* jump, in3 */
 #if 0  /* local variables moved into u.be */
                 int alreadyExists;
@@ -4278,7 +4883,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     if( !u.be.alreadyExists ) pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IsUnique P1 P2 P3 P4 *
@@ -4307,6 +4912,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: NotFound, NotExists, Found
                  */
+            VDBE_OPLABEL(OP_IsUnique)
             case OP_IsUnique: {        /* jump, in3 */
 #if 0  /* local variables moved into u.bf */
                 u16 ii;
@@ -4367,7 +4973,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         pIn3->u.i = u.bf.r.rowid;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: NotExists P1 P2 P3 * *
@@ -4384,6 +4990,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Found, NotFound, IsUnique
                  */
+            VDBE_OPLABEL(OP_NotExists)
             case OP_NotExists: {        /* jump, in3 */
 #if 0  /* local variables moved into u.bg */
                 VdbeCursor *pC;
@@ -4422,7 +5029,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     assert( u.bg.pC->rowidIsValid==0 );
                     u.bg.pC->seekResult = 0;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Sequence P1 P2 * * *
@@ -4432,11 +5039,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** The sequence number on the cursor is incremented after this
                  ** instruction.
                  */
+            VDBE_OPLABEL(OP_Sequence)
             case OP_Sequence: {           /* out2-prerelease */
                 assert( pOp->p1>=0 && pOp->p1<p->nCursor );
                 assert( p->apCsr[pOp->p1]!=0 );
                 pOut->u.i = p->apCsr[pOp->p1]->seqCount++;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -4454,6 +5062,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** generated record number. This P3 mechanism is used to help implement the
                  ** AUTOINCREMENT feature.
                  */
+            VDBE_OPLABEL(OP_NewRowid)
             case OP_NewRowid: {           /* out2-prerelease */
 #if 0  /* local variables moved into u.bh */
                 i64 v;                 /* The new rowid */
@@ -4588,7 +5197,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     u.bh.pC->cacheStatus = CACHE_STALE;
                 }
                 pOut->u.i = u.bh.v;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Insert P1 P2 P3 P4 P5
@@ -4635,7 +5244,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This works exactly like OP_Insert except that the key is the
                  ** integer value P3, not the value of the integer stored in register P3.
                  */
+            VDBE_OPLABEL(OP_Insert)
             case OP_Insert:
+            VDBE_OPLABEL(OP_InsertInt)
             case OP_InsertInt: {
 #if 0  /* local variables moved into u.bi */
                 Mem *pData;       /* MEM cell holding data for the record to be inserted */
@@ -4702,7 +5313,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     db->xUpdateCallback(db->pUpdateArg, u.bi.op, u.bi.zDb, u.bi.zTbl, u.bi.iKey);
                     assert( u.bi.pC->iDb>=0 );
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Delete P1 P2 * P4 *
@@ -4725,6 +5336,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P4 is not NULL then the P1 cursor must have been positioned
                  ** using OP_NotFound prior to invoking this opcode.
                  */
+            VDBE_OPLABEL(OP_Delete)
             case OP_Delete: {
 #if 0  /* local variables moved into u.bj */
                 i64 iKey;
@@ -4769,7 +5381,81 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     assert( u.bj.pC->iDb>=0 );
                 }
                 if( pOp->p2 & OPFLAG_NCHANGE ) p->nChange++;
-                break;
+                VDBE_DISPATCH();
+            }
+                
+                /* Opcode: DeleteRange P1 P2 P3 * P5
+                 **
+                 ** Delete every row of the table open on write cursor P1 whose rowid
+                 ** lies between the integer values in registers P2 and P2+1,
+                 ** inclusive.  The rows are removed directly from the b-tree a leaf
+                 ** or sub-tree at a time rather than by a loop of OP_Delete.
+                 **
+                 ** If the OPFLAG_NCHANGE flag of P5 is set, then the row change count
+                 ** is incremented by the number of rows deleted.  If P3 is greater
+                 ** than zero, then the value stored in register P3 is also
+                 ** incremented by the number of rows deleted.
+                 **
+                 ** If P4 is not NULL, then it is the name of the table that P1 is
+                 ** open on.  In that case, if an update hook is registered, the rows
+                 ** are instead deleted one at a time so that the hook is invoked for
+                 ** each of them.  The cursor is left invalid.
+                 */
+            VDBE_OPLABEL(OP_DeleteRange)
+            case OP_DeleteRange: {
+#if 0  /* local variables moved into u.ct */
+                VdbeCursor *pC;
+                int nChange;
+                i64 iKey;
+                int res;
+#endif /* local variables moved into u.ct */
+                
+                u.ct.nChange = 0;
+                assert( p->readOnly==0 );
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.ct.pC = p->apCsr[pOp->p1];
+                assert( u.ct.pC!=0 );
+                assert( u.ct.pC->pCursor!=0 && u.ct.pC->isTable );
+                assert( pOp->p2>0 && pOp->p2+1<=(p->nMem-p->nCursor) );
+                assert( memIsValid(&aMem[pOp->p2]) && memIsValid(&aMem[pOp->p2+1]) );
+                assert( (aMem[pOp->p2].flags & MEM_Int)!=0 );
+                assert( (aMem[pOp->p2+1].flags & MEM_Int)!=0 );
+                
+                sqlite3BtreeSetCachedRowid(u.ct.pC->pCursor, 0);
+                if( db->xUpdateCallback && pOp->p4.z ){
+                    const char *zDb = db->aDb[u.ct.pC->iDb].zName;
+                    while( 1 ){
+                        rc = sqlite3BtreeMovetoUnpacked(u.ct.pC->pCursor, 0,
+                                                        aMem[pOp->p2].u.i, 0, &u.ct.res
+                                                        );
+                        if( rc || sqlite3BtreeEof(u.ct.pC->pCursor) ) break;
+                        if( u.ct.res<0 ){
+                            rc = sqlite3BtreeNext(u.ct.pC->pCursor, &u.ct.res);
+                            if( rc || u.ct.res ) break;
+                        }
+                        rc = sqlite3BtreeKeySize(u.ct.pC->pCursor, &u.ct.iKey);
+                        if( rc || u.ct.iKey>aMem[pOp->p2+1].u.i ) break;
+                        rc = sqlite3BtreeDelete(u.ct.pC->pCursor);
+                        if( rc ) break;
+                        u.ct.nChange++;
+                        db->xUpdateCallback(db->pUpdateArg, SQLITE_DELETE, zDb, pOp->p4.z,
+                                            u.ct.iKey);
+                    }
+                }else{
+                    rc = sqlite3BtreeDeleteRange(u.ct.pC->pCursor,
+                                                 aMem[pOp->p2].u.i, aMem[pOp->p2+1].u.i, &u.ct.nChange
+                                                 );
+                }
+                u.ct.pC->cacheStatus = CACHE_STALE;
+                u.ct.pC->nullRow = 1;
+                u.ct.pC->rowidIsValid = 0;
+                if( pOp->p5 & OPFLAG_NCHANGE ) p->nChange += u.ct.nChange;
+                if( pOp->p3>0 ){
+                    assert( memIsValid(&aMem[pOp->p3]) );
+                    memAboutToChange(p, &aMem[pOp->p3]);
+                    aMem[pOp->p3].u.i += u.ct.nChange;
+                }
+                VDBE_DISPATCH();
             }
                 /* Opcode: ResetCount * * * * *
                  **
@@ -4778,10 +5464,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** Then the VMs internal change counter resets to 0.
                  ** This is used by trigger programs.
                  */
+            VDBE_OPLABEL(OP_ResetCount)
             case OP_ResetCount: {
                 sqlite3VdbeSetChanges(db, p->nChange);
                 p->nChange = 0;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: SorterCompare P1 P2 P3
@@ -4791,6 +5478,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If, excluding the rowid fields at the end, the two records are a match,
                  ** fall through to the next instruction. Otherwise, jump to instruction P2.
                  */
+            VDBE_OPLABEL(OP_SorterCompare)
             case OP_SorterCompare: {
 #if 0  /* local variables moved into u.bk */
                 VdbeCursor *pC;
@@ -4804,13 +5492,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.bk.res ){
                     pc = pOp->p2-1;
                 }
-                break;
+                VDBE_DISPATCH();
             };
                 
                 /* Opcode: SorterData P1 P2 * * *
                  **
                  ** Write into register P2 the current sorter data for sorter cursor P1.
                  */
+            VDBE_OPLABEL(OP_SorterData)
             case OP_SorterData: {
 #if 0  /* local variables moved into u.bl */
                 VdbeCursor *pC;
@@ -4820,7 +5509,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.bl.pC = p->apCsr[pOp->p1];
                 assert( u.bl.pC->isSorter );
                 rc = sqlite3VdbeSorterRowkey(u.bl.pC, pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: RowData P1 P2 * * *
@@ -4843,7 +5532,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If the P1 cursor must be pointing to a valid row (not a NULL row)
                  ** of a real table, not a pseudo-table.
                  */
+            VDBE_OPLABEL(OP_RowKey)
             case OP_RowKey:
+            VDBE_OPLABEL(OP_RowData)
             case OP_RowData: {
 #if 0  /* local variables moved into u.bm */
                 VdbeCursor *pC;
@@ -4904,7 +5595,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 pOut->enc = SQLITE_UTF8;  /* In case the blob is ever cast to text */
                 UPDATE_MAX_BLOBSIZE(pOut);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Rowid P1 P2 * * *
@@ -4916,6 +5607,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** be a separate OP_VRowid opcode for use with virtual tables, but this
                  ** one opcode now works for both table types.
                  */
+            VDBE_OPLABEL(OP_Rowid)
             case OP_Rowid: {                 /* out2-prerelease */
 #if 0  /* local variables moved into u.bn */
                 VdbeCursor *pC;
@@ -4953,7 +5645,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     }
                 }
                 pOut->u.i = u.bn.v;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: NullRow P1 * * * *
@@ -4962,6 +5654,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** that occur while the cursor is on the null row will always
                  ** write a NULL.
                  */
+            VDBE_OPLABEL(OP_NullRow)
             case OP_NullRow: {
 #if 0  /* local variables moved into u.bo */
                 VdbeCursor *pC;
@@ -4976,7 +5669,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.bo.pC->pCursor ){
                     sqlite3BtreeClearCursor(u.bo.pC->pCursor);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Last P1 P2 * * *
@@ -4987,6 +5680,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P2 is 0 or if the table or index is not empty, fall through
                  ** to the following instruction.
                  */
+            VDBE_OPLABEL(OP_Last)
             case OP_Last: {        /* jump */
 #if 0  /* local variables moved into u.bp */
                 VdbeCursor *pC;
@@ -5009,7 +5703,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( pOp->p2>0 && u.bp.res ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -5025,7 +5719,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** regression tests can determine whether or not the optimizer is
                  ** correctly optimizing out sorts.
                  */
+            VDBE_OPLABEL(OP_SorterSort)
             case OP_SorterSort:    /* jump */
+            VDBE_OPLABEL(OP_Sort)
             case OP_Sort: {        /* jump */
 #ifdef SQLITE_TEST
                 sqlite3_sort_count++;
@@ -5042,6 +5738,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P2 is 0 or if the table or index is not empty, fall through
                  ** to the following instruction.
                  */
+            VDBE_OPLABEL(OP_Rewind)
             case OP_Rewind: {        /* jump */
 #if 0  /* local variables moved into u.bq */
                 VdbeCursor *pC;
@@ -5070,7 +5767,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.bq.res ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Next P1 P2 * P4 P5
@@ -5105,8 +5802,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P5 is positive and the jump is taken, then event counter
                  ** number P5-1 in the prepared statement is incremented.
                  */
+            VDBE_OPLABEL(OP_SorterNext)
             case OP_SorterNext:    /* jump */
+            VDBE_OPLABEL(OP_Prev)
             case OP_Prev:          /* jump */
+            VDBE_OPLABEL(OP_Next)
             case OP_Next: {        /* jump */
 #if 0  /* local variables moved into u.br */
                 VdbeCursor *pC;
@@ -5156,7 +5856,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This instruction only works for indices.  The equivalent instruction
                  ** for tables is OP_Insert.
                  */
+            VDBE_OPLABEL(OP_SorterInsert)
             case OP_SorterInsert:       /* in2 */
+            VDBE_OPLABEL(OP_IdxInsert)
             case OP_IdxInsert: {        /* in2 */
 #if 0  /* local variables moved into u.bs */
                 VdbeCursor *pC;
@@ -5189,7 +5891,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         }
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IdxDelete P1 P2 P3 * *
@@ -5198,6 +5900,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** an unpacked index key. This opcode removes that entry from the 
                  ** index opened by cursor P1.
                  */
+            VDBE_OPLABEL(OP_IdxDelete)
             case OP_IdxDelete: {
 #if 0  /* local variables moved into u.bt */
                 VdbeCursor *pC;
@@ -5227,7 +5930,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     assert( u.bt.pC->deferredMoveto==0 );
                     u.bt.pC->cacheStatus = CACHE_STALE;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IdxRowid P1 P2 * * *
@@ -5238,6 +5941,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Rowid, MakeRecord.
                  */
+            VDBE_OPLABEL(OP_IdxRowid)
             case OP_IdxRowid: {              /* out2-prerelease */
 #if 0  /* local variables moved into u.bu */
                 BtCursor *pCrsr;
@@ -5264,7 +5968,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         pOut->flags = MEM_Int;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IdxGE P1 P2 P3 P4 P5
@@ -5293,7 +5997,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P5 is non-zero then the key value is increased by an epsilon prior 
                  ** to the comparison.  This makes the opcode work like IdxLE.
                  */
+            VDBE_OPLABEL(OP_IdxLT)
             case OP_IdxLT:          /* jump */
+            VDBE_OPLABEL(OP_IdxGE)
             case OP_IdxGE: {        /* jump */
 #if 0  /* local variables moved into u.bv */
                 VdbeCursor *pC;
@@ -5331,7 +6037,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         pc = pOp->p2 - 1 ;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Destroy P1 P2 P3 * *
@@ -5354,6 +6060,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Clear
                  */
+            VDBE_OPLABEL(OP_Destroy)
             case OP_Destroy: {     /* out2-prerelease */
 #if 0  /* local variables moved into u.bw */
                 int iMoved;
@@ -5395,7 +6102,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     }
 #endif
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Clear P1 P2 P3
@@ -5416,6 +6123,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See also: Destroy
                  */
+            VDBE_OPLABEL(OP_Clear)
             case OP_Clear: {
 #if 0  /* local variables moved into u.bx */
                 int nChange;
@@ -5436,7 +6144,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         aMem[pOp->p3].u.i += u.bx.nChange;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: CreateTable P1 P2 * * *
@@ -5461,7 +6169,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** See documentation on OP_CreateTable for additional information.
                  */
+            VDBE_OPLABEL(OP_CreateIndex)
             case OP_CreateIndex:            /* out2-prerelease */
+            VDBE_OPLABEL(OP_CreateTable)
             case OP_CreateTable: {          /* out2-prerelease */
 #if 0  /* local variables moved into u.by */
                 int pgno;
@@ -5483,7 +6193,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 rc = sqlite3BtreeCreateTable(u.by.pDb->pBt, &u.by.pgno, u.by.flags);
                 pOut->u.i = u.by.pgno;
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: ParseSchema P1 * * P4 *
@@ -5494,6 +6204,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This opcode invokes the parser to create a new virtual machine,
                  ** then runs the new virtual machine.  It is thus a re-entrant opcode.
                  */
+            VDBE_OPLABEL(OP_ParseSchema)
             case OP_ParseSchema: {
 #if 0  /* local variables moved into u.bz */
                 int iDb;
@@ -5540,7 +6251,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( rc==SQLITE_NOMEM ){
                     goto no_mem;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
 #if !defined(SQLITE_OMIT_ANALYZE)
@@ -5550,10 +6261,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** of that table into the internal index hash table.  This will cause
                  ** the analysis to be used when preparing all subsequent queries.
                  */
+            VDBE_OPLABEL(OP_LoadAnalysis)
             case OP_LoadAnalysis: {
                 assert( pOp->p1>=0 && pOp->p1<db->nDb );
                 rc = sqlite3AnalysisLoad(db, pOp->p1);
-                break;  
+                VDBE_DISPATCH();  
             }
 #endif /* !defined(SQLITE_OMIT_ANALYZE) */
                 
@@ -5564,9 +6276,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** is dropped in order to keep the internal representation of the
                  ** schema consistent with what is on disk.
                  */
+            VDBE_OPLABEL(OP_DropTable)
             case OP_DropTable: {
                 sqlite3UnlinkAndDeleteTable(db, pOp->p1, pOp->p4.z);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: DropIndex P1 * * P4 *
@@ -5576,9 +6289,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** is dropped in order to keep the internal representation of the
                  ** schema consistent with what is on disk.
                  */
+            VDBE_OPLABEL(OP_DropIndex)
             case OP_DropIndex: {
                 sqlite3UnlinkAndDeleteIndex(db, pOp->p1, pOp->p4.z);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: DropTrigger P1 * * P4 *
@@ -5588,9 +6302,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** is dropped in order to keep the internal representation of the
                  ** schema consistent with what is on disk.
                  */
+            VDBE_OPLABEL(OP_DropTrigger)
             case OP_DropTrigger: {
                 sqlite3UnlinkAndDeleteTrigger(db, pOp->p1, pOp->p4.z);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -5613,8 +6328,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P5 is not zero, the check is done on the auxiliary database
                  ** file, not the main database file.
                  **
+                 ** If parallel scans are enabled with sqlite3_parallel_scan(), the
+                 ** tables may be checked on several threads.  The result is the same.
+                 **
                  ** This opcode is used to implement the integrity_check pragma.
                  */
+            VDBE_OPLABEL(OP_IntegrityCk)
             case OP_IntegrityCk: {
 #if 0  /* local variables moved into u.ca */
                 int nRoot;      /* Number of tables to check.  (Number of root pages.) */
@@ -5623,6 +6342,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 int nErr;       /* Number of errors reported */
                 char *z;        /* Text of the error report */
                 Mem *pnErr;     /* Register keeping track of errors remaining */
+                IntegrityTree **apTree; /* Trees checked by other threads */
 #endif /* local variables moved into u.ca */
                 
                 assert( p->bIsReader );
@@ -5641,8 +6361,16 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.ca.aRoot[u.ca.j] = 0;
                 assert( pOp->p5<db->nDb );
                 assert( (p->btreeMask & (((yDbMask)1)<<pOp->p5))!=0 );
+                u.ca.apTree = 0;
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+                u.ca.apTree = sqlite3VdbeIntegrityParallel(db, pOp->p5, u.ca.aRoot, u.ca.nRoot,
+                                                           (int)u.ca.pnErr->u.i);
+#endif
                 u.ca.z = sqlite3BtreeIntegrityCheck(db->aDb[pOp->p5].pBt, u.ca.aRoot, u.ca.nRoot,
-                                                    (int)u.ca.pnErr->u.i, &u.ca.nErr);
+                                                    (int)u.ca.pnErr->u.i, &u.ca.nErr, u.ca.apTree);
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+                sqlite3VdbeIntegrityFree(db, u.ca.apTree, u.ca.nRoot);
+#endif
                 sqlite3DbFree(db, u.ca.aRoot);
                 u.ca.pnErr->u.i -= u.ca.nErr;
                 sqlite3VdbeMemSetNull(pIn1);
@@ -5655,7 +6383,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 UPDATE_MAX_BLOBSIZE(pIn1);
                 sqlite3VdbeChangeEncoding(pIn1, encoding);
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_INTEGRITY_CHECK */
                 
@@ -5666,6 +6394,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** An assertion fails if P2 is not an integer.
                  */
+            VDBE_OPLABEL(OP_RowSetAdd)
             case OP_RowSetAdd: {       /* in1, in2 */
                 pIn1 = &aMem[pOp->p1];
                 pIn2 = &aMem[pOp->p2];
@@ -5675,7 +6404,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     if( (pIn1->flags & MEM_RowSet)==0 ) goto no_mem;
                 }
                 sqlite3RowSetInsert(pIn1->u.pRowSet, pIn2->u.i);
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: RowSetRead P1 P2 P3 * *
@@ -5684,6 +6413,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** register P3.  Or, if boolean index P1 is initially empty, leave P3
                  ** unchanged and jump to instruction P2.
                  */
+            VDBE_OPLABEL(OP_RowSetRead)
             case OP_RowSetRead: {       /* jump, in1, out3 */
 #if 0  /* local variables moved into u.cb */
                 i64 val;
@@ -5726,6 +6456,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** previously inserted as part of set X (only if it was previously
                  ** inserted as part of some other set).
                  */
+            VDBE_OPLABEL(OP_RowSetTest)
             case OP_RowSetTest: {                     /* jump, in1, in3 */
 #if 0  /* local variables moved into u.cc */
                 int iSet;
@@ -5759,7 +6490,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.cc.iSet>=0 ){
                     sqlite3RowSetInsert(pIn1->u.pRowSet, pIn3->u.i);
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 
@@ -5778,6 +6509,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** P4 is a pointer to the VM containing the trigger program.
                  */
+            VDBE_OPLABEL(OP_Program)
             case OP_Program: {        /* jump */
 #if 0  /* local variables moved into u.cd */
                 int nMem;               /* Number of memory registers for sub-program */
@@ -5883,7 +6615,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pc = -1;
                 memset(p->aOnceFlag, 0, p->nOnceFlag);
                 
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: Param P1 P2 * * *
@@ -5898,6 +6630,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the value of the P1 argument to the value of the P1 argument to the
                  ** calling OP_Program instruction.
                  */
+            VDBE_OPLABEL(OP_Param)
             case OP_Param: {           /* out2-prerelease */
 #if 0  /* local variables moved into u.ce */
                 VdbeFrame *pFrame;
@@ -5906,7 +6639,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.ce.pFrame = p->pFrame;
                 u.ce.pIn = &u.ce.pFrame->aMem[pOp->p1 + u.ce.pFrame->aOp[u.ce.pFrame->pc].p1];
                 sqlite3VdbeMemShallowCopy(pOut, u.ce.pIn, MEM_Ephem);
-                break;
+                VDBE_DISPATCH();
             }
                 
 #endif /* #ifndef SQLITE_OMIT_TRIGGER */
@@ -5919,6 +6652,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** (deferred foreign key constraints). Otherwise, if P1 is zero, the 
                  ** statement counter is incremented (immediate foreign key constraints).
                  */
+            VDBE_OPLABEL(OP_FkCounter)
             case OP_FkCounter: {
                 if( db->flags & SQLITE_DeferFKs ){
                     db->nDeferredImmCons += pOp->p2;
@@ -5927,7 +6661,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }else{
                     p->nFkConstraint += pOp->p2;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: FkIfZero P1 P2 * * *
@@ -5941,13 +6675,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** zero, the jump is taken if the statement constraint-counter is zero
                  ** (immediate foreign key constraint violations).
                  */
+            VDBE_OPLABEL(OP_FkIfZero)
             case OP_FkIfZero: {         /* jump */
                 if( pOp->p1 ){
                     if( db->nDeferredCons==0 && db->nDeferredImmCons==0 ) pc = pOp->p2-1;
                 }else{
                     if( p->nFkConstraint==0 && db->nDeferredImmCons==0 ) pc = pOp->p2-1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* #ifndef SQLITE_OMIT_FOREIGN_KEY */
                 
@@ -5962,6 +6697,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This instruction throws an error if the memory cell is not initially
                  ** an integer.
                  */
+            VDBE_OPLABEL(OP_MemMax)
             case OP_MemMax: {        /* in2 */
 #if 0  /* local variables moved into u.cf */
                 Mem *pIn1;
@@ -5980,7 +6716,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( u.cf.pIn1->u.i<pIn2->u.i){
                     u.cf.pIn1->u.i = pIn2->u.i;
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_AUTOINCREMENT */
                 
@@ -5991,13 +6727,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** It is illegal to use this instruction on a register that does
                  ** not contain an integer.  An assertion fault will result if you try.
                  */
+            VDBE_OPLABEL(OP_IfPos)
             case OP_IfPos: {        /* jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 assert( pIn1->flags&MEM_Int );
                 if( pIn1->u.i>0 ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IfNeg P1 P2 * * *
@@ -6007,13 +6744,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** It is illegal to use this instruction on a register that does
                  ** not contain an integer.  An assertion fault will result if you try.
                  */
+            VDBE_OPLABEL(OP_IfNeg)
             case OP_IfNeg: {        /* jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 assert( pIn1->flags&MEM_Int );
                 if( pIn1->u.i<0 ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: IfZero P1 P2 P3 * *
@@ -6024,6 +6762,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** It is illegal to use this instruction on a register that does
                  ** not contain an integer.  An assertion fault will result if you try.
                  */
+            VDBE_OPLABEL(OP_IfZero)
             case OP_IfZero: {        /* jump, in1 */
                 pIn1 = &aMem[pOp->p1];
                 assert( pIn1->flags&MEM_Int );
@@ -6031,7 +6770,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( pIn1->u.i==0 ){
                     pc = pOp->p2 - 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: AggStep * P2 P3 P4 P5
@@ -6044,6 +6783,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** The P5 arguments are taken from register P2 and its
                  ** successors.
                  */
+            VDBE_OPLABEL(OP_AggStep)
             case OP_AggStep: {
 #if 0  /* local variables moved into u.cg */
                 int n;
@@ -6096,7 +6836,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 
                 sqlite3VdbeMemRelease(&u.cg.ctx.s);
                 
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /* Opcode: AggFinal P1 P2 * P4 *
@@ -6111,6 +6851,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 argument is only needed for the degenerate case where
                  ** the step function was not previously called.
                  */
+            VDBE_OPLABEL(OP_AggFinal)
             case OP_AggFinal: {
 #if 0  /* local variables moved into u.ch */
                 Mem *pMem;
@@ -6127,8 +6868,282 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( sqlite3VdbeMemTooBig(u.ch.pMem) ){
                     goto too_big;
                 }
-                break;
+                VDBE_DISPATCH();
+            }
+                
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+                /* Opcode: AggScan P1 * * P4 *
+                 **
+                 ** Scan every row of the table open on read cursor P1 and compute the
+                 ** aggregate functions described by the AggScan structure in P4 over
+                 ** the rows that satisfy all of its comparisons.  The final value of
+                 ** each aggregate is stored in its result register, so no OP_AggStep
+                 ** or OP_AggFinal is needed.  The cursor is left pointing at no row.
+                 **
+                 ** This is used for aggregate queries without a GROUP BY clause on
+                 ** a single table.  See sqlite3VdbeAggScan() for details.
+                 **
+                 ** The scan checks for sqlite3_interrupt() and invokes the progress
+                 ** handler as it goes, counting each row as one instruction.
+                 */
+            VDBE_OPLABEL(OP_AggScan)
+            case OP_AggScan: {
+#if 0  /* local variables moved into u.cu */
+                VdbeCursor *pC;
+#endif /* local variables moved into u.cu */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                assert( pOp->p4type==P4_AGGSCAN );
+                u.cu.pC = p->apCsr[pOp->p1];
+                assert( u.cu.pC!=0 && u.cu.pC->pCursor!=0 );
+                rc = sqlite3VdbeAggScan(p, u.cu.pC, pOp->p4.pAggScan);
+                if( rc==SQLITE_INTERRUPT ){
+                    /* Either sqlite3_interrupt() was called or the progress
+                     ** handler asked for the statement to stop */
+                    if( db->u1.isInterrupted ) goto abort_due_to_interrupt;
+                    goto vdbe_error_halt;
+                }
+                VDBE_DISPATCH();
+            }
+#endif /* SQLITE_OMIT_BATCH_AGGREGATE */
+                
+#if !defined(SQLITE_OMIT_HASH_JOIN) || !defined(SQLITE_OMIT_HASH_AGGREGATE)
+                /* Opcode: HashOpen P1 P2 P3 * *
+                 **
+                 ** Open cursor P1 on a new hash table for keys of P2 values.
+                 **
+                 ** If P3 is zero, the table maps each key to one or more rowids.  It
+                 ** is held in memory, or in a temporary b-tree if it grows larger than
+                 ** the page cache.  Only OP_HashInsert, OP_HashProbe, OP_HashNext and
+                 ** OP_Close may be used with the cursor.
+                 **
+                 ** Otherwise, the table maps each key to a group of P3 aggregate
+                 ** accumulators.  Only OP_HashGroup, OP_HashSort, OP_HashGroupNext
+                 ** and OP_Close may be used with the cursor.
+                 */
+            VDBE_OPLABEL(OP_HashOpen)
+            case OP_HashOpen: {
+#if 0  /* local variables moved into u.cv */
+                VdbeCursor *pCx;
+#endif /* local variables moved into u.cv */
+                
+                assert( pOp->p1>=0 && pOp->p2>0 );
+                u.cv.pCx = allocateCursor(p, pOp->p1, 0, -1, 1);
+                if( u.cv.pCx==0 ) goto no_mem;
+                u.cv.pCx->nullRow = 1;
+                rc = sqlite3VdbeHashOpen(db, u.cv.pCx, pOp->p2, pOp->p3);
+                VDBE_DISPATCH();
+            }
+#endif /* !SQLITE_OMIT_HASH_JOIN || !SQLITE_OMIT_HASH_AGGREGATE */
+                
+#ifndef SQLITE_OMIT_HASH_JOIN
+                /* Opcode: HashInsert P1 P2 * * *
+                 **
+                 ** Insert into the hash table open on cursor P1 an entry whose key is
+                 ** the N values in registers P2 through P2+N-1, where N is the number
+                 ** of key values given to OP_HashOpen, and whose rowid is the integer
+                 ** in register P2+N.  Nothing is inserted if any key value is NULL.
+                 */
+            VDBE_OPLABEL(OP_HashInsert)
+            case OP_HashInsert: {
+#if 0  /* local variables moved into u.cw */
+                VdbeCursor *pC;
+#endif /* local variables moved into u.cw */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.cw.pC = p->apCsr[pOp->p1];
+                assert( u.cw.pC!=0 && u.cw.pC->pHash!=0 );
+                assert( pOp->p2>0 && pOp->p2<=(p->nMem-p->nCursor) );
+                rc = sqlite3VdbeHashInsert(db, u.cw.pC, &aMem[pOp->p2]);
+                VDBE_DISPATCH();
+            }
+                
+                /* Opcode: HashProbe P1 P2 P3 * *
+                 **
+                 ** Look up the key held in the N registers starting at P3 in the hash
+                 ** table open on cursor P1.  If an entry with a matching key may exist,
+                 ** store its rowid in register P3+N and fall through.  Otherwise jump
+                 ** to P2.  A key containing a NULL never matches.
+                 **
+                 ** The rowids returned by this opcode and OP_HashNext are candidates
+                 ** only.  The caller must fetch each row and test the join condition.
+                 */
+                /* Opcode: HashNext P1 P2 P3 * *
+                 **
+                 ** Move to the next entry that may match the key most recently looked
+                 ** up by OP_HashProbe on cursor P1.  If there is one, store its rowid
+                 ** in register P3+N and jump to P2.  Otherwise fall through.
+                 */
+            VDBE_OPLABEL(OP_HashProbe)
+            case OP_HashProbe:        /* jump */
+            VDBE_OPLABEL(OP_HashNext)
+            case OP_HashNext: {       /* jump */
+#if 0  /* local variables moved into u.cx */
+                VdbeCursor *pC;
+                int bFound;
+#endif /* local variables moved into u.cx */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.cx.pC = p->apCsr[pOp->p1];
+                assert( u.cx.pC!=0 && u.cx.pC->pHash!=0 );
+                assert( pOp->p3>0 && pOp->p3<=(p->nMem-p->nCursor) );
+                if( pOp->opcode==OP_HashProbe ){
+                    rc = sqlite3VdbeHashProbe(db, u.cx.pC, &aMem[pOp->p3], &u.cx.bFound);
+                    if( rc==SQLITE_OK && !u.cx.bFound ) pc = pOp->p2 - 1;
+                }else{
+                    rc = sqlite3VdbeHashNext(u.cx.pC, &aMem[pOp->p3], &u.cx.bFound);
+                    if( rc==SQLITE_OK && u.cx.bFound ) pc = pOp->p2 - 1;
+                }
+                VDBE_DISPATCH();
+            }
+#endif /* SQLITE_OMIT_HASH_JOIN */
+                
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+                /* Opcode: HashGroup P1 P2 P3 P4 *
+                 **
+                 ** Find the group for the key held in the N registers starting at P3
+                 ** in the hash aggregation table open on cursor P1, where N is the
+                 ** number of key values given to OP_HashOpen.  Move the accumulators
+                 ** of the group into the M registers starting at P4, where M is the
+                 ** number of accumulators given to OP_HashOpen, after saving those of
+                 ** the group previously loaded.  A new group starts with all of its
+                 ** accumulators set to NULL.
+                 **
+                 ** If the key is not in the table and the table is too large to
+                 ** accept another group, jump to P2.  The P4 registers are then NULL.
+                 ** From then on, every key that is not already in the table jumps to
+                 ** P2, so no group is ever split between the table and the P2 path.
+                 */
+            VDBE_OPLABEL(OP_HashGroup)
+            case OP_HashGroup: {      /* jump */
+#if 0  /* local variables moved into u.cy */
+                VdbeCursor *pC;
+                int bFull;
+#endif /* local variables moved into u.cy */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                assert( pOp->p4type==P4_INT32 );
+                u.cy.pC = p->apCsr[pOp->p1];
+                assert( u.cy.pC!=0 && u.cy.pC->pHash!=0 );
+                assert( pOp->p3>0 && pOp->p3<=(p->nMem-p->nCursor) );
+                assert( pOp->p4.i>0 && pOp->p4.i<=(p->nMem-p->nCursor) );
+                rc = sqlite3VdbeHashGroup(db, u.cy.pC, &aMem[pOp->p3], &aMem[pOp->p4.i],
+                                          &u.cy.bFull);
+                if( rc==SQLITE_OK && u.cy.bFull ) pc = pOp->p2 - 1;
+                VDBE_DISPATCH();
+            }
+                
+                /* Opcode: HashSort P1 P2 P3 * *
+                 **
+                 ** Sort the groups of the hash aggregation table open on cursor P1 into
+                 ** key order and move the accumulators of the first into the registers
+                 ** starting at P3.  If there are no groups, jump to P2.  No more groups
+                 ** may be added to the table after this opcode runs.
+                 */
+                /* Opcode: HashGroupNext P1 P2 P3 * *
+                 **
+                 ** Move the accumulators of the next group of the hash aggregation table
+                 ** open on cursor P1 into the registers starting at P3 and jump to P2.
+                 ** If there are no more groups, fall through.
+                 */
+            VDBE_OPLABEL(OP_HashSort)
+            case OP_HashSort:         /* jump */
+            VDBE_OPLABEL(OP_HashGroupNext)
+            case OP_HashGroupNext: {  /* jump */
+#if 0  /* local variables moved into u.cz */
+                VdbeCursor *pC;
+                int bFound;
+#endif /* local variables moved into u.cz */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.cz.pC = p->apCsr[pOp->p1];
+                assert( u.cz.pC!=0 && u.cz.pC->pHash!=0 );
+                assert( pOp->p3>0 && pOp->p3<=(p->nMem-p->nCursor) );
+                if( pOp->opcode==OP_HashSort ){
+                    rc = sqlite3VdbeHashSort(u.cz.pC, &aMem[pOp->p3], &u.cz.bFound);
+                    if( rc==SQLITE_OK && !u.cz.bFound ) pc = pOp->p2 - 1;
+                }else{
+                    rc = sqlite3VdbeHashGroupNext(u.cz.pC, &aMem[pOp->p3], &u.cz.bFound);
+                    if( rc==SQLITE_OK && u.cz.bFound ) pc = pOp->p2 - 1;
+                }
+                VDBE_DISPATCH();
+            }
+#endif /* SQLITE_OMIT_HASH_AGGREGATE */
+                
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+                /* Opcode: MemoOpen P1 P2 P3 * *
+                 **
+                 ** Open cursor P1 on a new cache of up to P3 results of a correlated
+                 ** subquery, each stored under a key of P2 values.  Only OP_MemoLookup,
+                 ** OP_MemoStore and OP_Close may be used with the cursor.
+                 */
+            VDBE_OPLABEL(OP_MemoOpen)
+            case OP_MemoOpen: {
+#if 0  /* local variables moved into u.da */
+                VdbeCursor *pCx;
+#endif /* local variables moved into u.da */
+                
+                assert( pOp->p1>=0 && pOp->p2>0 );
+                u.da.pCx = allocateCursor(p, pOp->p1, 0, -1, 0);
+                if( u.da.pCx==0 ) goto no_mem;
+                u.da.pCx->nullRow = 1;
+                rc = sqlite3VdbeMemoOpen(db, u.da.pCx, pOp->p2, pOp->p3);
+                VDBE_DISPATCH();
+            }
+                
+                /* Opcode: MemoLookup P1 P2 P3 * *
+                 **
+                 ** Look up the key held in the N registers starting at P3 in the result
+                 ** cache open on cursor P1, where N is the number of key values given
+                 ** to OP_MemoOpen.  If a result is stored under that key, copy it into
+                 ** register P3+N and jump to P2.  Otherwise fall through.
+                 **
+                 ** In a statement that writes to the database the result of a subquery
+                 ** may change while the statement runs, so there this opcode always
+                 ** falls through.
+                 */
+            VDBE_OPLABEL(OP_MemoLookup)
+            case OP_MemoLookup: {  /* jump */
+#if 0  /* local variables moved into u.db */
+                VdbeCursor *pC;
+                int bFound;
+#endif /* local variables moved into u.db */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.db.pC = p->apCsr[pOp->p1];
+                assert( u.db.pC!=0 && u.db.pC->pMemo!=0 );
+                assert( pOp->p3>0 && pOp->p3<=(p->nMem-p->nCursor) );
+                if( p->readOnly ){
+                    rc = sqlite3VdbeMemoLookup(u.db.pC, &aMem[pOp->p3], &u.db.bFound);
+                    if( rc==SQLITE_OK && u.db.bFound ) pc = pOp->p2 - 1;
+                }
+                VDBE_DISPATCH();
+            }
+                
+                /* Opcode: MemoStore P1 * P3 * *
+                 **
+                 ** Store the subquery result held in register P3+N in the result cache
+                 ** open on cursor P1, under the key held in the N registers starting
+                 ** at P3.  If the cache is full, the least recently used result is
+                 ** discarded.  This is a no-op in a statement that writes to the
+                 ** database.
+                 */
+            VDBE_OPLABEL(OP_MemoStore)
+            case OP_MemoStore: {
+#if 0  /* local variables moved into u.dc */
+                VdbeCursor *pC;
+#endif /* local variables moved into u.dc */
+                
+                assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+                u.dc.pC = p->apCsr[pOp->p1];
+                assert( u.dc.pC!=0 && u.dc.pC->pMemo!=0 );
+                assert( pOp->p3>0 && pOp->p3<=(p->nMem-p->nCursor) );
+                if( p->readOnly ){
+                    rc = sqlite3VdbeMemoStore(db, u.dc.pC, &aMem[pOp->p3]);
+                }
+                VDBE_DISPATCH();
             }
+#endif /* SQLITE_OMIT_SUBQUERY_CACHE */
                 
 #ifndef SQLITE_OMIT_WAL
                 /* Opcode: Checkpoint P1 P2 P3 * *
@@ -6142,6 +7157,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** completes into mem[P3+2].  However on an error, mem[P3+1] and
                  ** mem[P3+2] are initialized to -1.
                  */
+            VDBE_OPLABEL(OP_Checkpoint)
             case OP_Checkpoint: {
 #if 0  /* local variables moved into u.ci */
                 int i;                          /* Loop counter */
@@ -6164,7 +7180,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 for(u.ci.i=0, u.ci.pMem = &aMem[pOp->p3]; u.ci.i<3; u.ci.i++, u.ci.pMem++){
                     sqlite3VdbeMemSetInt64(u.ci.pMem, (i64)u.ci.aRes[u.ci.i]);
                 }
-                break;
+                VDBE_DISPATCH();
             };  
 #endif
                 
@@ -6180,6 +7196,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** Write a string containing the final journal-mode to register P2.
                  */
+            VDBE_OPLABEL(OP_JournalMode)
             case OP_JournalMode: {    /* out2-prerelease */
 #if 0  /* local variables moved into u.cj */
                 Btree *pBt;                     /* Btree to change journal mode of */
@@ -6272,7 +7289,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 pOut->n = sqlite3Strlen30(pOut->z);
                 pOut->enc = SQLITE_UTF8;
                 sqlite3VdbeChangeEncoding(pOut, encoding);
-                break;
+                VDBE_DISPATCH();
             };
 #endif /* SQLITE_OMIT_PRAGMA */
                 
@@ -6283,10 +7300,11 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** machines to be created and run.  It may not be called from within
                  ** a transaction.
                  */
+            VDBE_OPLABEL(OP_Vacuum)
             case OP_Vacuum: {
                 assert( p->readOnly==0 );
                 rc = sqlite3RunVacuum(&p->zErrMsg, db);
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6297,6 +7315,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the P1 database. If the vacuum has finished, jump to instruction
                  ** P2. Otherwise, fall through to the next instruction.
                  */
+            VDBE_OPLABEL(OP_IncrVacuum)
             case OP_IncrVacuum: {        /* jump */
 #if 0  /* local variables moved into u.ck */
                 Btree *pBt;
@@ -6311,7 +7330,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     pc = pOp->p2 - 1;
                     rc = SQLITE_OK;
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6324,13 +7343,14 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If P1 is 0, then all SQL statements become expired. If P1 is non-zero,
                  ** then only the currently executing statement is affected. 
                  */
+            VDBE_OPLABEL(OP_Expire)
             case OP_Expire: {
                 if( !pOp->p1 ){
                     sqlite3ExpirePreparedStatements(db);
                 }else{
                     p->expired = 1;
                 }
-                break;
+                VDBE_DISPATCH();
             }
                 
 #ifndef SQLITE_OMIT_SHARED_CACHE
@@ -6348,6 +7368,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 contains a pointer to the name of the table being locked. This is only
                  ** used to generate an error message if the lock cannot be obtained.
                  */
+            VDBE_OPLABEL(OP_TableLock)
             case OP_TableLock: {
                 u8 isWriteLock = (u8)pOp->p3;
                 if( isWriteLock || 0==(db->flags&SQLITE_ReadUncommitted) ){
@@ -6361,7 +7382,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         sqlite3SetString(&p->zErrMsg, db, "database table is locked: %s", z);
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_SHARED_CACHE */
                 
@@ -6375,6 +7396,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** within a callback to a virtual table xSync() method. If it is, the error
                  ** code will be set to SQLITE_LOCKED.
                  */
+            VDBE_OPLABEL(OP_VBegin)
             case OP_VBegin: {
 #if 0  /* local variables moved into u.cl */
                 VTable *pVTab;
@@ -6382,7 +7404,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 u.cl.pVTab = pOp->p4.pVtab;
                 rc = sqlite3VtabBegin(db, u.cl.pVTab);
                 if( u.cl.pVTab ) sqlite3VtabImportErrmsg(p, u.cl.pVTab->pVtab);
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6392,9 +7414,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 is the name of a virtual table in database P1. Call the xCreate method
                  ** for that table.
                  */
+            VDBE_OPLABEL(OP_VCreate)
             case OP_VCreate: {
                 rc = sqlite3VtabCallCreate(db, pOp->p1, pOp->p4.z, &p->zErrMsg);
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6404,11 +7427,12 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P4 is the name of a virtual table in database P1.  Call the xDestroy method
                  ** of that table.
                  */
+            VDBE_OPLABEL(OP_VDestroy)
             case OP_VDestroy: {
                 p->inVtabMethod = 2;
                 rc = sqlite3VtabCallDestroy(db, pOp->p1, pOp->p4.z);
                 p->inVtabMethod = 0;
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6419,6 +7443,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** P1 is a cursor number.  This opcode opens a cursor to the virtual
                  ** table and stores that cursor in P1.
                  */
+            VDBE_OPLABEL(OP_VOpen)
             case OP_VOpen: {
 #if 0  /* local variables moved into u.cm */
                 VdbeCursor *pCur;
@@ -6449,7 +7474,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         u.cm.pModule->xClose(u.cm.pVtabCursor);
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6472,6 +7497,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** A jump is made to P2 if the result set after filtering would be empty.
                  */
+            VDBE_OPLABEL(OP_VFilter)
             case OP_VFilter: {   /* jump */
 #if 0  /* local variables moved into u.cn */
                 int nArg;
@@ -6525,7 +7551,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 }
                 u.cn.pCur->nullRow = 0;
                 
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6536,6 +7562,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** the row of the virtual-table that the 
                  ** P1 cursor is pointing to into register P3.
                  */
+            VDBE_OPLABEL(OP_VColumn)
             case OP_VColumn: {
 #if 0  /* local variables moved into u.co */
                 sqlite3_vtab *pVtab;
@@ -6584,7 +7611,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                 if( sqlite3VdbeMemTooBig(u.co.pDest) ){
                     goto too_big;
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6595,6 +7622,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** jump to instruction P2.  Or, if the virtual table has reached
                  ** the end of its result set, then fall through to the next instruction.
                  */
+            VDBE_OPLABEL(OP_VNext)
             case OP_VNext: {   /* jump */
 #if 0  /* local variables moved into u.cp */
                 sqlite3_vtab *pVtab;
@@ -6642,6 +7670,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This opcode invokes the corresponding xRename method. The value
                  ** in register P1 is passed as the zName argument to the xRename method.
                  */
+            VDBE_OPLABEL(OP_VRename)
             case OP_VRename: {
 #if 0  /* local variables moved into u.cq */
                 sqlite3_vtab *pVtab;
@@ -6664,7 +7693,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     sqlite3VtabImportErrmsg(p, u.cq.pVtab);
                     p->expired = 0;
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6692,6 +7721,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** is successful, then the value returned by sqlite3_last_insert_rowid() 
                  ** is set to the value of the rowid for the row just inserted.
                  */
+            VDBE_OPLABEL(OP_VUpdate)
             case OP_VUpdate: {
 #if 0  /* local variables moved into u.cr */
                 sqlite3_vtab *pVtab;
@@ -6740,7 +7770,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                         p->nChange++;
                     }
                 }
-                break;
+                VDBE_DISPATCH();
             }
 #endif /* SQLITE_OMIT_VIRTUALTABLE */
                 
@@ -6749,9 +7779,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** Write the current number of pages in database P1 to memory cell P2.
                  */
+            VDBE_OPLABEL(OP_Pagecount)
             case OP_Pagecount: {            /* out2-prerelease */
                 pOut->u.i = sqlite3BtreeLastPage(db->aDb[pOp->p1].pBt);
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6765,6 +7796,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  **
                  ** Store the maximum page count after the change in register P2.
                  */
+            VDBE_OPLABEL(OP_MaxPgcnt)
             case OP_MaxPgcnt: {            /* out2-prerelease */
                 unsigned int newMax;
                 Btree *pBt;
@@ -6776,7 +7808,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     if( newMax < (unsigned)pOp->p3 ) newMax = (unsigned)pOp->p3;
                 }
                 pOut->u.i = sqlite3BtreeMaxPageCount(pBt, newMax);
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6787,6 +7819,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** If tracing is enabled (by the sqlite3_trace()) interface, then
                  ** the UTF-8 string contained in P4 is emitted on the trace callback.
                  */
+            VDBE_OPLABEL(OP_Trace)
             case OP_Trace: {
 #if 0  /* local variables moved into u.cs */
                 char *zTrace;
@@ -6808,7 +7841,7 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                     sqlite3DebugPrintf("SQL-trace: %s\n", u.cs.zTrace);
                 }
 #endif /* SQLITE_DEBUG */
-                break;
+                VDBE_DISPATCH();
             }
 #endif
                 
@@ -6824,9 +7857,10 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  ** This opcode records information from the optimizer.  It is the
                  ** the same as a no-op.  This opcodesnever appears in a real VM program.
                  */
+            VDBE_OPLABEL(OP_Noop)
             default: {          /* This is really OP_Noop and OP_Explain */
                 assert( pOp->opcode==OP_Noop || pOp->opcode==OP_Explain );
-                break;
+                VDBE_DISPATCH();
             }
                 
                 /*****************************************************************************
@@ -6837,38 +7871,9 @@ SQLITE_PRIVATE int sqlite3VdbeExec(
                  *****************************************************************************/
         }
         
-#ifdef VDBE_PROFILE
-        {
-            u64 elapsed = sqlite3Hwtime() - start;
-            pOp->cycles += elapsed;
-            pOp->cnt++;
-#if 0
-            fprintf(stdout, "%10llu ", elapsed);
-            sqlite3VdbePrintOp(stdout, origPc, &aOp[origPc]);
-#endif
-        }
-#endif
-        
-        /* The following code adds nothing to the actual functionality
-         ** of the program.  It is only here for testing and debugging.
-         ** On the other hand, it does burn CPU cycles every time through
-         ** the evaluator loop.  So we can leave it out when NDEBUG is defined.
-         */
-#ifndef NDEBUG
-        assert( pc>=-1 && pc<p->nOp );
-        
-#ifdef SQLITE_DEBUG
-        if( p->trace ){
-            if( rc!=0 ) fprintf(p->trace,"rc=%d\n",rc);
-            if( pOp->opflags & (OPFLG_OUT2_PRERELEASE|OPFLG_OUT2) ){
-                registerTrace(p->trace, pOp->p2, &aMem[pOp->p2]);
-            }
-            if( pOp->opflags & OPFLG_OUT3 ){
-                registerTrace(p->trace, pOp->p3, &aMem[pOp->p3]);
-            }
-        }
-#endif  /* SQLITE_DEBUG */
-#endif  /* NDEBUG */
+        /* Only reached when the case did not end with VDBE_DISPATCH(), or
+         ** when compiled without SQLITE_ENABLE_COMPUTED_GOTO.  */
+        VDBE_OP_EPILOGUE
     }  /* The end of the for(;;) loop the loops through opcodes */
     
     /* If we reach this point, it means that execution is finished with
@@ -6891,6 +7896,14 @@ vdbe_error_halt:
      ** release the mutexes on btrees that were acquired at the
      ** top. */
 vdbe_return:
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    /* Account for an instruction that left the loop by jumping here, such
+     ** as OP_ResultRow, OP_Halt or one that failed.  */
+    if( pOpStat ){
+        pOpStat->nExec++;
+        pOpStat->nCycle += vdbeOpClock() - iOpStart;
+    }
+#endif
     db->lastRowid = lastRowid;
     testcase( nVmStep>0 );
     p->aCounter[SQLITE_STMTSTATUS_VM_STEP] += (int)nVmStep;
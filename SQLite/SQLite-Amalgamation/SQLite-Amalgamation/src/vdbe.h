@@ -33,6 +33,7 @@ typedef struct Vdbe Vdbe;
  */
 typedef struct Mem Mem;
 typedef struct SubProgram SubProgram;
+typedef struct AggScan AggScan;
 
 /*
  ** A single instruction of the virtual machine has an opcode
@@ -61,6 +62,7 @@ struct VdbeOp {
         int *ai;               /* Used when p4type is P4_INTARRAY */
         SubProgram *pProgram;  /* Used when p4type is P4_SUBPROGRAM */
         int (*xAdvance)(BtCursor *, int *);
+        AggScan *pAggScan;     /* Used when p4type is P4_AGGSCAN */
     } p4;
 #ifdef SQLITE_DEBUG
     char *zComment;          /* Comment to improve readability */
@@ -72,6 +74,14 @@ struct VdbeOp {
 };
 typedef struct VdbeOp VdbeOp;
 
+/*
+ ** The OPFLG_* bits generated into opcodes.h use only the low seven bits
+ ** of VdbeOp.opflags.  The following bit is set by the peephole pass in
+ ** sqlite3VdbeMakeReady() on an instruction whose successor can be run
+ ** directly, without returning to the top of the interpreter loop.
+ */
+#define OPFLG_FUSED           0x80
+
 
 /*
  ** A sub-routine used to implement a trigger program.
@@ -86,6 +96,46 @@ struct SubProgram {
     SubProgram *pNext;            /* Next sub-program already visited */
 };
 
+/*
+ ** The P4 argument of an OP_AggScan instruction.  It describes a scan of
+ ** every row of a single table that evaluates a set of built-in aggregate
+ ** functions over the rows satisfying a conjunction of comparisons between
+ ** a column and a value held in a register.  The structure and the three
+ ** arrays it points to are obtained from a single sqlite3DbMalloc() call,
+ ** so that it is freed along with the instruction.
+ */
+struct AggScan {
+    int nCol;                     /* Number of entries in aCol[] */
+    int nTerm;                    /* Number of entries in aTerm[] */
+    int nAgg;                     /* Number of entries in aAgg[] */
+    int iRoot;                    /* Root page of the table */
+    struct AggScanCol {           /* Table columns read by the scan */
+        int iColumn;                /* Column number, or -1 for the rowid */
+        u8 bReal;                   /* True if the column has REAL affinity */
+    } *aCol;
+    struct AggScanTerm {          /* WHERE clause terms: aCol[iCol] <op> reg[iReg] */
+        int iCol;                   /* Left-hand operand.  Index into aCol[] */
+        int iReg;                   /* Register holding the right-hand operand */
+        u8 op;                      /* OP_Eq, OP_Ne, OP_Lt, OP_Le, OP_Gt or OP_Ge */
+    } *aTerm;
+    struct AggScanAgg {           /* Aggregate functions to evaluate */
+        int iCol;                   /* Argument.  Index into aCol[], or -1 */
+        int iMem;                   /* Register to store the result in */
+        u8 eKind;                   /* One of the AGGSCAN_* values */
+    } *aAgg;
+};
+
+/*
+ ** Allowed values for AggScan.aAgg[].eKind.  An AGGSCAN_COUNT with no
+ ** argument (iCol<0) is count(*).
+ */
+#define AGGSCAN_COUNT    1        /* count() */
+#define AGGSCAN_SUM      2        /* sum() */
+#define AGGSCAN_TOTAL    3        /* total() */
+#define AGGSCAN_AVG      4        /* avg() */
+#define AGGSCAN_MIN      5        /* min() with a single argument */
+#define AGGSCAN_MAX      6        /* max() with a single argument */
+
 /*
  ** A smaller version of VdbeOp used for the VdbeAddOpList() function because
  ** it takes up less space.
@@ -117,6 +167,7 @@ typedef struct VdbeOpList VdbeOpList;
 #define P4_INTARRAY (-15) /* P4 is a vector of 32-bit integers */
 #define P4_SUBPROGRAM  (-18) /* P4 is a pointer to a SubProgram structure */
 #define P4_ADVANCE  (-19) /* P4 is a pointer to BtreeNext() or BtreePrev() */
+#define P4_AGGSCAN  (-20) /* P4 is a pointer to an AggScan structure */
 
 /* When adding a P4 argument using P4_KEYINFO, a copy of the KeyInfo structure
  ** is made.  That copy is freed when the Vdbe is finalized.  But if the
@@ -174,6 +225,7 @@ SQLITE_PRIVATE int sqlite3VdbeAddOp1(Vdbe*,int,int);
 SQLITE_PRIVATE int sqlite3VdbeAddOp2(Vdbe*,int,int,int);
 SQLITE_PRIVATE int sqlite3VdbeAddOp3(Vdbe*,int,int,int,int);
 SQLITE_PRIVATE int sqlite3VdbeAddOp4(Vdbe*,int,int,int,int,const char *zP4,int);
+SQLITE_PRIVATE int sqlite3VdbeAddOp4Dup8(Vdbe*,int,int,int,int,const u8*,int);
 SQLITE_PRIVATE int sqlite3VdbeAddOp4Int(Vdbe*,int,int,int,int,int);
 SQLITE_PRIVATE int sqlite3VdbeAddOpList(Vdbe*, int nOp, VdbeOpList const *aOp);
 SQLITE_PRIVATE void sqlite3VdbeAddParseSchemaOp(Vdbe*,int,char*);
@@ -216,12 +268,66 @@ SQLITE_PRIVATE   char *sqlite3VdbeExpandSql(Vdbe*, const char*);
 
 SQLITE_PRIVATE void sqlite3VdbeRecordUnpack(KeyInfo*,int,const void*,UnpackedRecord*);
 SQLITE_PRIVATE int sqlite3VdbeRecordCompare(int,const void*,UnpackedRecord*);
+typedef int (*RecordCompare)(int,const void*,UnpackedRecord*);
+#ifndef SQLITE_OMIT_FAST_RECORD_COMPARE
+SQLITE_PRIVATE RecordCompare sqlite3VdbeFindCompare(UnpackedRecord*);
+#else
+# define sqlite3VdbeFindCompare(p) sqlite3VdbeRecordCompare
+#endif
 SQLITE_PRIVATE UnpackedRecord *sqlite3VdbeAllocUnpackedRecord(KeyInfo *, char *, int, char **);
 
 #ifndef SQLITE_OMIT_TRIGGER
 SQLITE_PRIVATE void sqlite3VdbeLinkSubProgram(Vdbe *, SubProgram *);
 #endif
 
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+SQLITE_PRIVATE int sqlite3AggScanKind(FuncDef*);
+#endif
+
+/*
+ ** The subquery result cache is part of the code for subqueries.
+ */
+#if defined(SQLITE_OMIT_SUBQUERY) && !defined(SQLITE_OMIT_SUBQUERY_CACHE)
+# define SQLITE_OMIT_SUBQUERY_CACHE 1
+#endif
+
+/*
+ ** A FuncDef.funcFlags bit for built-in functions whose result may differ
+ ** between calls with the same arguments during a single statement, or
+ ** that have side effects.  The result cache is never used for subqueries
+ ** that call one of them.  Application-defined functions never have it.
+ **
+ ** The other SQLITE_FUNC_* bits, SQLITE_FUNC_ENCMASK (0x003) through
+ ** SQLITE_FUNC_UNLIKELY (0x400), are defined with FuncDef in sqliteInt.h,
+ ** which is not part of this tree.  That is where this definition belongs.
+ ** It is kept here, next to the only code that tests it, with a value
+ ** well clear of theirs.
+ */
+#define SQLITE_FUNC_VOLATILE 0x4000
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+SQLITE_PRIVATE int sqlite3VdbeMemoSize(sqlite3*);
+#endif
+#ifndef SQLITE_OMIT_STMT_CACHE
+SQLITE_PRIVATE Vdbe *sqlite3VdbeCacheLookup(sqlite3*, const char*, int, const char**, u32*);
+SQLITE_PRIVATE void sqlite3VdbeCacheSetKey(Vdbe*, u32);
+SQLITE_PRIVATE void sqlite3VdbeCacheStatus(sqlite3*, int, int, int*, int*);
+#endif
+
+#ifndef SQLITE_OMIT_LAZY_SCHEMA
+SQLITE_PRIVATE int sqlite3LazySchemaEnabled(Schema*);
+SQLITE_PRIVATE void sqlite3LazySchemaEnable(Schema*, int);
+SQLITE_PRIVATE int sqlite3LazySchemaCallback(void*, int, char**, char**);
+SQLITE_PRIVATE Table *sqlite3LazySchemaTable(sqlite3*, int, const char*);
+SQLITE_PRIVATE Index *sqlite3LazySchemaIndex(sqlite3*, int, const char*);
+SQLITE_PRIVATE void sqlite3LazySchemaLoadAll(sqlite3*, int);
+SQLITE_PRIVATE void sqlite3LazySchemaRootPageMoved(Schema*, int, int);
+SQLITE_PRIVATE int sqlite3LazySchemaStat(sqlite3*, const char*, char**);
+SQLITE_PRIVATE void sqlite3AnalysisLoadRow(sqlite3*, int, char**);
+SQLITE_PRIVATE int sqlite3LazySchemaSize(Schema*);
+#else
+# define sqlite3LazySchemaLoadAll(x,y)
+#endif
+
 
 #ifndef NDEBUG
 SQLITE_PRIVATE   void sqlite3VdbeComment(Vdbe*, const char*, ...);
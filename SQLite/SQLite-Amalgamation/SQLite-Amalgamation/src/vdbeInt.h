@@ -42,12 +42,34 @@ typedef unsigned char Bool;
 /* Opaque type used by code in vdbesort.c */
 typedef struct VdbeSorter VdbeSorter;
 
+/* Opaque type used by code in vdbehash.c */
+typedef struct VdbeHash VdbeHash;
+
+/* Opaque type used by code in vdbememo.c */
+typedef struct VdbeMemo VdbeMemo;
+
+/* Opaque type used by code in threads.c */
+typedef struct SQLiteThread SQLiteThread;
+
 /* Opaque type used by the explainer */
 typedef struct Explain Explain;
 
 /* Elements of the linked list at Vdbe.pAuxData */
 typedef struct AuxData AuxData;
 
+/* Elements of the array at Vdbe.aOpStat */
+typedef struct VdbeOpStat VdbeOpStat;
+
+/* Parameter arrays bound by sqlite3_bind_array() */
+typedef struct VdbeBatch VdbeBatch;
+typedef struct VdbeBatchParam VdbeBatchParam;
+
+/* Per-connection state kept by sqlite3VdbeConnData() */
+typedef struct VdbeConnData VdbeConnData;
+
+/* Opaque type used by code in vdbecache.c */
+typedef struct StmtCache StmtCache;
+
 /*
  ** A cursor is a pointer into a single BTree within a database file.
  ** The cursor can seek to a BTree entry with a particular key, or
@@ -82,6 +104,8 @@ struct VdbeCursor {
     i64 movetoTarget;     /* Argument to the deferred sqlite3BtreeMoveto() */
     i64 lastRowid;        /* Last rowid from a Next or NextIdx operation */
     VdbeSorter *pSorter;  /* Sorter object for OP_SorterOpen cursors */
+    VdbeHash *pHash;      /* Hash table for OP_HashOpen cursors */
+    VdbeMemo *pMemo;      /* Result cache for OP_MemoOpen cursors */
     
     /* Result of last sqlite3BtreeMoveto() done by an OP_NotExists or
      ** OP_IsUnique opcode on this cursor. */
@@ -95,12 +119,20 @@ struct VdbeCursor {
      **
      ** aRow might point to (ephemeral) data for the current row, or it might
      ** be NULL.
+     **
+     ** The header is decoded lazily.  Only the first nHdrParsed entries of
+     ** aType[] and aOffset[] are valid, and aOffset[nHdrParsed] is the offset
+     ** of the data for the next field to be decoded.  OP_Column resumes the
+     ** decode at header byte iHdrOffset when it needs a later field.
      */
     u32 cacheStatus;      /* Cache is valid if this matches Vdbe.cacheCtr */
     int payloadSize;      /* Total number of bytes in the record */
     u32 *aType;           /* Type values for all entries in the record */
     u32 *aOffset;         /* Cached offsets to the start of each columns data */
     u8 *aRow;             /* Data for the current row, if all on one page */
+    int nHdrParsed;       /* Number of header fields decoded so far */
+    u32 iHdrOffset;       /* Offset to the next undecoded header byte */
+    u32 szHdr;            /* Size of the record header in bytes */
 };
 typedef struct VdbeCursor VdbeCursor;
 
@@ -249,6 +281,44 @@ struct AuxData {
     AuxData *pNext;                 /* Next element in list */
 };
 
+/*
+ ** When opcode profiling has been enabled for a statement using
+ ** sqlite3_stmt_profile(), Vdbe.aOpStat[] holds one instance of this
+ ** structure for each instruction of the main program.  The clock used
+ ** for nCycle is the CPU cycle counter where one is available and a
+ ** monotonic high-resolution timer otherwise.
+ */
+struct VdbeOpStat {
+    u64 nExec;                      /* Times the instruction was executed */
+    u64 nCycle;                     /* Total clock ticks spent executing it */
+};
+
+/*
+ ** Once sqlite3_bind_array() has been used on a statement, Vdbe.pBatch
+ ** points to an instance of this structure, followed by one VdbeBatchParam
+ ** for each entry of Vdbe.aVar[].
+ **
+ ** While sqlite3_step_batch() is running, nRun is the number of rows in
+ ** the batch and iRow the row currently being executed.  When the program
+ ** halts at the end of a row, sqlite3VdbeBatchNext() finishes that row,
+ ** loads the next set of parameters into Vdbe.aVar[] and restarts the
+ ** program, so that the whole batch runs in one call to sqlite3VdbeExec().
+ */
+struct VdbeBatchParam {
+    int eType;                      /* SQLITE_INTEGER etc, or 0 if not bound */
+    int nRow;                       /* Number of entries in aValue[] */
+    const void *aValue;             /* Array of values */
+    const int *anByte;              /* Sizes or NULL flags, or NULL */
+};
+struct VdbeBatch {
+    int nRun;                       /* Rows in running batch, or 0 */
+    int iRow;                       /* Row currently executing */
+    int *aRowRc;                    /* Per-row result codes, or NULL */
+    int rcFail;                     /* Result code of first failed row */
+    int nChange;                    /* Vdbe.nChange when row iRow started */
+    VdbeBatchParam *aParam;         /* One entry for each Vdbe.aVar[] */
+};
+
 /*
  ** The "context" argument for a installable function.  A pointer to an
  ** instance of this structure is the first argument to the routines used
@@ -343,6 +413,10 @@ struct Vdbe {
     bft bIsReader:1;        /* True for statements that read */
     bft isPrepareV2:1;      /* True if prepared with prepare_v2() */
     bft doingRerun:1;       /* True if rerunning after an auto-reprepare */
+    bft bOpProfile:1;       /* True to collect per-instruction statistics */
+    bft bFetchPending:1;    /* Current row not yet stored by fetch_batch() */
+    bft bZeroCopy:1;        /* Result values may borrow b-tree memory */
+    bft bCached:1;          /* Parked in the statement cache */
     int nChange;            /* Number of db changes made since last reset */
     yDbMask btreeMask;      /* Bitmask of db->aDb[] entries referenced */
     yDbMask lockMask;       /* Subset of btreeMask that requires a lock */
@@ -372,8 +446,47 @@ struct Vdbe {
     int nOnceFlag;          /* Size of array aOnceFlag[] */
     u8 *aOnceFlag;          /* Flags for OP_Once */
     AuxData *pAuxData;      /* Linked list of auxdata allocations */
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    VdbeOpStat *aOpStat;    /* Per-instruction statistics, if bOpProfile */
+#endif
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    VdbeBatch *pBatch;      /* Arrays bound by sqlite3_bind_array() */
+#endif
+#ifndef SQLITE_OMIT_ZEROCOPY
+    u64 mBorrow;            /* Result columns borrowed from b-tree pages */
+#endif
+#ifndef SQLITE_OMIT_STMT_CACHE
+    u32 iCacheHash;         /* Hash of the text this was prepared from */
+    Vdbe *pCacheNext;       /* Next parked statement in the same hash slot */
+    Vdbe *pLruNext;         /* Next statement parked after this one */
+    Vdbe *pLruPrev;         /* Previous statement parked before this one */
+#endif
 };
 
+#if !defined(SQLITE_OMIT_STMT_CACHE) || !defined(SQLITE_OMIT_PARALLEL_SCAN) \
+    || !defined(SQLITE_OMIT_SUBQUERY_CACHE)
+/*
+ ** The state that the optional features implemented by the vdbe*.c files
+ ** keep for a database connection: the settings made through their
+ ** interfaces and any resources they hold on to between statements.  It
+ ** is allocated by the first call to sqlite3VdbeConnData() that asks for
+ ** it and freed when the connection is closed.
+ */
+struct VdbeConnData {
+#ifndef SQLITE_OMIT_STMT_CACHE
+    StmtCache *pStmtCache;  /* Statement cache, if enabled */
+#endif
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    int nScanThread;        /* Threads each OP_AggScan may use */
+    int nScanPool;          /* Number of connections in apScanPool[] */
+    sqlite3 **apScanPool;   /* Idle worker connections for parallel scans */
+#endif
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+    int nMemo;              /* Size of each correlated subquery cache */
+#endif
+};
+#endif
+
 /*
  ** The following are allowed values for Vdbe.magic
  */
@@ -396,6 +509,61 @@ SQLITE_PRIVATE u32 sqlite3VdbeSerialType(Mem*, int);
 SQLITE_PRIVATE u32 sqlite3VdbeSerialPut(unsigned char*, int, Mem*, int);
 SQLITE_PRIVATE u32 sqlite3VdbeSerialGet(const unsigned char*, u32, Mem*);
 SQLITE_PRIVATE void sqlite3VdbeDeleteAuxData(Vdbe*, int, int);
+#if !defined(SQLITE_OMIT_OPCODE_PROFILE) && !defined(SQLITE_OMIT_VIRTUALTABLE)
+SQLITE_PRIVATE int sqlite3VdbeProfileRegister(sqlite3*);
+#endif
+#if !defined(SQLITE_OMIT_STMT_CACHE) || !defined(SQLITE_OMIT_PARALLEL_SCAN) \
+    || !defined(SQLITE_OMIT_SUBQUERY_CACHE)
+SQLITE_PRIVATE VdbeConnData *sqlite3VdbeConnData(sqlite3*, int);
+#endif
+#ifndef SQLITE_OMIT_STMT_CACHE
+SQLITE_PRIVATE int sqlite3VdbeCachePark(Vdbe*, int*);
+SQLITE_PRIVATE void sqlite3VdbeCacheFree(StmtCache*);
+SQLITE_PRIVATE void sqlite3VdbeCacheExpire(sqlite3*);
+#endif
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+SQLITE_PRIVATE int sqlite3VdbeAggScan(Vdbe*, VdbeCursor*, const AggScan*);
+#endif
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+SQLITE_PRIVATE int sqlite3VdbeMemoOpen(sqlite3*, VdbeCursor*, int, int);
+SQLITE_PRIVATE void sqlite3VdbeMemoClose(sqlite3*, VdbeCursor*);
+SQLITE_PRIVATE int sqlite3VdbeMemoLookup(VdbeCursor*, Mem*, int*);
+SQLITE_PRIVATE int sqlite3VdbeMemoStore(sqlite3*, VdbeCursor*, Mem*);
+#else
+# define sqlite3VdbeMemoClose(x,y)
+#endif
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+SQLITE_PRIVATE void sqlite3VdbeScanPoolTrim(VdbeConnData*, int);
+SQLITE_PRIVATE int sqlite3ThreadCreate(SQLiteThread**, void *(*)(void*), void*);
+SQLITE_PRIVATE int sqlite3ThreadJoin(SQLiteThread*, void**);
+# ifndef SQLITE_OMIT_INTEGRITY_CHECK
+SQLITE_PRIVATE IntegrityTree **sqlite3VdbeIntegrityParallel(sqlite3*, int, int*, int, int);
+SQLITE_PRIVATE void sqlite3VdbeIntegrityFree(sqlite3*, IntegrityTree**, int);
+# endif
+#endif
+#if !defined(SQLITE_OMIT_HASH_JOIN) || !defined(SQLITE_OMIT_HASH_AGGREGATE)
+SQLITE_PRIVATE int sqlite3VdbeHashOpen(sqlite3*, VdbeCursor*, int, int);
+SQLITE_PRIVATE void sqlite3VdbeHashClose(sqlite3*, VdbeCursor*);
+#else
+# define sqlite3VdbeHashClose(x,y)
+#endif
+#ifndef SQLITE_OMIT_HASH_JOIN
+SQLITE_PRIVATE int sqlite3VdbeHashInsert(sqlite3*, VdbeCursor*, Mem*);
+SQLITE_PRIVATE int sqlite3VdbeHashProbe(sqlite3*, VdbeCursor*, Mem*, int*);
+SQLITE_PRIVATE int sqlite3VdbeHashNext(VdbeCursor*, Mem*, int*);
+#endif
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+SQLITE_PRIVATE int sqlite3VdbeHashGroup(sqlite3*, VdbeCursor*, Mem*, Mem*, int*);
+SQLITE_PRIVATE int sqlite3VdbeHashSort(VdbeCursor*, Mem*, int*);
+SQLITE_PRIVATE int sqlite3VdbeHashGroupNext(VdbeCursor*, Mem*, int*);
+#endif
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+SQLITE_PRIVATE int sqlite3VdbeBatchLoad(Vdbe*);
+SQLITE_PRIVATE int sqlite3VdbeBatchNext(Vdbe*);
+# define sqlite3VdbeBatchRunning(p) ((p)->pBatch && (p)->pBatch->nRun>0)
+#else
+# define sqlite3VdbeBatchRunning(p) 0
+#endif
 
 int sqlite2BtreeKeyCompare(BtCursor *, const void *, int, int, int *);
 SQLITE_PRIVATE int sqlite3VdbeIdxKeyCompare(VdbeCursor*,UnpackedRecord*,int*);
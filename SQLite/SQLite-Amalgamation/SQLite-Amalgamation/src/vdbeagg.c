@@ -0,0 +1,1292 @@
+/************** Begin file vdbeagg.c *****************************************/
+/*
+ ** 2013 October 28
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file contains the implementation of the OP_AggScan instruction,
+ ** used for aggregate queries of the form:
+ **
+ **     SELECT sum(x), count(*), min(y) FROM t WHERE z > ?
+ **
+ ** Instead of a loop that runs OP_Column and OP_AggStep for each row,
+ ** the rows of the table are decoded a batch at a time into arrays of
+ ** integers and doubles, one array for each column used.  The WHERE
+ ** clause comparisons and the aggregates are then evaluated over each
+ ** batch by short loops over those arrays, written so that a compiler
+ ** can turn most of them into SIMD code.  Rows containing text or blob
+ ** values are rare in the columns of such queries and are handled one
+ ** at a time using the usual Mem routines.
+ **
+ ** The results are identical to those of the sum(), avg() etc. functions
+ ** in func.c.  In particular, floating point sums are still accumulated
+ ** in row order, and an integer overflow is reported by sum() whenever
+ ** a row by row evaluation would have reported one.
+ **
+ ** The exception is a parallel scan, enabled by sqlite3_parallel_scan().
+ ** The table is then divided into ranges of rowids using the keys of its
+ ** upper interior pages.  Each range but the first is scanned by a worker
+ ** thread with a read-only connection of its own, while this thread scans
+ ** the first.  The accumulators of each range are then merged in rowid
+ ** order.  Every aggregate handled here can be merged, but the floating
+ ** point sums are no longer accumulated in row order, and sum() checks
+ ** for integer overflow once per range.  After the scan each worker
+ ** connection ends its read transaction and is kept in a pool with the
+ ** other per-connection state (see sqlite3VdbeConnData()), to be reused
+ ** by the next parallel scan of the same database file.
+ **
+ ** Only queries coded as OP_AggScan are divided: aggregate queries with no
+ ** GROUP BY clause whose WHERE clause, if any, is made of the column and
+ ** constant comparisons that batchAggregate() in select.c accepts.  The
+ ** rows of any other query, including an aggregate query with a GROUP BY
+ ** clause (hashed or not), an aggregate query with any other WHERE clause
+ ** and a query that returns table rows, are processed by the VDBE program
+ ** of the statement, which runs on the thread and connection that steps
+ ** it.  Dividing those would mean running copies of the program on the
+ ** worker connections and merging their output, which for GROUP BY would also
+ ** need a merge operation for each aggregate function.  The accumulators
+ ** of the built-in functions above can be merged by aggScanMerge(), but
+ ** the aggregate function interface has no such operation.
+ **
+ ** Each worker connection reads the database file under its own shared
+ ** lock.  This connection holds a shared lock for as long as the workers
+ ** run, so in rollback journal mode no other connection can commit in the
+ ** meantime and every worker sees the same database as this connection.
+ ** That is not true of a WAL database, of a database in shared cache mode
+ ** or of a database this connection is writing, so those are always
+ ** scanned serially.  A range that a worker cannot start on (for example
+ ** because it cannot obtain its shared lock) is scanned by this thread
+ ** afterwards.
+ **
+ ** PRAGMA integrity_check uses the same threads and pool of worker
+ ** connections, under the same conditions, to check the b-trees of a
+ ** database several at a time (see sqlite3VdbeIntegrityParallel()).
+ */
+
+#include "vdbeInt.h"
+
+#ifndef SQLITE_OMIT_BATCH_AGGREGATE
+
+/*
+ ** Number of rows decoded before the WHERE clause and aggregates are
+ ** evaluated.
+ */
+#define AGGSCAN_BATCH 256
+
+/*
+ ** Types of the values stored in an AggScanValues object.
+ */
+#define AGGSCAN_NULL  0
+#define AGGSCAN_INT   1
+#define AGGSCAN_REAL  2
+
+typedef struct AggScanValues AggScanValues;
+typedef struct AggScanAcc AggScanAcc;
+typedef struct AggScanCtx AggScanCtx;
+
+/*
+ ** The values of one column for the rows of the current batch.  For an
+ ** AGGSCAN_INT row, both aI[] and aR[] hold the value.  For an AGGSCAN_REAL
+ ** row aR[] holds the value and aI[] is zero.  For an AGGSCAN_NULL row
+ ** both are zero.
+ */
+struct AggScanValues {
+    u8 aType[AGGSCAN_BATCH];        /* AGGSCAN_NULL, INT or REAL */
+    i64 aI[AGGSCAN_BATCH];          /* Integer values */
+    double aR[AGGSCAN_BATCH];       /* All non-NULL values, as doubles */
+    u8 bHasReal;                    /* True if any aType[] is AGGSCAN_REAL */
+};
+
+/*
+ ** The running state of one aggregate function.  The n, rSum, iSum,
+ ** overflow and approx fields have the same meanings as the fields of
+ ** the SumCtx object in func.c.
+ */
+struct AggScanAcc {
+    i64 n;                          /* Rows counted, or values summed */
+    double rSum;                    /* Floating point sum */
+    i64 iSum;                       /* Integer sum */
+    u8 overflow;                    /* True if integer overflow seen */
+    u8 approx;                      /* True if a non-integer was summed */
+    Mem best;                       /* Current min() or max() value */
+};
+
+/*
+ ** State of a single OP_AggScan, or of one range of a parallel scan.
+ ** aReg points to the registers of the VM running the OP_AggScan, which
+ ** are only read while the scan runs, including by worker threads.
+ */
+struct AggScanCtx {
+    sqlite3 *db;                    /* Connection that owns the Mem cells */
+    Mem *aReg;                      /* Registers of the VM */
+    const AggScan *pScan;           /* What to compute */
+    u8 enc;                         /* Text encoding of the database */
+    int mxRec;                      /* SQLITE_LIMIT_LENGTH of the VM */
+    volatile int *pInterrupt;       /* Interrupt flag of the VM */
+    int nProgress;                  /* Rows scanned since xProgress was called */
+    BtCursor *pCrsr;                /* Cursor on the table being scanned */
+    int nField;                     /* Entries in aType[] and aOffset[] */
+    u32 *aType;                     /* Serial types of the current row */
+    u32 *aOffset;                   /* Offsets of the fields of the current row */
+    Mem *aVal;                      /* Values of aCol[] for the current row */
+    Mem sRec;                       /* Holds records that overflow the page */
+    Mem sTmp;                       /* Argument passed to aggScanStep() */
+    AggScanAcc *aAcc;               /* One for each pScan->aAgg[] */
+    AggScanValues *aBatch;          /* One for each pScan->aCol[] */
+    u8 aMask[AGGSCAN_BATCH];        /* True for batch rows matching WHERE */
+};
+
+/*
+ ** Return true if a comparison result cmp satisfies comparison op.
+ */
+static int aggScanTest(int op, int cmp){
+    switch( op ){
+        case OP_Eq:  return cmp==0;
+        case OP_Ne:  return cmp!=0;
+        case OP_Lt:  return cmp<0;
+        case OP_Le:  return cmp<=0;
+        case OP_Gt:  return cmp>0;
+        default:     assert( op==OP_Ge );  return cmp>=0;
+    }
+}
+
+/*
+ ** Add value pVal to aggregate accumulator pAcc.  pVal is NULL for the
+ ** count(*) aggregate.  This is the row at a time version of the code in
+ ** aggScanBatch(), and follows the step functions in func.c exactly.
+ */
+static int aggScanStep(AggScanAcc *pAcc, int eKind, Mem *pVal){
+    int type;
+    switch( eKind ){
+        case AGGSCAN_COUNT: {
+            if( pVal==0 || (pVal->flags & MEM_Null)==0 ) pAcc->n++;
+            break;
+        }
+        case AGGSCAN_SUM:
+        case AGGSCAN_TOTAL:
+        case AGGSCAN_AVG: {
+            type = sqlite3_value_numeric_type(pVal);
+            if( type==SQLITE_NULL ) break;
+            pAcc->n++;
+            if( type==SQLITE_INTEGER ){
+                i64 x = sqlite3VdbeIntValue(pVal);
+                pAcc->rSum += x;
+                if( (pAcc->approx|pAcc->overflow)==0 && sqlite3AddInt64(&pAcc->iSum, x) ){
+                    pAcc->overflow = 1;
+                }
+            }else{
+                pAcc->rSum += sqlite3VdbeRealValue(pVal);
+                pAcc->approx = 1;
+            }
+            break;
+        }
+        default: {
+            int cmp;
+            assert( eKind==AGGSCAN_MIN || eKind==AGGSCAN_MAX );
+            if( pVal->flags & MEM_Null ) break;
+            if( pAcc->best.flags & MEM_Null ){
+                return sqlite3VdbeMemCopy(&pAcc->best, pVal);
+            }
+            cmp = sqlite3MemCompare(&pAcc->best, pVal, 0);
+            if( (eKind==AGGSCAN_MAX && cmp<0) || (eKind==AGGSCAN_MIN && cmp>0) ){
+                return sqlite3VdbeMemCopy(&pAcc->best, pVal);
+            }
+            break;
+        }
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Load the value that column pCol has in batch row i into Mem cell pMem.
+ */
+static void aggScanLoad(AggScanValues *pCol, int i, Mem *pMem){
+    switch( pCol->aType[i] ){
+        case AGGSCAN_INT:   sqlite3VdbeMemSetInt64(pMem, pCol->aI[i]);   break;
+        case AGGSCAN_REAL:  sqlite3VdbeMemSetDouble(pMem, pCol->aR[i]);  break;
+        default:            sqlite3VdbeMemSetNull(pMem);                 break;
+    }
+}
+
+/*
+ ** Clear aMask[i] for each of the first n batch rows for which the
+ ** comparison between the column values in pCol and the value in pRhs
+ ** is false.
+ **
+ ** This, like sqlite3MemCompare(), compares two integers as integers
+ ** and an integer and a real as reals.  The loops below contain no
+ ** branches, so that they may be vectorized.
+ */
+static void aggScanFilter(AggScanCtx *p, AggScanValues *pCol, int op, Mem *pRhs, int n){
+    u8 *aMask = p->aMask;
+    const u8 *aType = pCol->aType;
+    const i64 *aI = pCol->aI;
+    const double *aR = pCol->aR;
+    int i;
+    
+    if( pRhs->flags & MEM_Null ){
+        memset(aMask, 0, n);
+    }else if( pRhs->flags & MEM_Int ){
+        i64 iVal = pRhs->u.i;
+        double rVal = (double)iVal;
+#define AGGSCAN_FILTER_INT(CMP) \
+        for(i=0; i<n; i++){ \
+            aMask[i] &= (aType[i]==AGGSCAN_INT) ? (aI[i] CMP iVal) \
+                        : ((aType[i]==AGGSCAN_REAL) & (aR[i] CMP rVal)); \
+        }
+        switch( op ){
+            case OP_Eq:  AGGSCAN_FILTER_INT(==);  break;
+            case OP_Ne:  AGGSCAN_FILTER_INT(!=);  break;
+            case OP_Lt:  AGGSCAN_FILTER_INT(<);   break;
+            case OP_Le:  AGGSCAN_FILTER_INT(<=);  break;
+            case OP_Gt:  AGGSCAN_FILTER_INT(>);   break;
+            default:     AGGSCAN_FILTER_INT(>=);  break;
+        }
+#undef AGGSCAN_FILTER_INT
+    }else if( pRhs->flags & MEM_Real ){
+        double rVal = pRhs->r;
+#define AGGSCAN_FILTER_REAL(CMP) \
+        for(i=0; i<n; i++){ \
+            aMask[i] &= (aType[i]!=AGGSCAN_NULL) & (aR[i] CMP rVal); \
+        }
+        switch( op ){
+            case OP_Eq:  AGGSCAN_FILTER_REAL(==);  break;
+            case OP_Ne:  AGGSCAN_FILTER_REAL(!=);  break;
+            case OP_Lt:  AGGSCAN_FILTER_REAL(<);   break;
+            case OP_Le:  AGGSCAN_FILTER_REAL(<=);  break;
+            case OP_Gt:  AGGSCAN_FILTER_REAL(>);   break;
+            default:     AGGSCAN_FILTER_REAL(>=);  break;
+        }
+#undef AGGSCAN_FILTER_REAL
+    }else{
+        /* The right-hand side is a string or blob.  Every number is less
+         ** than every string or blob, so the result is the same for all
+         ** non-NULL rows. */
+        u8 bPass = (u8)aggScanTest(op, -1);
+        for(i=0; i<n; i++){
+            aMask[i] &= (aType[i]!=AGGSCAN_NULL) & bPass;
+        }
+    }
+}
+
+/*
+ ** Evaluate the WHERE clause and the aggregate functions for the first n
+ ** rows of the current batch.
+ */
+static int aggScanBatch(AggScanCtx *p, int n){
+    const AggScan *pScan = p->pScan;
+    Mem *aMem = p->aReg;
+    u8 *aMask = p->aMask;
+    int i, j;
+    int rc = SQLITE_OK;
+    
+    memset(aMask, 1, n);
+    for(j=0; j<pScan->nTerm; j++){
+        const struct AggScanTerm *pTerm = &pScan->aTerm[j];
+        aggScanFilter(p, &p->aBatch[pTerm->iCol], pTerm->op, &aMem[pTerm->iReg], n);
+    }
+    
+    for(j=0; j<pScan->nAgg && rc==SQLITE_OK; j++){
+        const struct AggScanAgg *pAgg = &pScan->aAgg[j];
+        AggScanAcc *pAcc = &p->aAcc[j];
+        AggScanValues *pCol;
+        const u8 *aType;
+        const i64 *aI;
+        
+        if( pAgg->iCol<0 ){
+            /* count(*) */
+            i64 nRow = 0;
+            for(i=0; i<n; i++) nRow += aMask[i];
+            pAcc->n += nRow;
+            continue;
+        }
+        pCol = &p->aBatch[pAgg->iCol];
+        aType = pCol->aType;
+        aI = pCol->aI;
+        
+        switch( pAgg->eKind ){
+            case AGGSCAN_COUNT: {
+                i64 nRow = 0;
+                for(i=0; i<n; i++) nRow += aMask[i] & (aType[i]!=AGGSCAN_NULL);
+                pAcc->n += nRow;
+                break;
+            }
+            
+            case AGGSCAN_SUM:
+            case AGGSCAN_TOTAL:
+            case AGGSCAN_AVG: {
+                if( pCol->bHasReal==0 && (pAcc->approx|pAcc->overflow)==0 ){
+                    /* Every value in the batch is an integer or NULL.  If no value
+                     ** has a magnitude of 2^54 or more, the batch cannot add up to
+                     ** more than 2^62 in magnitude.  If in addition the running sum
+                     ** is less than 2^62 in magnitude, no partial sum can overflow
+                     ** and the batch can be summed in any order.  Otherwise fall
+                     ** through to the row at a time code below. */
+                    i64 iSum = 0;
+                    i64 nSum = 0;
+                    u64 mBig = 0;
+                    double rSum = pAcc->rSum;
+                    for(i=0; i<n; i++){
+                        int m = aMask[i] & (aType[i]!=AGGSCAN_NULL);
+                        i64 x = aI[i] & -(i64)m;
+                        iSum += x;
+                        nSum += m;
+                        mBig |= (u64)(x<0 ? -(x+1) : x) >> 54;
+                    }
+                    if( mBig==0
+                       && pAcc->iSum<((i64)1<<62) && pAcc->iSum>-((i64)1<<62)
+                       ){
+                        /* The floating point sum must be accumulated in row order to
+                         ** give exactly the same result as sumStep(). */
+                        for(i=0; i<n; i++){
+                            if( aMask[i] && aType[i]!=AGGSCAN_NULL ) rSum += aI[i];
+                        }
+                        pAcc->rSum = rSum;
+                        pAcc->iSum += iSum;
+                        pAcc->n += nSum;
+                        break;
+                    }
+                }
+                /* fall through */
+            }
+            default: {
+                Mem *pVal = &p->sTmp;
+                if( (pAgg->eKind==AGGSCAN_MIN || pAgg->eKind==AGGSCAN_MAX)
+                   && pCol->bHasReal==0
+                   ){
+                    /* Integer min() or max().  Find the extreme value of the batch,
+                     ** then compare it with the value found so far. */
+                    int bFound = 0;
+                    i64 iBest;
+                    if( pAgg->eKind==AGGSCAN_MIN ){
+                        iBest = LARGEST_INT64;
+                        for(i=0; i<n; i++){
+                            int m = aMask[i] & (aType[i]!=AGGSCAN_NULL);
+                            i64 x = m ? aI[i] : LARGEST_INT64;
+                            iBest = x<iBest ? x : iBest;
+                            bFound |= m;
+                        }
+                    }else{
+                        iBest = SMALLEST_INT64;
+                        for(i=0; i<n; i++){
+                            int m = aMask[i] & (aType[i]!=AGGSCAN_NULL);
+                            i64 x = m ? aI[i] : SMALLEST_INT64;
+                            iBest = x>iBest ? x : iBest;
+                            bFound |= m;
+                        }
+                    }
+                    if( bFound ){
+                        sqlite3VdbeMemSetInt64(pVal, iBest);
+                        rc = aggScanStep(pAcc, pAgg->eKind, pVal);
+                    }
+                    break;
+                }
+                for(i=0; i<n && rc==SQLITE_OK; i++){
+                    if( aMask[i]==0 ) continue;
+                    aggScanLoad(pCol, i, pVal);
+                    rc = aggScanStep(pAcc, pAgg->eKind, pVal);
+                }
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+/*
+ ** Evaluate the WHERE clause and aggregate functions for the row whose
+ ** column values are loaded into p->aVal[], one row at a time.  This is
+ ** used for rows that contain a string or blob in one of the columns.
+ */
+static int aggScanRow(AggScanCtx *p){
+    const AggScan *pScan = p->pScan;
+    Mem *aMem = p->aReg;
+    int j;
+    int rc = SQLITE_OK;
+    
+    for(j=0; j<pScan->nTerm; j++){
+        const struct AggScanTerm *pTerm = &pScan->aTerm[j];
+        Mem *pLhs = &p->aVal[pTerm->iCol];
+        Mem *pRhs = &aMem[pTerm->iReg];
+        if( (pLhs->flags|pRhs->flags) & MEM_Null ) return SQLITE_OK;
+        if( !aggScanTest(pTerm->op, sqlite3MemCompare(pLhs, pRhs, 0)) ){
+            return SQLITE_OK;
+        }
+    }
+    for(j=0; j<pScan->nAgg && rc==SQLITE_OK; j++){
+        const struct AggScanAgg *pAgg = &pScan->aAgg[j];
+        Mem *pVal = 0;
+        if( pAgg->iCol>=0 ){
+            /* Pass a copy, as sum() may convert its argument to a number */
+            pVal = &p->sTmp;
+            sqlite3VdbeMemShallowCopy(pVal, &p->aVal[pAgg->iCol], MEM_Ephem);
+        }
+        rc = aggScanStep(&p->aAcc[j], pAgg->eKind, pVal);
+    }
+    return rc;
+}
+
+/*
+ ** Decode the columns of the row that the cursor currently points to into
+ ** slot iRow of the batch.  If the row contains a string or blob in one
+ ** of the columns, evaluate the rows already in the batch, then evaluate
+ ** this row on its own, and set *pbFlush.
+ */
+static int aggScanDecode(AggScanCtx *p, int iRow, int *pbFlush){
+    const AggScan *pScan = p->pScan;
+    BtCursor *pCrsr = p->pCrsr;
+    const u8 *aRec;
+    u32 nRec;
+    int avail;
+    u32 szHdr;
+    u32 offset;
+    const u8 *zIdx;
+    const u8 *zEndHdr;
+    int i, j;
+    int bSlow = 0;
+    int rc;
+    
+    *pbFlush = 0;
+    VVA_ONLY(rc =) sqlite3BtreeDataSize(pCrsr, &nRec);
+    assert( rc==SQLITE_OK );
+    if( nRec>(u32)p->mxRec ) return SQLITE_TOOBIG;
+    aRec = (const u8*)sqlite3BtreeDataFetch(pCrsr, &avail);
+    if( (u32)avail<nRec ){
+        rc = sqlite3VdbeMemFromBtree(pCrsr, 0, nRec, 0, &p->sRec);
+        if( rc ) return rc;
+        aRec = (const u8*)p->sRec.z;
+    }
+    
+    /* Parse the record header as far as the last column needed.  The
+     ** checks for corruption are the same as those made by OP_Column. */
+    if( nRec==0 ){
+        szHdr = 0;
+        zIdx = zEndHdr = aRec;
+        offset = 0;
+    }else{
+        zIdx = aRec + getVarint32(aRec, szHdr);
+        if( szHdr>98307 || szHdr>nRec ) return SQLITE_CORRUPT_BKPT;
+        zEndHdr = &aRec[szHdr];
+        offset = szHdr;
+    }
+    for(i=0; i<p->nField && zIdx<zEndHdr; i++){
+        u32 t;
+        u32 sz;
+        p->aOffset[i] = offset;
+        zIdx += getVarint32(zIdx, t);
+        p->aType[i] = t;
+        sz = sqlite3VdbeSerialTypeLen(t);
+        offset += sz;
+        if( offset<sz ) return SQLITE_CORRUPT_BKPT;
+    }
+    if( zIdx>zEndHdr || offset>nRec || (zIdx==zEndHdr && offset!=nRec) ){
+        return SQLITE_CORRUPT_BKPT;
+    }
+    for(; i<p->nField; i++){
+        /* Fields missing from the end of the record are NULL.  The caller
+         ** does not use OP_AggScan on columns with default values. */
+        p->aType[i] = 0;
+        p->aOffset[i] = 0;
+    }
+    
+    /* Decode each column used by the scan */
+    for(j=0; j<pScan->nCol; j++){
+        const struct AggScanCol *pCol = &pScan->aCol[j];
+        AggScanValues *pVals = &p->aBatch[j];
+        Mem *pVal = &p->aVal[j];
+        int eType;
+        if( pCol->iColumn<0 ){
+            i64 iKey;
+            VVA_ONLY(rc =) sqlite3BtreeKeySize(pCrsr, &iKey);
+            assert( rc==SQLITE_OK );
+            sqlite3VdbeMemSetInt64(pVal, iKey);
+        }else{
+            u32 t = p->aType[pCol->iColumn];
+            sqlite3VdbeMemSetNull(pVal);
+            if( t ){
+                sqlite3VdbeSerialGet(&aRec[p->aOffset[pCol->iColumn]], t, pVal);
+                pVal->enc = p->enc;
+                if( t>=12 ) bSlow = 1;
+            }
+        }
+        if( pCol->bReal && (pVal->flags & MEM_Int) ){
+            sqlite3VdbeMemRealify(pVal);
+        }
+        if( pVal->flags & MEM_Int ){
+            eType = AGGSCAN_INT;
+            pVals->aI[iRow] = pVal->u.i;
+            pVals->aR[iRow] = (double)pVal->u.i;
+        }else if( pVal->flags & MEM_Real ){
+            eType = AGGSCAN_REAL;
+            pVals->aI[iRow] = 0;
+            pVals->aR[iRow] = pVal->r;
+            pVals->bHasReal = 1;
+        }else{
+            eType = AGGSCAN_NULL;
+            pVals->aI[iRow] = 0;
+            pVals->aR[iRow] = 0.0;
+        }
+        pVals->aType[iRow] = (u8)eType;
+    }
+    
+    rc = SQLITE_OK;
+    if( bSlow ){
+        /* Text and blob values point into the record, so evaluate this row
+         ** before the cursor moves.  Evaluate the earlier rows of the batch
+         ** first to keep the rows in order. */
+        *pbFlush = 1;
+        if( iRow>0 ) rc = aggScanBatch(p, iRow);
+        if( rc==SQLITE_OK ) rc = aggScanRow(p);
+    }
+    if( p->sRec.flags & MEM_Dyn ){
+        sqlite3VdbeMemRelease(&p->sRec);
+        p->sRec.flags = MEM_Null;
+    }
+    return rc;
+}
+
+/*
+ ** Store the final value of the aggregate computed by pAcc in pOut.
+ */
+static int aggScanResult(Vdbe *v, AggScanAcc *pAcc, int eKind, Mem *pOut){
+    switch( eKind ){
+        case AGGSCAN_COUNT: {
+            sqlite3VdbeMemSetInt64(pOut, pAcc->n);
+            break;
+        }
+        case AGGSCAN_SUM: {
+            if( pAcc->n==0 ){
+                sqlite3VdbeMemSetNull(pOut);
+            }else if( pAcc->overflow ){
+                sqlite3SetString(&v->zErrMsg, v->db, "integer overflow");
+                return SQLITE_ERROR;
+            }else if( pAcc->approx ){
+                sqlite3VdbeMemSetDouble(pOut, pAcc->rSum);
+            }else{
+                sqlite3VdbeMemSetInt64(pOut, pAcc->iSum);
+            }
+            break;
+        }
+        case AGGSCAN_TOTAL: {
+            sqlite3VdbeMemSetDouble(pOut, pAcc->rSum);
+            break;
+        }
+        case AGGSCAN_AVG: {
+            if( pAcc->n==0 ){
+                sqlite3VdbeMemSetNull(pOut);
+            }else{
+                sqlite3VdbeMemSetDouble(pOut, pAcc->rSum/(double)pAcc->n);
+            }
+            break;
+        }
+        default: {
+            assert( eKind==AGGSCAN_MIN || eKind==AGGSCAN_MAX );
+            sqlite3VdbeMemMove(pOut, &pAcc->best);
+            break;
+        }
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Allocate and initialize an AggScanCtx that computes the aggregates
+ ** described by pScan over the rows of the table open on cursor pCrsr.
+ ** Its Mem cells belong to connection db.  The caller must set the aReg,
+ ** enc, mxRec and pInterrupt fields.
+ */
+static AggScanCtx *aggScanNew(sqlite3 *db, const AggScan *pScan, BtCursor *pCrsr){
+    AggScanCtx *p;
+    int nField = 0;
+    int nByte;
+    int i;
+    
+    for(i=0; i<pScan->nCol; i++){
+        if( pScan->aCol[i].iColumn>=nField ) nField = pScan->aCol[i].iColumn+1;
+    }
+    nByte = ROUND8(sizeof(AggScanCtx))
+          + pScan->nCol*sizeof(AggScanValues)
+          + ROUND8(pScan->nAgg*sizeof(AggScanAcc))
+          + ROUND8(pScan->nCol*sizeof(Mem))
+          + nField*2*sizeof(u32);
+    p = (AggScanCtx*)sqlite3DbMallocZero(db, nByte);
+    if( p==0 ) return 0;
+    p->db = db;
+    p->pScan = pScan;
+    p->pCrsr = pCrsr;
+    p->nField = nField;
+    p->aBatch = (AggScanValues*)&((u8*)p)[ROUND8(sizeof(AggScanCtx))];
+    p->aAcc = (AggScanAcc*)&p->aBatch[pScan->nCol];
+    p->aVal = (Mem*)&((u8*)p->aAcc)[ROUND8(pScan->nAgg*sizeof(AggScanAcc))];
+    p->aType = (u32*)&((u8*)p->aVal)[ROUND8(pScan->nCol*sizeof(Mem))];
+    p->aOffset = &p->aType[nField];
+    p->sRec.flags = MEM_Null;
+    p->sRec.db = db;
+    p->sTmp.flags = MEM_Null;
+    p->sTmp.db = db;
+    for(i=0; i<pScan->nAgg; i++){
+        p->aAcc[i].best.flags = MEM_Null;
+        p->aAcc[i].best.db = db;
+    }
+    for(i=0; i<pScan->nCol; i++){
+        p->aVal[i].flags = MEM_Null;
+        p->aVal[i].db = db;
+    }
+    return p;
+}
+
+/*
+ ** Free an AggScanCtx allocated by aggScanNew().
+ */
+static void aggScanFree(AggScanCtx *p){
+    int i;
+    for(i=0; i<p->pScan->nAgg; i++){
+        sqlite3VdbeMemRelease(&p->aAcc[i].best);
+    }
+    for(i=0; i<p->pScan->nCol; i++){
+        sqlite3VdbeMemRelease(&p->aVal[i]);
+    }
+    sqlite3VdbeMemRelease(&p->sRec);
+    sqlite3VdbeMemRelease(&p->sTmp);
+    sqlite3DbFree(p->db, p);
+}
+
+/*
+ ** Called by aggScanRange() after every nRow rows.  Return SQLITE_INTERRUPT
+ ** if sqlite3_interrupt() has been called or if the progress handler asks
+ ** for the statement to stop, or SQLITE_OK otherwise.
+ **
+ ** Each row counts as one VM instruction towards the interval given to
+ ** sqlite3_progress_handler(), so a long scan calls the handler about as
+ ** often as the equivalent loop of OP_Column and OP_Next would.  The
+ ** connections of worker threads have no progress handler, so it is only
+ ** ever invoked by the thread running the statement.
+ */
+static int aggScanCheck(AggScanCtx *p, int nRow){
+    if( *p->pInterrupt ) return SQLITE_INTERRUPT;
+#ifndef SQLITE_OMIT_PROGRESS_CALLBACK
+    if( p->db->xProgress ){
+        sqlite3 *db = p->db;
+        p->nProgress += nRow;
+        if( p->nProgress>=db->nProgressOps ){
+            p->nProgress %= db->nProgressOps;
+            if( db->xProgress(db->pProgressArg) ) return SQLITE_INTERRUPT;
+        }
+    }
+#endif
+    return SQLITE_OK;
+}
+
+/*
+ ** Add the rows of the table to the accumulators of p.  If bLo is true,
+ ** start after the row with rowid iLo.  If bHi is true, stop after the
+ ** row with rowid iHi.  Otherwise, start and stop at the ends of the
+ ** table.
+ */
+static int aggScanRange(AggScanCtx *p, int bLo, i64 iLo, int bHi, i64 iHi){
+    const AggScan *pScan = p->pScan;
+    BtCursor *pCrsr = p->pCrsr;
+    int iRow = 0;
+    int nRow = 0;
+    int res = 0;
+    int i;
+    int rc;
+    
+    if( bLo ){
+        rc = sqlite3BtreeMovetoUnpacked(pCrsr, 0, iLo, 0, &res);
+        if( rc==SQLITE_OK ){
+            if( res<=0 ){
+                rc = sqlite3BtreeNext(pCrsr, &res);
+            }else{
+                res = 0;
+            }
+        }
+    }else{
+        rc = sqlite3BtreeFirst(pCrsr, &res);
+    }
+    while( rc==SQLITE_OK && res==0 ){
+        int bFlush;
+        if( bHi ){
+            i64 iKey;
+            VVA_ONLY(rc =) sqlite3BtreeKeySize(pCrsr, &iKey);
+            assert( rc==SQLITE_OK );
+            if( iKey>iHi ) break;
+        }
+        rc = aggScanDecode(p, iRow, &bFlush);
+        if( rc ) break;
+        if( bFlush ){
+            iRow = 0;
+            for(i=0; i<pScan->nCol; i++) p->aBatch[i].bHasReal = 0;
+        }else if( ++iRow==AGGSCAN_BATCH ){
+            rc = aggScanBatch(p, iRow);
+            iRow = 0;
+            for(i=0; i<pScan->nCol; i++) p->aBatch[i].bHasReal = 0;
+            if( rc ) break;
+        }
+        if( ++nRow==AGGSCAN_BATCH ){
+            nRow = 0;
+            rc = aggScanCheck(p, AGGSCAN_BATCH);
+            if( rc ) break;
+        }
+        rc = sqlite3BtreeNext(pCrsr, &res);
+    }
+    if( rc==SQLITE_OK && iRow>0 ){
+        rc = aggScanBatch(p, iRow);
+    }
+    for(i=0; i<pScan->nCol; i++) p->aBatch[i].bHasReal = 0;
+    return rc;
+}
+
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+
+/*
+ ** The largest number of threads a parallel scan may use.
+ */
+#define AGGSCAN_MAX_THREADS 64
+
+typedef struct AggScanPart AggScanPart;
+
+/*
+ ** One range of a parallel scan, scanned by a worker thread.  The range
+ ** holds the rows with rowids greater than iLo and, if bHi is set, no
+ ** greater than iHi.
+ **
+ ** If db is set when the worker starts, it is an idle connection to the
+ ** database taken from the pool of the calling connection.  Otherwise the
+ ** worker opens a new one.  The worker sets bStarted once it holds a read
+ ** transaction on the database and is about to scan.  If it never does,
+ ** the range is scanned by the thread that started it instead.
+ */
+struct AggScanPart {
+    AggScanCtx *pMain;              /* Scan that this is a part of */
+    const char *zFile;              /* Database file to open */
+    const char *zVfs;               /* VFS to open it with */
+    u32 iCookie;                    /* Expected schema cookie */
+    i64 iLo;                        /* Rows with rowids greater than this */
+    i64 iHi;                        /* Rows with rowids no greater than this */
+    u8 bHi;                         /* True if iHi is used */
+    u8 bStarted;                    /* True if the worker scanned the range */
+    u8 bOpen;                       /* True if db is open and usable */
+    int rc;                         /* Result of the worker's scan */
+    sqlite3 *db;                    /* Worker connection */
+    BtCursor *pCrsr;                /* Worker cursor on the table */
+    AggScanCtx *p;                  /* Worker accumulators */
+    SQLiteThread *pThread;          /* The worker thread */
+};
+
+/*
+ ** Close the idle worker connections in the pool of pData beyond the
+ ** first nKeep.  If nKeep is zero, free the pool as well.  This is called
+ ** when the number of threads is reduced and when the connection that
+ ** owns the pool is closed.
+ */
+SQLITE_PRIVATE void sqlite3VdbeScanPoolTrim(VdbeConnData *pData, int nKeep){
+    while( pData->nScanPool>nKeep ){
+        sqlite3_close(pData->apScanPool[--pData->nScanPool]);
+    }
+    if( nKeep==0 ){
+        sqlite3_free(pData->apScanPool);
+        pData->apScanPool = 0;
+    }
+}
+
+/*
+ ** Set the number of threads connection db may use for each scan run by
+ ** OP_AggScan.  Zero or one disables parallel scans.
+ */
+SQLITE_API int sqlite3_parallel_scan(sqlite3 *db, int nThread){
+    VdbeConnData *pData;
+    int rc = SQLITE_OK;
+    
+    if( !sqlite3SafetyCheckOk(db) ) return SQLITE_MISUSE_BKPT;
+    if( nThread<0 ) nThread = 0;
+    if( nThread>AGGSCAN_MAX_THREADS ) nThread = AGGSCAN_MAX_THREADS;
+    sqlite3_mutex_enter(db->mutex);
+    pData = sqlite3VdbeConnData(db, nThread>1);
+    if( pData ){
+        pData->nScanThread = nThread;
+        sqlite3VdbeScanPoolTrim(pData, nThread>1 ? nThread-1 : 0);
+    }else if( nThread>1 ){
+        rc = SQLITE_NOMEM;
+    }
+    rc = sqlite3ApiExit(db, rc);
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+
+/*
+ ** Return true if worker connection pDb is open on database file zFile
+ ** using VFS pVfs.
+ */
+static int aggScanSameFile(sqlite3 *pDb, const char *zFile, sqlite3_vfs *pVfs){
+    return pDb->pVfs==pVfs
+        && strcmp(sqlite3BtreeGetFilename(pDb->aDb[0].pBt), zFile)==0;
+}
+
+/*
+ ** Remove an idle worker connection to database file zFile, opened with
+ ** VFS pVfs, from the pool of pData and return it.  Return NULL if the
+ ** pool has none.
+ */
+static sqlite3 *aggScanPoolTake(
+    VdbeConnData *pData,            /* Owner of the pool */
+    const char *zFile,              /* Database file */
+    sqlite3_vfs *pVfs               /* VFS used to open it */
+){
+    int i;
+    for(i=pData->nScanPool-1; i>=0; i--){
+        sqlite3 *pDb = pData->apScanPool[i];
+        if( aggScanSameFile(pDb, zFile, pVfs) ){
+            pData->apScanPool[i] = pData->apScanPool[--pData->nScanPool];
+            return pDb;
+        }
+    }
+    return 0;
+}
+
+/*
+ ** Add idle worker connection pDb to the pool of pData, which may hold up
+ ** to nMax connections.  If the pool is full, make room by closing one
+ ** that is open on a different database file.  If there is none, close
+ ** pDb instead.
+ */
+static void aggScanPoolPut(VdbeConnData *pData, sqlite3 *pDb, int nMax){
+    if( pData->apScanPool==0 ){
+        pData->apScanPool = (sqlite3**)sqlite3MallocZero(
+                                AGGSCAN_MAX_THREADS*sizeof(sqlite3*));
+        if( pData->apScanPool==0 ) nMax = 0;
+    }
+    if( pData->nScanPool>=nMax && nMax>0 ){
+        const char *zFile = sqlite3BtreeGetFilename(pDb->aDb[0].pBt);
+        int i;
+        for(i=0; i<pData->nScanPool; i++){
+            sqlite3 *pOld = pData->apScanPool[i];
+            if( !aggScanSameFile(pOld, zFile, pDb->pVfs) ){
+                pData->apScanPool[i] = pData->apScanPool[--pData->nScanPool];
+                sqlite3_close(pOld);
+                break;
+            }
+        }
+    }
+    if( pData->nScanPool<nMax ){
+        pData->apScanPool[pData->nScanPool++] = pDb;
+    }else{
+        sqlite3_close(pDb);
+    }
+}
+
+/*
+ ** Merge the accumulators of the range scanned by pFrom into those of p.
+ ** The rows of pFrom follow the rows already added to p.
+ */
+static int aggScanMerge(AggScanCtx *p, AggScanCtx *pFrom){
+    const AggScan *pScan = p->pScan;
+    int rc = SQLITE_OK;
+    int j;
+    
+    for(j=0; j<pScan->nAgg && rc==SQLITE_OK; j++){
+        AggScanAcc *pAcc = &p->aAcc[j];
+        AggScanAcc *pSrc = &pFrom->aAcc[j];
+        int eKind = pScan->aAgg[j].eKind;
+        if( eKind==AGGSCAN_MIN || eKind==AGGSCAN_MAX ){
+            if( (pSrc->best.flags & MEM_Null)==0 ){
+                /* pSrc->best belongs to the worker connection.  Step a shallow
+                 ** copy owned by p->db, so that any copy made is owned by it. */
+                Mem sVal;
+                memset(&sVal, 0, sizeof(sVal));
+                sVal.flags = MEM_Null;
+                sqlite3VdbeMemShallowCopy(&sVal, &pSrc->best, MEM_Ephem);
+                sVal.db = p->db;
+                rc = aggScanStep(pAcc, eKind, &sVal);
+            }
+        }else{
+            /* As in aggScanStep(), the integer sum stops once a non-integer
+             ** has been summed. */
+            pAcc->n += pSrc->n;
+            pAcc->rSum += pSrc->rSum;
+            if( (pAcc->approx|pAcc->overflow)==0 ){
+                if( pSrc->overflow || sqlite3AddInt64(&pAcc->iSum, pSrc->iSum) ){
+                    pAcc->overflow = 1;
+                }
+            }
+            pAcc->approx |= pSrc->approx;
+        }
+    }
+    return rc;
+}
+
+/*
+ ** Body of a worker thread.  Open a read-only connection to the database
+ ** unless the AggScanPart passed as the argument already has one, check
+ ** that it sees the same schema as the main connection, and scan the
+ ** range described by the AggScanPart.  The read transaction is left
+ ** open, so that the accumulators remain valid until the main thread has
+ ** merged them.
+ */
+static void *aggScanWorker(void *pArg){
+    AggScanPart *pPart = (AggScanPart*)pArg;
+    AggScanCtx *pMain = pPart->pMain;
+    sqlite3 *db = pPart->db;
+    Btree *pBt = 0;
+    u32 iCookie = 0;
+    int rc = SQLITE_OK;
+    
+    if( db==0 ){
+        rc = sqlite3_open_v2(pPart->zFile, &db,
+                             SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX|SQLITE_OPEN_PRIVATECACHE,
+                             pPart->zVfs);
+        pPart->db = db;
+        pPart->bOpen = (rc==SQLITE_OK);
+    }
+    if( rc==SQLITE_OK ){
+        pBt = db->aDb[0].pBt;
+        rc = sqlite3BtreeBeginTrans(pBt, 0);
+    }
+    if( rc==SQLITE_OK ){
+        sqlite3BtreeGetMeta(pBt, BTREE_SCHEMA_VERSION, &iCookie);
+        if( iCookie!=pPart->iCookie ) rc = SQLITE_SCHEMA;
+    }
+    if( rc==SQLITE_OK ){
+        pPart->pCrsr = (BtCursor*)sqlite3DbMallocZero(db, sqlite3BtreeCursorSize());
+        if( pPart->pCrsr==0 ) rc = SQLITE_NOMEM;
+    }
+    if( rc==SQLITE_OK ){
+        rc = sqlite3BtreeCursor(pBt, pMain->pScan->iRoot, 0, 0, pPart->pCrsr);
+    }
+    if( rc==SQLITE_OK ){
+        pPart->p = aggScanNew(db, pMain->pScan, pPart->pCrsr);
+        if( pPart->p==0 ) rc = SQLITE_NOMEM;
+    }
+    if( rc==SQLITE_OK ){
+        AggScanCtx *p = pPart->p;
+        p->aReg = pMain->aReg;
+        p->enc = pMain->enc;
+        p->mxRec = pMain->mxRec;
+        p->pInterrupt = pMain->pInterrupt;
+        pPart->bStarted = 1;
+        pPart->rc = aggScanRange(p, 1, pPart->iLo, pPart->bHi, pPart->iHi);
+    }
+    return 0;
+}
+
+/*
+ ** Release the resources held by a worker once its thread has finished.
+ ** The worker connection ends its read transaction and is returned to
+ ** the pool of pData, which may hold up to nMax connections.  Keeping it
+ ** open rather than closing it saves reopening the file for the next
+ ** scan, and avoids leaving its file descriptor to be closed by the VFS
+ ** only once the calling connection releases its own lock.
+ */
+static void aggScanPartClose(AggScanPart *pPart, VdbeConnData *pData, int nMax){
+    if( pPart->p ) aggScanFree(pPart->p);
+    if( pPart->pCrsr ){
+        sqlite3BtreeCloseCursor(pPart->pCrsr);
+        sqlite3DbFree(pPart->db, pPart->pCrsr);
+    }
+    if( pPart->bOpen && sqlite3BtreeCommit(pPart->db->aDb[0].pBt)==SQLITE_OK ){
+        aggScanPoolPut(pData, pPart->db, nMax);
+    }else{
+        sqlite3_close(pPart->db);
+    }
+}
+
+/*
+ ** If connection db allows parallel scans and the table open on cursor pC
+ ** is worth dividing, scan it in parallel, add the rows of the whole table
+ ** to the accumulators of p and set *pbDone.  Otherwise leave p unchanged
+ ** and *pbDone clear, so that the caller scans the table itself.
+ */
+static int aggScanParallel(AggScanCtx *p, VdbeCursor *pC, int *pbDone){
+    sqlite3 *db = p->db;
+    VdbeConnData *pData = sqlite3VdbeConnData(db, 0);
+    int nThread = pData ? pData->nScanThread : 0;
+    Btree *pBt;
+    const char *zFile;
+    i64 aKey[AGGSCAN_MAX_THREADS];
+    int nKey = 0;
+    AggScanPart *aPart;
+    u32 iCookie;
+    int i;
+    int rc;
+    
+    *pbDone = 0;
+    if( nThread<2 || pC->iDb==1 || !sqlite3GlobalConfig.bCoreMutex ){
+        return SQLITE_OK;
+    }
+    pBt = db->aDb[pC->iDb].pBt;
+    zFile = sqlite3BtreeGetFilename(pBt);
+    if( zFile==0 || zFile[0]==0 ) return SQLITE_OK;
+    if( sqlite3BtreeSharable(pBt) || sqlite3BtreeIsInTrans(pBt) ) return SQLITE_OK;
+    if( sqlite3PagerGetJournalMode(sqlite3BtreePager(pBt))==PAGER_JOURNALMODE_WAL ){
+        return SQLITE_OK;
+    }
+    rc = sqlite3BtreeSplitKeys(p->pCrsr, nThread, aKey, &nKey);
+    if( rc!=SQLITE_OK || nKey==0 ) return rc;
+    aPart = (AggScanPart*)sqlite3DbMallocZero(db, nKey*sizeof(AggScanPart));
+    if( aPart==0 ) return SQLITE_NOMEM;
+    sqlite3BtreeGetMeta(pBt, BTREE_SCHEMA_VERSION, &iCookie);
+    
+    /* Start a worker for each range but the first.  If a worker cannot be
+     ** started its range is scanned below, as if the worker had failed. */
+    for(i=0; i<nKey; i++){
+        AggScanPart *pPart = &aPart[i];
+        pPart->pMain = p;
+        pPart->zFile = zFile;
+        pPart->zVfs = db->pVfs->zName;
+        pPart->iCookie = iCookie;
+        pPart->iLo = aKey[i];
+        if( i<nKey-1 ){
+            pPart->iHi = aKey[i+1];
+            pPart->bHi = 1;
+        }
+        pPart->db = aggScanPoolTake(pData, zFile, db->pVfs);
+        pPart->bOpen = (pPart->db!=0);
+        sqlite3ThreadCreate(&pPart->pThread, aggScanWorker, (void*)pPart);
+    }
+    *pbDone = 1;
+    
+    /* Scan the first range, then merge the others in order, scanning any
+     ** range that a worker did not. */
+    rc = aggScanRange(p, 0, 0, 1, aKey[0]);
+    for(i=0; i<nKey; i++){
+        AggScanPart *pPart = &aPart[i];
+        if( pPart->pThread ){
+            void *pOut;
+            sqlite3ThreadJoin(pPart->pThread, &pOut);
+        }
+        if( rc==SQLITE_OK ){
+            if( pPart->bStarted ){
+                rc = pPart->rc;
+                if( rc==SQLITE_OK ) rc = aggScanMerge(p, pPart->p);
+            }else{
+                rc = aggScanRange(p, 1, pPart->iLo, pPart->bHi, pPart->iHi);
+            }
+        }
+        aggScanPartClose(pPart, pData, nThread-1);
+    }
+    sqlite3DbFree(db, aPart);
+    return rc;
+}
+
+#ifndef SQLITE_OMIT_INTEGRITY_CHECK
+typedef struct IntCkJob IntCkJob;
+typedef struct IntCkPart IntCkPart;
+
+/*
+ ** The trees of a parallel integrity check, shared by the threads taking
+ ** part in it.  Each thread takes the next tree to check from iNext.
+ */
+struct IntCkJob {
+    sqlite3_mutex *mutex;           /* Protects iNext */
+    int *aRoot;                     /* Root pages of the trees */
+    int nRoot;                      /* Number of entries in aRoot[] */
+    int iNext;                      /* Index of the next tree to check */
+    int mxErr;                      /* Error limit for each tree */
+    IntegrityTree **apTree;         /* Results, one for each aRoot[] */
+};
+
+/*
+ ** A worker thread of a parallel integrity check.  As for an AggScanPart,
+ ** db is either an idle connection taken from the pool or opened by the
+ ** worker.
+ */
+struct IntCkPart {
+    IntCkJob *pJob;                 /* Trees to check */
+    const char *zFile;              /* Database file to open */
+    const char *zVfs;               /* VFS to open it with */
+    u8 bOpen;                       /* True if db is open and usable */
+    sqlite3 *db;                    /* Worker connection */
+    SQLiteThread *pThread;          /* The worker thread */
+};
+
+/*
+ ** Return the index of the next tree of the IntCkJob passed as the
+ ** argument to check, or -1 if there are none left.
+ */
+static int intCkNext(void *pArg){
+    IntCkJob *pJob = (IntCkJob*)pArg;
+    int i = -1;
+    sqlite3_mutex_enter(pJob->mutex);
+    while( pJob->iNext<pJob->nRoot ){
+        int iTree = pJob->iNext++;
+        if( pJob->aRoot[iTree] ){
+            i = iTree;
+            break;
+        }
+    }
+    sqlite3_mutex_leave(pJob->mutex);
+    return i;
+}
+
+/*
+ ** Body of a worker thread of a parallel integrity check.  Open a
+ ** read-only connection to the database unless the IntCkPart passed as
+ ** the argument already has one, and check trees until there are none
+ ** left.  If the worker cannot start, the other threads check its share
+ ** of the trees.
+ */
+static void *intCkWorker(void *pArg){
+    IntCkPart *pPart = (IntCkPart*)pArg;
+    IntCkJob *pJob = pPart->pJob;
+    sqlite3 *db = pPart->db;
+    int rc = SQLITE_OK;
+    
+    if( db==0 ){
+        rc = sqlite3_open_v2(pPart->zFile, &db,
+                             SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX|SQLITE_OPEN_PRIVATECACHE,
+                             pPart->zVfs);
+        pPart->db = db;
+        pPart->bOpen = (rc==SQLITE_OK);
+    }
+    if( rc==SQLITE_OK ){
+        Btree *pBt = db->aDb[0].pBt;
+        rc = sqlite3BtreeBeginTrans(pBt, 0);
+        if( rc==SQLITE_OK ){
+            sqlite3BtreeIntegrityTrees(pBt, pJob->aRoot, pJob->mxErr,
+                                       intCkNext, (void*)pJob, pJob->apTree);
+        }
+    }
+    return 0;
+}
+
+/*
+ ** Free an array returned by sqlite3VdbeIntegrityParallel().
+ */
+SQLITE_PRIVATE void sqlite3VdbeIntegrityFree(sqlite3 *db, IntegrityTree **apTree, int nRoot){
+    if( apTree ){
+        int i;
+        for(i=0; i<nRoot; i++) sqlite3BtreeIntegrityTreeFree(apTree[i]);
+        sqlite3DbFree(db, apTree);
+    }
+}
+
+/*
+ ** If connection db allows parallel scans, check the trees with root
+ ** pages aRoot[] of database iDb on several threads for PRAGMA
+ ** integrity_check, and return an array of results to be passed to
+ ** sqlite3BtreeIntegrityCheck().  This thread checks trees too, using
+ ** connection db.  Otherwise, or if anything goes wrong, return NULL and
+ ** let sqlite3BtreeIntegrityCheck() check every tree itself.
+ **
+ ** The same conditions apply as to a parallel scan (see the comment at
+ ** the top of this file), so every worker sees the same database as db.
+ ** Each tree is checked on its own, and sqlite3BtreeIntegrityCheck()
+ ** checks again any tree whose result might differ from that of a
+ ** serial check, so the report is the same either way.
+ */
+SQLITE_PRIVATE IntegrityTree **sqlite3VdbeIntegrityParallel(
+    sqlite3 *db,                    /* The database connection */
+    int iDb,                        /* Database to check */
+    int *aRoot,                     /* Root pages of the trees */
+    int nRoot,                      /* Number of entries in aRoot[] */
+    int mxErr                       /* Error limit */
+){
+    VdbeConnData *pData = sqlite3VdbeConnData(db, 0);
+    int nThread = pData ? pData->nScanThread : 0;
+    Btree *pBt = db->aDb[iDb].pBt;
+    const char *zFile;
+    IntCkPart *aPart;
+    IntCkJob sJob;
+    int nPart;
+    int i;
+    
+    if( nThread<2 || nRoot<2 || iDb==1 || !sqlite3GlobalConfig.bCoreMutex ){
+        return 0;
+    }
+    zFile = sqlite3BtreeGetFilename(pBt);
+    if( zFile==0 || zFile[0]==0 ) return 0;
+    if( sqlite3BtreeSharable(pBt) || sqlite3BtreeIsInTrans(pBt) ) return 0;
+    if( sqlite3PagerGetJournalMode(sqlite3BtreePager(pBt))==PAGER_JOURNALMODE_WAL ){
+        return 0;
+    }
+    
+    memset(&sJob, 0, sizeof(sJob));
+    sJob.aRoot = aRoot;
+    sJob.nRoot = nRoot;
+    sJob.mxErr = mxErr;
+    sJob.mutex = sqlite3MutexAlloc(SQLITE_MUTEX_FAST);
+    nPart = (nThread<nRoot ? nThread : nRoot) - 1;
+    sJob.apTree = (IntegrityTree**)sqlite3DbMallocZero(db, nRoot*sizeof(IntegrityTree*));
+    aPart = (IntCkPart*)sqlite3DbMallocZero(db, nPart*sizeof(IntCkPart));
+    if( sJob.apTree==0 || aPart==0 || (SQLITE_THREADSAFE && sJob.mutex==0) ){
+        sqlite3DbFree(db, sJob.apTree);
+        sqlite3DbFree(db, aPart);
+        sqlite3_mutex_free(sJob.mutex);
+        return 0;
+    }
+    
+    for(i=0; i<nPart; i++){
+        IntCkPart *pPart = &aPart[i];
+        pPart->pJob = &sJob;
+        pPart->zFile = zFile;
+        pPart->zVfs = db->pVfs->zName;
+        pPart->db = aggScanPoolTake(pData, zFile, db->pVfs);
+        pPart->bOpen = (pPart->db!=0);
+        sqlite3ThreadCreate(&pPart->pThread, intCkWorker, (void*)pPart);
+    }
+    sqlite3BtreeIntegrityTrees(pBt, aRoot, mxErr, intCkNext, (void*)&sJob, sJob.apTree);
+    for(i=0; i<nPart; i++){
+        IntCkPart *pPart = &aPart[i];
+        if( pPart->pThread ){
+            void *pOut;
+            sqlite3ThreadJoin(pPart->pThread, &pOut);
+        }
+        if( pPart->bOpen && sqlite3BtreeCommit(pPart->db->aDb[0].pBt)==SQLITE_OK ){
+            aggScanPoolPut(pData, pPart->db, nThread-1);
+        }else{
+            sqlite3_close(pPart->db);
+        }
+    }
+    sqlite3DbFree(db, aPart);
+    sqlite3_mutex_free(sJob.mutex);
+    return sJob.apTree;
+}
+#endif /* SQLITE_OMIT_INTEGRITY_CHECK */
+#endif /* SQLITE_OMIT_PARALLEL_SCAN */
+
+/*
+ ** Scan every row of the table open on cursor pC and compute the
+ ** aggregates described by pScan.  The result of each aggregate is
+ ** written into register pScan->aAgg[i].iMem.  On return the cursor is
+ ** left pointing at no row.
+ */
+SQLITE_PRIVATE int sqlite3VdbeAggScan(Vdbe *v, VdbeCursor *pC, const AggScan *pScan){
+    sqlite3 *db = v->db;
+    AggScanCtx *p;
+    int bDone = 0;
+    int i;
+    int rc = SQLITE_OK;
+    
+    p = aggScanNew(db, pScan, pC->pCursor);
+    if( p==0 ) return SQLITE_NOMEM;
+    p->aReg = v->aMem;
+    p->enc = ENC(db);
+    p->mxRec = db->aLimit[SQLITE_LIMIT_LENGTH];
+    p->pInterrupt = &db->u1.isInterrupted;
+    
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    rc = aggScanParallel(p, pC, &bDone);
+#endif
+    if( rc==SQLITE_OK && !bDone ){
+        rc = aggScanRange(p, 0, 0, 0, 0);
+    }
+    for(i=0; i<pScan->nAgg && rc==SQLITE_OK; i++){
+        Mem *pOut = &v->aMem[pScan->aAgg[i].iMem];
+        rc = aggScanResult(v, &p->aAcc[i], pScan->aAgg[i].eKind, pOut);
+    }
+    aggScanFree(p);
+    
+    pC->nullRow = 1;
+    pC->cacheStatus = CACHE_STALE;
+    return rc;
+}
+
+#endif /* SQLITE_OMIT_BATCH_AGGREGATE */
+
+/************** End of vdbeagg.c *********************************************/
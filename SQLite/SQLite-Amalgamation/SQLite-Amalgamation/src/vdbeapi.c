@@ -75,6 +75,9 @@ SQLITE_API int sqlite3_finalize(sqlite3_stmt *pStmt){
         sqlite3 *db = v->db;
         if( vdbeSafety(v) ) return SQLITE_MISUSE_BKPT;
         sqlite3_mutex_enter(db->mutex);
+#ifndef SQLITE_OMIT_STMT_CACHE
+        if( !sqlite3VdbeCachePark(v, &rc) )
+#endif
         rc = sqlite3VdbeFinalize(v);
         rc = sqlite3ApiExit(db, rc);
         sqlite3LeaveMutexAndCloseZombie(db);
@@ -121,6 +124,12 @@ SQLITE_API int sqlite3_clear_bindings(sqlite3_stmt *pStmt){
         sqlite3VdbeMemRelease(&p->aVar[i]);
         p->aVar[i].flags = MEM_Null;
     }
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    if( p->pBatch && p->pBatch->nRun==0 ){
+        sqlite3DbFree(p->db, p->pBatch);
+        p->pBatch = 0;
+    }
+#endif
     if( p->isPrepareV2 && p->expmask ){
         p->expired = 1;
     }
@@ -464,27 +473,23 @@ end_of_step:
 }
 
 /*
- ** This is the top-level implementation of sqlite3_step().  Call
- ** sqlite3Step() to do most of the work.  If a schema error occurs,
- ** call sqlite3Reprepare() and try again.
+ ** Call sqlite3Step() to do most of the work of sqlite3_step().  If a
+ ** schema error occurs, call sqlite3Reprepare() and try again.  The
+ ** caller must hold the database connection mutex.
  */
-SQLITE_API int sqlite3_step(sqlite3_stmt *pStmt){
+static int vdbeStepWithReprepare(Vdbe *v){
     int rc = SQLITE_OK;      /* Result from sqlite3Step() */
     int rc2 = SQLITE_OK;     /* Result from sqlite3Reprepare() */
-    Vdbe *v = (Vdbe*)pStmt;  /* the prepared statement */
     int cnt = 0;             /* Counter to prevent infinite loop of reprepares */
-    sqlite3 *db;             /* The database connection */
+    sqlite3 *db = v->db;     /* The database connection */
     
-    if( vdbeSafetyNotNull(v) ){
-        return SQLITE_MISUSE_BKPT;
-    }
-    db = v->db;
-    sqlite3_mutex_enter(db->mutex);
+    assert( sqlite3_mutex_held(db->mutex) );
     v->doingRerun = 0;
+    v->bFetchPending = 0;
     while( (rc = sqlite3Step(v))==SQLITE_SCHEMA
           && cnt++ < SQLITE_MAX_SCHEMA_RETRY
           && (rc2 = rc = sqlite3Reprepare(v))==SQLITE_OK ){
-        sqlite3_reset(pStmt);
+        sqlite3_reset((sqlite3_stmt*)v);
         v->doingRerun = 1;
         assert( v->expired==0 );
     }
@@ -507,8 +512,22 @@ SQLITE_API int sqlite3_step(sqlite3_stmt *pStmt){
             v->rc = rc = SQLITE_NOMEM;
         }
     }
-    rc = sqlite3ApiExit(db, rc);
-    sqlite3_mutex_leave(db->mutex);
+    return sqlite3ApiExit(db, rc);
+}
+
+/*
+ ** This is the top-level implementation of sqlite3_step().
+ */
+SQLITE_API int sqlite3_step(sqlite3_stmt *pStmt){
+    int rc;
+    Vdbe *v = (Vdbe*)pStmt;  /* the prepared statement */
+    
+    if( vdbeSafetyNotNull(v) ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    sqlite3_mutex_enter(v->db->mutex);
+    rc = vdbeStepWithReprepare(v);
+    sqlite3_mutex_leave(v->db->mutex);
     return rc;
 }
 
@@ -838,6 +857,223 @@ SQLITE_API int sqlite3_column_type(sqlite3_stmt *pStmt, int i){
     return iType;
 }
 
+#ifndef SQLITE_OMIT_BATCH_FETCH
+/*
+ ** Store the current result row of statement p as row iRow of the column
+ ** buffers aCol[0] through aCol[nCol-1].  Text and blob values are
+ ** converted and measured before anything is stored, so that a row which
+ ** does not fit in some zArena[] buffer is not partially stored.
+ **
+ ** Return SQLITE_OK if the row was stored, SQLITE_FULL if it does not fit,
+ ** or SQLITE_NOMEM if a conversion fails.
+ */
+static int vdbeFetchRow(
+                        Vdbe *p,                    /* Statement with a current row */
+                        int iRow,                   /* Store the row at this index */
+                        sqlite3_fetch_column *aCol, /* Column buffers */
+                        int nCol                    /* Number of entries in aCol[] */
+){
+    Mem *aRes = p->pResultSet;
+    int i;
+    
+    for(i=0; i<nCol; i++){
+        int eType = aCol[i].eType;
+        if( (eType==SQLITE_TEXT || eType==SQLITE_BLOB)
+           && (aRes[i].flags & MEM_Null)==0
+           ){
+            if( eType==SQLITE_TEXT ){
+                /* UTF-8 text is copied as it is, even if it is not terminated
+                 ** (as with values borrowed from a b-tree page) */
+                if( (aRes[i].flags & MEM_Str)==0 || aRes[i].enc!=SQLITE_UTF8 ){
+                    sqlite3_value_text((sqlite3_value*)&aRes[i]);
+                }
+            }else{
+                sqlite3_value_blob((sqlite3_value*)&aRes[i]);
+            }
+            if( p->db->mallocFailed ) return SQLITE_NOMEM;
+            if( aRes[i].n > aCol[i].nArena - aCol[i].nArenaUsed ){
+                return SQLITE_FULL;
+            }
+        }
+    }
+    
+    for(i=0; i<nCol; i++){
+        sqlite3_fetch_column *pCol = &aCol[i];
+        Mem *pMem = &aRes[i];
+        int isNull = (pMem->flags & MEM_Null)!=0;
+        
+        if( pCol->eType==SQLITE_NULL ) continue;
+        if( pCol->aNull ){
+            if( isNull ){
+                pCol->aNull[iRow>>3] |= (u8)(1<<(iRow&7));
+            }else{
+                pCol->aNull[iRow>>3] &= (u8)~(1<<(iRow&7));
+            }
+        }
+        switch( pCol->eType ){
+            case SQLITE_INTEGER: {
+                ((i64*)pCol->aValue)[iRow] = sqlite3VdbeIntValue(pMem);
+                break;
+            }
+            case SQLITE_FLOAT: {
+                ((double*)pCol->aValue)[iRow] = sqlite3VdbeRealValue(pMem);
+                break;
+            }
+            default: {
+                int *aOff = (int*)pCol->aValue;
+                assert( pCol->eType==SQLITE_TEXT || pCol->eType==SQLITE_BLOB );
+                if( !isNull && pMem->n>0 ){
+                    memcpy(&pCol->zArena[pCol->nArenaUsed], pMem->z, pMem->n);
+                    pCol->nArenaUsed += pMem->n;
+                }
+                aOff[iRow+1] = pCol->nArenaUsed;
+                break;
+            }
+        }
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Return true if the column buffers aCol[0] through aCol[nCol-1] are
+ ** usable: each has a known eType, and every column that is not skipped
+ ** has a value array and, for TEXT and BLOB, an arena of valid size.
+ */
+static int vdbeFetchColumnsOk(const sqlite3_fetch_column *aCol, int nCol){
+    int i;
+    for(i=0; i<nCol; i++){
+        switch( aCol[i].eType ){
+            case SQLITE_NULL:
+                break;
+            case SQLITE_INTEGER:
+            case SQLITE_FLOAT:
+                if( aCol[i].aValue==0 ) return 0;
+                break;
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+                if( aCol[i].aValue==0 || aCol[i].nArena<0 ) return 0;
+                if( aCol[i].nArena>0 && aCol[i].zArena==0 ) return 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ ** Step statement pStmt up to nRow times, storing the first nCol columns
+ ** of each row in the buffers aCol[].  This avoids the mutex, the
+ ** columnMem() lookup and the sqlite3ApiExit() call that the
+ ** sqlite3_column_xxx() routines make for every value.
+ */
+SQLITE_API int sqlite3_fetch_batch(
+                                   sqlite3_stmt *pStmt,
+                                   int nRow,
+                                   sqlite3_fetch_column *aCol,
+                                   int nCol,
+                                   int *pnFetched
+){
+    Vdbe *v = (Vdbe*)pStmt;
+    sqlite3 *db;
+    int iRow = 0;
+    int rc = SQLITE_ROW;
+    int i;
+    
+    if( pnFetched ) *pnFetched = 0;
+    if( vdbeSafetyNotNull(v) || nRow<0 || nCol<0 || (nCol>0 && aCol==0)
+       || !vdbeFetchColumnsOk(aCol, nCol)
+       ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    db = v->db;
+    sqlite3_mutex_enter(db->mutex);
+    if( nCol>v->nResColumn ){
+        sqlite3Error(db, SQLITE_RANGE, 0);
+        sqlite3_mutex_leave(db->mutex);
+        return SQLITE_RANGE;
+    }
+    for(i=0; i<nCol; i++){
+        aCol[i].nArenaUsed = 0;
+        if( aCol[i].eType==SQLITE_TEXT || aCol[i].eType==SQLITE_BLOB ){
+            ((int*)aCol[i].aValue)[0] = 0;
+        }
+    }
+    
+    while( iRow<nRow ){
+        if( v->bFetchPending && v->pResultSet ){
+            /* A row that did not fit into the buffers last time */
+            v->bFetchPending = 0;
+        }else{
+            rc = vdbeStepWithReprepare(v);
+            if( rc!=SQLITE_ROW ) break;
+        }
+        rc = vdbeFetchRow(v, iRow, aCol, nCol);
+        if( rc==SQLITE_FULL ){
+            v->bFetchPending = 1;
+            if( iRow==0 ){
+                rc = SQLITE_TOOBIG;
+                sqlite3Error(db, rc, 0);
+            }else{
+                rc = SQLITE_ROW;
+            }
+            break;
+        }
+        if( rc!=SQLITE_OK ) break;
+        rc = SQLITE_ROW;
+        iRow++;
+    }
+    
+    if( pnFetched ) *pnFetched = iRow;
+    rc = sqlite3ApiExit(db, rc);
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+#endif /* SQLITE_OMIT_BATCH_FETCH */
+
+#ifndef SQLITE_OMIT_ZEROCOPY
+/*
+ ** Enable (onoff>0), disable (onoff==0) or query (onoff<0) zero-copy
+ ** access to the result values of a read-only statement.  Return the
+ ** resulting setting.
+ */
+SQLITE_API int sqlite3_stmt_zerocopy(sqlite3_stmt *pStmt, int onoff){
+    Vdbe *v = (Vdbe*)pStmt;
+    if( vdbeSafetyNotNull(v) ){
+        return 0;
+    }
+    if( onoff>=0 ){
+        sqlite3_mutex_enter(v->db->mutex);
+        v->bZeroCopy = (onoff>0 && v->readOnly);
+        sqlite3_mutex_leave(v->db->mutex);
+    }
+    return v->bZeroCopy;
+}
+
+/*
+ ** Return the UTF-8 text of column i of the current row of pStmt and
+ ** write its length in bytes to *pnByte.  Unlike sqlite3_column_text(),
+ ** the text returned need not be zero-terminated, so a UTF-8 value that
+ ** was borrowed from a b-tree page is returned without being copied.
+ ** Any other value is converted as by sqlite3_column_text().
+ */
+SQLITE_API const char *sqlite3_column_text_nocopy(sqlite3_stmt *pStmt, int i, int *pnByte){
+    Mem *pMem = columnMem(pStmt, i);
+    const char *z;
+    int n;
+    if( (pMem->flags & (MEM_Str|MEM_Zero))==MEM_Str && pMem->enc==SQLITE_UTF8 ){
+        z = pMem->z ? pMem->z : "";
+        n = pMem->n;
+    }else{
+        z = (const char*)sqlite3_value_text(pMem);
+        n = sqlite3_value_bytes(pMem);
+    }
+    columnMallocFailure(pStmt);
+    if( pnByte ) *pnByte = n;
+    return z;
+}
+#endif /* SQLITE_OMIT_ZEROCOPY */
+
 /*
  ** Convert the N-th element of pStmt->pColName[] into a string using
  ** xFunc() then return that string.  If N is out of range, return 0.
@@ -1013,6 +1249,11 @@ static int vdbeUnbind(Vdbe *p, int i){
     pVar = &p->aVar[i];
     sqlite3VdbeMemRelease(pVar);
     pVar->flags = MEM_Null;
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    if( p->pBatch ){
+        p->pBatch->aParam[i].eType = 0;
+    }
+#endif
     sqlite3Error(p->db, SQLITE_OK, 0);
     
     /* If the bit corresponding to this variable in Vdbe.expmask is set, then
@@ -1172,6 +1413,150 @@ SQLITE_API int sqlite3_bind_zeroblob(sqlite3_stmt *pStmt, int i, int n){
     return rc;
 }
 
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+/*
+ ** Allocate the VdbeBatch object of statement p, if it does not already
+ ** have one. Return NULL if a malloc fails.
+ */
+static VdbeBatch *vdbeBatchAlloc(Vdbe *p){
+    if( p->pBatch==0 ){
+        int nByte = sizeof(VdbeBatch) + p->nVar*sizeof(VdbeBatchParam);
+        p->pBatch = (VdbeBatch*)sqlite3DbMallocZero(p->db, nByte);
+        if( p->pBatch ){
+            p->pBatch->aParam = (VdbeBatchParam*)&p->pBatch[1];
+        }
+    }
+    return p->pBatch;
+}
+
+/*
+ ** Bind an array of nRow values to parameter i. The values are loaded
+ ** into the parameter one row at a time by sqlite3_step_batch().
+ */
+SQLITE_API int sqlite3_bind_array(
+                                  sqlite3_stmt *pStmt,
+                                  int i,
+                                  int eType,
+                                  const void *aValue,
+                                  const int *anByte,
+                                  int nRow
+){
+    Vdbe *p = (Vdbe *)pStmt;
+    int rc;
+    
+    if( (eType!=SQLITE_INTEGER && eType!=SQLITE_FLOAT
+         && eType!=SQLITE_TEXT && eType!=SQLITE_BLOB)
+       || nRow<0
+       || (nRow>0 && aValue==0)
+       || (nRow>0 && eType==SQLITE_BLOB && anByte==0)
+       ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    rc = vdbeUnbind(p, i);
+    if( rc==SQLITE_OK ){
+        VdbeBatch *pBatch = vdbeBatchAlloc(p);
+        if( pBatch ){
+            VdbeBatchParam *pParam = &pBatch->aParam[i-1];
+            pParam->eType = eType;
+            pParam->nRow = nRow;
+            pParam->aValue = aValue;
+            pParam->anByte = anByte;
+        }
+        rc = sqlite3ApiExit(p->db, rc);
+        sqlite3_mutex_leave(p->db->mutex);
+    }
+    return rc;
+}
+
+/*
+ ** Run statement pStmt once for each of the first nRow rows of the arrays
+ ** bound to it by sqlite3_bind_array(). The rows are run by a single call
+ ** to sqlite3Step() - OP_Halt restarts the program for each new row (see
+ ** sqlite3VdbeBatchNext()) - and the statement is reset once, at the end.
+ */
+SQLITE_API int sqlite3_step_batch(sqlite3_stmt *pStmt, int nRow, int *aRowRc){
+    Vdbe *v = (Vdbe*)pStmt;  /* the prepared statement */
+    VdbeBatch *pBatch;       /* Bound arrays and batch state */
+    sqlite3 *db;             /* The database connection */
+    int rc;                  /* Return code */
+    int i;
+    
+    if( vdbeSafetyNotNull(v) || nRow<0 ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    db = v->db;
+    sqlite3_mutex_enter(db->mutex);
+    if( v->magic==VDBE_MAGIC_RUN && v->pc>=0 ){
+        sqlite3_log(SQLITE_MISUSE,
+                    "batch on a busy prepared statement: [%s]", v->zSql);
+        sqlite3_mutex_leave(db->mutex);
+        return SQLITE_MISUSE_BKPT;
+    }
+    pBatch = vdbeBatchAlloc(v);
+    if( pBatch==0 ){
+        rc = sqlite3ApiExit(db, SQLITE_NOMEM);
+        sqlite3_mutex_leave(db->mutex);
+        return rc;
+    }
+    for(i=0; i<v->nVar; i++){
+        if( pBatch->aParam[i].eType && pBatch->aParam[i].nRow<nRow ){
+            sqlite3Error(db, SQLITE_RANGE, 0);
+            sqlite3_mutex_leave(db->mutex);
+            return SQLITE_RANGE;
+        }
+    }
+    if( nRow==0 ){
+        sqlite3_mutex_leave(db->mutex);
+        return SQLITE_DONE;
+    }
+    
+    if( v->magic!=VDBE_MAGIC_RUN ){
+        sqlite3_reset(pStmt);
+    }
+    if( aRowRc ){
+        for(i=0; i<nRow; i++) aRowRc[i] = SQLITE_ABORT;
+    }
+    pBatch->nRun = nRow;
+    pBatch->iRow = 0;
+    pBatch->aRowRc = aRowRc;
+    pBatch->rcFail = SQLITE_OK;
+    pBatch->nChange = 0;
+    rc = sqlite3VdbeBatchLoad(v);
+    if( rc==SQLITE_OK ){
+        /* Rows of output, if the statement produces any, are discarded */
+        while( (rc = vdbeStepWithReprepare(v))==SQLITE_ROW ){}
+    }else if( aRowRc ){
+        aRowRc[0] = rc;
+    }
+    
+    /* The statement may have been re-prepared, but the bound
+     ** arrays stay with the statement handle, so v->pBatch is unchanged. */
+    assert( v->pBatch==pBatch );
+    if( rc!=SQLITE_DONE && aRowRc && aRowRc[pBatch->iRow]==SQLITE_ABORT ){
+        aRowRc[pBatch->iRow] = rc;
+    }
+    pBatch->nRun = 0;
+    pBatch->aRowRc = 0;
+    sqlite3_reset(pStmt);
+    if( rc==SQLITE_DONE && pBatch->rcFail!=SQLITE_OK ){
+        rc = pBatch->rcFail & db->errMask;
+        sqlite3Error(db, rc, 0);
+    }
+    
+    /* The array-bound parameters point into application memory, which
+     ** need not remain valid once this call returns. */
+    for(i=0; i<v->nVar; i++){
+        if( pBatch->aParam[i].eType ){
+            sqlite3VdbeMemRelease(&v->aVar[i]);
+            v->aVar[i].flags = MEM_Null;
+        }
+    }
+    rc = sqlite3ApiExit(db, rc);
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+#endif /* SQLITE_OMIT_BATCH_EXECUTE */
+
 /*
  ** Return the number of wildcards that can be potentially bound to.
  ** This routine is added to support DBD::SQLite.  
@@ -1319,4 +1704,88 @@ SQLITE_API int sqlite3_stmt_status(sqlite3_stmt *pStmt, int op, int resetFlag){
     return (int)v;
 }
 
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+/*
+ ** Enable (onoff>0), disable (onoff==0) or query (onoff<0) the collection
+ ** of per-instruction statistics for a prepared statement.  Enabling
+ ** profiling on a statement that already has it zeroes the statistics
+ ** gathered so far.
+ */
+SQLITE_API int sqlite3_stmt_profile(sqlite3_stmt *pStmt, int onoff){
+    Vdbe *v = (Vdbe*)pStmt;
+    sqlite3 *db;
+    int rc = SQLITE_OK;
+    if( vdbeSafetyNotNull(v) ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    if( onoff<0 ){
+        return v->bOpProfile;
+    }
+    db = v->db;
+    sqlite3_mutex_enter(db->mutex);
+    if( onoff ){
+#ifndef SQLITE_OMIT_VIRTUALTABLE
+        rc = sqlite3VdbeProfileRegister(db);
+#endif
+        if( rc==SQLITE_OK ){
+            v->bOpProfile = 1;
+            if( v->aOpStat ){
+                memset(v->aOpStat, 0, v->nOp*sizeof(VdbeOpStat));
+            }
+        }
+    }else if( v->pc>=0 ){
+        /* The statistics of a statement that is part way through running
+         ** may be in use by sqlite3VdbeExec(), so cannot be discarded. */
+        rc = SQLITE_BUSY;
+    }else{
+        v->bOpProfile = 0;
+        sqlite3DbFree(db, v->aOpStat);
+        v->aOpStat = 0;
+    }
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+
+/*
+ ** Read the statistics collected for the instruction at address iAddr of
+ ** a profiled statement.
+ */
+SQLITE_API int sqlite3_stmt_profile_op(
+    sqlite3_stmt *pStmt,
+    int iAddr,
+    const char **pzOpcode,
+    sqlite3_int64 *pnExec,
+    sqlite3_int64 *pnCycle
+){
+    Vdbe *v = (Vdbe*)pStmt;
+    sqlite3 *db;
+    int rc = SQLITE_OK;
+    if( vdbeSafetyNotNull(v) ){
+        return SQLITE_MISUSE_BKPT;
+    }
+    db = v->db;
+    sqlite3_mutex_enter(db->mutex);
+    if( iAddr<0 || iAddr>=v->nOp ){
+        rc = SQLITE_RANGE;
+    }else{
+        if( pzOpcode ){
+#if !defined(SQLITE_OMIT_EXPLAIN) || !defined(NDEBUG) \
+|| defined(VDBE_PROFILE) || defined(SQLITE_DEBUG)
+            *pzOpcode = sqlite3OpcodeName(v->aOp[iAddr].opcode);
+#else
+            *pzOpcode = 0;
+#endif
+        }
+        if( pnExec ){
+            *pnExec = v->aOpStat ? (sqlite3_int64)v->aOpStat[iAddr].nExec : 0;
+        }
+        if( pnCycle ){
+            *pnCycle = v->aOpStat ? (sqlite3_int64)v->aOpStat[iAddr].nCycle : 0;
+        }
+    }
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+#endif /* SQLITE_OMIT_OPCODE_PROFILE */
+
 /************** End of vdbeapi.c *********************************************/
\ No newline at end of file
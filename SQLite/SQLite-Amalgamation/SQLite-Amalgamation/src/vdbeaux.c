@@ -78,6 +78,19 @@ SQLITE_PRIVATE void sqlite3VdbeSwap(Vdbe *pA, Vdbe *pB){
     pA->zSql = pB->zSql;
     pB->zSql = zTmp;
     pB->isPrepareV2 = pA->isPrepareV2;
+    pB->bOpProfile = pA->bOpProfile;
+    pB->bZeroCopy = pA->bZeroCopy;
+#ifndef SQLITE_OMIT_STMT_CACHE
+    pB->iCacheHash = pA->iCacheHash;
+#endif
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    {
+        /* Bound arrays belong to the statement handle, not its program */
+        VdbeBatch *pBatch = pA->pBatch;
+        pA->pBatch = pB->pBatch;
+        pB->pBatch = pBatch;
+    }
+#endif
 }
 
 #ifdef SQLITE_DEBUG
@@ -186,6 +199,24 @@ SQLITE_PRIVATE int sqlite3VdbeAddOp4(
     return addr;
 }
 
+/*
+ ** Add an opcode that includes the p4 value with a P4_INT64 or P4_REAL
+ ** type.  The 8-byte value at zP4 is copied into memory owned by the VM.
+ */
+SQLITE_PRIVATE int sqlite3VdbeAddOp4Dup8(
+                                         Vdbe *p,            /* Add the opcode to this VM */
+                                         int op,             /* The new opcode */
+                                         int p1,             /* The P1 operand */
+                                         int p2,             /* The P2 operand */
+                                         int p3,             /* The P3 operand */
+                                         const u8 *zP4,      /* The P4 operand */
+                                         int p4type          /* P4 operand type */
+){
+    char *p4copy = sqlite3DbMallocRaw(sqlite3VdbeDb(p), 8);
+    if( p4copy ) memcpy(p4copy, zP4, 8);
+    return sqlite3VdbeAddOp4(p, op, p1, p2, p3, p4copy, p4type);
+}
+
 /*
  ** Add an OP_ParseSchema opcode.  This routine is broken out from
  ** sqlite3VdbeAddOp4() since it needs to also needs to mark all btrees
@@ -386,6 +417,59 @@ SQLITE_PRIVATE int sqlite3VdbeAssertMayAbort(Vdbe *v, int mayAbort){
 }
 #endif /* SQLITE_DEBUG - the sqlite3AssertMayAbort() function */
 
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+/*
+ ** Peephole pass over a program whose labels have already been resolved.
+ ** Look for short instruction sequences that occur in the inner loops of
+ ** most queries and set the OPFLG_FUSED bit on the first instruction of
+ ** each pair.  After an instruction carrying OPFLG_FUSED has run without
+ ** error, sqlite3VdbeExec() jumps straight into the body of the next
+ ** instruction rather than going back through the dispatch switch and the
+ ** per-instruction bookkeeping at the top of the interpreter loop.
+ **
+ ** The sequences recognized are:
+ **
+ **     OP_Column    followed by  OP_Column
+ **     OP_Column    followed by  OP_MakeRecord consuming its output
+ **     OP_Column    followed by  OP_Eq..OP_Ge  comparing its output
+ **
+ ** OP_Column never jumps, so the second instruction of each pair is
+ ** always the one that would have run next.  It does not matter whether
+ ** or not the second instruction is also a jump target - a jump to it
+ ** simply dispatches it in the usual way.
+ */
+static void fuseOpcodes(Vdbe *p){
+    int i;
+    Op *pOp;
+    for(pOp=p->aOp, i=p->nOp-1; i>0; i--, pOp++){
+        Op *pNext = &pOp[1];
+        if( pOp->opcode!=OP_Column ) continue;
+        switch( pNext->opcode ){
+            case OP_Column: {
+                break;
+            }
+            case OP_MakeRecord: {
+                if( pOp->p3<pNext->p1 || pOp->p3>=pNext->p1+pNext->p2 ) continue;
+                break;
+            }
+            case OP_Eq:
+            case OP_Ne:
+            case OP_Lt:
+            case OP_Le:
+            case OP_Gt:
+            case OP_Ge: {
+                if( pOp->p3!=pNext->p1 && pOp->p3!=pNext->p3 ) continue;
+                break;
+            }
+            default: {
+                continue;
+            }
+        }
+        pOp->opflags |= OPFLG_FUSED;
+    }
+}
+#endif /* SQLITE_OMIT_OPCODE_FUSION */
+
 /*
  ** Loop through the program looking for P2 values that are negative
  ** on jump instructions.  Each such value is a label.  Resolve the
@@ -397,7 +481,8 @@ SQLITE_PRIVATE int sqlite3VdbeAssertMayAbort(Vdbe *v, int mayAbort){
  ** to an OP_Function, OP_AggStep or OP_VFilter opcode. This is used by
  ** sqlite3VdbeMakeReady() to size the Vdbe.apArg[] array.
  **
- ** The Op.opflags field is set on all opcodes.
+ ** The Op.opflags field is set on all opcodes.  Unless SQLITE_OMIT_OPCODE_FUSION
+ ** is defined, the peephole pass in fuseOpcodes() is run afterwards.
  */
 static void resolveP2Values(Vdbe *p, int *pMaxFuncArgs){
     int i;
@@ -470,6 +555,9 @@ static void resolveP2Values(Vdbe *p, int *pMaxFuncArgs){
     }
     sqlite3DbFree(p->db, p->aLabel);
     p->aLabel = 0;
+#ifndef SQLITE_OMIT_OPCODE_FUSION
+    fuseOpcodes(p);
+#endif
     *pMaxFuncArgs = nMaxArgs;
     assert( p->bIsReader!=0 || p->btreeMask==0 );
 }
@@ -625,6 +713,7 @@ static void freeP4(sqlite3 *db, int p4type, void *p4){
             case P4_DYNAMIC:
             case P4_KEYINFO:
             case P4_INTARRAY:
+            case P4_AGGSCAN:
             case P4_KEYINFO_HANDOFF: {
                 sqlite3DbFree(db, p4);
                 break;
@@ -942,6 +1031,11 @@ static char *displayP4(Op *pOp, char *zTemp, int nTemp){
             sqlite3_snprintf(nTemp, zTemp, "intarray");
             break;
         }
+        case P4_AGGSCAN: {
+            AggScan *pScan = pOp->p4.pAggScan;
+            sqlite3_snprintf(nTemp, zTemp, "aggscan(%d,%d)", pScan->nAgg, pScan->nTerm);
+            break;
+        }
         case P4_SUBPROGRAM: {
             sqlite3_snprintf(nTemp, zTemp, "program");
             break;
@@ -1440,6 +1534,10 @@ SQLITE_PRIVATE void sqlite3VdbeRewind(Vdbe *p){
     p->minWriteFileFormat = 255;
     p->iStatement = 0;
     p->nFkConstraint = 0;
+    p->bFetchPending = 0;
+#ifndef SQLITE_OMIT_ZEROCOPY
+    p->mBorrow = 0;
+#endif
 #ifdef VDBE_PROFILE
     for(i=0; i<p->nOp; i++){
         p->aOp[i].cnt = 0;
@@ -1582,6 +1680,8 @@ SQLITE_PRIVATE void sqlite3VdbeFreeCursor(Vdbe *p, VdbeCursor *pCx){
         return;
     }
     sqlite3VdbeSorterClose(p->db, pCx);
+    sqlite3VdbeHashClose(p->db, pCx);
+    sqlite3VdbeMemoClose(p->db, pCx);
     if( pCx->pBt ){
         sqlite3BtreeClose(pCx->pBt);
         /* The pCx->pCursor will be close automatically, if it exists, by
@@ -2313,6 +2413,150 @@ SQLITE_PRIVATE int sqlite3VdbeHalt(Vdbe *p){
     return (p->rc==SQLITE_BUSY ? SQLITE_BUSY : SQLITE_OK);
 }
 
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+/*
+ ** Copy the values for row pBatch->iRow of each array bound with
+ ** sqlite3_bind_array() into the corresponding entries of p->aVar[].
+ ** Text and blob values are not copied; the Mem objects point directly
+ ** at the application's buffers. Return SQLITE_OK, or an error code if
+ ** a value could not be loaded.
+ */
+SQLITE_PRIVATE int sqlite3VdbeBatchLoad(Vdbe *p){
+    VdbeBatch *pBatch = p->pBatch;
+    int iRow = pBatch->iRow;
+    int rc = SQLITE_OK;
+    int i;
+    
+    assert( iRow>=0 && iRow<pBatch->nRun );
+    for(i=0; i<p->nVar && rc==SQLITE_OK; i++){
+        VdbeBatchParam *pParam = &pBatch->aParam[i];
+        Mem *pVar = &p->aVar[i];
+        int n;
+        
+        if( pParam->eType==0 ) continue;
+        assert( iRow<pParam->nRow );
+        n = pParam->anByte ? pParam->anByte[iRow] : -1;
+        switch( pParam->eType ){
+            case SQLITE_INTEGER: {
+                if( pParam->anByte && n<0 ){
+                    sqlite3VdbeMemSetNull(pVar);
+                }else{
+                    sqlite3VdbeMemSetInt64(pVar, ((const i64*)pParam->aValue)[iRow]);
+                }
+                break;
+            }
+            case SQLITE_FLOAT: {
+                if( pParam->anByte && n<0 ){
+                    sqlite3VdbeMemSetNull(pVar);
+                }else{
+                    sqlite3VdbeMemSetDouble(pVar,
+                                            ((const double*)pParam->aValue)[iRow]);
+                }
+                break;
+            }
+            default: {
+                const void *z = ((const void *const*)pParam->aValue)[iRow];
+                if( z==0 ){
+                    sqlite3VdbeMemSetNull(pVar);
+                }else if( pParam->eType==SQLITE_TEXT ){
+                    rc = sqlite3VdbeMemSetStr(pVar, z, n, SQLITE_UTF8, SQLITE_STATIC);
+                    if( rc==SQLITE_OK ){
+                        rc = sqlite3VdbeChangeEncoding(pVar, ENC(p->db));
+                    }
+                }else if( n<0 ){
+                    /* A BLOB has no terminator to find its size by */
+                    assert( pParam->eType==SQLITE_BLOB );
+                    rc = SQLITE_MISUSE_BKPT;
+                }else{
+                    assert( pParam->eType==SQLITE_BLOB );
+                    rc = sqlite3VdbeMemSetStr(pVar, z, n, 0, SQLITE_STATIC);
+                }
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+/*
+ ** This routine is called by OP_Halt when the main program halts while
+ ** sqlite3_step_batch() is running. It finishes the current row of the
+ ** batch: the row's statement transaction is committed, or rolled back
+ ** if the row failed a constraint, and its result code is recorded.
+ **
+ ** If there is another row to run, its parameters are loaded and 1 is
+ ** returned. The caller then restarts the program from the first
+ ** instruction. Otherwise 0 is returned and the caller halts the VM as
+ ** usual. A row that fails for any reason other than an ABORT or FAIL
+ ** constraint ends the batch, and p->rc is left holding the error for
+ ** sqlite3VdbeHalt() to act on.
+ */
+SQLITE_PRIVATE int sqlite3VdbeBatchNext(Vdbe *p){
+    sqlite3 *db = p->db;
+    VdbeBatch *pBatch = p->pBatch;
+    int eStatementOp;
+    int rc;
+    
+    assert( sqlite3VdbeBatchRunning(p) );
+    if( p->rc==SQLITE_OK && !db->mallocFailed ){
+        sqlite3VdbeCheckFk(p, 0);
+    }
+    if( pBatch->aRowRc ){
+        pBatch->aRowRc[pBatch->iRow] = p->rc;
+    }
+    if( db->mallocFailed ){
+        return 0;
+    }
+    if( p->rc==SQLITE_OK || p->errorAction==OE_Fail ){
+        eStatementOp = SAVEPOINT_RELEASE;
+    }else if( (p->rc&0xff)==SQLITE_CONSTRAINT && p->errorAction==OE_Abort ){
+        eStatementOp = SAVEPOINT_ROLLBACK;
+    }else{
+        return 0;
+    }
+    
+    /* The cursors must be closed before the statement transaction is
+     ** rolled back. This also restores the main program if the row was
+     ** halted by a trigger. */
+    closeAllCursors(p);
+    if( p->aOnceFlag ) memset(p->aOnceFlag, 0, p->nOnceFlag);
+    rc = sqlite3VdbeCloseStatement(p, eStatementOp);
+    if( rc!=SQLITE_OK ){
+        p->rc = rc;
+        p->errorAction = OE_Abort;
+        sqlite3DbFree(db, p->zErrMsg);
+        p->zErrMsg = 0;
+        return 0;
+    }
+    if( p->rc!=SQLITE_OK ){
+        if( pBatch->rcFail==SQLITE_OK ) pBatch->rcFail = p->rc;
+        if( eStatementOp==SAVEPOINT_ROLLBACK ) p->nChange = pBatch->nChange;
+        sqlite3DbFree(db, p->zErrMsg);
+        p->zErrMsg = 0;
+    }
+    p->rc = SQLITE_OK;
+    p->errorAction = OE_Abort;
+    p->nFkConstraint = 0;
+    
+    /* If this was the last row, the VM may now halt normally. Since the
+     ** row's statement transaction has already been closed, this commits
+     ** the work of the batch if the connection is in autocommit mode. */
+    if( pBatch->iRow+1>=pBatch->nRun ){
+        return 0;
+    }
+    pBatch->iRow++;
+    pBatch->nChange = p->nChange;
+    rc = sqlite3VdbeBatchLoad(p);
+    if( rc!=SQLITE_OK ){
+        p->rc = rc;
+        if( pBatch->aRowRc ) pBatch->aRowRc[pBatch->iRow] = rc;
+        return 0;
+    }
+    p->doingRerun = 1;
+    return 1;
+}
+#endif /* SQLITE_OMIT_BATCH_EXECUTE */
+
 
 /*
  ** Each VDBE holds the result of the most recent sqlite3_step() call
@@ -2520,6 +2764,12 @@ SQLITE_PRIVATE void sqlite3VdbeClearObject(sqlite3 *db, Vdbe *p){
     sqlite3DbFree(db, p->zExplain);
     sqlite3DbFree(db, p->pExplain);
 #endif
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    sqlite3DbFree(db, p->aOpStat);
+#endif
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    sqlite3DbFree(db, p->pBatch);
+#endif
 }
 
 /*
@@ -3108,6 +3358,268 @@ SQLITE_PRIVATE int sqlite3VdbeRecordCompare(
     return rc;
 }
 
+#ifndef SQLITE_OMIT_FAST_RECORD_COMPARE
+/*
+ ** The routines that follow are specialized versions of
+ ** sqlite3VdbeRecordCompare() for the most common key shapes: a single
+ ** integer, a single text value compared using BINARY, and an integer
+ ** followed by a rowid. sqlite3VdbeFindCompare() selects one of them once
+ ** per search, after which it is called for every cell visited.
+ **
+ ** Each fast comparator handles only records whose header size and leading
+ ** serial types are single-byte varints (text serial types may be longer)
+ ** and whose fields lie entirely within the nKey1 bytes supplied. Anything
+ ** else, including REAL values that would need a mixed int/real comparison,
+ ** is passed to the generic routine, so that results are always identical
+ ** to those of sqlite3VdbeRecordCompare().
+ */
+
+/*
+ ** Decode the integer with serial type serial_type (one of 1..6, 8 or 9)
+ ** stored at aKey.
+ */
+static i64 vdbeRecordDecodeInt(u32 serial_type, const unsigned char *aKey){
+    switch( serial_type ){
+        case 1:
+            return (signed char)aKey[0];
+        case 2:
+            return (((signed char)aKey[0])<<8) | aKey[1];
+        case 3:
+            return (((signed char)aKey[0])<<16) | (aKey[1]<<8) | aKey[2];
+        case 4:
+            return (aKey[0]<<24) | (aKey[1]<<16) | (aKey[2]<<8) | aKey[3];
+        case 5: {
+            u64 x = (((signed char)aKey[0])<<8) | aKey[1];
+            u32 y = (aKey[2]<<24) | (aKey[3]<<16) | (aKey[4]<<8) | aKey[5];
+            x = (x<<32) | y;
+            return *(i64*)&x;
+        }
+        case 6: {
+            u64 x = (aKey[0]<<24) | (aKey[1]<<16) | (aKey[2]<<8) | aKey[3];
+            u32 y = (aKey[4]<<24) | (aKey[5]<<16) | (aKey[6]<<8) | aKey[7];
+            x = (x<<32) | y;
+            return *(i64*)&x;
+        }
+        case 8:
+            return 0;
+        default:
+            assert( serial_type==9 );
+            return 1;
+    }
+}
+
+/*
+ ** True if serial_type is one of the integer serial types.
+ */
+#define isIntSerialType(t) ((t)>=1 && (t)<=9 && (t)!=7)
+
+/*
+ ** Return the result of a comparison in which all fields of pPKey2 were
+ ** equal to the corresponding fields of key1. idx1 is the offset of the
+ ** next unread entry of key1's header, and szHdr1 the header size. This
+ ** is the same tie-breaking logic used at the end of
+ ** sqlite3VdbeRecordCompare().
+ */
+static int vdbeRecordCompareTail(
+                                 const UnpackedRecord *pPKey2,
+                                 u32 idx1,
+                                 u32 szHdr1
+){
+    if( pPKey2->flags & UNPACKED_INCRKEY ){
+        return -1;
+    }else if( pPKey2->flags & UNPACKED_PREFIX_MATCH ){
+        return 0;
+    }
+    return idx1<szHdr1;
+}
+
+/*
+ ** Comparator for an UnpackedRecord that consists of a single integer.
+ */
+static int vdbeRecordCompareInt(
+                                int nKey1, const void *pKey1, /* Left key */
+                                UnpackedRecord *pPKey2        /* Right key */
+){
+    const unsigned char *aKey1 = (const unsigned char *)pKey1;
+    u32 szHdr1;
+    u32 serial_type1;
+    int rc;
+    
+    assert( pPKey2->nField==1 );
+    assert( pPKey2->aMem[0].flags & MEM_Int );
+    if( nKey1<2 ) goto int_fallback;
+    szHdr1 = aKey1[0];
+    serial_type1 = aKey1[1];
+    if( szHdr1<2 || szHdr1>0x7f || serial_type1>0x7f ) goto int_fallback;
+    if( szHdr1+sqlite3VdbeSerialTypeLen(serial_type1)>(u32)nKey1 ){
+        goto int_fallback;
+    }
+    
+    if( isIntSerialType(serial_type1) ){
+        i64 v1 = vdbeRecordDecodeInt(serial_type1, &aKey1[szHdr1]);
+        i64 v2 = pPKey2->aMem[0].u.i;
+        if( v1==v2 ){
+            return vdbeRecordCompareTail(pPKey2, 2, szHdr1);
+        }
+        rc = v1<v2 ? -1 : +1;
+    }else if( serial_type1>=12 ){
+        /* Text and blobs are always greater than integers */
+        rc = +1;
+    }else{
+        /* NULL, REAL or a reserved serial type */
+        goto int_fallback;
+    }
+    
+    if( pPKey2->pKeyInfo->aSortOrder[0] ){
+        rc = -rc;
+    }
+    return rc;
+    
+int_fallback:
+    return sqlite3VdbeRecordCompare(nKey1, pKey1, pPKey2);
+}
+
+/*
+ ** Comparator for an UnpackedRecord that consists of two integers, most
+ ** often an integer index column followed by the rowid.
+ */
+static int vdbeRecordCompareIntRowid(
+                                     int nKey1, const void *pKey1, /* Left key */
+                                     UnpackedRecord *pPKey2        /* Right key */
+){
+    const unsigned char *aKey1 = (const unsigned char *)pKey1;
+    const u8 *aSortOrder = pPKey2->pKeyInfo->aSortOrder;
+    u32 szHdr1;
+    u32 t0, t1;
+    u32 n0;
+    i64 v1, v2;
+    
+    assert( pPKey2->nField==2 );
+    assert( pPKey2->aMem[0].flags & MEM_Int );
+    assert( pPKey2->aMem[1].flags & MEM_Int );
+    assert( (pPKey2->flags & UNPACKED_PREFIX_SEARCH)==0 );
+    if( nKey1<3 ) goto introwid_fallback;
+    szHdr1 = aKey1[0];
+    t0 = aKey1[1];
+    t1 = aKey1[2];
+    if( szHdr1<3 || szHdr1>0x7f
+       || !isIntSerialType(t0) || !isIntSerialType(t1)
+       ){
+        goto introwid_fallback;
+    }
+    n0 = sqlite3VdbeSerialTypeLen(t0);
+    if( szHdr1+n0+sqlite3VdbeSerialTypeLen(t1)>(u32)nKey1 ){
+        goto introwid_fallback;
+    }
+    
+    v1 = vdbeRecordDecodeInt(t0, &aKey1[szHdr1]);
+    v2 = pPKey2->aMem[0].u.i;
+    if( v1!=v2 ){
+        int rc = v1<v2 ? -1 : +1;
+        return aSortOrder[0] ? -rc : rc;
+    }
+    v1 = vdbeRecordDecodeInt(t1, &aKey1[szHdr1+n0]);
+    v2 = pPKey2->aMem[1].u.i;
+    if( v1!=v2 ){
+        int rc = v1<v2 ? -1 : +1;
+        return aSortOrder[1] ? -rc : rc;
+    }
+    return vdbeRecordCompareTail(pPKey2, 3, szHdr1);
+    
+introwid_fallback:
+    return sqlite3VdbeRecordCompare(nKey1, pKey1, pPKey2);
+}
+
+/*
+ ** Comparator for an UnpackedRecord that consists of a single text value
+ ** compared using the BINARY collating sequence.
+ */
+static int vdbeRecordCompareString(
+                                   int nKey1, const void *pKey1, /* Left key */
+                                   UnpackedRecord *pPKey2        /* Right key */
+){
+    const unsigned char *aKey1 = (const unsigned char *)pKey1;
+    const Mem *pMem2 = &pPKey2->aMem[0];
+    u32 szHdr1;
+    u32 idx1;
+    u32 serial_type1;
+    int rc;
+    
+    assert( pPKey2->nField==1 );
+    assert( pMem2->flags & MEM_Str );
+    if( nKey1<2 ) goto string_fallback;
+    szHdr1 = aKey1[0];
+    if( szHdr1<2 || szHdr1>0x7f ) goto string_fallback;
+    idx1 = 1 + getVarint32(&aKey1[1], serial_type1);
+    if( idx1>szHdr1
+       || szHdr1+sqlite3VdbeSerialTypeLen(serial_type1)>(u32)nKey1
+       ){
+        goto string_fallback;
+    }
+    
+    if( serial_type1<12 ){
+        /* NULLs and numbers are always less than text */
+        rc = -1;
+    }else if( (serial_type1 & 1)==0 ){
+        /* Blobs are always greater than text */
+        rc = +1;
+    }else{
+        int n1 = (serial_type1-13)/2;
+        int n2 = pMem2->n;
+        rc = memcmp(&aKey1[szHdr1], pMem2->z, n1<n2 ? n1 : n2);
+        if( rc==0 ){
+            rc = n1 - n2;
+            if( rc==0 ){
+                return vdbeRecordCompareTail(pPKey2, idx1, szHdr1);
+            }
+        }
+    }
+    
+    if( pPKey2->pKeyInfo->aSortOrder[0] ){
+        rc = -rc;
+    }
+    return rc;
+    
+string_fallback:
+    return sqlite3VdbeRecordCompare(nKey1, pKey1, pPKey2);
+}
+
+/*
+ ** Return a comparison function suitable for comparing serialized records
+ ** against the unpacked key p. The function returned always produces the
+ ** same results as sqlite3VdbeRecordCompare(), which is itself returned
+ ** if no specialized routine applies to the shape of p.
+ **
+ ** The choice depends on the types of the values in p->aMem[] and on its
+ ** flags, so it must be made again whenever p is re-populated.
+ */
+SQLITE_PRIVATE RecordCompare sqlite3VdbeFindCompare(UnpackedRecord *p){
+    if( (p->flags & UNPACKED_PREFIX_SEARCH)==0 && p->nField>0 ){
+        int flags = p->aMem[0].flags;
+        if( p->nField==1 ){
+            if( (flags & (MEM_Int|MEM_Null))==MEM_Int ){
+                return vdbeRecordCompareInt;
+            }
+            if( (flags & (MEM_Str|MEM_Int|MEM_Real|MEM_Null))==MEM_Str ){
+                KeyInfo *pKeyInfo = p->pKeyInfo;
+                CollSeq *pColl = pKeyInfo->aColl[0];
+                if( pColl==0 || (pColl->enc==pKeyInfo->enc
+                                 && sqlite3StrICmp(pColl->zName, "BINARY")==0)
+                   ){
+                    return vdbeRecordCompareString;
+                }
+            }
+        }else if( p->nField==2
+                 && (flags & (MEM_Int|MEM_Null))==MEM_Int
+                 && (p->aMem[1].flags & (MEM_Int|MEM_Null))==MEM_Int
+                 ){
+            return vdbeRecordCompareIntRowid;
+        }
+    }
+    return sqlite3VdbeRecordCompare;
+}
+#endif /* SQLITE_OMIT_FAST_RECORD_COMPARE */
+
 
 /*
  ** pCur points at an index entry created using the OP_MakeRecord opcode.
@@ -3222,7 +3734,7 @@ SQLITE_PRIVATE int sqlite3VdbeIdxKeyCompare(
         return rc;
     }
     assert( pUnpacked->flags & UNPACKED_PREFIX_MATCH );
-    *res = sqlite3VdbeRecordCompare(m.n, m.z, pUnpacked);
+    *res = sqlite3VdbeFindCompare(pUnpacked)(m.n, m.z, pUnpacked);
     sqlite3VdbeMemRelease(&m);
     return SQLITE_OK;
 }
@@ -3260,7 +3772,45 @@ SQLITE_PRIVATE void sqlite3ExpirePreparedStatements(sqlite3 *db){
     for(p = db->pVdbe; p; p=p->pNext){
         p->expired = 1;
     }
+#ifndef SQLITE_OMIT_STMT_CACHE
+    sqlite3VdbeCacheExpire(db);
+#endif
+}
+
+#if !defined(SQLITE_OMIT_STMT_CACHE) || !defined(SQLITE_OMIT_PARALLEL_SCAN) \
+    || !defined(SQLITE_OMIT_SUBQUERY_CACHE)
+/*
+ ** Destructor for a VdbeConnData object, called when the main database
+ ** of its connection is closed.  Release whatever the features using it
+ ** still hold.  The object itself is freed by the caller.
+ */
+static void vdbeConnDataFree(void *pArg){
+    VdbeConnData *pData = (VdbeConnData*)pArg;
+#ifndef SQLITE_OMIT_STMT_CACHE
+    sqlite3VdbeCacheFree(pData->pStmtCache);
+#endif
+#ifndef SQLITE_OMIT_PARALLEL_SCAN
+    sqlite3VdbeScanPoolTrim(pData, 0);
+#endif
+}
+
+/*
+ ** Return the VdbeConnData object of connection db.  If it has not been
+ ** allocated yet, allocate it if bCreate is true, or return NULL if it is
+ ** false.  NULL is also returned if an allocation fails.
+ **
+ ** The object is kept as the connection data of the b-tree handle of the
+ ** main database (see sqlite3BtreeConnData()), which is only closed once
+ ** every statement of the connection has been finalized.
+ */
+SQLITE_PRIVATE VdbeConnData *sqlite3VdbeConnData(sqlite3 *db, int bCreate){
+    Btree *pBt = db->aDb[0].pBt;
+    assert( sqlite3_mutex_held(db->mutex) );
+    if( pBt==0 ) return 0;
+    return (VdbeConnData*)sqlite3BtreeConnData(pBt,
+                                bCreate ? sizeof(VdbeConnData) : 0, vdbeConnDataFree);
 }
+#endif
 
 /*
  ** Return the database associated with the Vdbe.
@@ -0,0 +1,420 @@
+/************** Begin file vdbecache.c ***************************************/
+/*
+ ** 2013 October 30
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file implements the prepared statement cache enabled on a
+ ** database connection by sqlite3_stmt_cache().  While the cache is
+ ** enabled, sqlite3_finalize() on a statement prepared by
+ ** sqlite3_prepare_v2() resets the statement and parks it here instead
+ ** of deleting it, and a later sqlite3_prepare_v2() of the same SQL text
+ ** hands the parked statement back without running the compiler.
+ **
+ ** Parked statements are taken off the Vdbe.pNext list of the connection,
+ ** so that they do not count as unfinalized statements when it closes and
+ ** are not returned by sqlite3_next_stmt().  They are put back on the list
+ ** when handed back, and just before they are deleted.  The usual expiry
+ ** logic (schema changes, OP_Expire, new functions and collating
+ ** sequences, the authorizer) calls sqlite3VdbeCacheExpire() to mark them
+ ** expired along with every other statement.  An expired statement is
+ ** never handed back.  Schema changes made by other connections are caught
+ ** by OP_VerifyCookie when the statement runs, exactly as for a statement
+ ** that was never finalized.
+ **
+ ** The cache object is kept with the other per-connection state of the
+ ** VDBE (see sqlite3VdbeConnData()).  Statements still parked when the
+ ** connection closes are deleted by sqlite3VdbeCacheFree().
+ */
+
+#include "vdbeInt.h"
+
+#ifndef SQLITE_OMIT_STMT_CACHE
+
+/*
+ ** The largest number of statements a connection may park.
+ */
+#define STMTCACHE_MAX_SIZE 10000
+
+/*
+ ** The statement cache of one database connection.  Parked statements are
+ ** linked into a hash table by Vdbe.pCacheNext and into a list ordered
+ ** by the time they were parked by Vdbe.pLruNext and Vdbe.pLruPrev.
+ */
+struct StmtCache {
+    int nMax;                 /* Largest number of statements to park */
+    int nStmt;                /* Number of statements currently parked */
+    int nHash;                /* Number of slots in apHash[].  A power of 2 */
+    Vdbe **apHash;            /* Hash table of parked statements */
+    Vdbe *pLru;               /* Parked statement to evict first */
+    Vdbe *pMru;               /* Most recently parked statement */
+    int nHit;                 /* sqlite3_prepare_v2() calls served from here */
+    int nMiss;                /* sqlite3_prepare_v2() calls that compiled */
+};
+
+/*
+ ** Return the statement cache of connection db, or NULL if
+ ** sqlite3_stmt_cache() has never enabled it.
+ */
+static StmtCache *stmtCacheGet(sqlite3 *db){
+    VdbeConnData *pData = sqlite3VdbeConnData(db, 0);
+    return pData ? pData->pStmtCache : 0;
+}
+
+/*
+ ** Compute the hash of the first n bytes of z.  A statement is parked
+ ** under the hash of the whole text passed to sqlite3_prepare_v2(), so a
+ ** statement parsed from the start of a longer script is found again by
+ ** a call that passes the same script.
+ */
+static u32 stmtCacheHash(const char *z, int n){
+    u32 h = 0;
+    while( n-- > 0 ){
+        h = (h<<3) ^ h ^ (u8)*(z++);
+    }
+    return h;
+}
+
+/*
+ ** Remove parked statement p from the hash table and LRU list of pCache.
+ */
+static void stmtCacheUnlink(StmtCache *pCache, Vdbe *p){
+    Vdbe **pp;
+    assert( p->bCached );
+    for(pp=&pCache->apHash[p->iCacheHash & (pCache->nHash-1)]; *pp!=p;
+        pp=&(*pp)->pCacheNext){
+        assert( *pp );
+    }
+    *pp = p->pCacheNext;
+    if( p->pLruPrev ){
+        p->pLruPrev->pLruNext = p->pLruNext;
+    }else{
+        pCache->pLru = p->pLruNext;
+    }
+    if( p->pLruNext ){
+        p->pLruNext->pLruPrev = p->pLruPrev;
+    }else{
+        pCache->pMru = p->pLruPrev;
+    }
+    p->pCacheNext = p->pLruNext = p->pLruPrev = 0;
+    p->bCached = 0;
+    pCache->nStmt--;
+}
+
+/*
+ ** Put statement p, which has just been removed from the cache, back on
+ ** the list of statements of its connection.
+ */
+static void stmtCacheRelink(Vdbe *p){
+    sqlite3 *db = p->db;
+    assert( p->pPrev==0 && p->pNext==0 && db->pVdbe!=p );
+    if( db->pVdbe ){
+        db->pVdbe->pPrev = p;
+    }
+    p->pNext = db->pVdbe;
+    db->pVdbe = p;
+}
+
+/*
+ ** Remove parked statement p from pCache and delete it.  It has already
+ ** been reset, so there is nothing to report.
+ */
+static void stmtCacheDelete(StmtCache *pCache, Vdbe *p){
+    stmtCacheUnlink(pCache, p);
+    stmtCacheRelink(p);
+    sqlite3VdbeDelete(p);
+}
+
+/*
+ ** Delete parked statements, least recently parked first, until no more
+ ** than nKeep remain.
+ */
+static void stmtCacheTrim(StmtCache *pCache, int nKeep){
+    while( pCache->nStmt>nKeep ){
+        stmtCacheDelete(pCache, pCache->pLru);
+    }
+}
+
+/*
+ ** Delete the statements parked in pCache and free it.  Called when the
+ ** connection is closed.
+ */
+SQLITE_PRIVATE void sqlite3VdbeCacheFree(StmtCache *pCache){
+    if( pCache ){
+        stmtCacheTrim(pCache, 0);
+        sqlite3_free(pCache->apHash);
+        sqlite3_free(pCache);
+    }
+}
+
+/*
+ ** Mark every statement parked by connection db as expired.  Called by
+ ** sqlite3ExpirePreparedStatements(), since parked statements are not on
+ ** the list that it walks.
+ */
+SQLITE_PRIVATE void sqlite3VdbeCacheExpire(sqlite3 *db){
+    StmtCache *pCache = stmtCacheGet(db);
+    Vdbe *p;
+    if( pCache ){
+        for(p=pCache->pLru; p; p=p->pLruNext){
+            p->expired = 1;
+        }
+    }
+}
+
+/*
+ ** Set the largest number of statements connection db will park.  Zero
+ ** disables the cache and deletes any statements already parked.
+ */
+SQLITE_API int sqlite3_stmt_cache(sqlite3 *db, int nMax){
+    VdbeConnData *pData;
+    StmtCache *pCache;
+    int rc = SQLITE_OK;
+    
+    if( !sqlite3SafetyCheckOk(db) ) return SQLITE_MISUSE_BKPT;
+    if( nMax<0 ) nMax = 0;
+    if( nMax>STMTCACHE_MAX_SIZE ) nMax = STMTCACHE_MAX_SIZE;
+    sqlite3_mutex_enter(db->mutex);
+    pData = sqlite3VdbeConnData(db, nMax>0);
+    pCache = pData ? pData->pStmtCache : 0;
+    if( pCache==0 && nMax>0 ){
+        if( pData ){
+            pCache = (StmtCache*)sqlite3MallocZero(sizeof(StmtCache));
+            pData->pStmtCache = pCache;
+        }
+        if( pCache==0 ) rc = SQLITE_NOMEM;
+    }
+    if( pCache ){
+        int nHash = 16;
+        while( nHash<nMax ) nHash *= 2;
+        stmtCacheTrim(pCache, nMax);
+        if( nHash>pCache->nHash ){
+            /* Rehash the parked statements into the larger table */
+            Vdbe **apNew = (Vdbe**)sqlite3MallocZero(nHash*sizeof(Vdbe*));
+            if( apNew==0 ){
+                rc = SQLITE_NOMEM;
+            }else{
+                int i;
+                for(i=0; i<pCache->nHash; i++){
+                    Vdbe *p, *pNext;
+                    for(p=pCache->apHash[i]; p; p=pNext){
+                        Vdbe **pp = &apNew[p->iCacheHash & (nHash-1)];
+                        pNext = p->pCacheNext;
+                        p->pCacheNext = *pp;
+                        *pp = p;
+                    }
+                }
+                sqlite3_free(pCache->apHash);
+                pCache->apHash = apNew;
+                pCache->nHash = nHash;
+            }
+        }
+        if( rc==SQLITE_OK ) pCache->nMax = nMax;
+    }
+    rc = sqlite3ApiExit(db, rc);
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+
+/*
+ ** Look for a parked statement that sqlite3_prepare_v2() may return for
+ ** the SQL text zSql, of at most nBytes bytes.  If one is found, remove it
+ ** from the cache, set *pzTail to the end of its text within zSql and
+ ** return it.  Otherwise return NULL, in which case the caller compiles
+ ** the statement and passes the key written to *piKey to
+ ** sqlite3VdbeCacheSetKey().
+ **
+ ** A parked statement matches if it was prepared from text with the same
+ ** hash and its own text is a prefix of zSql that the parser would also
+ ** have stopped at: either all of zSql, or a prefix ending in the ';'
+ ** that terminated the statement when it was compiled.
+ */
+SQLITE_PRIVATE Vdbe *sqlite3VdbeCacheLookup(
+    sqlite3 *db,                  /* Database connection */
+    const char *zSql,             /* UTF-8 encoded SQL text */
+    int nBytes,                   /* Length of zSql, or -1 */
+    const char **pzTail,          /* OUT: End of the statement within zSql */
+    u32 *piKey                    /* OUT: Key to park a new statement under */
+){
+    StmtCache *pCache;
+    Vdbe *p, *pNext;
+    int n;
+    u32 h;
+    
+    assert( sqlite3_mutex_held(db->mutex) );
+    *piKey = 0;
+    pCache = stmtCacheGet(db);
+    if( pCache==0 || pCache->nMax==0 ) return 0;
+    if( nBytes<0 ){
+        n = sqlite3Strlen30(zSql);
+    }else{
+        for(n=0; n<nBytes && zSql[n]; n++){}
+    }
+    h = stmtCacheHash(zSql, n);
+    *piKey = h;
+    for(p=pCache->apHash[h & (pCache->nHash-1)]; p; p=pNext){
+        int nSql;
+        pNext = p->pCacheNext;
+        if( p->iCacheHash!=h ) continue;
+        if( p->expired ){
+            stmtCacheDelete(pCache, p);
+            continue;
+        }
+        nSql = sqlite3Strlen30(p->zSql);
+        if( nSql<=n && memcmp(p->zSql, zSql, nSql)==0
+         && (nSql==n || p->zSql[nSql-1]==';') ){
+            stmtCacheUnlink(pCache, p);
+            stmtCacheRelink(p);
+            pCache->nHit++;
+            if( pzTail ) *pzTail = &zSql[nSql];
+            return p;
+        }
+    }
+    pCache->nMiss++;
+    return 0;
+}
+
+/*
+ ** Record the key under which statement p, just compiled from SQL text
+ ** that sqlite3VdbeCacheLookup() found no match for, will be parked.
+ */
+SQLITE_PRIVATE void sqlite3VdbeCacheSetKey(Vdbe *p, u32 iKey){
+    p->iCacheHash = iKey;
+}
+
+/*
+ ** Called by sqlite3_finalize() on statement p.  If p can be parked in the
+ ** statement cache, reset it, clear its bindings and any other state set
+ ** through its handle, park it and return non-zero, writing the result of
+ ** the reset to *pRc.  Return zero if the statement should be deleted
+ ** instead.
+ **
+ ** Statements with a non-zero Vdbe.expmask are not parked.  Their program
+ ** was planned for the values bound when they were compiled, and would
+ ** expire as soon as the next user bound different ones.
+ */
+SQLITE_PRIVATE int sqlite3VdbeCachePark(Vdbe *p, int *pRc){
+    sqlite3 *db = p->db;
+    StmtCache *pCache;
+    int rc = SQLITE_OK;
+    int i;
+    
+    assert( sqlite3_mutex_held(db->mutex) );
+    assert( !p->bCached );
+    if( !p->isPrepareV2 || p->zSql==0 || p->expired || p->expmask ) return 0;
+    if( db->magic!=SQLITE_MAGIC_OPEN || db->mallocFailed ) return 0;
+    pCache = stmtCacheGet(db);
+    if( pCache==0 || pCache->nMax==0 ) return 0;
+    
+    if( p->magic==VDBE_MAGIC_RUN || p->magic==VDBE_MAGIC_HALT ){
+        rc = sqlite3VdbeReset(p);
+    }
+    sqlite3VdbeRewind(p);
+    if( p->expired ){
+        /* Statements marked runOnlyOnce expire when they are reset */
+        *pRc = rc;
+        sqlite3VdbeDelete(p);
+        return 1;
+    }
+    /* Clear the bindings and the settings made through the handle.  Any
+     ** row pending for sqlite3_fetch_batch() was dropped by the rewind. */
+    for(i=0; i<p->nVar; i++){
+        sqlite3VdbeMemRelease(&p->aVar[i]);
+        p->aVar[i].flags = MEM_Null;
+    }
+#ifndef SQLITE_OMIT_BATCH_EXECUTE
+    if( p->pBatch ){
+        sqlite3DbFree(db, p->pBatch);
+        p->pBatch = 0;
+    }
+#endif
+#ifndef SQLITE_OMIT_ZEROCOPY
+    p->bZeroCopy = 0;
+#endif
+    p->bOpProfile = 0;
+#ifndef SQLITE_OMIT_OPCODE_PROFILE
+    sqlite3DbFree(db, p->aOpStat);
+    p->aOpStat = 0;
+#endif
+    memset(p->aCounter, 0, sizeof(p->aCounter));
+    
+    /* A statement prepared before the cache was enabled has no key.  Park
+     ** it under the hash of its own text. */
+    if( p->iCacheHash==0 ){
+        p->iCacheHash = stmtCacheHash(p->zSql, sqlite3Strlen30(p->zSql));
+    }
+    
+    /* Take p off the list of statements of the connection */
+    if( p->pPrev ){
+        p->pPrev->pNext = p->pNext;
+    }else{
+        assert( db->pVdbe==p );
+        db->pVdbe = p->pNext;
+    }
+    if( p->pNext ){
+        p->pNext->pPrev = p->pPrev;
+    }
+    p->pPrev = p->pNext = 0;
+    
+    p->pCacheNext = pCache->apHash[p->iCacheHash & (pCache->nHash-1)];
+    pCache->apHash[p->iCacheHash & (pCache->nHash-1)] = p;
+    p->pLruPrev = pCache->pMru;
+    p->pLruNext = 0;
+    if( pCache->pMru ){
+        pCache->pMru->pLruNext = p;
+    }else{
+        pCache->pLru = p;
+    }
+    pCache->pMru = p;
+    p->bCached = 1;
+    pCache->nStmt++;
+    stmtCacheTrim(pCache, pCache->nMax);
+    *pRc = rc;
+    return 1;
+}
+
+/*
+ ** Implementation of the SQLITE_DBSTATUS_STMTCACHE_HIT, _MISS and _USED
+ ** verbs of sqlite3_db_status().
+ */
+SQLITE_PRIVATE void sqlite3VdbeCacheStatus(
+    sqlite3 *db,                  /* Database connection */
+    int op,                       /* SQLITE_DBSTATUS_STMTCACHE_xxx */
+    int resetFlag,                /* Reset the hit or miss counter */
+    int *pCurrent,                /* OUT: Current value */
+    int *pHighwater               /* OUT: Highwater value */
+){
+    StmtCache *pCache = stmtCacheGet(db);
+    *pCurrent = 0;
+    *pHighwater = 0;
+    if( pCache==0 ) return;
+    switch( op ){
+        case SQLITE_DBSTATUS_STMTCACHE_HIT: {
+            *pCurrent = pCache->nHit;
+            if( resetFlag ) pCache->nHit = 0;
+            break;
+        }
+        case SQLITE_DBSTATUS_STMTCACHE_MISS: {
+            *pCurrent = pCache->nMiss;
+            if( resetFlag ) pCache->nMiss = 0;
+            break;
+        }
+        default: {
+            assert( op==SQLITE_DBSTATUS_STMTCACHE_USED );
+            *pCurrent = pCache->nStmt;
+            *pHighwater = pCache->nMax;
+            break;
+        }
+    }
+}
+
+#endif /* SQLITE_OMIT_STMT_CACHE */
+
+/************** End of vdbecache.c *******************************************/
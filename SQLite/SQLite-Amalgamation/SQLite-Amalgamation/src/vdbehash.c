@@ -0,0 +1,761 @@
+/************** Begin file vdbehash.c ****************************************/
+/*
+ ** 2013 November 2
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file contains the hash tables opened by OP_HashOpen.  They are used
+ ** in two ways:
+ **
+ **    *  By OP_HashInsert, OP_HashProbe and OP_HashNext to code a hash join.
+ **       See hashJoin() in select.c.
+ **
+ **    *  By OP_HashGroup, OP_HashSort and OP_HashGroupNext to code a GROUP BY
+ **       query by hash aggregation.  See the GROUP BY code in sqlite3Select().
+ **
+ ** The build side of the join inserts one entry for each of its rows.  An
+ ** entry is a 64-bit hash of the join key values and the rowid of the row.
+ ** The key values themselves are not stored.  A probe returns the rowid of
+ ** every entry with the same hash as the probe key, and the caller seeks
+ ** the build table to each rowid and evaluates the join condition against
+ ** the row found there.  So a hash collision costs a wasted seek, but can
+ ** never produce a wrong result, as long as any two key values that the
+ ** join condition considers equal hash to the same value.  To ensure that:
+ **
+ **    *  The caller applies the comparison affinity to the key values on
+ **       both sides before they are hashed, and only uses a hash join for
+ **       comparisons with the BINARY collating sequence.
+ **
+ **    *  Integers and reals are hashed by their value as a double, which
+ **       is how sqlite3MemCompare() compares an integer with a real.
+ **
+ **    *  A key containing a NULL is never inserted, and a probe with such
+ **       a key never matches, as NULL is not equal to anything.
+ **
+ ** Entries are kept in an array in memory.  If the array grows larger than
+ ** the page cache of the main database, it is moved to a temporary b-tree
+ ** and all further entries go there as well.  The b-tree is an intkey
+ ** table whose keys are made from the top 31 bits of the hash and a
+ ** sequence number, so that the entries for a hash are found by seeking to
+ ** the first key for it.  The data of each b-tree entry is the full 64-bit
+ ** hash followed by the rowid as a varint.
+ **
+ ** For hash aggregation, the table holds one HashGroup object for each
+ ** distinct GROUP BY key seen.  A group stores copies of its key values and
+ ** the contents of the aggregate accumulator registers of the group.  For
+ ** each input row, OP_HashGroup saves the accumulators of the previous
+ ** row's group (if it was different) and moves those of the new row's group
+ ** into the registers, so that the usual OP_AggStep code can update them.
+ ** Moving a Mem is a struct copy, so this is cheap.  Here two keys are the
+ ** same if sqlite3MemCompare() considers them equal with the BINARY
+ ** collating sequence, and keys with NULL values are allowed, since GROUP BY
+ ** puts all NULLs in a single group.
+ **
+ ** Aggregation does not spill to disk.  If a new group would take the table
+ ** over the same memory limit, OP_HashGroup jumps instead, and the caller
+ ** passes the row to the sorter used by the usual GROUP BY code.  Each group
+ ** is then either entirely in the hash table or entirely in the sorter.
+ **
+ ** The memory counted against the limit is that of the groups, their key
+ ** values and their accumulators, including the buffer each accumulator
+ ** Mem owns, such as the context of an aggregate function.  Accumulators
+ ** are measured each time their group is saved, so a group that grows
+ ** stops new groups from being created.  Memory that an aggregate function
+ ** allocates on its own, outside its context, cannot be seen here and is
+ ** not counted.  The text that group_concat() builds is such memory.  Only
+ ** sqlite3HeapNearlyFull() guards against that memory.
+ */
+
+#include "vdbeInt.h"
+
+#if !defined(SQLITE_OMIT_HASH_JOIN) || !defined(SQLITE_OMIT_HASH_AGGREGATE)
+
+/*
+ ** Minimum number of pages of memory that a hash table may use before it
+ ** is moved to a temporary b-tree or stops accepting new groups.
+ */
+#define HASH_MIN_WORKING 10
+
+typedef struct HashEntry HashEntry;
+typedef struct HashGroup HashGroup;
+
+/*
+ ** An entry in the in-memory table.
+ */
+struct HashEntry {
+    u64 h;                    /* Hash of the key */
+    i64 iRowid;               /* Rowid of the build-side row */
+};
+
+/*
+ ** A group in a hash aggregation table.  aMem[] holds the nKey key values
+ ** followed by the nAcc accumulators of the group.
+ */
+struct HashGroup {
+    u64 h;                    /* Hash of the key */
+    int iNext;                /* Next group in the same bucket plus 1, or 0 */
+    i64 nAccByte;             /* Accumulator bytes counted in VdbeHash.nUsed */
+    Mem *aMem;                /* Key values and accumulators */
+};
+
+/*
+ ** A hash table opened by OP_HashOpen.
+ **
+ ** aBucket[] and aNext[] link the entries of aEntry[] into chains, one for
+ ** each bucket.  Both hold entry numbers plus one, so that zero marks the
+ ** end of a chain.  They are built by the first probe after an insert.
+ ** A hash aggregation table uses aBucket[] with HashGroup.iNext instead,
+ ** and keeps them up to date as groups are added.
+ */
+struct VdbeHash {
+    int nKey;                 /* Number of key values */
+    i64 mxMem;                /* Move entries to a b-tree above this.  0: never */
+    int nEntry;               /* Number of entries in aEntry[] */
+    int nAlloc;               /* Allocated size of aEntry[] */
+    HashEntry *aEntry;        /* In-memory entries, in insertion order */
+    int nBucket;              /* Number of buckets.  A power of 2, or 0 */
+    int *aBucket;             /* First entry of each chain */
+    int *aNext;               /* Next entry of each chain */
+    u64 hProbe;               /* Hash of the most recent probe key */
+    int iProbe;               /* Current match in aEntry[] plus 1, or 0 */
+    u8 bSpilled;              /* True once entries are in the b-tree */
+    u8 bFull;                 /* True once a new group has been refused */
+    i64 nSpill;               /* Number of entries written to the b-tree */
+    int nAcc;                 /* Number of accumulators.  0 for a join table */
+    int nGroup;               /* Number of groups in apGroup[] */
+    int nGroupAlloc;          /* Allocated size of apGroup[] */
+    HashGroup **apGroup;      /* Groups, in insertion order or sorted */
+    int iLoaded;              /* Group whose accumulators are in registers, or -1 */
+    int iOut;                 /* Next group to return from OP_HashGroupNext */
+    i64 nUsed;                /* Approximate bytes used by groups */
+};
+
+/*
+ ** Open a hash table for keys of nKey values on cursor pCsr, which was
+ ** allocated with room for a b-tree cursor.  If nAcc is zero, the table is
+ ** for a hash join.  Otherwise it is for hash aggregation with nAcc
+ ** accumulator registers.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashOpen(sqlite3 *db, VdbeCursor *pCsr, int nKey, int nAcc){
+    VdbeHash *pHash;
+    
+    assert( pCsr->pHash==0 && pCsr->pBt==0 && pCsr->pCursor!=0 );
+    pCsr->pHash = pHash = sqlite3DbMallocZero(db, sizeof(VdbeHash));
+    if( pHash==0 ) return SQLITE_NOMEM;
+    pHash->nKey = nKey;
+    pHash->nAcc = nAcc;
+    pHash->iLoaded = -1;
+    if( !sqlite3TempInMemory(db) ){
+        int pgsz = sqlite3BtreeGetPageSize(db->aDb[0].pBt);
+        int mxCache = db->aDb[0].pSchema->cache_size;
+        if( mxCache<HASH_MIN_WORKING ) mxCache = HASH_MIN_WORKING;
+        pHash->mxMem = (i64)mxCache * pgsz;
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Free the hash table of cursor pCsr, if it has one.  A temporary b-tree
+ ** is closed by sqlite3VdbeFreeCursor().
+ */
+SQLITE_PRIVATE void sqlite3VdbeHashClose(sqlite3 *db, VdbeCursor *pCsr){
+    VdbeHash *pHash = pCsr->pHash;
+    if( pHash ){
+        int i, j;
+        for(i=0; i<pHash->nGroup; i++){
+            HashGroup *pGroup = pHash->apGroup[i];
+            for(j=0; j<pHash->nKey+pHash->nAcc; j++){
+                sqlite3VdbeMemRelease(&pGroup->aMem[j]);
+            }
+            sqlite3DbFree(db, pGroup);
+        }
+        sqlite3_free(pHash->apGroup);
+        sqlite3_free(pHash->aEntry);
+        sqlite3_free(pHash->aBucket);
+        sqlite3_free(pHash->aNext);
+        sqlite3DbFree(db, pHash);
+        pCsr->pHash = 0;
+    }
+}
+
+/*
+ ** Add n bytes at z to hash h using FNV-1a.
+ */
+static u64 vdbeHashBytes(u64 h, const u8 *z, int n){
+    int i;
+    for(i=0; i<n; i++){
+        h = (h ^ z[i]) * (((u64)0x100<<32) | 0x1b3);
+    }
+    return h;
+}
+
+/*
+ ** Compute the hash of the nKey values in aKey[] and write it to *pH.
+ ** Return SQLITE_OK, or an error code if a value could not be converted.
+ ** If one of the values is NULL and bNull is false, return SQLITE_DONE.
+ */
+static int vdbeHashKey(sqlite3 *db, Mem *aKey, int nKey, int bNull, u64 *pH){
+    u64 h = (((u64)0xcbf29ce4)<<32) | 0x84222325;
+    int i;
+    
+    for(i=0; i<nKey; i++){
+        Mem *pMem = &aKey[i];
+        u8 eType;
+        if( pMem->flags & MEM_Null ){
+            if( !bNull ) return SQLITE_DONE;
+            eType = SQLITE_NULL;
+            h = vdbeHashBytes(h, &eType, 1);
+        }else if( pMem->flags & (MEM_Int|MEM_Real) ){
+            double r = (pMem->flags & MEM_Real) ? pMem->r : (double)pMem->u.i;
+            u8 aBuf[8];
+            u64 x;
+            int j;
+            if( r==0.0 ) r = 0.0;     /* Hash -0.0 the same as +0.0 */
+            memcpy(&x, &r, sizeof(x));
+            for(j=0; j<8; j++) aBuf[j] = (u8)(x >> (j*8));
+            eType = SQLITE_FLOAT;
+            h = vdbeHashBytes(h, &eType, 1);
+            h = vdbeHashBytes(h, aBuf, 8);
+        }else{
+            int rc;
+            if( pMem->flags & MEM_Str ){
+                rc = sqlite3VdbeChangeEncoding(pMem, ENC(db));
+                eType = SQLITE_TEXT;
+            }else{
+                rc = sqlite3VdbeMemExpandBlob(pMem);
+                eType = SQLITE_BLOB;
+            }
+            if( rc ) return rc;
+            h = vdbeHashBytes(h, &eType, 1);
+            h = vdbeHashBytes(h, (const u8*)pMem->z, pMem->n);
+        }
+    }
+    *pH = h;
+    return SQLITE_OK;
+}
+
+#ifndef SQLITE_OMIT_HASH_JOIN
+/*
+ ** The intkey table key of the b-tree entry with hash h and sequence
+ ** number iSeq.
+ */
+#define HASH_BTREE_KEY(h, iSeq) ((i64)(((h)>>33)<<32) | ((iSeq) & 0xffffffff))
+
+/*
+ ** Write an entry to the temporary b-tree of pCsr.
+ */
+static int vdbeHashBtreeInsert(VdbeCursor *pCsr, u64 h, i64 iRowid){
+    VdbeHash *pHash = pCsr->pHash;
+    u8 aData[8+9];
+    int n;
+    
+    if( pHash->nSpill>=((i64)1<<32) ) return SQLITE_FULL;
+    for(n=0; n<8; n++) aData[n] = (u8)(h >> (56 - n*8));
+    n = 8 + sqlite3PutVarint(&aData[8], (u64)iRowid);
+    return sqlite3BtreeInsert(pCsr->pCursor, 0,
+                              HASH_BTREE_KEY(h, pHash->nSpill++), aData, n, 0, 0, 0);
+}
+
+/*
+ ** Move the in-memory entries of pCsr to a new temporary b-tree.
+ */
+static int vdbeHashSpill(sqlite3 *db, VdbeCursor *pCsr){
+    static const int vfsFlags =
+    SQLITE_OPEN_READWRITE |
+    SQLITE_OPEN_CREATE |
+    SQLITE_OPEN_EXCLUSIVE |
+    SQLITE_OPEN_DELETEONCLOSE |
+    SQLITE_OPEN_TRANSIENT_DB;
+    VdbeHash *pHash = pCsr->pHash;
+    int rc;
+    int i;
+    
+    rc = sqlite3BtreeOpen(db->pVfs, 0, db, &pCsr->pBt,
+                          BTREE_OMIT_JOURNAL | BTREE_SINGLE, vfsFlags);
+    if( rc==SQLITE_OK ){
+        rc = sqlite3BtreeBeginTrans(pCsr->pBt, 1);
+    }
+    if( rc==SQLITE_OK ){
+        rc = sqlite3BtreeCursor(pCsr->pBt, MASTER_ROOT, 1, 0, pCsr->pCursor);
+    }
+    for(i=0; rc==SQLITE_OK && i<pHash->nEntry; i++){
+        rc = vdbeHashBtreeInsert(pCsr, pHash->aEntry[i].h, pHash->aEntry[i].iRowid);
+    }
+    if( rc==SQLITE_OK ){
+        pHash->bSpilled = 1;
+        sqlite3_free(pHash->aEntry);
+        sqlite3_free(pHash->aBucket);
+        sqlite3_free(pHash->aNext);
+        pHash->aEntry = 0;
+        pHash->aBucket = 0;
+        pHash->aNext = 0;
+        pHash->nEntry = pHash->nAlloc = pHash->nBucket = 0;
+    }
+    return rc;
+}
+
+/*
+ ** Insert an entry into the hash table of cursor pCsr.  The nKey key values
+ ** are in aKey[0] to aKey[nKey-1], and the rowid is in aKey[nKey].
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashInsert(sqlite3 *db, VdbeCursor *pCsr, Mem *aKey){
+    VdbeHash *pHash = pCsr->pHash;
+    u64 h;
+    int rc;
+    
+    assert( pHash );
+    rc = vdbeHashKey(db, aKey, pHash->nKey, 0, &h);
+    if( rc!=SQLITE_OK ) return (rc==SQLITE_DONE ? SQLITE_OK : rc);
+    assert( aKey[pHash->nKey].flags & MEM_Int );
+    
+    if( !pHash->bSpilled && pHash->nEntry>=pHash->nAlloc ){
+        int nNew = pHash->nAlloc ? pHash->nAlloc*2 : 64;
+        HashEntry *aNew = 0;
+        if( pHash->mxMem==0
+         || ((i64)nNew*sizeof(HashEntry)<=pHash->mxMem && !sqlite3HeapNearlyFull())
+        ){
+            aNew = (HashEntry*)sqlite3_realloc(pHash->aEntry, nNew*sizeof(HashEntry));
+        }
+        if( aNew ){
+            pHash->aEntry = aNew;
+            pHash->nAlloc = nNew;
+        }else if( pHash->mxMem==0 ){
+            return SQLITE_NOMEM;
+        }else{
+            rc = vdbeHashSpill(db, pCsr);
+            if( rc ) return rc;
+        }
+    }
+    
+    if( pHash->bSpilled ){
+        return vdbeHashBtreeInsert(pCsr, h, aKey[pHash->nKey].u.i);
+    }
+    pHash->aEntry[pHash->nEntry].h = h;
+    pHash->aEntry[pHash->nEntry].iRowid = aKey[pHash->nKey].u.i;
+    pHash->nEntry++;
+    pHash->nBucket = 0;
+    return SQLITE_OK;
+}
+
+/*
+ ** Link the in-memory entries into bucket chains.
+ */
+static int vdbeHashBuildBuckets(VdbeHash *pHash){
+    int nBucket = 16;
+    int i;
+    
+    while( nBucket<pHash->nEntry ) nBucket *= 2;
+    sqlite3_free(pHash->aBucket);
+    sqlite3_free(pHash->aNext);
+    pHash->aBucket = (int*)sqlite3MallocZero(nBucket*sizeof(int));
+    pHash->aNext = (int*)sqlite3Malloc((pHash->nEntry+1)*sizeof(int));
+    if( pHash->aBucket==0 || pHash->aNext==0 ) return SQLITE_NOMEM;
+    
+    /* Insert in reverse so that each chain is in insertion order */
+    for(i=pHash->nEntry-1; i>=0; i--){
+        int iBucket = (int)(pHash->aEntry[i].h & (nBucket-1));
+        pHash->aNext[i] = pHash->aBucket[iBucket];
+        pHash->aBucket[iBucket] = i+1;
+    }
+    pHash->nBucket = nBucket;
+    return SQLITE_OK;
+}
+
+/*
+ ** Set *pbFound to true and store the rowid of the entry at the current
+ ** position of the b-tree cursor of pCsr in pOut if that entry has hash
+ ** pHash->hProbe.  Otherwise set *pbFound to false.
+ */
+static int vdbeHashBtreeMatch(VdbeCursor *pCsr, Mem *pOut, int *pbFound){
+    VdbeHash *pHash = pCsr->pHash;
+    const u8 *aData;
+    int nData;
+    i64 iKey;
+    u64 h;
+    u64 iRowid;
+    int i;
+    
+    while( !sqlite3BtreeEof(pCsr->pCursor) ){
+        int res = 0;
+        int rc;
+        VVA_ONLY(rc =) sqlite3BtreeKeySize(pCsr->pCursor, &iKey);
+        assert( rc==SQLITE_OK );
+        if( (iKey>>32)!=(i64)(pHash->hProbe>>33) ) break;
+        aData = (const u8*)sqlite3BtreeDataFetch(pCsr->pCursor, &nData);
+        if( aData==0 || nData<9 ) return SQLITE_CORRUPT_BKPT;
+        for(h=0, i=0; i<8; i++) h = (h<<8) | aData[i];
+        if( h==pHash->hProbe ){
+            sqlite3GetVarint(&aData[8], &iRowid);
+            sqlite3VdbeMemSetInt64(pOut, (i64)iRowid);
+            *pbFound = 1;
+            return SQLITE_OK;
+        }
+        rc = sqlite3BtreeNext(pCsr->pCursor, &res);
+        if( rc ) return rc;
+    }
+    *pbFound = 0;
+    return SQLITE_OK;
+}
+
+/*
+ ** Look up the key held in aKey[0] to aKey[nKey-1] in the hash table of
+ ** pCsr.  If there is an entry with the same hash, store its rowid in
+ ** aKey[nKey] and set *pbFound to true.  Otherwise set *pbFound to false.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashProbe(sqlite3 *db, VdbeCursor *pCsr, Mem *aKey, int *pbFound){
+    VdbeHash *pHash = pCsr->pHash;
+    int rc;
+    int i;
+    
+    assert( pHash );
+    *pbFound = 0;
+    pHash->iProbe = 0;
+    rc = vdbeHashKey(db, aKey, pHash->nKey, 0, &pHash->hProbe);
+    if( rc!=SQLITE_OK ) return (rc==SQLITE_DONE ? SQLITE_OK : rc);
+    
+    if( pHash->bSpilled ){
+        int res;
+        i64 iKey = HASH_BTREE_KEY(pHash->hProbe, 0);
+        rc = sqlite3BtreeMovetoUnpacked(pCsr->pCursor, 0, iKey, 0, &res);
+        if( rc==SQLITE_OK && res<0 && !sqlite3BtreeEof(pCsr->pCursor) ){
+            rc = sqlite3BtreeNext(pCsr->pCursor, &res);
+        }
+        if( rc==SQLITE_OK ){
+            rc = vdbeHashBtreeMatch(pCsr, &aKey[pHash->nKey], pbFound);
+        }
+        return rc;
+    }
+    
+    if( pHash->nEntry==0 ) return SQLITE_OK;
+    if( pHash->nBucket==0 ){
+        rc = vdbeHashBuildBuckets(pHash);
+        if( rc ) return rc;
+    }
+    i = pHash->aBucket[pHash->hProbe & (pHash->nBucket-1)];
+    while( i && pHash->aEntry[i-1].h!=pHash->hProbe ) i = pHash->aNext[i-1];
+    if( i ){
+        pHash->iProbe = i;
+        sqlite3VdbeMemSetInt64(&aKey[pHash->nKey], pHash->aEntry[i-1].iRowid);
+        *pbFound = 1;
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Advance to the next entry with the same hash as the most recent
+ ** sqlite3VdbeHashProbe() on pCsr.  If there is one, store its rowid in
+ ** aKey[nKey] and set *pbFound to true.  Otherwise set *pbFound to false.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashNext(VdbeCursor *pCsr, Mem *aKey, int *pbFound){
+    VdbeHash *pHash = pCsr->pHash;
+    int i;
+    
+    assert( pHash );
+    *pbFound = 0;
+    if( pHash->bSpilled ){
+        int res;
+        int rc = sqlite3BtreeNext(pCsr->pCursor, &res);
+        if( rc==SQLITE_OK ){
+            rc = vdbeHashBtreeMatch(pCsr, &aKey[pHash->nKey], pbFound);
+        }
+        return rc;
+    }
+    
+    i = pHash->iProbe;
+    if( i==0 ) return SQLITE_OK;
+    i = pHash->aNext[i-1];
+    while( i && pHash->aEntry[i-1].h!=pHash->hProbe ) i = pHash->aNext[i-1];
+    pHash->iProbe = i;
+    if( i ){
+        sqlite3VdbeMemSetInt64(&aKey[pHash->nKey], pHash->aEntry[i-1].iRowid);
+        *pbFound = 1;
+    }
+    return SQLITE_OK;
+}
+#endif /* SQLITE_OMIT_HASH_JOIN */
+
+#ifndef SQLITE_OMIT_HASH_AGGREGATE
+/*
+ ** Return true if the key values of group pGroup are the same as the nKey
+ ** values in aKey[].
+ */
+static int vdbeHashGroupMatch(HashGroup *pGroup, Mem *aKey, int nKey){
+    int i;
+    for(i=0; i<nKey; i++){
+        if( sqlite3MemCompare(&pGroup->aMem[i], &aKey[i], 0)!=0 ) return 0;
+    }
+    return 1;
+}
+
+/*
+ ** If the accumulators of a group are in the registers at aAcc[], move them
+ ** back into the group.  This leaves the registers set to NULL.  The memory
+ ** the accumulators hold is added to the total used by the table.
+ */
+static int vdbeHashGroupSave(VdbeHash *pHash, Mem *aAcc){
+    if( pHash->iLoaded>=0 ){
+        HashGroup *pGroup = pHash->apGroup[pHash->iLoaded];
+        i64 nAccByte = 0;
+        int i;
+        for(i=0; i<pHash->nAcc; i++){
+            Mem *pMem = &pGroup->aMem[pHash->nKey+i];
+            if( aAcc[i].flags & MEM_Ephem ){
+                int rc = sqlite3VdbeMemMakeWriteable(&aAcc[i]);
+                if( rc ) return rc;
+            }
+            sqlite3VdbeMemMove(pMem, &aAcc[i]);
+            if( pMem->zMalloc ){
+                nAccByte += sqlite3DbMallocSize(pMem->db, pMem->zMalloc);
+            }
+        }
+        pHash->nUsed += nAccByte - pGroup->nAccByte;
+        pGroup->nAccByte = nAccByte;
+        pHash->iLoaded = -1;
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Move the accumulators of group iGroup into the registers at aAcc[].
+ */
+static void vdbeHashGroupLoad(VdbeHash *pHash, int iGroup, Mem *aAcc){
+    HashGroup *pGroup = pHash->apGroup[iGroup];
+    int i;
+    for(i=0; i<pHash->nAcc; i++){
+        sqlite3VdbeMemMove(&aAcc[i], &pGroup->aMem[pHash->nKey+i]);
+    }
+}
+
+/*
+ ** Rebuild the buckets of a hash aggregation table with nBucket buckets.
+ */
+static int vdbeHashGroupRehash(VdbeHash *pHash, int nBucket){
+    int *aNew;
+    int i;
+    
+    aNew = (int*)sqlite3MallocZero(nBucket*sizeof(int));
+    if( aNew==0 ) return SQLITE_NOMEM;
+    sqlite3_free(pHash->aBucket);
+    pHash->aBucket = aNew;
+    pHash->nBucket = nBucket;
+    for(i=0; i<pHash->nGroup; i++){
+        HashGroup *pGroup = pHash->apGroup[i];
+        int iBucket = (int)(pGroup->h & (nBucket-1));
+        pGroup->iNext = aNew[iBucket];
+        aNew[iBucket] = i+1;
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Find the group for the key held in aKey[0] to aKey[nKey-1] in the hash
+ ** aggregation table of cursor pCsr and move its accumulators into the
+ ** registers at aAcc[], after moving those of the previously loaded group
+ ** back into that group.  If there is no such group, create one with NULL
+ ** accumulators.
+ **
+ ** If a new group is needed but the table has reached its memory limit,
+ ** set *pbFull to true and leave the registers at aAcc[] set to NULL.
+ ** Otherwise set *pbFull to false.  Once a group has been refused, no
+ ** new group is created for the rest of the scan, even if memory has been
+ ** freed in the meantime.  Otherwise the rows of a group could be split
+ ** between a group in the table and the caller's fallback path.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashGroup(
+                                         sqlite3 *db,
+                                         VdbeCursor *pCsr,
+                                         Mem *aKey,
+                                         Mem *aAcc,
+                                         int *pbFull
+){
+    VdbeHash *pHash = pCsr->pHash;
+    HashGroup *pGroup;
+    int nMem;
+    i64 nByte;
+    u64 h;
+    int rc;
+    int i;
+    
+    assert( pHash && pHash->nAcc>0 );
+    *pbFull = 0;
+    rc = vdbeHashKey(db, aKey, pHash->nKey, 1, &h);
+    if( rc ) return rc;
+    
+    /* Rows of the same group often arrive together.  Check the group that
+     ** is already loaded before searching the table. */
+    if( pHash->iLoaded>=0 ){
+        pGroup = pHash->apGroup[pHash->iLoaded];
+        if( pGroup->h==h && vdbeHashGroupMatch(pGroup, aKey, pHash->nKey) ){
+            return SQLITE_OK;
+        }
+    }
+    rc = vdbeHashGroupSave(pHash, aAcc);
+    if( rc ) return rc;
+    
+    i = pHash->nBucket ? pHash->aBucket[h & (pHash->nBucket-1)] : 0;
+    while( i ){
+        pGroup = pHash->apGroup[i-1];
+        if( pGroup->h==h && vdbeHashGroupMatch(pGroup, aKey, pHash->nKey) ) break;
+        i = pGroup->iNext;
+    }
+    if( i ){
+        vdbeHashGroupLoad(pHash, i-1, aAcc);
+        pHash->iLoaded = i-1;
+        return SQLITE_OK;
+    }
+    
+    /* A new group.  Its accumulators are still NULL, so only the group and
+     ** its key values are counted here.  The accumulators are counted by
+     ** vdbeHashGroupSave(). */
+    nMem = pHash->nKey + pHash->nAcc;
+    nByte = sizeof(HashGroup) + nMem*sizeof(Mem) + sizeof(HashGroup*) + sizeof(int);
+    for(i=0; i<pHash->nKey; i++){
+        if( aKey[i].flags & (MEM_Str|MEM_Blob) ) nByte += aKey[i].n;
+    }
+    if( pHash->bFull || (pHash->mxMem
+     && (pHash->nUsed+nByte>pHash->mxMem || sqlite3HeapNearlyFull()))
+    ){
+        pHash->bFull = 1;
+        *pbFull = 1;
+        return SQLITE_OK;
+    }
+    if( pHash->nGroup>=pHash->nGroupAlloc ){
+        int nNew = pHash->nGroupAlloc ? pHash->nGroupAlloc*2 : 64;
+        HashGroup **apNew;
+        apNew = (HashGroup**)sqlite3_realloc(pHash->apGroup, nNew*sizeof(HashGroup*));
+        if( apNew==0 ) return SQLITE_NOMEM;
+        pHash->apGroup = apNew;
+        pHash->nGroupAlloc = nNew;
+    }
+    pGroup = (HashGroup*)sqlite3DbMallocZero(db, sizeof(HashGroup) + nMem*sizeof(Mem));
+    if( pGroup==0 ) return SQLITE_NOMEM;
+    pGroup->aMem = (Mem*)&pGroup[1];
+    for(i=0; i<nMem; i++){
+        pGroup->aMem[i].flags = MEM_Null;
+        pGroup->aMem[i].db = db;
+    }
+    pHash->apGroup[pHash->nGroup++] = pGroup;
+    for(i=0; rc==SQLITE_OK && i<pHash->nKey; i++){
+        rc = sqlite3VdbeMemCopy(&pGroup->aMem[i], &aKey[i]);
+    }
+    if( rc ) return rc;
+    pGroup->h = h;
+    pHash->nUsed += nByte;
+    
+    if( pHash->nGroup>pHash->nBucket ){
+        rc = vdbeHashGroupRehash(pHash, pHash->nBucket ? pHash->nBucket*2 : 64);
+    }else{
+        int iBucket = (int)(h & (pHash->nBucket-1));
+        pGroup->iNext = pHash->aBucket[iBucket];
+        pHash->aBucket[iBucket] = pHash->nGroup;
+    }
+    if( rc==SQLITE_OK ){
+        for(i=0; i<pHash->nAcc; i++) sqlite3VdbeMemSetNull(&aAcc[i]);
+        pHash->iLoaded = pHash->nGroup-1;
+    }
+    return rc;
+}
+
+/*
+ ** Compare the keys of groups p1 and p2 of hash table pHash in the same
+ ** way as the sorter used by GROUP BY with the BINARY collating sequence.
+ */
+static int vdbeHashGroupCompare(VdbeHash *pHash, HashGroup *p1, HashGroup *p2){
+    int i;
+    for(i=0; i<pHash->nKey; i++){
+        int c = sqlite3MemCompare(&p1->aMem[i], &p2->aMem[i], 0);
+        if( c ) return c;
+    }
+    return 0;
+}
+
+/*
+ ** Sort the groups of hash table pHash into key order using a merge sort.
+ */
+static int vdbeHashGroupSort(VdbeHash *pHash){
+    HashGroup **aTmp;
+    HashGroup **aIn = pHash->apGroup;
+    int n = pHash->nGroup;
+    int nRun;
+    
+    if( n<2 ) return SQLITE_OK;
+    aTmp = (HashGroup**)sqlite3_malloc(n*sizeof(HashGroup*));
+    if( aTmp==0 ) return SQLITE_NOMEM;
+    for(nRun=1; nRun<n; nRun*=2){
+        HashGroup **aOut = (aIn==aTmp) ? pHash->apGroup : aTmp;
+        int iStart;
+        for(iStart=0; iStart<n; iStart+=nRun*2){
+            int i1 = iStart;
+            int i2 = iStart+nRun;
+            int e1 = (i2<n) ? i2 : n;
+            int e2 = (i2+nRun<n) ? i2+nRun : n;
+            int iOut = iStart;
+            while( i1<e1 || i2<e2 ){
+                if( i2>=e2 || (i1<e1 && vdbeHashGroupCompare(pHash, aIn[i1], aIn[i2])<=0) ){
+                    aOut[iOut++] = aIn[i1++];
+                }else{
+                    aOut[iOut++] = aIn[i2++];
+                }
+            }
+        }
+        aIn = aOut;
+    }
+    if( aIn!=pHash->apGroup ){
+        memcpy(pHash->apGroup, aIn, n*sizeof(HashGroup*));
+    }
+    sqlite3_free(aTmp);
+    return SQLITE_OK;
+}
+
+/*
+ ** Sort the groups of the hash aggregation table of cursor pCsr into key
+ ** order and move the accumulators of the first group into the registers
+ ** at aAcc[].  Set *pbFound to false if the table has no groups.
+ **
+ ** After this call no more groups may be added.  The buckets are no longer
+ ** valid once the groups have been sorted.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashSort(VdbeCursor *pCsr, Mem *aAcc, int *pbFound){
+    VdbeHash *pHash = pCsr->pHash;
+    int rc;
+    
+    assert( pHash && pHash->nAcc>0 );
+    *pbFound = 0;
+    rc = vdbeHashGroupSave(pHash, aAcc);
+    if( rc==SQLITE_OK ) rc = vdbeHashGroupSort(pHash);
+    if( rc ) return rc;
+    sqlite3_free(pHash->aBucket);
+    pHash->aBucket = 0;
+    pHash->nBucket = 0;
+    pHash->iOut = 0;
+    return sqlite3VdbeHashGroupNext(pCsr, aAcc, pbFound);
+}
+
+/*
+ ** Move the accumulators of the next group, in the order established by
+ ** sqlite3VdbeHashSort(), into the registers at aAcc[] and set *pbFound to
+ ** true.  Or, if there are no more groups, set *pbFound to false.
+ */
+SQLITE_PRIVATE int sqlite3VdbeHashGroupNext(VdbeCursor *pCsr, Mem *aAcc, int *pbFound){
+    VdbeHash *pHash = pCsr->pHash;
+    
+    assert( pHash && pHash->nAcc>0 && pHash->iLoaded<0 );
+    if( pHash->iOut<pHash->nGroup ){
+        vdbeHashGroupLoad(pHash, pHash->iOut++, aAcc);
+        *pbFound = 1;
+    }else{
+        *pbFound = 0;
+    }
+    return SQLITE_OK;
+}
+#endif /* SQLITE_OMIT_HASH_AGGREGATE */
+#endif /* !SQLITE_OMIT_HASH_JOIN || !SQLITE_OMIT_HASH_AGGREGATE */
+
+/************** End of vdbehash.c ********************************************/
@@ -0,0 +1,356 @@
+/************** Begin file vdbememo.c ****************************************/
+/*
+ ** 2013 November 5
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file contains the result cache for correlated scalar subqueries
+ ** enabled on a database connection by sqlite3_subquery_cache().  For a
+ ** query such as:
+ **
+ **     SELECT f.a, (SELECT name FROM dim WHERE dim.id=f.dim_id) FROM f
+ **
+ ** sqlite3CodeSubselect() evaluates the outer column values that the
+ ** subquery refers to (here f.dim_id) into registers and passes them to
+ ** OP_MemoLookup.  If the subquery has already been run with the same
+ ** values, the result stored by OP_MemoStore at the end of that run is
+ ** copied into the result register and the subquery is skipped.
+ **
+ ** Two keys match only if their values are identical: of the same type,
+ ** and with the same bytes for a string or blob or the same bits for a
+ ** real.  The cache holds a fixed number of results and discards the
+ ** least recently used when it is full.  It belongs to a cursor, so it is
+ ** discarded when the statement is reset.
+ **
+ ** The cache is only correct while the tables read by the subquery do
+ ** not change, so OP_MemoLookup and OP_MemoStore do nothing in statements
+ ** that write to the database.  sqlite3CodeSubselect() does not cache
+ ** subqueries that call random() or other built-in functions marked
+ ** SQLITE_FUNC_VOLATILE.
+ **
+ ** The size set by sqlite3_subquery_cache() is kept with the other
+ ** per-connection state of the VDBE (see sqlite3VdbeConnData()).
+ */
+
+#include "vdbeInt.h"
+
+#ifndef SQLITE_OMIT_SUBQUERY_CACHE
+
+/*
+ ** The largest number of results that sqlite3_subquery_cache() allows a
+ ** cache to hold.
+ */
+#define MEMO_MAX_SIZE 100000
+
+/*
+ ** The bits of Mem.flags that describe the value held.
+ */
+#define MEMO_TYPEMASK (MEM_Null|MEM_Int|MEM_Real|MEM_Str|MEM_Blob)
+
+typedef struct MemoEntry MemoEntry;
+
+/*
+ ** One cached subquery result.
+ */
+struct MemoEntry {
+    u32 h;                    /* Hash of the key */
+    MemoEntry *pHashNext;     /* Next entry in the same hash slot */
+    MemoEntry *pLruNext;      /* Next entry used more recently than this */
+    MemoEntry *pLruPrev;      /* Previous entry, used less recently */
+    Mem *aMem;                /* nKey key values followed by the result */
+};
+
+/*
+ ** A result cache opened by OP_MemoOpen.  Entries are linked into a hash
+ ** table by MemoEntry.pHashNext and into a list ordered by the time they
+ ** were last used by MemoEntry.pLruNext and pLruPrev.
+ */
+struct VdbeMemo {
+    int nKey;                 /* Number of key values */
+    int nMax;                 /* Largest number of entries */
+    int nEntry;               /* Number of entries */
+    int nHash;                /* Number of slots in apHash[].  A power of 2 */
+    MemoEntry **apHash;       /* Hash table of entries */
+    MemoEntry *pLru;          /* Entry to discard first */
+    MemoEntry *pMru;          /* Most recently used entry */
+};
+
+/*
+ ** Set the number of results that each correlated subquery in statements
+ ** prepared on connection db from now on may cache.  Zero disables the
+ ** cache.
+ */
+SQLITE_API int sqlite3_subquery_cache(sqlite3 *db, int nEntry){
+    VdbeConnData *pData;
+    int rc = SQLITE_OK;
+
+    if( !sqlite3SafetyCheckOk(db) ) return SQLITE_MISUSE_BKPT;
+    if( nEntry<0 ) nEntry = 0;
+    if( nEntry>MEMO_MAX_SIZE ) nEntry = MEMO_MAX_SIZE;
+    sqlite3_mutex_enter(db->mutex);
+    pData = sqlite3VdbeConnData(db, nEntry>0);
+    if( pData ){
+        pData->nMemo = nEntry;
+    }else if( nEntry>0 ){
+        rc = SQLITE_NOMEM;
+    }
+    rc = sqlite3ApiExit(db, rc);
+    sqlite3_mutex_leave(db->mutex);
+    return rc;
+}
+
+/*
+ ** Return the number of results a correlated subquery in a statement now
+ ** being prepared on connection db may cache, or zero if it may not.
+ */
+SQLITE_PRIVATE int sqlite3VdbeMemoSize(sqlite3 *db){
+    VdbeConnData *pData = sqlite3VdbeConnData(db, 0);
+    return pData ? pData->nMemo : 0;
+}
+
+/*
+ ** Open a cache of up to nMax results with keys of nKey values on cursor
+ ** pCsr.
+ */
+SQLITE_PRIVATE int sqlite3VdbeMemoOpen(sqlite3 *db, VdbeCursor *pCsr, int nKey, int nMax){
+    VdbeMemo *pMemo;
+
+    assert( pCsr->pMemo==0 && nKey>0 );
+    pCsr->pMemo = pMemo = sqlite3DbMallocZero(db, sizeof(VdbeMemo));
+    if( pMemo==0 ) return SQLITE_NOMEM;
+    pMemo->nKey = nKey;
+    pMemo->nMax = nMax>0 ? nMax : 1;
+    return SQLITE_OK;
+}
+
+/*
+ ** Release the values held by entry pEntry of pMemo.
+ */
+static void memoEntryClear(VdbeMemo *pMemo, MemoEntry *pEntry){
+    int i;
+    for(i=0; i<=pMemo->nKey; i++){
+        sqlite3VdbeMemRelease(&pEntry->aMem[i]);
+        pEntry->aMem[i].flags = MEM_Null;
+    }
+}
+
+/*
+ ** Free the result cache of cursor pCsr, if it has one.
+ */
+SQLITE_PRIVATE void sqlite3VdbeMemoClose(sqlite3 *db, VdbeCursor *pCsr){
+    VdbeMemo *pMemo = pCsr->pMemo;
+    if( pMemo ){
+        MemoEntry *pEntry, *pNext;
+        for(pEntry=pMemo->pLru; pEntry; pEntry=pNext){
+            pNext = pEntry->pLruNext;
+            memoEntryClear(pMemo, pEntry);
+            sqlite3DbFree(db, pEntry);
+        }
+        sqlite3_free(pMemo->apHash);
+        sqlite3DbFree(db, pMemo);
+        pCsr->pMemo = 0;
+    }
+}
+
+/*
+ ** Compute the hash of the nKey values in aKey[].  Blobs with a zero-filled
+ ** tail are expanded first, so that they compare by their bytes.
+ */
+static int memoHash(Mem *aKey, int nKey, u32 *pH){
+    u32 h = 0;
+    int i;
+
+    for(i=0; i<nKey; i++){
+        Mem *pMem = &aKey[i];
+        const u8 *z;
+        int n;
+        if( pMem->flags & MEM_Zero ){
+            int rc = sqlite3VdbeMemExpandBlob(pMem);
+            if( rc ) return rc;
+        }
+        h = (h<<3) ^ h ^ (pMem->flags & MEMO_TYPEMASK);
+        if( pMem->flags & (MEM_Str|MEM_Blob) ){
+            z = (const u8*)pMem->z;
+            n = pMem->n;
+        }else if( pMem->flags & MEM_Int ){
+            z = (const u8*)&pMem->u.i;
+            n = sizeof(i64);
+        }else if( pMem->flags & MEM_Real ){
+            z = (const u8*)&pMem->r;
+            n = sizeof(double);
+        }else{
+            n = 0;
+        }
+        while( n-- > 0 ){
+            h = (h<<3) ^ h ^ *(z++);
+        }
+    }
+    *pH = h;
+    return SQLITE_OK;
+}
+
+/*
+ ** Return true if the nKey values in aKey[] are identical to the key of
+ ** entry pEntry.
+ */
+static int memoMatch(MemoEntry *pEntry, Mem *aKey, int nKey){
+    int i;
+    for(i=0; i<nKey; i++){
+        Mem *p1 = &pEntry->aMem[i];
+        Mem *p2 = &aKey[i];
+        int f = p1->flags & MEMO_TYPEMASK;
+        if( f!=(p2->flags & MEMO_TYPEMASK) ) return 0;
+        if( (f & MEM_Int) && p1->u.i!=p2->u.i ) return 0;
+        if( (f & MEM_Real) && memcmp(&p1->r, &p2->r, sizeof(double)) ) return 0;
+        if( f & (MEM_Str|MEM_Blob) ){
+            if( p1->n!=p2->n || memcmp(p1->z, p2->z, p1->n) ) return 0;
+            if( (f & MEM_Str) && p1->enc!=p2->enc ) return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ ** Remove entry pEntry from the LRU list of pMemo.
+ */
+static void memoLruUnlink(VdbeMemo *pMemo, MemoEntry *pEntry){
+    if( pEntry->pLruPrev ){
+        pEntry->pLruPrev->pLruNext = pEntry->pLruNext;
+    }else{
+        pMemo->pLru = pEntry->pLruNext;
+    }
+    if( pEntry->pLruNext ){
+        pEntry->pLruNext->pLruPrev = pEntry->pLruPrev;
+    }else{
+        pMemo->pMru = pEntry->pLruPrev;
+    }
+    pEntry->pLruNext = pEntry->pLruPrev = 0;
+}
+
+/*
+ ** Add entry pEntry to the most recently used end of the LRU list.
+ */
+static void memoLruAppend(VdbeMemo *pMemo, MemoEntry *pEntry){
+    pEntry->pLruPrev = pMemo->pMru;
+    pEntry->pLruNext = 0;
+    if( pMemo->pMru ){
+        pMemo->pMru->pLruNext = pEntry;
+    }else{
+        pMemo->pLru = pEntry;
+    }
+    pMemo->pMru = pEntry;
+}
+
+/*
+ ** Look up the key held in aKey[] in the result cache of cursor pCsr.  If
+ ** it is found, copy the stored result into aKey[nKey] and set *pbFound.
+ */
+SQLITE_PRIVATE int sqlite3VdbeMemoLookup(VdbeCursor *pCsr, Mem *aKey, int *pbFound){
+    VdbeMemo *pMemo = pCsr->pMemo;
+    MemoEntry *pEntry;
+    u32 h;
+    int rc;
+
+    *pbFound = 0;
+    rc = memoHash(aKey, pMemo->nKey, &h);
+    if( rc || pMemo->nHash==0 ) return rc;
+    for(pEntry=pMemo->apHash[h & (pMemo->nHash-1)]; pEntry; pEntry=pEntry->pHashNext){
+        if( pEntry->h==h && memoMatch(pEntry, aKey, pMemo->nKey) ){
+            memoLruUnlink(pMemo, pEntry);
+            memoLruAppend(pMemo, pEntry);
+            *pbFound = 1;
+            return sqlite3VdbeMemCopy(&aKey[pMemo->nKey], &pEntry->aMem[pMemo->nKey]);
+        }
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Resize the hash table of pMemo to nHash slots.
+ */
+static int memoRehash(VdbeMemo *pMemo, int nHash){
+    MemoEntry **apNew;
+    MemoEntry *pEntry;
+
+    apNew = (MemoEntry**)sqlite3MallocZero(nHash*sizeof(MemoEntry*));
+    if( apNew==0 ) return SQLITE_NOMEM;
+    for(pEntry=pMemo->pLru; pEntry; pEntry=pEntry->pLruNext){
+        MemoEntry **pp = &apNew[pEntry->h & (nHash-1)];
+        pEntry->pHashNext = *pp;
+        *pp = pEntry;
+    }
+    sqlite3_free(pMemo->apHash);
+    pMemo->apHash = apNew;
+    pMemo->nHash = nHash;
+    return SQLITE_OK;
+}
+
+/*
+ ** Store the result held in aKey[nKey] in the result cache of cursor pCsr
+ ** with the key held in aKey[].  If the cache is full, or memory is
+ ** short, the least recently used entry is discarded to make room.
+ */
+SQLITE_PRIVATE int sqlite3VdbeMemoStore(sqlite3 *db, VdbeCursor *pCsr, Mem *aKey){
+    VdbeMemo *pMemo = pCsr->pMemo;
+    int nKey = pMemo->nKey;
+    MemoEntry *pEntry;
+    u32 h;
+    int i;
+    int rc;
+
+    rc = memoHash(aKey, nKey, &h);
+    if( rc ) return rc;
+
+    if( pMemo->nEntry>=pMemo->nMax || (pMemo->nEntry>0 && sqlite3HeapNearlyFull()) ){
+        /* Reuse the least recently used entry */
+        MemoEntry **pp;
+        pEntry = pMemo->pLru;
+        for(pp=&pMemo->apHash[pEntry->h & (pMemo->nHash-1)]; *pp!=pEntry;
+            pp=&(*pp)->pHashNext){
+            assert( *pp );
+        }
+        *pp = pEntry->pHashNext;
+        memoLruUnlink(pMemo, pEntry);
+        memoEntryClear(pMemo, pEntry);
+    }else{
+        int nByte = ROUND8(sizeof(MemoEntry)) + (nKey+1)*sizeof(Mem);
+        if( pMemo->nEntry>=pMemo->nHash ){
+            rc = memoRehash(pMemo, pMemo->nHash ? pMemo->nHash*2 : 64);
+            if( rc ) return rc;
+        }
+        pEntry = (MemoEntry*)sqlite3DbMallocZero(db, nByte);
+        if( pEntry==0 ) return SQLITE_NOMEM;
+        pEntry->aMem = (Mem*)&((u8*)pEntry)[ROUND8(sizeof(MemoEntry))];
+        for(i=0; i<=nKey; i++){
+            pEntry->aMem[i].flags = MEM_Null;
+            pEntry->aMem[i].db = db;
+        }
+        pMemo->nEntry++;
+    }
+
+    pEntry->h = h;
+    for(i=0; i<=nKey && rc==SQLITE_OK; i++){
+        rc = sqlite3VdbeMemCopy(&pEntry->aMem[i], &aKey[i]);
+    }
+    if( rc ){
+        memoEntryClear(pMemo, pEntry);
+        sqlite3DbFree(db, pEntry);
+        pMemo->nEntry--;
+        return rc;
+    }
+    pEntry->pHashNext = pMemo->apHash[h & (pMemo->nHash-1)];
+    pMemo->apHash[h & (pMemo->nHash-1)] = pEntry;
+    memoLruAppend(pMemo, pEntry);
+    return SQLITE_OK;
+}
+
+#endif /* SQLITE_OMIT_SUBQUERY_CACHE */
+
+/************** End of vdbememo.c ********************************************/
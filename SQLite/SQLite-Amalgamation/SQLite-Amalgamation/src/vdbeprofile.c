@@ -0,0 +1,352 @@
+/************** Begin file vdbeprofile.c *************************************/
+/*
+ ** 2013 October 24
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** This file contains the "stmt_profile" virtual table, which reports
+ ** the per-instruction statistics collected for prepared statements on
+ ** which sqlite3_stmt_profile() has been called.  The module is registered
+ ** on a database connection the first time profiling is enabled for one
+ ** of its statements.  Typical use is:
+ **
+ **     CREATE VIRTUAL TABLE temp.prof USING stmt_profile;
+ **     SELECT addr, opcode, nexec, ncycle FROM prof WHERE sql LIKE ...;
+ **
+ ** The table has one row for each instruction of each profiled statement.
+ ** The addr and opcode columns match the output of EXPLAIN for the same
+ ** statement, so the two can be joined to see where the time goes.
+ */
+
+#include "vdbeInt.h"
+
+#if !defined(SQLITE_OMIT_OPCODE_PROFILE) && !defined(SQLITE_OMIT_VIRTUALTABLE)
+
+/*
+ ** Columns of the stmt_profile table.
+ */
+#define PROFILE_COL_STMT    0     /* Identifies the statement */
+#define PROFILE_COL_SQL     1     /* SQL text of the statement */
+#define PROFILE_COL_ADDR    2     /* Address of the instruction */
+#define PROFILE_COL_OPCODE  3     /* Name of the opcode */
+#define PROFILE_COL_P1      4     /* Operands of the instruction */
+#define PROFILE_COL_P2      5
+#define PROFILE_COL_P3      6
+#define PROFILE_COL_NEXEC   7     /* Number of times executed */
+#define PROFILE_COL_NCYCLE  8     /* Total clock ticks spent in it */
+
+typedef struct ProfileVtab ProfileVtab;
+typedef struct ProfileCursor ProfileCursor;
+typedef struct ProfileRow ProfileRow;
+
+/*
+ ** A stmt_profile virtual table.
+ */
+struct ProfileVtab {
+    sqlite3_vtab base;              /* Base class.  Must be first */
+    sqlite3 *db;                    /* Connection whose statements are shown */
+};
+
+/*
+ ** One row of output.  The statistics are copied out of the statement
+ ** when the scan starts, so that finalizing or stepping a statement part
+ ** way through a scan cannot affect it.
+ */
+struct ProfileRow {
+    int iStmt;                      /* Index into ProfileCursor.aStmt[] */
+    int iAddr;                      /* Address of the instruction */
+    u8 opcode;                      /* The opcode */
+    int p1, p2, p3;                 /* Operands */
+    u64 nExec;                      /* Copy of VdbeOpStat.nExec */
+    u64 nCycle;                     /* Copy of VdbeOpStat.nCycle */
+};
+
+/*
+ ** A cursor on a stmt_profile table.
+ */
+struct ProfileCursor {
+    sqlite3_vtab_cursor base;       /* Base class.  Must be first */
+    int nRow;                       /* Number of entries in aRow[] */
+    int iRow;                       /* Current row */
+    ProfileRow *aRow;               /* Snapshot of all rows */
+    int nStmt;                      /* Number of entries in aStmt[] */
+    struct ProfileStmt {
+        i64 iStmt;                  /* Value of the "stmt" column */
+        char *zSql;                 /* Copy of the SQL text, or NULL */
+    } *aStmt;
+};
+
+/*
+ ** Connect to or create a stmt_profile table.
+ */
+static int profileConnect(
+                          sqlite3 *db,
+                          void *pAux,
+                          int argc, const char *const*argv,
+                          sqlite3_vtab **ppVtab,
+                          char **pzErr
+){
+    ProfileVtab *pTab;
+    int rc;
+    
+    UNUSED_PARAMETER(pAux);
+    UNUSED_PARAMETER(argc);
+    UNUSED_PARAMETER(argv);
+    UNUSED_PARAMETER(pzErr);
+    
+    rc = sqlite3_declare_vtab(db,
+                              "CREATE TABLE x(stmt INTEGER, sql TEXT, addr INTEGER, opcode TEXT,"
+                              " p1 INTEGER, p2 INTEGER, p3 INTEGER, nexec INTEGER, ncycle INTEGER)"
+                              );
+    if( rc!=SQLITE_OK ) return rc;
+    pTab = (ProfileVtab *)sqlite3_malloc(sizeof(ProfileVtab));
+    if( pTab==0 ) return SQLITE_NOMEM;
+    memset(pTab, 0, sizeof(ProfileVtab));
+    pTab->db = db;
+    *ppVtab = &pTab->base;
+    return SQLITE_OK;
+}
+
+/*
+ ** Disconnect from or destroy a stmt_profile table.
+ */
+static int profileDisconnect(sqlite3_vtab *pVtab){
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+/*
+ ** There are no indexes.  Every query is a full scan.
+ */
+static int profileBestIndex(sqlite3_vtab *pVtab, sqlite3_index_info *pIdxInfo){
+    UNUSED_PARAMETER(pVtab);
+    pIdxInfo->estimatedCost = 10000.0;
+    return SQLITE_OK;
+}
+
+/*
+ ** Free the snapshot held by cursor pCsr.
+ */
+static void profileResetCursor(ProfileCursor *pCsr){
+    int i;
+    for(i=0; i<pCsr->nStmt; i++){
+        sqlite3_free(pCsr->aStmt[i].zSql);
+    }
+    sqlite3_free(pCsr->aStmt);
+    sqlite3_free(pCsr->aRow);
+    pCsr->aStmt = 0;
+    pCsr->aRow = 0;
+    pCsr->nStmt = 0;
+    pCsr->nRow = 0;
+    pCsr->iRow = 0;
+}
+
+/*
+ ** Open a new cursor.
+ */
+static int profileOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor){
+    ProfileCursor *pCsr;
+    UNUSED_PARAMETER(pVtab);
+    pCsr = (ProfileCursor *)sqlite3_malloc(sizeof(ProfileCursor));
+    if( pCsr==0 ) return SQLITE_NOMEM;
+    memset(pCsr, 0, sizeof(ProfileCursor));
+    *ppCursor = &pCsr->base;
+    return SQLITE_OK;
+}
+
+/*
+ ** Close a cursor.
+ */
+static int profileClose(sqlite3_vtab_cursor *pCursor){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    profileResetCursor(pCsr);
+    sqlite3_free(pCsr);
+    return SQLITE_OK;
+}
+
+/*
+ ** Start a scan.  Take a snapshot of the statistics of every profiled
+ ** statement belonging to the connection.
+ */
+static int profileFilter(
+                         sqlite3_vtab_cursor *pCursor,
+                         int idxNum, const char *idxStr,
+                         int argc, sqlite3_value **argv
+){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    sqlite3 *db = ((ProfileVtab *)pCursor->pVtab)->db;
+    Vdbe *v;
+    int nStmt = 0;
+    int nRow = 0;
+    int rc = SQLITE_OK;
+    
+    UNUSED_PARAMETER(idxNum);
+    UNUSED_PARAMETER(idxStr);
+    UNUSED_PARAMETER(argc);
+    UNUSED_PARAMETER(argv);
+    
+    profileResetCursor(pCsr);
+    assert( sqlite3_mutex_held(db->mutex) );
+    for(v=db->pVdbe; v; v=v->pNext){
+        if( v->aOpStat ){
+            nStmt++;
+            nRow += v->nOp;
+        }
+    }
+    if( nStmt==0 ) return SQLITE_OK;
+    
+    pCsr->aStmt = sqlite3_malloc(nStmt*sizeof(pCsr->aStmt[0]));
+    pCsr->aRow = sqlite3_malloc(nRow*sizeof(ProfileRow));
+    if( pCsr->aStmt==0 || pCsr->aRow==0 ){
+        profileResetCursor(pCsr);
+        return SQLITE_NOMEM;
+    }
+    for(v=db->pVdbe; v && rc==SQLITE_OK; v=v->pNext){
+        int i;
+        if( v->aOpStat==0 ) continue;
+        pCsr->aStmt[pCsr->nStmt].iStmt = (i64)(size_t)v;
+        pCsr->aStmt[pCsr->nStmt].zSql = 0;
+        if( v->zSql ){
+            pCsr->aStmt[pCsr->nStmt].zSql = sqlite3_mprintf("%s", v->zSql);
+            if( pCsr->aStmt[pCsr->nStmt].zSql==0 ) rc = SQLITE_NOMEM;
+        }
+        for(i=0; i<v->nOp; i++){
+            ProfileRow *pRow = &pCsr->aRow[pCsr->nRow++];
+            pRow->iStmt = pCsr->nStmt;
+            pRow->iAddr = i;
+            pRow->opcode = v->aOp[i].opcode;
+            pRow->p1 = v->aOp[i].p1;
+            pRow->p2 = v->aOp[i].p2;
+            pRow->p3 = v->aOp[i].p3;
+            pRow->nExec = v->aOpStat[i].nExec;
+            pRow->nCycle = v->aOpStat[i].nCycle;
+        }
+        pCsr->nStmt++;
+    }
+    if( rc!=SQLITE_OK ){
+        profileResetCursor(pCsr);
+    }
+    return rc;
+}
+
+/*
+ ** Advance the cursor to the next row.
+ */
+static int profileNext(sqlite3_vtab_cursor *pCursor){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    pCsr->iRow++;
+    return SQLITE_OK;
+}
+
+/*
+ ** Return true if the cursor has moved past the last row.
+ */
+static int profileEof(sqlite3_vtab_cursor *pCursor){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    return pCsr->iRow>=pCsr->nRow;
+}
+
+/*
+ ** Return the value of column i of the current row.
+ */
+static int profileColumn(
+                         sqlite3_vtab_cursor *pCursor,
+                         sqlite3_context *ctx,
+                         int i
+){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    ProfileRow *pRow = &pCsr->aRow[pCsr->iRow];
+    switch( i ){
+        case PROFILE_COL_STMT:
+            sqlite3_result_int64(ctx, pCsr->aStmt[pRow->iStmt].iStmt);
+            break;
+        case PROFILE_COL_SQL:
+            sqlite3_result_text(ctx, pCsr->aStmt[pRow->iStmt].zSql, -1,
+                                SQLITE_TRANSIENT);
+            break;
+        case PROFILE_COL_ADDR:
+            sqlite3_result_int(ctx, pRow->iAddr);
+            break;
+        case PROFILE_COL_OPCODE:
+#if !defined(SQLITE_OMIT_EXPLAIN) || !defined(NDEBUG) \
+|| defined(VDBE_PROFILE) || defined(SQLITE_DEBUG)
+            sqlite3_result_text(ctx, sqlite3OpcodeName(pRow->opcode), -1,
+                                SQLITE_STATIC);
+#else
+            sqlite3_result_int(ctx, pRow->opcode);
+#endif
+            break;
+        case PROFILE_COL_P1:
+            sqlite3_result_int(ctx, pRow->p1);
+            break;
+        case PROFILE_COL_P2:
+            sqlite3_result_int(ctx, pRow->p2);
+            break;
+        case PROFILE_COL_P3:
+            sqlite3_result_int(ctx, pRow->p3);
+            break;
+        case PROFILE_COL_NEXEC:
+            sqlite3_result_int64(ctx, (i64)pRow->nExec);
+            break;
+        default:
+            assert( i==PROFILE_COL_NCYCLE );
+            sqlite3_result_int64(ctx, (i64)pRow->nCycle);
+            break;
+    }
+    return SQLITE_OK;
+}
+
+/*
+ ** Return the rowid of the current row.
+ */
+static int profileRowid(sqlite3_vtab_cursor *pCursor, sqlite_int64 *pRowid){
+    ProfileCursor *pCsr = (ProfileCursor *)pCursor;
+    *pRowid = pCsr->iRow;
+    return SQLITE_OK;
+}
+
+/*
+ ** Register the stmt_profile module with database connection db, if it
+ ** has not been registered already.
+ */
+SQLITE_PRIVATE int sqlite3VdbeProfileRegister(sqlite3 *db){
+    static sqlite3_module profile_module = {
+        0,                            /* iVersion */
+        profileConnect,               /* xCreate */
+        profileConnect,               /* xConnect */
+        profileBestIndex,             /* xBestIndex */
+        profileDisconnect,            /* xDisconnect */
+        profileDisconnect,            /* xDestroy */
+        profileOpen,                  /* xOpen - open a cursor */
+        profileClose,                 /* xClose - close a cursor */
+        profileFilter,                /* xFilter - configure scan constraints */
+        profileNext,                  /* xNext - advance a cursor */
+        profileEof,                   /* xEof - check for end of scan */
+        profileColumn,                /* xColumn - read data */
+        profileRowid,                 /* xRowid - read data */
+        0,                            /* xUpdate */
+        0,                            /* xBegin */
+        0,                            /* xSync */
+        0,                            /* xCommit */
+        0,                            /* xRollback */
+        0,                            /* xFindMethod */
+        0,                            /* xRename */
+    };
+    static const char zName[] = "stmt_profile";
+    assert( sqlite3_mutex_held(db->mutex) );
+    if( sqlite3HashFind(&db->aModule, zName, sizeof(zName)-1) ){
+        return SQLITE_OK;
+    }
+    return sqlite3_create_module(db, zName, &profile_module, 0);
+}
+
+#endif /* !SQLITE_OMIT_OPCODE_PROFILE && !SQLITE_OMIT_VIRTUALTABLE */
+
+/************** End of vdbeprofile.c *****************************************/
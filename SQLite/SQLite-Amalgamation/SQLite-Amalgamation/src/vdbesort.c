@@ -413,7 +413,7 @@ static void vdbeSorterCompare(
         r2->flags |= UNPACKED_PREFIX_MATCH;
     }
     
-    *pRes = sqlite3VdbeRecordCompare(nKey1, pKey1, r2);
+    *pRes = sqlite3VdbeFindCompare(r2)(nKey1, pKey1, r2);
 }
 
 /*
@@ -0,0 +1,167 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that inserting rows with sqlite3_bind_array() and
+ ** sqlite3_step_batch() has the same effect as binding and stepping the
+ ** statement once per row, including for NULL array entries, parameters
+ ** that keep an ordinary value, and rows that fail a UNIQUE constraint.
+ ** Build with:
+ **
+ **     gcc -I. -o batchbind test/batchbind.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Fail unless queries zA and zB return the same rows, in any order.
+ */
+static void checkSame(sqlite3 *db, const char *zA, const char *zB){
+    int nA, nB;
+    sqlite3_uint64 hA = resultHash(db, zA, &nA);
+    sqlite3_uint64 hB = resultHash(db, zB, &nB);
+    if( hA!=hB || nA!=nB ){
+        fprintf(stderr, "FAIL: results differ:\n    %s\n    %s\n", zA, zB);
+        exit(1);
+    }
+}
+
+#define NROW 1000
+
+int main(void){
+    sqlite3 *db = 0;
+    sqlite3_stmt *pStmt;
+    static sqlite3_int64 aInt[NROW];
+    static double aReal[NROW];
+    static const char *azText[NROW];
+    static const void *aBlob[NROW];
+    static int anInt[NROW], anText[NROW], anBlob[NROW];
+    static sqlite3_int64 aKey[NROW];
+    static char azBuf[NROW][32];
+    static int aRc[NROW];
+    int nFail = 0;
+    int rc;
+    int i;
+
+    for(i=0; i<NROW; i++){
+        aInt[i] = (sqlite3_int64)i * 1000003;
+        anInt[i] = (i%7==0) ? -1 : 0;          /* Every 7th integer is NULL */
+        aReal[i] = i / 8.0;
+        sqlite3_snprintf(sizeof(azBuf[i]), azBuf[i], "text %d", i);
+        azText[i] = (i%11==0) ? 0 : azBuf[i];  /* Every 11th text is NULL */
+        anText[i] = (i%2) ? -1 : 5;            /* Odd rows zero-terminated */
+        aBlob[i] = azBuf[i];
+        anBlob[i] = i%9;                       /* Including empty blobs */
+        aKey[i] = (i==500) ? 499 : i;          /* Row 500 is a duplicate */
+    }
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db,
+        "CREATE TABLE a(i INTEGER, r REAL, t TEXT, b BLOB, k UNIQUE, c);"
+        "CREATE TABLE b(i INTEGER, r REAL, t TEXT, b BLOB, k UNIQUE, c);"
+    );
+
+    /* Batched */
+    if( sqlite3_prepare_v2(db, "INSERT INTO a VALUES(?,?,?,?,?,?)", -1, &pStmt, 0) ){
+        fail(db, "prepare");
+    }
+    if( sqlite3_bind_array(pStmt, 1, SQLITE_INTEGER, aInt, anInt, NROW)
+     || sqlite3_bind_array(pStmt, 2, SQLITE_FLOAT, aReal, 0, NROW)
+     || sqlite3_bind_array(pStmt, 3, SQLITE_TEXT, azText, anText, NROW)
+     || sqlite3_bind_array(pStmt, 4, SQLITE_BLOB, aBlob, anBlob, NROW)
+     || sqlite3_bind_array(pStmt, 5, SQLITE_INTEGER, aKey, 0, NROW)
+     || sqlite3_bind_int(pStmt, 6, 42)
+    ){
+        fail(db, "bind_array");
+    }
+    if( sqlite3_step_batch(pStmt, NROW+1, 0)!=SQLITE_RANGE ){
+        fail(db, "step_batch accepted more rows than were bound");
+    }
+    rc = sqlite3_step_batch(pStmt, NROW, aRc);
+    if( (rc&0xff)!=SQLITE_CONSTRAINT ) fail(db, "step_batch result");
+    for(i=0; i<NROW; i++){
+        if( i==500 ){
+            if( (aRc[i]&0xff)!=SQLITE_CONSTRAINT ) fail(0, "duplicate row accepted");
+        }else if( aRc[i]!=SQLITE_OK ){
+            fail(0, "row failed");
+        }
+    }
+    sqlite3_finalize(pStmt);
+
+    /* One row at a time */
+    if( sqlite3_prepare_v2(db, "INSERT INTO b VALUES(?,?,?,?,?,?)", -1, &pStmt, 0) ){
+        fail(db, "prepare");
+    }
+    for(i=0; i<NROW; i++){
+        if( anInt[i]<0 ){
+            sqlite3_bind_null(pStmt, 1);
+        }else{
+            sqlite3_bind_int64(pStmt, 1, aInt[i]);
+        }
+        sqlite3_bind_double(pStmt, 2, aReal[i]);
+        sqlite3_bind_text(pStmt, 3, azText[i], anText[i], SQLITE_STATIC);
+        sqlite3_bind_blob(pStmt, 4, aBlob[i], anBlob[i], SQLITE_STATIC);
+        sqlite3_bind_int64(pStmt, 5, aKey[i]);
+        sqlite3_bind_int(pStmt, 6, 42);
+        if( sqlite3_step(pStmt)!=SQLITE_DONE ) nFail++;
+        sqlite3_reset(pStmt);
+    }
+    sqlite3_finalize(pStmt);
+    if( nFail!=1 ) fail(0, "row by row insert");
+
+    checkSame(db, "SELECT i, r, t, b, typeof(b), k, c FROM a",
+                  "SELECT i, r, t, b, typeof(b), k, c FROM b");
+
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
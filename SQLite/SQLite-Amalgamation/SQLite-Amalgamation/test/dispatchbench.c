@@ -0,0 +1,87 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Compares the switch dispatcher of sqlite3VdbeExec() with the threaded
+ ** dispatcher enabled by SQLITE_ENABLE_COMPUTED_GOTO.  Build it twice:
+ **
+ **     gcc -O2 -I. -o bench-switch test/dispatchbench.c sqlite3.c
+ **     gcc -O2 -I. -DSQLITE_ENABLE_COMPUTED_GOTO \
+ **         -o bench-goto test/dispatchbench.c sqlite3.c
+ **
+ ** and run each as "./bench-switch ?NROW? ?NLOOP?".  Each run prints a
+ ** checksum of the query results, which must be the same for both
+ ** builds, followed by the elapsed time of the query loop.  The queries
+ ** are chosen so that almost all of the time is spent running short
+ ** arithmetic and comparison opcodes, where dispatch cost dominates.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+static const char *azQuery[] = {
+    "SELECT sum(a*3+b), max(a%7+b%5), count(*) FROM t WHERE a>b-10",
+    "SELECT count(*) FROM t WHERE (a&255)=(b&255) OR a+b<1000",
+    "SELECT sum(CASE WHEN a<b THEN a-b ELSE b-a END) FROM t",
+};
+
+int main(int argc, char **argv){
+    sqlite3 *db = 0;
+    sqlite3_stmt *pStmt;
+    int nRow = argc>1 ? atoi(argv[1]) : 100000;
+    int nLoop = argc>2 ? atoi(argv[2]) : 50;
+    sqlite3_int64 iSum = 0;
+    clock_t t0;
+    int i, j;
+
+    if( sqlite3_open(":memory:", &db)!=SQLITE_OK ) fail(db, "open");
+    run(db, "CREATE TABLE t(a INTEGER, b INTEGER)");
+    run(db, "BEGIN");
+    if( sqlite3_prepare_v2(db, "INSERT INTO t VALUES(?, ?)", -1, &pStmt, 0) ){
+        fail(db, "prepare insert");
+    }
+    for(i=0; i<nRow; i++){
+        sqlite3_bind_int(pStmt, 1, i);
+        sqlite3_bind_int(pStmt, 2, (i*7919) % nRow);
+        if( sqlite3_step(pStmt)!=SQLITE_DONE ) fail(db, "insert");
+        sqlite3_reset(pStmt);
+    }
+    sqlite3_finalize(pStmt);
+    run(db, "COMMIT");
+
+    t0 = clock();
+    for(j=0; j<(int)(sizeof(azQuery)/sizeof(azQuery[0])); j++){
+        if( sqlite3_prepare_v2(db, azQuery[j], -1, &pStmt, 0) ){
+            fail(db, azQuery[j]);
+        }
+        for(i=0; i<nLoop; i++){
+            while( sqlite3_step(pStmt)==SQLITE_ROW ){
+                iSum += sqlite3_column_int64(pStmt, 0);
+            }
+            if( sqlite3_reset(pStmt)!=SQLITE_OK ) fail(db, azQuery[j]);
+        }
+        sqlite3_finalize(pStmt);
+    }
+    printf("checksum %lld\n", iSum);
+    printf("%.3f seconds\n", (double)(clock() - t0) / CLOCKS_PER_SEC);
+    sqlite3_close(db);
+    return 0;
+}
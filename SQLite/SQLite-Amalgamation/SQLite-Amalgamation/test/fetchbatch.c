@@ -0,0 +1,156 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that sqlite3_fetch_batch() returns the same rows and values as
+ ** sqlite3_step() and the sqlite3_column() routines, when its text and
+ ** blob buffers fill up part way through a batch, and when a single row
+ ** is too large for them.
+ ** Build with:
+ **
+ **     gcc -I. -o fetchbatch test/fetchbatch.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+#define NROW   2000     /* Rows in table t */
+#define NBATCH 64       /* Rows requested from each sqlite3_fetch_batch() */
+#define NSMALL 1024     /* Size of the usual text and blob buffers */
+#define NBIG   8192     /* Size of the buffers used after SQLITE_TOOBIG */
+
+static const char zQuery[] = "SELECT i, r, t, b FROM t ORDER BY rowid";
+
+/*
+ ** Return true if bit iRow of NULL bitmap aNull is set.
+ */
+static int isNull(const unsigned char *aNull, int iRow){
+    return (aNull[iRow/8] >> (iRow&7)) & 1;
+}
+
+/*
+ ** Check the text or blob value in row iRow of pCol against column iCol
+ ** of the current row of pRef.
+ */
+static void checkVar(sqlite3_stmt *pRef, int iCol, sqlite3_fetch_column *pCol, int iRow){
+    const int *aOff = (const int*)pCol->aValue;
+    int n = aOff[iRow+1] - aOff[iRow];
+    const void *z = pCol->eType==SQLITE_TEXT ?
+        (const void*)sqlite3_column_text(pRef, iCol) : sqlite3_column_blob(pRef, iCol);
+    if( n!=sqlite3_column_bytes(pRef, iCol) ) fail(0, "size differs");
+    if( n>0 && memcmp(&pCol->zArena[aOff[iRow]], z, n)!=0 ) fail(0, "content differs");
+}
+
+int main(void){
+    sqlite3 *db = 0;
+    sqlite3_stmt *pStmt;
+    sqlite3_stmt *pRef;
+    static sqlite3_int64 aInt[NBATCH];
+    static double aReal[NBATCH];
+    static int aTextOff[NBATCH+1], aBlobOff[NBATCH+1];
+    static unsigned char aNull[4][(NBATCH+7)/8];
+    static char zText[NBIG], zBlob[NBIG];
+    sqlite3_fetch_column aCol[4];
+    int nTotal = 0;
+    int nTooBig = 0;
+    int i, j;
+    int rc;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db,
+        "CREATE TABLE t(i INTEGER, r REAL, t TEXT, b BLOB);"
+        "CREATE TEMP TABLE seq(x INTEGER PRIMARY KEY);"
+        "INSERT INTO seq VALUES(1);"
+    );
+    for(i=0; i<11; i++) run(db, "INSERT INTO seq SELECT x+(SELECT max(x) FROM seq) FROM seq");
+    run(db,
+        "INSERT INTO t SELECT"
+        "  CASE WHEN x%5 THEN x*x END,"
+        "  CASE WHEN x%6 THEN x/3.0 END,"
+        "  CASE WHEN x%7 THEN substr('abcdefghijklmnopqrstuvwxyz', 1, x%27) END,"
+        "  CASE WHEN x%8 THEN zeroblob(x%40) END"
+        "  FROM seq WHERE x<=2000;"
+        /* One row is too large for the usual buffers */
+        "UPDATE t SET t=substr(quote(zeroblob(2500)), 3, 5000) WHERE rowid=777;"
+    );
+
+    memset(aCol, 0, sizeof(aCol));
+    aCol[0].eType = SQLITE_INTEGER;  aCol[0].aValue = aInt;
+    aCol[1].eType = SQLITE_FLOAT;    aCol[1].aValue = aReal;
+    aCol[2].eType = SQLITE_TEXT;     aCol[2].aValue = aTextOff;
+    aCol[2].zArena = zText;
+    aCol[3].eType = SQLITE_BLOB;     aCol[3].aValue = aBlobOff;
+    aCol[3].zArena = zBlob;
+    for(i=0; i<4; i++) aCol[i].aNull = aNull[i];
+
+    if( sqlite3_prepare_v2(db, zQuery, -1, &pStmt, 0) ) fail(db, "prepare");
+    if( sqlite3_prepare_v2(db, zQuery, -1, &pRef, 0) ) fail(db, "prepare");
+
+    /* An invalid column type is rejected without stepping the statement */
+    aCol[0].eType = 99;
+    if( sqlite3_fetch_batch(pStmt, NBATCH, aCol, 4, &j)!=SQLITE_MISUSE ){
+        fail(0, "invalid eType accepted");
+    }
+    aCol[0].eType = SQLITE_INTEGER;
+
+    do{
+        int nArena = nTooBig==1 ? NBIG : NSMALL;
+        int nFetched = 0;
+        aCol[2].nArena = aCol[3].nArena = nArena;
+        rc = sqlite3_fetch_batch(pStmt, NBATCH, aCol, 4, &nFetched);
+        if( rc!=SQLITE_ROW && rc!=SQLITE_DONE && rc!=SQLITE_TOOBIG ){
+            fail(db, "fetch_batch");
+        }
+        if( rc==SQLITE_TOOBIG ){
+            if( nFetched!=0 ) fail(0, "rows stored with SQLITE_TOOBIG");
+            nTooBig++;
+            continue;
+        }
+        if( nTooBig==1 ) nTooBig++;
+        if( aCol[2].nArenaUsed>nArena || aCol[3].nArenaUsed>nArena ){
+            fail(0, "arena overrun");
+        }
+        for(i=0; i<nFetched; i++){
+            if( sqlite3_step(pRef)!=SQLITE_ROW ) fail(0, "too many rows");
+            for(j=0; j<4; j++){
+                int bNull = sqlite3_column_type(pRef, j)==SQLITE_NULL;
+                if( isNull(aNull[j], i)!=bNull ) fail(0, "NULL bitmap");
+            }
+            if( aInt[i]!=sqlite3_column_int64(pRef, 0) ) fail(0, "integer differs");
+            if( aReal[i]!=sqlite3_column_double(pRef, 1) ) fail(0, "real differs");
+            checkVar(pRef, 2, &aCol[2], i);
+            checkVar(pRef, 3, &aCol[3], i);
+        }
+        nTotal += nFetched;
+    }while( rc!=SQLITE_DONE );
+
+    if( sqlite3_step(pRef)!=SQLITE_DONE ) fail(0, "too few rows");
+    if( nTotal!=NROW ) fail(0, "row count");
+    if( nTooBig!=2 ) fail(0, "SQLITE_TOOBIG not returned for the large row");
+    sqlite3_finalize(pStmt);
+    sqlite3_finalize(pRef);
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
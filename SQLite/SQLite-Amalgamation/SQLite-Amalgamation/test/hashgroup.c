@@ -0,0 +1,185 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that GROUP BY queries coded using hash aggregation return the
+ ** same rows as the same queries coded with a sorter.  Hash aggregation
+ ** is not used if the query has an ORDER BY that is the same as its GROUP
+ ** BY, so each query is compared against a copy with that ORDER BY
+ ** appended.  The GROUP BY values mix integers, reals, text and NULLs, and
+ ** the queries are repeated with a small page cache so that groups that
+ ** do not fit in the hash table are passed to the sorter.  Build with:
+ **
+ **     gcc -I. -o hashgroup test/hashgroup.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Fail unless queries zA and zB return the same rows, in any order.
+ */
+static void checkSame(sqlite3 *db, const char *zA, const char *zB){
+    int nA, nB;
+    sqlite3_uint64 hA = resultHash(db, zA, &nA);
+    sqlite3_uint64 hB = resultHash(db, zB, &nB);
+    if( hA!=hB || nA!=nB ){
+        fprintf(stderr, "FAIL: results differ:\n    %s\n    %s\n", zA, zB);
+        exit(1);
+    }
+}
+
+/*
+ ** Return true if the EXPLAIN QUERY PLAN output of zSql contains zText.
+ */
+static int planContains(sqlite3 *db, const char *zSql, const char *zText){
+    sqlite3_stmt *pStmt;
+    char *zExplain = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", zSql);
+    int bFound = 0;
+    if( sqlite3_prepare_v2(db, zExplain, -1, &pStmt, 0) ) fail(db, zExplain);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        const char *zDetail = (const char*)sqlite3_column_text(pStmt, 3);
+        if( zDetail && strstr(zDetail, zText) ) bFound = 1;
+    }
+    sqlite3_finalize(pStmt);
+    sqlite3_free(zExplain);
+    return bFound;
+}
+
+/*
+ ** Each query is run as is, and with "ORDER BY" and its GROUP BY terms
+ ** appended.  Integer and real GROUP BY values that compare equal fall
+ ** into one group, but the value reported for the group may be either,
+ ** so g is only output as "g*1.0".  Values of v are integers or multiples
+ ** of 0.25, so that sum() and avg() do not depend on the order of the
+ ** rows within a group.
+ */
+static const struct {
+    const char *zSql;
+    const char *zGroupBy;
+} aQuery[] = {
+    { "SELECT g*1.0, count(*), count(v), sum(v), avg(v), min(v), max(v),"
+      "  total(v) FROM t GROUP BY g", "g" },
+    { "SELECT g*1.0, h, count(*), sum(v), min(k) FROM t GROUP BY g, h",
+      "g, h" },
+    { "SELECT g%10, count(*), max(h), min(h) FROM t GROUP BY g%10", "g%10" },
+    { "SELECT h, sum(v), count(*) FROM t GROUP BY h"
+      "  HAVING count(*)>100 AND sum(v)>1000", "h" },
+    { "SELECT k, count(*), sum(v), min(h), max(g*1.0) FROM t GROUP BY k",
+      "k" },
+    { "SELECT k%7, k, max(v), total(v) FROM t WHERE v IS NOT NULL GROUP BY k",
+      "k" },
+    { "SELECT h, k, count(*) FROM t GROUP BY h, k HAVING count(*)>1", "h, k" },
+};
+
+static const char zData[] =
+    "CREATE TABLE t(g, h, k INTEGER, v);"
+    "CREATE TEMP TABLE seq(i INTEGER PRIMARY KEY);"
+    "INSERT INTO seq VALUES(1);"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    /* Column g has no affinity, so 7 and 7.0 are one group and '7' is
+     ** another.  Column k has 5000 distinct values. */
+    "INSERT INTO t SELECT"
+    "  CASE i%4 WHEN 0 THEN i%50 WHEN 1 THEN (i%50)*1.0"
+    "           WHEN 2 THEN CAST(i%50 AS TEXT) ELSE NULL END,"
+    "  CASE WHEN i%7 THEN 'h' || (i%9) ELSE i%9 END,"
+    "  CASE WHEN i%97 THEN i%5000 END,"
+    "  CASE i%3 WHEN 0 THEN i%1000 WHEN 1 THEN (i%400)*0.25 ELSE NULL END"
+    "  FROM seq WHERE i<=20000;";
+
+static void runQueries(sqlite3 *db){
+    int i;
+    for(i=0; i<(int)(sizeof(aQuery)/sizeof(aQuery[0])); i++){
+        const char *zHash = aQuery[i].zSql;
+        char *zSort = sqlite3_mprintf("%s ORDER BY %s",
+                                      zHash, aQuery[i].zGroupBy);
+        if( !planContains(db, zHash, "USE HASH TABLE FOR GROUP BY") ){
+            fail(0, zHash);
+        }
+        if( planContains(db, zSort, "USE HASH TABLE FOR GROUP BY") ){
+            fail(0, zSort);
+        }
+        checkSame(db, zHash, zSort);
+        sqlite3_free(zSort);
+    }
+}
+
+int main(void){
+    sqlite3 *db = 0;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db, zData);
+    runQueries(db);
+
+    /* With a 10 page cache the hash table fills up, and the groups that
+     ** do not fit are aggregated using the sorter */
+    run(db, "PRAGMA cache_size=10; PRAGMA temp_store=FILE;");
+    runQueries(db);
+
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
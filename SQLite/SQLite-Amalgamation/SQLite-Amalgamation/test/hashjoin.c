@@ -0,0 +1,183 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that two-table equi-joins coded as hash joins return the same
+ ** rows as the same joins on copies of the tables that have an index on
+ ** each join column, which are coded as ordinary nested loops.  The join
+ ** columns mix integers, reals, text, blobs and NULLs, in columns with
+ ** and without type affinity, and the joins are repeated with a small
+ ** page cache so that the hash table is moved to a temporary b-tree.  Build with:
+ **
+ **     gcc -I. -o hashjoin test/hashjoin.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Fail unless queries zA and zB return the same rows, in any order.
+ */
+static void checkSame(sqlite3 *db, const char *zA, const char *zB){
+    int nA, nB;
+    sqlite3_uint64 hA = resultHash(db, zA, &nA);
+    sqlite3_uint64 hB = resultHash(db, zB, &nB);
+    if( hA!=hB || nA!=nB ){
+        fprintf(stderr, "FAIL: results differ:\n    %s\n    %s\n", zA, zB);
+        exit(1);
+    }
+}
+
+/*
+ ** Return true if the EXPLAIN QUERY PLAN output of zSql contains zText.
+ */
+static int planContains(sqlite3 *db, const char *zSql, const char *zText){
+    sqlite3_stmt *pStmt;
+    char *zExplain = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", zSql);
+    int bFound = 0;
+    if( sqlite3_prepare_v2(db, zExplain, -1, &pStmt, 0) ) fail(db, zExplain);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        const char *zDetail = (const char*)sqlite3_column_text(pStmt, 3);
+        if( zDetail && strstr(zDetail, zText) ) bFound = 1;
+    }
+    sqlite3_finalize(pStmt);
+    sqlite3_free(zExplain);
+    return bFound;
+}
+
+/* Each query is run with its two %s replaced by "t1" and "t2", which
+ ** have no indexes, and by "i1" and "i2", which have an index on each
+ ** join column. */
+static const char *azQuery[] = {
+    "SELECT * FROM %s AS p, %s AS q WHERE p.a=q.x",
+    "SELECT p.b, q.y FROM %s AS p, %s AS q WHERE q.y=p.b",
+    "SELECT * FROM %s AS p, %s AS q WHERE p.a=q.x AND p.b=q.y",
+    "SELECT * FROM %s AS p, %s AS q WHERE p.a=q.x AND p.c>10 AND q.z<50",
+    "SELECT * FROM %s AS p, %s AS q WHERE p.a=q.x AND p.c<q.z",
+    "SELECT * FROM %s AS p, %s AS q WHERE p.u=q.v",
+    "SELECT p.c, q.z FROM %s AS p, %s AS q WHERE p.a=q.x ORDER BY 1, 2",
+    "SELECT * FROM %s AS p CROSS JOIN %s AS q WHERE p.a=q.x",
+};
+
+static const char zData[] =
+    "CREATE TABLE t1(a INTEGER, b TEXT, c, u);"
+    "CREATE TABLE t2(x INTEGER, y TEXT, z, v);"
+    "CREATE TEMP TABLE seq(i INTEGER PRIMARY KEY);"
+    "INSERT INTO seq VALUES(1);"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+    /* Column u has no affinity, so 7, 7.0, '7' and x'37' are distinct
+     ** values there, while 7 and 7.0 are equal in every column. */
+    "INSERT INTO t1 SELECT"
+    "  CASE WHEN i%13 THEN i%700 END,"
+    "  'k' || (i%50),"
+    "  i%100,"
+    "  CASE i%5 WHEN 0 THEN i%40 WHEN 1 THEN (i%40)*1.0"
+    "           WHEN 2 THEN CAST(i%40 AS TEXT) WHEN 3 THEN CAST(i%40 AS BLOB)"
+    "           ELSE NULL END"
+    "  FROM seq WHERE i<=2000;"
+    "INSERT INTO t2 SELECT"
+    "  CASE WHEN i%11 THEN (i*7)%900 END,"
+    "  'k' || (i%60),"
+    "  i%90,"
+    "  CASE i%4 WHEN 0 THEN i%30 WHEN 1 THEN (i%30)*1.0"
+    "           WHEN 2 THEN CAST(i%30 AS TEXT) ELSE CAST(i%30 AS BLOB) END"
+    "  FROM seq WHERE i<=1500;"
+    "INSERT INTO t1 VALUES('7', 7, 7.0, 7);"
+    "INSERT INTO t2 VALUES(7.0, '7', 7, '7');"
+    "CREATE TABLE i1(a INTEGER, b TEXT, c, u);"
+    "CREATE TABLE i2(x INTEGER, y TEXT, z, v);"
+    "INSERT INTO i1 SELECT * FROM t1;"
+    "INSERT INTO i2 SELECT * FROM t2;"
+    "CREATE INDEX i1a ON i1(a);  CREATE INDEX i1b ON i1(b);"
+    "CREATE INDEX i1u ON i1(u);"
+    "CREATE INDEX i2x ON i2(x);  CREATE INDEX i2y ON i2(y);"
+    "CREATE INDEX i2v ON i2(v);"
+    "ANALYZE;";
+
+static void runQueries(sqlite3 *db){
+    int i;
+    for(i=0; i<(int)(sizeof(azQuery)/sizeof(azQuery[0])); i++){
+        char *zHash = sqlite3_mprintf(azQuery[i], "t1", "t2");
+        char *zLoop = sqlite3_mprintf(azQuery[i], "i1", "i2");
+        if( !planContains(db, zHash, "HASH JOIN") ) fail(0, zHash);
+        if( planContains(db, zLoop, "HASH JOIN") ) fail(0, zLoop);
+        checkSame(db, zHash, zLoop);
+        sqlite3_free(zHash);
+        sqlite3_free(zLoop);
+    }
+}
+
+int main(void){
+    sqlite3 *db = 0;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db, zData);
+    runQueries(db);
+
+    /* With a 10 page cache the hash table overflows into a b-tree */
+    run(db, "PRAGMA cache_size=10; PRAGMA temp_store=FILE;");
+    runQueries(db);
+
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
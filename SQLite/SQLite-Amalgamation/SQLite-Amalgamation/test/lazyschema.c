@@ -0,0 +1,140 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that a connection that loads its schema lazily, as enabled by
+ ** sqlite3_lazy_schema(), behaves exactly like one that parses the whole
+ ** schema up front.  The same statements are run against two identical
+ ** database files, one through each kind of connection, and their results
+ ** and error messages are compared.  Build with:
+ **
+ **     gcc -I. -o lazyschema test/lazyschema.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.  It creates and deletes the files "lazy.db" and
+ ** "eager.db" in the current directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+static const char zSchema[] =
+    "PRAGMA foreign_keys=ON;"
+    "CREATE TABLE t1(a INTEGER PRIMARY KEY, b TEXT, c);"
+    "CREATE INDEX t1b ON t1(b);"
+    "CREATE TABLE t2(x PRIMARY KEY, y UNIQUE);"
+    "CREATE TABLE t3(p REFERENCES t1(a), q);"
+    "CREATE TABLE t4(m, n COLLATE nocase, CHECK(m>0));"
+    "CREATE INDEX t4n ON t4(n);"
+    "CREATE TABLE t5(u, v);"
+    "CREATE VIEW v1 AS SELECT a, b, m FROM t1, t4 WHERE a=m;"
+    "CREATE TRIGGER r1 AFTER INSERT ON t5 BEGIN"
+    "  INSERT INTO t4 VALUES(new.u, new.v);"
+    "END;"
+    "INSERT INTO t1 VALUES(1, 'one', 1.5);"
+    "INSERT INTO t1 VALUES(2, 'two', NULL);"
+    "INSERT INTO t4 VALUES(1, 'Alpha');"
+    "INSERT INTO t4 VALUES(2, 'beta');";
+
+/* Each statement is run on both connections, in this order */
+static const char *azStmt[] = {
+    "SELECT * FROM t1 INDEXED BY t1b WHERE b>'a'",
+    "SELECT * FROM t4 WHERE n='ALPHA'",
+    "SELECT * FROM v1",
+    "INSERT INTO t5 VALUES(3, 'gamma')",
+    "SELECT * FROM t4 ORDER BY m",
+    "INSERT INTO t3 VALUES(99, 'no parent')",
+    "INSERT INTO t3 VALUES(1, 'parent')",
+    "INSERT INTO t4 VALUES(0, 'check')",
+    "PRAGMA table_info(t2)",
+    "PRAGMA index_list(t4)",
+    "SELECT * FROM t1 INDEXED BY t4n",
+    "DROP INDEX t4n",
+    "ALTER TABLE t5 ADD COLUMN w DEFAULT 'w'",
+    "SELECT * FROM t5",
+    "CREATE TABLE t6 AS SELECT * FROM t1",
+    "DROP TABLE t2",
+    "SELECT * FROM t2",
+    "PRAGMA integrity_check",
+    "SELECT type, name, tbl_name, sql FROM sqlite_master ORDER BY name",
+};
+
+/*
+ ** Return a hash of the rows returned by zSql and of the error message,
+ ** if any, with which it fails.
+ */
+static sqlite3_uint64 stmtHash(sqlite3 *db, const char *zSql){
+    sqlite3_stmt *pStmt = 0;
+    sqlite3_uint64 h = 0;
+    int rc = sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0);
+    if( rc==SQLITE_OK ){
+        while( (rc = sqlite3_step(pStmt))==SQLITE_ROW ){
+            sqlite3_uint64 r = 14695981039346656037ULL;
+            int i, j;
+            for(i=0; i<sqlite3_column_count(pStmt); i++){
+                const unsigned char *z;
+                int nByte;
+                r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+                z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+                nByte = sqlite3_column_bytes(pStmt, i);
+                for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+            }
+            h += r;
+        }
+        rc = sqlite3_finalize(pStmt);
+    }
+    if( rc!=SQLITE_OK ){
+        const unsigned char *z = (const unsigned char*)sqlite3_errmsg(db);
+        h = (h ^ (sqlite3_uint64)rc) * 1099511628211ULL;
+        while( *z ) h = (h ^ *z++) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static sqlite3 *openDb(const char *zFile, int bLazy){
+    sqlite3 *db = 0;
+    remove(zFile);
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    run(db, zSchema);
+    sqlite3_close(db);
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    if( sqlite3_lazy_schema(db, bLazy)!=SQLITE_OK ) fail(db, "lazy_schema");
+    run(db, "PRAGMA foreign_keys=ON");
+    return db;
+}
+
+int main(void){
+    sqlite3 *dbLazy = openDb("lazy.db", 1);
+    sqlite3 *dbEager = openDb("eager.db", 0);
+    int i;
+
+    for(i=0; i<(int)(sizeof(azStmt)/sizeof(azStmt[0])); i++){
+        if( stmtHash(dbLazy, azStmt[i])!=stmtHash(dbEager, azStmt[i]) ){
+            fail(0, azStmt[i]);
+        }
+    }
+
+    sqlite3_close(dbLazy);
+    sqlite3_close(dbEager);
+    remove("lazy.db");
+    remove("eager.db");
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that a DELETE on a range of rowids, which is coded as a single
+ ** b-tree range delete, leaves the table and the changes() count exactly
+ ** as the ordinary row by row DELETE does.  The optimization is only used
+ ** on tables without indexes, triggers or foreign keys.  The WHERE
+ ** clause of the row by row DELETE is wrapped in "NOT NOT (...)", which
+ ** the range delete optimization does not recognize.  Build with:
+ **
+ **     gcc -I. -o rangedelete test/rangedelete.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Fail unless queries zA and zB return the same rows, in any order.
+ */
+static void checkSame(sqlite3 *db, const char *zA, const char *zB){
+    int nA, nB;
+    sqlite3_uint64 hA = resultHash(db, zA, &nA);
+    sqlite3_uint64 hB = resultHash(db, zB, &nB);
+    if( hA!=hB || nA!=nB ){
+        fprintf(stderr, "FAIL: results differ:\n    %s\n    %s\n", zA, zB);
+        exit(1);
+    }
+}
+
+/*
+ ** Return true if the program of statement zSql contains opcode zOp.
+ */
+static int usesOpcode(sqlite3 *db, const char *zSql, const char *zOp){
+    sqlite3_stmt *pStmt;
+    char *zExplain = sqlite3_mprintf("EXPLAIN %s", zSql);
+    int bFound = 0;
+    if( sqlite3_prepare_v2(db, zExplain, -1, &pStmt, 0) ) fail(db, zExplain);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        if( sqlite3_stricmp((const char*)sqlite3_column_text(pStmt, 1), zOp)==0 ){
+            bFound = 1;
+        }
+    }
+    sqlite3_finalize(pStmt);
+    sqlite3_free(zExplain);
+    return bFound;
+}
+
+static void checkIntegrity(sqlite3 *db){
+    sqlite3_stmt *pStmt;
+    if( sqlite3_prepare_v2(db, "PRAGMA integrity_check", -1, &pStmt, 0) ){
+        fail(db, "integrity_check");
+    }
+    if( sqlite3_step(pStmt)!=SQLITE_ROW
+     || sqlite3_stricmp((const char*)sqlite3_column_text(pStmt, 0), "ok")!=0
+    ){
+        fail(0, "integrity_check");
+    }
+    sqlite3_finalize(pStmt);
+}
+
+/* Each clause is used by the range DELETE on t1 and, wrapped in
+ ** "NOT NOT (...)", by the row by row DELETE on t2. */
+static const char *azWhere[] = {
+    "rowid=7",
+    "a BETWEEN 100 AND 2000",
+    "rowid>=18000",
+    "rowid<50",
+    "a>2500 AND a<=4000 AND a>=3000",
+    "3999<rowid AND 4500>=rowid",
+    "rowid BETWEEN 30000 AND 40000",
+    "rowid>10 AND rowid<5",
+    "rowid<=-1",
+    "rowid>=-9223372036854775808 AND rowid<9223372036854775807 AND rowid<6000",
+};
+
+int main(void){
+    sqlite3 *db = 0;
+    char *zSql;
+    int i;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db,
+        "CREATE TABLE t1(a INTEGER PRIMARY KEY, b, c);"
+        "CREATE TABLE t2(a INTEGER PRIMARY KEY, b, c);"
+        "BEGIN;"
+        "CREATE TEMP TABLE seq(i INTEGER PRIMARY KEY);"
+        "INSERT INTO seq VALUES(1);"
+    );
+    /* 20000 rows.  Every 50th row has a value large enough to need
+     ** overflow pages, which the range delete must also free. */
+    for(i=0; i<15; i++) run(db, "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq");
+    run(db,
+        "INSERT INTO t1 SELECT i, i%97, CASE WHEN i%50==0 THEN zeroblob(5000)"
+        "  ELSE 'row ' || i END FROM seq WHERE i<=20000;"
+        "INSERT INTO t2 SELECT * FROM t1;"
+        "COMMIT;"
+    );
+
+    for(i=0; i<(int)(sizeof(azWhere)/sizeof(azWhere[0])); i++){
+        int nRange, nPlain;
+        zSql = sqlite3_mprintf("DELETE FROM t1 WHERE %s", azWhere[i]);
+        if( !usesOpcode(db, zSql, "DeleteRange") ) fail(0, zSql);
+        run(db, zSql);
+        sqlite3_free(zSql);
+        nRange = sqlite3_changes(db);
+        zSql = sqlite3_mprintf("DELETE FROM t2 WHERE NOT NOT (%s)", azWhere[i]);
+        if( usesOpcode(db, zSql, "DeleteRange") ) fail(0, zSql);
+        run(db, zSql);
+        sqlite3_free(zSql);
+        nPlain = sqlite3_changes(db);
+        if( nRange!=nPlain ) fail(0, azWhere[i]);
+        checkSame(db, "SELECT * FROM t1", "SELECT * FROM t2");
+        checkIntegrity(db);
+    }
+
+    /* A range delete that is rolled back leaves the table unchanged */
+    run(db, "BEGIN; DELETE FROM t1 WHERE rowid>=1; ROLLBACK;");
+    checkSame(db, "SELECT * FROM t1", "SELECT * FROM t2");
+    checkIntegrity(db);
+
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
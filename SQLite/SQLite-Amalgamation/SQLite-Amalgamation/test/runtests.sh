@@ -0,0 +1,42 @@
+#!/bin/sh
+#
+# Build each test program in this directory against an amalgamation and
+# run it.  Every program prints "ok" and exits with status 0 on success.
+#
+# Usage, from the directory that holds sqlite3.h:
+#
+#     sh test/runtests.sh PATH/TO/sqlite3.c ?CFLAGS...?
+#
+# Extra arguments are passed to the compiler, for example
+# -DSQLITE_ENABLE_COMPUTED_GOTO to run the tests against that build.
+# test/dispatchbench.c is a benchmark, not a test, and is skipped.
+#
+if [ $# -lt 1 ] || [ ! -f "$1" ]; then
+    echo "usage: sh test/runtests.sh PATH/TO/sqlite3.c ?CFLAGS...?" >&2
+    exit 2
+fi
+AMALG=$1
+shift
+CC=${CC:-gcc}
+OUT=${TMPDIR:-/tmp}/sqlite-tests.$$
+mkdir -p "$OUT" || exit 2
+trap 'rm -rf "$OUT"' 0
+
+$CC -O2 -I. "$@" -c -o "$OUT/sqlite3.o" "$AMALG" || exit 1
+
+nfail=0
+ntest=0
+for src in test/*.c; do
+    name=`basename "$src" .c`
+    [ "$name" = dispatchbench ] && continue
+    ntest=`expr $ntest + 1`
+    if $CC -O2 -I. "$@" -o "$OUT/$name" "$src" "$OUT/sqlite3.o" \
+        -lpthread -ldl -lm && (cd "$OUT" && "./$name"); then
+        echo "$name: ok"
+    else
+        echo "$name: FAILED"
+        nfail=`expr $nfail + 1`
+    fi
+done
+echo "$nfail errors out of $ntest tests"
+[ $nfail -eq 0 ]
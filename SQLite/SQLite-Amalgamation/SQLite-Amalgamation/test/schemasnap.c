@@ -0,0 +1,157 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that a connection that builds its schema from a process-wide
+ ** schema snapshot ends up with the same schema as one that parses the
+ ** CREATE statements in sqlite_master: after the snapshot is first made,
+ ** after another connection changes the schema, after sqlite_master is
+ ** edited with PRAGMA writable_schema without changing the schema cookie,
+ ** and after sqlite3_reset_schema_snapshots().  Build with:
+ **
+ **     gcc -I. -o schemasnap test/schemasnap.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.  It creates and deletes the file "schemasnap.db"
+ ** in the current directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+static const char zFile[] = "schemasnap.db";
+
+/* Queries whose results depend on every part of the schema */
+static const char *azQuery[] = {
+    "SELECT type, name, tbl_name, sql FROM sqlite_master",
+    "PRAGMA table_info(t1)",
+    "PRAGMA table_info(t2)",
+    "PRAGMA index_list(t1)",
+    "PRAGMA index_info(t1b)",
+    "SELECT * FROM v1",
+    "SELECT name FROM sqlite_master WHERE name='t3'",
+};
+
+/*
+ ** Open a new connection to zFile, make a change through it to show that
+ ** its triggers work, and return a hash of the results of azQuery[].  The
+ ** change is rolled back before the connection is closed.
+ */
+static sqlite3_uint64 schemaHash(void){
+    sqlite3 *db = 0;
+    sqlite3_uint64 h = 0;
+    int i;
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    run(db, "BEGIN; INSERT INTO t1(a, b) VALUES(100, 'trigger');");
+    for(i=0; i<(int)(sizeof(azQuery)/sizeof(azQuery[0])); i++){
+        int nRow;
+        h = h*1099511628211ULL + resultHash(db, azQuery[i], &nRow) + nRow;
+    }
+    run(db, "ROLLBACK");
+    if( sqlite3_close(db) ) fail(db, "close");
+    return h;
+}
+
+/*
+ ** Return the hash that schemaHash() returns once every snapshot has been
+ ** discarded, so that the schema is parsed from sqlite_master.
+ */
+static sqlite3_uint64 parsedHash(void){
+    sqlite3_reset_schema_snapshots();
+    return schemaHash();
+}
+
+static void check(const char *zWhat){
+    /* The first connection after a change must not use a snapshot of the
+     ** old schema.  It may make a new one, which the second then uses. */
+    sqlite3_uint64 hFirst = schemaHash();
+    sqlite3_uint64 hSecond = schemaHash();
+    sqlite3_uint64 hParsed = parsedHash();
+    if( hFirst!=hParsed || hSecond!=hParsed ) fail(0, zWhat);
+}
+
+int main(void){
+    sqlite3 *db = 0;
+
+    remove(zFile);
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    run(db,
+        "CREATE TABLE t1(a INTEGER PRIMARY KEY, b TEXT COLLATE nocase, c DEFAULT 5);"
+        "CREATE INDEX t1b ON t1(b, c DESC);"
+        "CREATE TABLE t2(p, q);"
+        "CREATE VIEW v1 AS SELECT a, b, p FROM t1, t2 WHERE a=p;"
+        "CREATE TRIGGER r1 AFTER INSERT ON t1 BEGIN"
+        "  INSERT INTO t2 VALUES(new.a, new.b);"
+        "END;"
+        "INSERT INTO t1(a, b) VALUES(1, 'one');"
+    );
+    sqlite3_close(db);
+    check("initial schema");
+
+    /* Another connection changes the schema */
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    run(db, "CREATE TABLE t3(x UNIQUE)");
+    sqlite3_close(db);
+    check("schema change");
+
+    /* Edit sqlite_master without changing the schema cookie.  The
+     ** snapshot made for the old content must not be used. */
+    if( sqlite3_open(zFile, &db) ) fail(db, "open");
+    run(db,
+        "PRAGMA writable_schema=ON;"
+        "UPDATE sqlite_master SET sql='CREATE TABLE t2(p, qq)' WHERE name='t2';"
+        "PRAGMA writable_schema=OFF;"
+    );
+    sqlite3_close(db);
+    check("writable_schema edit");
+
+    sqlite3_reset_schema_snapshots();
+    remove(zFile);
+    printf("ok\n");
+    return 0;
+}
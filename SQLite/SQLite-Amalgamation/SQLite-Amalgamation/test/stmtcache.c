@@ -0,0 +1,185 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks the prepared statement cache enabled by sqlite3_stmt_cache():
+ ** a statement prepared again after sqlite3_finalize() comes from the
+ ** cache with its bindings cleared and returns the same rows as on a
+ ** connection without the cache, a statement invalidated by a schema
+ ** change is compiled again, the cache is limited to N statements, and
+ ** cached statements do not keep sqlite3_close() from succeeding.  Build with:
+ **
+ **     gcc -I. -o stmtcache test/stmtcache.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Fail unless queries zA and zB return the same rows, in any order.
+ */
+static void checkSame(sqlite3 *db, const char *zA, const char *zB){
+    int nA, nB;
+    sqlite3_uint64 hA = resultHash(db, zA, &nA);
+    sqlite3_uint64 hB = resultHash(db, zB, &nB);
+    if( hA!=hB || nA!=nB ){
+        fprintf(stderr, "FAIL: results differ:\n    %s\n    %s\n", zA, zB);
+        exit(1);
+    }
+}
+
+/*
+ ** Return the current value of sqlite3_db_status() verb op.
+ */
+static int cacheStat(sqlite3 *db, int op){
+    int iCur = 0, iHigh = 0;
+    if( sqlite3_db_status(db, op, &iCur, &iHigh, 0) ) fail(db, "db_status");
+    return iCur;
+}
+
+static const char *azQuery[] = {
+    "SELECT x, y FROM t WHERE x>10",
+    "SELECT count(*), sum(x) FROM t",
+    "SELECT y, count(*) FROM t GROUP BY y",
+};
+
+static const char zSchema[] =
+    "CREATE TABLE t(x, y);"
+    "INSERT INTO t VALUES(1, 'one');"
+    "INSERT INTO t SELECT x+1, y FROM t;"
+    "INSERT INTO t SELECT x+2, 'three' FROM t;"
+    "INSERT INTO t SELECT x+4, y FROM t;"
+    "INSERT INTO t SELECT x+8, 'nine' FROM t;"
+    "INSERT INTO t SELECT x+16, y FROM t;";
+
+int main(void){
+    sqlite3 *db = 0;
+    sqlite3 *db2 = 0;
+    sqlite3_stmt *pStmt;
+    sqlite3_stmt *pFirst;
+    int nHit, nMiss;
+    int i;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    if( sqlite3_open(":memory:", &db2) ) fail(db2, "open");
+    run(db, zSchema);
+    run(db2, zSchema);
+    if( sqlite3_stmt_cache(db, 4)!=SQLITE_OK ) fail(db, "stmt_cache");
+
+    /* Each query is compiled once and then found in the cache, and returns
+     ** the same rows as on the connection without a cache. */
+    nHit = cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_HIT);
+    nMiss = cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_MISS);
+    for(i=0; i<3; i++){
+        checkSame(db, azQuery[i], azQuery[i]);
+        checkSame(db, azQuery[i], azQuery[i]);
+    }
+    for(i=0; i<3; i++){
+        int nRow;
+        sqlite3_uint64 h = resultHash(db2, azQuery[i], &nRow);
+        int nRow2;
+        if( resultHash(db, azQuery[i], &nRow2)!=h || nRow!=nRow2 ){
+            fail(0, azQuery[i]);
+        }
+    }
+    if( cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_MISS)-nMiss!=3 ) fail(0, "misses");
+    if( cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_HIT)-nHit!=12 ) fail(0, "hits");
+
+    /* A cached statement is returned with its bindings cleared */
+    if( sqlite3_prepare_v2(db, "SELECT ?1 IS NULL", -1, &pStmt, 0) ) fail(db, "prepare");
+    sqlite3_bind_int(pStmt, 1, 5);
+    if( sqlite3_step(pStmt)!=SQLITE_ROW || sqlite3_column_int(pStmt, 0)!=0 ){
+        fail(db, "bound value");
+    }
+    pFirst = pStmt;
+    sqlite3_finalize(pStmt);
+    if( sqlite3_next_stmt(db, 0)!=0 ) fail(0, "cached statement is listed");
+    nHit = cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_HIT);
+    if( sqlite3_prepare_v2(db, "SELECT ?1 IS NULL", -1, &pStmt, 0) ) fail(db, "prepare");
+    if( cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_HIT)!=nHit+1 || pStmt!=pFirst ){
+        fail(0, "statement not cached");
+    }
+    if( sqlite3_step(pStmt)!=SQLITE_ROW || sqlite3_column_int(pStmt, 0)!=1 ){
+        fail(db, "binding survived the cache");
+    }
+    sqlite3_finalize(pStmt);
+
+    /* A schema change invalidates the cached statements */
+    if( sqlite3_prepare_v2(db, "SELECT * FROM t", -1, &pStmt, 0) ) fail(db, "prepare");
+    sqlite3_finalize(pStmt);
+    run(db, "ALTER TABLE t ADD COLUMN z DEFAULT 7");
+    nMiss = cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_MISS);
+    if( sqlite3_prepare_v2(db, "SELECT * FROM t", -1, &pStmt, 0) ) fail(db, "prepare");
+    if( cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_MISS)!=nMiss+1 ){
+        fail(0, "stale statement returned");
+    }
+    if( sqlite3_column_count(pStmt)!=3 ) fail(0, "stale column count");
+    sqlite3_finalize(pStmt);
+
+    /* No more than N statements are kept */
+    for(i=0; i<10; i++){
+        char *zSql = sqlite3_mprintf("SELECT %d", i);
+        if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+        sqlite3_finalize(pStmt);
+        sqlite3_free(zSql);
+    }
+    if( cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_USED)!=4 ) fail(0, "cache size");
+    if( sqlite3_stmt_cache(db, 2)!=SQLITE_OK
+     || cacheStat(db, SQLITE_DBSTATUS_STMTCACHE_USED)!=2
+    ){
+        fail(0, "cache not reduced");
+    }
+
+    if( sqlite3_close(db)!=SQLITE_OK ) fail(0, "close with cached statements");
+    sqlite3_close(db2);
+    printf("ok\n");
+    return 0;
+}
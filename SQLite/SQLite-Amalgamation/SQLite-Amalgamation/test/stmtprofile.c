@@ -0,0 +1,92 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that per-instruction profiling enabled by sqlite3_stmt_profile()
+ ** survives the automatic re-prepare of a statement after a schema change.
+ ** Build with:
+ **
+ **     gcc -I. -o stmtprofile test/stmtprofile.c sqlite3.c
+ **
+ ** where sqlite3.c is the amalgamation of the sources in src/, or run all
+ ** of the programs in this directory with test/runtests.sh.  The program
+ ** prints "ok" and exits with status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Step pStmt to completion and reset it.
+ */
+static void runStmt(sqlite3 *db, sqlite3_stmt *pStmt){
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){}
+    if( sqlite3_reset(pStmt)!=SQLITE_OK ) fail(db, "reset");
+}
+
+/*
+ ** Return the total execution count recorded for the statement with SQL
+ ** text zSql.
+ */
+static sqlite3_int64 totalExec(sqlite3 *db, const char *zSql){
+    sqlite3_stmt *pQuery;
+    sqlite3_int64 n = -1;
+    if( sqlite3_prepare_v2(db,
+                "SELECT total(nexec) FROM temp.prof WHERE sql=?", -1, &pQuery, 0) ){
+        fail(db, "prepare profile query");
+    }
+    sqlite3_bind_text(pQuery, 1, zSql, -1, SQLITE_STATIC);
+    if( sqlite3_step(pQuery)==SQLITE_ROW ){
+        n = sqlite3_column_int64(pQuery, 0);
+    }
+    sqlite3_finalize(pQuery);
+    return n;
+}
+
+int main(void){
+    static const char zSql[] = "SELECT x FROM t1";
+    sqlite3 *db = 0;
+    sqlite3_stmt *pStmt = 0;
+    sqlite3_int64 nBefore;
+    
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db, "CREATE TABLE t1(x); INSERT INTO t1 VALUES(1); INSERT INTO t1 VALUES(2);");
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, "prepare");
+    if( sqlite3_stmt_profile(pStmt, 1)!=SQLITE_OK ) fail(db, "stmt_profile");
+    run(db, "CREATE VIRTUAL TABLE temp.prof USING stmt_profile");
+    runStmt(db, pStmt);
+    nBefore = totalExec(db, zSql);
+    if( nBefore<=0 ) fail(0, "no statistics before the schema change");
+    
+    /* Expire pStmt.  The next sqlite3_step() re-prepares it. */
+    run(db, "CREATE TABLE t2(y)");
+    runStmt(db, pStmt);
+    if( sqlite3_stmt_profile(pStmt, -1)!=1 ){
+        fail(0, "profiling switched off by re-prepare");
+    }
+    if( totalExec(db, zSql)<=0 ){
+        fail(0, "no statistics after re-prepare");
+    }
+    
+    sqlite3_finalize(pStmt);
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
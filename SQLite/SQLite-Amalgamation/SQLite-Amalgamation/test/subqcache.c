@@ -0,0 +1,218 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks the correlated subquery result cache enabled by
+ ** sqlite3_subquery_cache().  Each subquery calls the application-defined
+ ** function cnt(), which counts how many times the subquery runs.  With
+ ** the cache enabled a subquery must run once for each distinct key and
+ ** return the same rows as with the cache disabled.  A subquery that
+ ** calls random() or a date and time function, or that runs inside a
+ ** statement that writes to the database, must run once for each outer
+ ** row.  Build with:
+ **
+ **     gcc -I. -o subqcache test/subqcache.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+/*
+ ** Return a hash of the rows returned by zSql that does not depend on
+ ** their order, and write the number of rows to *pnRow.
+ */
+static sqlite3_uint64 resultHash(sqlite3 *db, const char *zSql, int *pnRow){
+    sqlite3_stmt *pStmt;
+    sqlite3_uint64 h = 0;
+    int n = 0;
+    if( sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0) ) fail(db, zSql);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        sqlite3_uint64 r = 14695981039346656037ULL;
+        int i, j;
+        for(i=0; i<sqlite3_column_count(pStmt); i++){
+            const unsigned char *z;
+            int nByte;
+            r = (r ^ (sqlite3_uint64)sqlite3_column_type(pStmt, i)) * 1099511628211ULL;
+            z = (const unsigned char*)sqlite3_column_blob(pStmt, i);
+            nByte = sqlite3_column_bytes(pStmt, i);
+            for(j=0; j<nByte; j++) r = (r ^ z[j]) * 1099511628211ULL;
+        }
+        h += r;
+        n++;
+    }
+    if( sqlite3_finalize(pStmt) ) fail(db, zSql);
+    *pnRow = n;
+    return h;
+}
+
+/*
+ ** Return true if the program of statement zSql contains opcode zOp.
+ */
+static int usesOpcode(sqlite3 *db, const char *zSql, const char *zOp){
+    sqlite3_stmt *pStmt;
+    char *zExplain = sqlite3_mprintf("EXPLAIN %s", zSql);
+    int bFound = 0;
+    if( sqlite3_prepare_v2(db, zExplain, -1, &pStmt, 0) ) fail(db, zExplain);
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+        if( sqlite3_stricmp((const char*)sqlite3_column_text(pStmt, 1), zOp)==0 ){
+            bFound = 1;
+        }
+    }
+    sqlite3_finalize(pStmt);
+    sqlite3_free(zExplain);
+    return bFound;
+}
+
+/*
+ ** Implementation of cnt(X).  Return X and increment the counter passed
+ ** as the user data of the function.
+ */
+static void cntFunc(sqlite3_context *ctx, int argc, sqlite3_value **argv){
+    int *pnCall = (int*)sqlite3_user_data(ctx);
+    (void)argc;
+    (*pnCall)++;
+    sqlite3_result_value(ctx, argv[0]);
+}
+
+static int nCall = 0;
+
+/*
+ ** Run zSql with a subquery result cache of nCache results and return
+ ** the number of calls made to cnt().  Fail if the statement does not use
+ ** the cache when it should, or if its results differ from those of
+ ** zSql with the cache disabled.
+ */
+static int runCached(sqlite3 *db, const char *zSql, int nCache){
+    sqlite3_uint64 hPlain, hCached;
+    int nPlain, nCached, nRow;
+
+    if( sqlite3_subquery_cache(db, 0) ) fail(db, "subquery_cache");
+    if( usesOpcode(db, zSql, "MemoLookup") ) fail(0, zSql);
+    nCall = 0;
+    hPlain = resultHash(db, zSql, &nRow);
+    nPlain = nCall;
+
+    if( sqlite3_subquery_cache(db, nCache) ) fail(db, "subquery_cache");
+    nCall = 0;
+    hCached = resultHash(db, zSql, &nCached);
+    if( hCached!=hPlain || nCached!=nRow ){
+        fprintf(stderr, "FAIL: results differ with the cache: %s\n", zSql);
+        exit(1);
+    }
+    if( nCall>nPlain ) fail(0, zSql);
+    return nCall;
+}
+
+int main(void){
+    sqlite3 *db = 0;
+    const char *zSql;
+    int n;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    if( sqlite3_create_function(db, "cnt", 1, SQLITE_UTF8, &nCall,
+                                cntFunc, 0, 0) ){
+        fail(db, "create_function");
+    }
+    /* 1000 rows in t1.  Column b has 50 distinct values in no particular
+     ** order, and column d has 50 distinct values in runs of 20 rows. */
+    run(db,
+        "CREATE TABLE t1(a INTEGER PRIMARY KEY, b INTEGER, d INTEGER, c);"
+        "CREATE TABLE t2(x INTEGER, y);"
+        "CREATE INDEX t2x ON t2(x);"
+        "CREATE TEMP TABLE seq(i INTEGER PRIMARY KEY);"
+        "INSERT INTO seq VALUES(1);"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO seq SELECT i+(SELECT max(i) FROM seq) FROM seq;"
+        "INSERT INTO t1 SELECT i, (i*37)%50, (i-1)/20, NULL"
+        "  FROM seq WHERE i<=1000;"
+        "INSERT INTO t2 SELECT i%60, 'y' || i FROM seq WHERE i<=600;"
+    );
+
+    /* A scalar subquery runs once for each of the 50 keys */
+    zSql = "SELECT a, (SELECT cnt(max(y)) FROM t2 WHERE t2.x=t1.b) FROM t1";
+    if( sqlite3_subquery_cache(db, 100) ) fail(db, "subquery_cache");
+    if( !usesOpcode(db, zSql, "MemoLookup") ) fail(0, zSql);
+    n = runCached(db, zSql, 100);
+    if( n!=50 ) fail(0, zSql);
+
+    /* So does an EXISTS subquery that stops at its first row */
+    zSql = "SELECT a FROM t1"
+           " WHERE EXISTS(SELECT 1 FROM t2 WHERE t2.x=t1.b AND cnt(y)>'y3')";
+    n = runCached(db, zSql, 100);
+    if( n<50 || n>600 ) fail(0, zSql);
+
+    /* The key holds every outer column the subquery refers to, and each
+     ** column only once */
+    zSql = "SELECT a, (SELECT cnt(count(*)) FROM t2"
+           "  WHERE t2.x>=t1.b AND t2.x<t1.d) FROM t1";
+    n = runCached(db, zSql, 1000);
+    if( n!=1000 ) fail(0, zSql);
+    zSql = "SELECT a, (SELECT cnt(count(*)) FROM t2"
+           "  WHERE t2.x>=t1.d AND t2.x<t1.d+3) FROM t1";
+    n = runCached(db, zSql, 1000);
+    if( n!=50 ) fail(0, zSql);
+
+    /* A cache smaller than the number of keys discards the least recently
+     ** used results.  Column b cycles through its 50 values, so every
+     ** lookup misses, while for the runs of column d one result is enough. */
+    zSql = "SELECT a, (SELECT cnt(max(y)) FROM t2 WHERE t2.x=t1.b) FROM t1";
+    n = runCached(db, zSql, 10);
+    if( n!=1000 ) fail(0, zSql);
+    zSql = "SELECT a, (SELECT cnt(max(y)) FROM t2 WHERE t2.x=t1.d) FROM t1";
+    n = runCached(db, zSql, 1);
+    if( n!=50 ) fail(0, zSql);
+
+    /* Subqueries that call volatile functions are not cached */
+    zSql = "SELECT a, (SELECT cnt(max(y)) + random()*0 FROM t2"
+           "  WHERE t2.x=t1.b) FROM t1";
+    if( sqlite3_subquery_cache(db, 100) ) fail(db, "subquery_cache");
+    if( usesOpcode(db, zSql, "MemoLookup") ) fail(0, zSql);
+    n = runCached(db, zSql, 100);
+    if( n!=1000 ) fail(0, zSql);
+    zSql = "SELECT a, (SELECT cnt(max(y)) FROM t2"
+           "  WHERE t2.x=t1.b AND datetime('now') IS NOT NULL) FROM t1";
+    if( usesOpcode(db, zSql, "MemoLookup") ) fail(0, zSql);
+    n = runCached(db, zSql, 100);
+    if( n!=1000 ) fail(0, zSql);
+
+    /* The cache is bypassed in a statement that writes to the database */
+    if( sqlite3_subquery_cache(db, 100) ) fail(db, "subquery_cache");
+    nCall = 0;
+    run(db, "UPDATE t1 SET c=(SELECT cnt(max(y)) FROM t2 WHERE t2.x=t1.b)");
+    if( nCall!=1000 ) fail(0, "UPDATE");
+    resultHash(db, "SELECT a FROM t1"
+                   " WHERE c IS NOT (SELECT max(y) FROM t2 WHERE t2.x=t1.b)", &n);
+    if( n!=0 ) fail(0, "UPDATE results");
+
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ ** 2013 November 6
+ **
+ ** The author disclaims copyright to this source code.  In place of
+ ** a legal notice, here is a blessing:
+ **
+ **    May you do good and not evil.
+ **    May you find forgiveness for yourself and forgive others.
+ **    May you share freely, never taking more than you give.
+ **
+ *************************************************************************
+ **
+ ** Checks that with zero-copy access enabled by sqlite3_stmt_zerocopy(),
+ ** sqlite3_column_blob(), sqlite3_column_text(), sqlite3_column_bytes()
+ ** and sqlite3_column_text_nocopy() return the same values as on a
+ ** statement without it, for short values borrowed from the page, long
+ ** values that spill onto overflow pages, multi-byte UTF-8 text and
+ ** values of other types.  Build with:
+ **
+ **     gcc -I. -o zerocopy test/zerocopy.c sqlite3.c
+ **
+ ** or run test/runtests.sh.  The program prints "ok" and exits with
+ ** status 0 on success.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sqlite3.h"
+
+static void fail(sqlite3 *db, const char *zWhat){
+    fprintf(stderr, "FAIL: %s: %s\n", zWhat, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void run(sqlite3 *db, const char *zSql){
+    if( sqlite3_exec(db, zSql, 0, 0, 0)!=SQLITE_OK ) fail(db, zSql);
+}
+
+static const char zQuery[] = "SELECT i, t, b, t FROM t ORDER BY rowid";
+
+int main(void){
+    sqlite3 *db = 0;
+    sqlite3_stmt *pZero;
+    sqlite3_stmt *pCopy;
+    sqlite3_stmt *pWrite;
+    int nRow = 0;
+    int i;
+
+    if( sqlite3_open(":memory:", &db) ) fail(db, "open");
+    run(db,
+        "CREATE TABLE t(i, t TEXT, b BLOB);"
+        "INSERT INTO t VALUES(1, 'short', x'0102030405');"
+        "INSERT INTO t VALUES(2, '', x'');"
+        "INSERT INTO t VALUES(3, 'gr\xc3\xbc\xc3\x9f \xe2\x82\xac', x'00ff00');"
+        "INSERT INTO t VALUES(4, NULL, NULL);"
+        "INSERT INTO t VALUES(5, 12345, 6.5);"
+        "INSERT INTO t VALUES(6, substr(quote(zeroblob(4000)), 3, 8000),"
+        "                        zeroblob(9000));"
+        "INSERT INTO t VALUES('seven', 'last', x'07');"
+    );
+
+    if( sqlite3_prepare_v2(db, zQuery, -1, &pZero, 0) ) fail(db, "prepare");
+    if( sqlite3_prepare_v2(db, zQuery, -1, &pCopy, 0) ) fail(db, "prepare");
+    if( sqlite3_stmt_zerocopy(pZero, 1)!=1 ) fail(0, "zerocopy not enabled");
+    if( sqlite3_stmt_zerocopy(pCopy, -1)!=0 ) fail(0, "zerocopy on by default");
+
+    /* Zero-copy access is refused for statements that write */
+    if( sqlite3_prepare_v2(db, "INSERT INTO t VALUES(8, 'x', 'y')", -1, &pWrite, 0) ){
+        fail(db, "prepare");
+    }
+    if( sqlite3_stmt_zerocopy(pWrite, 1)!=0 ) fail(0, "zerocopy on a write");
+    sqlite3_finalize(pWrite);
+
+    while( sqlite3_step(pZero)==SQLITE_ROW ){
+        if( sqlite3_step(pCopy)!=SQLITE_ROW ) fail(0, "row count");
+        nRow++;
+        for(i=0; i<3; i++){
+            int eType = sqlite3_column_type(pZero, i);
+            int nNoCopy = -1;
+            const char *zNoCopy = sqlite3_column_text_nocopy(pZero, i, &nNoCopy);
+            const void *pA = sqlite3_column_blob(pZero, i);
+            int nA = sqlite3_column_bytes(pZero, i);
+            const void *pB = sqlite3_column_blob(pCopy, i);
+            int nB = sqlite3_column_bytes(pCopy, i);
+            if( nA!=nB || (nA>0 && memcmp(pA, pB, nA)!=0) ){
+                fail(0, "column_blob differs");
+            }
+
+            /* Text is returned in place, so reading it again as a blob
+             ** returns the same pointer */
+            if( eType==SQLITE_TEXT && nA>0 && zNoCopy!=pA ){
+                fail(0, "column_text_nocopy copied text");
+            }
+            if( (zNoCopy==0)!=(sqlite3_column_text(pCopy, i)==0)
+             || nNoCopy!=sqlite3_column_bytes(pCopy, i)
+             || (nNoCopy>0 && memcmp(zNoCopy, sqlite3_column_text(pCopy, i), nNoCopy))
+            ){
+                fail(0, "column_text_nocopy differs");
+            }
+        }
+        
+        /* Column 3 is read as terminated text first */
+        {
+            const char *zA = (const char*)sqlite3_column_text(pZero, 3);
+            const char *zB = (const char*)sqlite3_column_text(pCopy, 3);
+            if( (zA==0)!=(zB==0) || (zA && strcmp(zA, zB)!=0) ){
+                fail(0, "column_text differs");
+            }
+            if( zA && (int)strlen(zA)!=sqlite3_column_bytes(pZero, 3) ){
+                fail(0, "column_text not terminated");
+            }
+        }
+    }
+    if( sqlite3_step(pCopy)!=SQLITE_DONE || nRow!=7 ) fail(0, "row count");
+
+    sqlite3_finalize(pZero);
+    sqlite3_finalize(pCopy);
+    sqlite3_close(db);
+    printf("ok\n");
+    return 0;
+}